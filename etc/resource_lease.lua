@@ -0,0 +1,21 @@
+-- KEYS[1]: resource key
+-- ARGV: node_id, lease_size, limit
+-- grants the lease block to the node if it fits into the limit
+-- together with the usage of all nodes.
+-- the check and the increment are done atomically to not exceed the limit
+-- on the concurrent renewals from the several nodes
+-- returns: {granted, total usage before the grant}
+
+local total = 0
+for i,v in ipairs(redis.call('HVALS',KEYS[1])) do
+    total = total + tonumber(v)
+end
+
+local lease_size = tonumber(ARGV[2])
+if total + lease_size > tonumber(ARGV[3]) then
+    return {0, total}
+end
+
+redis.call('HINCRBY',KEYS[1],ARGV[1],lease_size)
+
+return {1, total}
@@ -0,0 +1,129 @@
+#include "AdmissionControl.h"
+#include "cfg/yeti_opts.h"
+#include "AmUtils.h"
+#include "AmSession.h"
+#include "log.h"
+#include "sip/defs.h"
+
+#include <algorithm>
+
+#define LATENCY_EWMA_ALPHA 0.2
+#define LIMIT_DECREASE_FACTOR 0.9
+
+AdmissionControl::AdmissionControl()
+  : enabled(false),
+    target_latency_ms(500),
+    min_limit(10),
+    max_limit(1000),
+    reply_code(503),
+    reply_reason("Service Unavailable"),
+    retry_after(0),
+    active_requests(0),
+    limit(max_limit),
+    latency_ewma_ms(0),
+    shed_count(stat_group(Counter, "yeti", "admission_control_shed").addAtomicCounter()),
+    limit_decreases(stat_group(Counter, "yeti", "admission_control_limit_decreases").addAtomicCounter())
+{}
+
+int AdmissionControl::configure(cfg_t *routing_sec)
+{
+    cfg_t *sec = cfg_getsec(routing_sec, section_name_admission_control);
+    if(!sec) return 0;
+
+    AmLock l(mutex);
+
+    enabled = cfg_getbool(sec, opt_admission_control_enabled);
+    target_latency_ms = cfg_getint(sec, opt_admission_control_target_latency);
+    min_limit = cfg_getint(sec, opt_admission_control_min_active_requests);
+    max_limit = cfg_getint(sec, opt_admission_control_max_active_requests);
+    reply_code = cfg_getint(sec, opt_admission_control_reply_code);
+    reply_reason = cfg_getstr(sec, opt_admission_control_reply_reason);
+    retry_after = cfg_getint(sec, opt_admission_control_retry_after);
+
+    if(!min_limit) min_limit = 1;
+    if(max_limit < min_limit) {
+        ERROR("admission_control: %s(%u) is less than %s(%u)",
+              opt_admission_control_max_active_requests, max_limit,
+              opt_admission_control_min_active_requests, min_limit);
+        return -1;
+    }
+    if(reply_code < 300 || reply_code > 699) {
+        ERROR("admission_control: invalid %s %u",
+              opt_admission_control_reply_code, reply_code);
+        return -1;
+    }
+
+    reply_hdrs.clear();
+    if(retry_after)
+        reply_hdrs = "Retry-After: " + int2str(retry_after) + CRLF;
+
+    limit = max_limit;
+
+    if(enabled) {
+        INFO("admission_control: target_latency:%ums, limits:%u-%u, reply: %u %s",
+             target_latency_ms, min_limit, max_limit,
+             reply_code, reply_reason.data());
+    }
+
+    return 0;
+}
+
+bool AdmissionControl::admit()
+{
+    if(!enabled) return true;
+
+    AmLock l(mutex);
+    if(active_requests < static_cast<unsigned int>(limit))
+        return true;
+
+    shed_count.inc();
+    return false;
+}
+
+void AdmissionControl::onRequestStarted()
+{
+    AmLock l(mutex);
+    active_requests++;
+}
+
+void AdmissionControl::onRequestFinished(long latency_ms)
+{
+    AmLock l(mutex);
+
+    if(active_requests) active_requests--;
+
+    if(latency_ms < 0) return;
+
+    latency_ewma_ms = latency_ewma_ms ?
+        latency_ewma_ms + LATENCY_EWMA_ALPHA * (latency_ms - latency_ewma_ms) :
+        latency_ms;
+
+    if(static_cast<unsigned long>(latency_ms) > target_latency_ms) {
+        auto new_limit = std::max<double>(min_limit, limit * LIMIT_DECREASE_FACTOR);
+        if(new_limit < limit) {
+            limit = new_limit;
+            limit_decreases.inc();
+        }
+    } else {
+        limit = std::min<double>(max_limit, limit + 1 / limit);
+    }
+}
+
+void AdmissionControl::getState(AmArg &ret)
+{
+    AmLock l(mutex);
+
+    ret["enabled"] = enabled;
+    ret["target_latency"] = target_latency_ms;
+    ret["min_active_requests"] = min_limit;
+    ret["max_active_requests"] = max_limit;
+    ret["limit"] = static_cast<unsigned int>(limit);
+    ret["active_requests"] = active_requests;
+    ret["latency_ewma"] = latency_ewma_ms;
+    ret["sessions"] = static_cast<int>(AmSession::getSessionNum());
+    ret["shed"] = static_cast<unsigned int>(shed_count.get());
+    ret["limit_decreases"] = static_cast<unsigned int>(limit_decreases.get());
+    ret["reply_code"] = reply_code;
+    ret["reply_reason"] = reply_reason;
+    ret["retry_after"] = retry_after;
+}
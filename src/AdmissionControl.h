@@ -0,0 +1,61 @@
+#pragma once
+
+#include "AmArg.h"
+#include "AmThread.h"
+#include "AmStatistics.h"
+#include "confuse.h"
+
+#include <string>
+
+using std::string;
+
+/* INVITEs admission based on the routing (getprofile) requests backlog
+ *
+ * keeps AIMD limit for the in-flight getprofile requests:
+ *  - multiplicative decrease when request latency exceeds target_latency
+ *  - additive increase (about +1 per limit completions) otherwise
+ * new INVITEs are rejected by SBCFactory::onInvite before the leg creation
+ * while in-flight requests count reaches the limit.
+ * limit never drops below min_active_requests so completions keep probing
+ * the routing DB latency */
+class AdmissionControl
+{
+    AmMutex mutex;
+
+    bool enabled;
+    unsigned int target_latency_ms;
+    unsigned int min_limit;
+    unsigned int max_limit;
+    unsigned int reply_code;
+    string reply_reason;
+    unsigned int retry_after;
+    string reply_hdrs;
+
+    unsigned int active_requests;
+    double limit;
+    double latency_ewma_ms;
+
+    AtomicCounter &shed_count;
+    AtomicCounter &limit_decreases;
+
+  public:
+    AdmissionControl();
+
+    int configure(cfg_t *routing_sec);
+
+    bool isEnabled() const { return enabled; }
+
+    /* false if the new INVITE must be rejected
+     * with getReplyCode/getReplyReason/getReplyHeaders */
+    bool admit();
+
+    void onRequestStarted();
+    //latency_ms < 0 for requests finished without the DB reply
+    void onRequestFinished(long latency_ms);
+
+    unsigned int getReplyCode() const { return reply_code; }
+    const string &getReplyReason() const { return reply_reason; }
+    const string &getReplyHeaders() const { return reply_hdrs; }
+
+    void getState(AmArg &ret);
+};
@@ -0,0 +1,149 @@
+#include "AorLookupCache.h"
+#include "log.h"
+
+#include <cstdlib>
+
+AorLookupCache::AorLookupCache()
+  : enabled(false),
+    ready(false),
+    ttl(60),
+    generation(0),
+    hits(stat_group(Counter, "yeti", "aor_cache_hits").addAtomicCounter()),
+    misses(stat_group(Counter, "yeti", "aor_cache_misses").addAtomicCounter()),
+    invalidations(stat_group(Counter, "yeti", "aor_cache_invalidations").addAtomicCounter())
+{}
+
+void AorLookupCache::configure(bool in_enabled, std::chrono::seconds in_ttl)
+{
+    AmLock l(mutex);
+    enabled = in_enabled;
+    ttl = in_ttl;
+}
+
+void AorLookupCache::setReady(bool in_ready)
+{
+    AmLock l(mutex);
+    if(ready == in_ready) return;
+
+    DBG("AoR lookup cache %s", in_ready ? "is ready" : "is not ready. clear");
+
+    ready = in_ready;
+    generation++;
+    entries.clear();
+}
+
+bool AorLookupCache::checkNotifyKeyspaceEvents(const string &flags)
+{
+    //'E' - keyevent events, 'A' - alias for "g$lshzxet"
+    if(flags.find('E') == string::npos)
+        return false;
+    if(flags.find('A') != string::npos)
+        return true;
+    return flags.find('h') != string::npos && //hset
+           flags.find('g') != string::npos && //del
+           flags.find('x') != string::npos;   //expired
+}
+
+bool AorLookupCache::lookup(
+    const std::set<int> &aor_ids, AorsMap &aors,
+    std::chrono::steady_clock::time_point now)
+{
+    if(!enabled) return false;
+
+    AmLock l(mutex);
+
+    if(!ready) return false;
+
+    for(const auto &id : aor_ids) {
+        auto it = entries.find(id);
+        if(it == entries.end() || it->second.expire_at <= now) {
+            aors.clear();
+            misses.inc();
+            return false;
+        }
+        if(!it->second.bindings.empty())
+            aors.emplace(id, it->second.bindings);
+    }
+
+    hits.inc();
+    return true;
+}
+
+AorLookupCache::LookupRequest *AorLookupCache::createLookupRequest(const std::set<int> &aor_ids)
+{
+    if(!enabled) return nullptr;
+
+    AmLock l(mutex);
+    return new LookupRequest(aor_ids, generation);
+}
+
+void AorLookupCache::update(
+    const LookupRequest &request, const AorsMap &aors,
+    std::chrono::steady_clock::time_point now)
+{
+    AmLock l(mutex);
+
+    if(!ready || request.generation != generation) {
+        DBG("AoR lookup cache was invalidated during the request. skip update");
+        return;
+    }
+
+    const auto expire_at = now + ttl;
+    for(const auto &id : request.aor_ids) {
+        auto &e = entries[id];
+        e.expire_at = expire_at;
+
+        auto it = aors.find(id);
+        if(it != aors.end()) e.bindings = it->second;
+        else e.bindings.clear();
+    }
+}
+
+void AorLookupCache::invalidate(int auth_id)
+{
+    invalidations.inc();
+
+    AmLock l(mutex);
+    generation++;
+    entries.erase(auth_id);
+}
+
+void AorLookupCache::invalidateKey(const char *key)
+{
+    if(!enabled) return;
+
+    if((key[0] != 'c' && key[0] != 'a') || key[1] != ':')
+        return;
+
+    char *end;
+    long id = strtol(key + 2, &end, 10);
+    if(end == key + 2 || (*end != ':' && *end != '\0'))
+        return;
+
+    invalidate(static_cast<int>(id));
+}
+
+void AorLookupCache::clear()
+{
+    AmLock l(mutex);
+    generation++;
+    entries.clear();
+}
+
+void AorLookupCache::getStats(AmArg &ret)
+{
+    auto hits_count = hits.get();
+    auto misses_count = misses.get();
+
+    ret["enabled"] = enabled;
+    ret["hits"] = static_cast<unsigned int>(hits_count);
+    ret["misses"] = static_cast<unsigned int>(misses_count);
+    ret["hit_ratio"] = hits_count + misses_count ?
+        static_cast<double>(hits_count) / (hits_count + misses_count) : 0.0;
+    ret["invalidations"] = static_cast<unsigned int>(invalidations.get());
+
+    AmLock l(mutex);
+    ret["ready"] = ready;
+    ret["ttl"] = static_cast<int>(ttl.count());
+    ret["entries"] = static_cast<unsigned int>(entries.size());
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "AmArg.h"
+#include "AmThread.h"
+#include "AmStatistics.h"
+
+#include <chrono>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+using std::string;
+
+/* local cache for the registered AoRs lookup (auth_id -> contacts and paths)
+ *
+ * filled from the aor_lookup.lua replies and invalidated by auth_id from the
+ * registrar keyspace events subscription:
+ *   hset on the contact key (new/refreshed binding),
+ *   del/expired on the contact key or on the auth_id set key.
+ * not registered auth_ids are cached as entries without bindings.
+ *
+ * replies are not cached if any invalidation happened
+ * after the request was sent (see LookupRequest::generation).
+ * cache is not used until the subscription is confirmed
+ * and the server notify-keyspace-events config is checked,
+ * it is cleared on the subscription connection loss */
+class AorLookupCache
+{
+  public:
+    struct Binding {
+        string contact;
+        string path;
+        Binding(const char *contact, const char *path)
+          : contact(contact),
+            path(path)
+        {}
+    };
+    using Bindings = std::list<Binding>;
+    using AorsMap = std::map<int, Bindings>;
+
+    //attached to the aor_lookup.lua request as user_data
+    struct LookupRequest
+      : public AmObject
+    {
+        std::set<int> aor_ids;
+        uint64_t generation;
+        LookupRequest(const std::set<int> &aor_ids, uint64_t generation)
+          : aor_ids(aor_ids),
+            generation(generation)
+        {}
+    };
+
+  private:
+    struct Entry {
+        Bindings bindings;
+        std::chrono::steady_clock::time_point expire_at;
+    };
+
+    AmMutex mutex;
+
+    bool enabled;
+    bool ready;
+    std::chrono::seconds ttl;
+    uint64_t generation;
+    std::unordered_map<int, Entry> entries;
+
+    AtomicCounter &hits;
+    AtomicCounter &misses;
+    AtomicCounter &invalidations;
+
+  public:
+    AorLookupCache();
+
+    void configure(bool enabled, std::chrono::seconds ttl);
+    bool isEnabled() const { return enabled; }
+
+    //subscription state
+    void setReady(bool ready);
+
+    /* true if notify-keyspace-events config value enables keyevent
+     * notifications for all the commands used for invalidation */
+    static bool checkNotifyKeyspaceEvents(const string &flags);
+
+    /* returns true and fills 'aors' with the registered ones
+     * if all 'aor_ids' are cached */
+    bool lookup(
+        const std::set<int> &aor_ids, AorsMap &aors,
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    //nullptr if cache is disabled
+    LookupRequest *createLookupRequest(const std::set<int> &aor_ids);
+
+    void update(
+        const LookupRequest &request, const AorsMap &aors,
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    void invalidate(int auth_id);
+    //'c:<auth_id>:<contact>' or 'a:<auth_id>' keys from keyspace events
+    void invalidateKey(const char *key);
+    void clear();
+
+    void getStats(AmArg &ret);
+};
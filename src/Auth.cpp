@@ -6,6 +6,7 @@
 #include "md5.h"
 #include "AmUriParser.h"
 #include "yeti.h"
+#include "db/DbHelpers.h"
 
 #include <unistd.h>
 
@@ -45,6 +46,26 @@ void Auth::CredentialsContainer::add(
     const std::string &password)
 {
     emplace(username,cred(id,username,password));
+    usernames.emplace(id, username);
+}
+
+void Auth::CredentialsContainer::remove(auth_id_type id)
+{
+    auto ids_range = usernames.equal_range(id);
+    for(auto ids_it = ids_range.first; ids_it != ids_range.second; ++ids_it) {
+        auto range = equal_range(ids_it->second);
+        for(auto it = range.first; it != range.second;) {
+            if(it->second.id == id) it = erase(it);
+            else ++it;
+        }
+    }
+    usernames.erase(id);
+}
+
+void Auth::CredentialsContainer::swap(CredentialsContainer &other)
+{
+    std::unordered_multimap<std::string, struct cred>::swap(other);
+    usernames.swap(other.usernames);
 }
 
 Auth::Auth()
@@ -115,6 +136,29 @@ void Auth::reload_credentials(const AmArg &data)
     credentials.swap(c);
 }
 
+void Auth::apply_credentials_changes(const AmArg &data)
+{
+    if(!isArgArray(data))
+        return;
+
+    AmLock l(credentials_mutex);
+
+    for(size_t i = 0; i < data.size(); i++)
+        credentials.remove(data[i]["id"].asInt());
+
+    for(size_t i = 0; i < data.size(); i++) {
+        auto &a = data[i];
+        if(DbAmArg_hash_get_bool(a, "deleted", false))
+            continue;
+        credentials.add(a["id"].asInt(),
+                        a["username"].asCStr(),
+                        a["password"].asCStr());
+    }
+
+    DBG("applied %zd credentials changes. %zd items",
+        data.size(), credentials.size());
+}
+
 Auth::auth_id_type Auth::check_request_auth(const AmSipRequest &req,  AmArg &ret)
 {
     string auth_hdr =  getHeader(req.hdrs, SIP_HDR_AUTHORIZATION);
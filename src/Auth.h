@@ -38,7 +38,12 @@ class Auth {
     struct CredentialsContainer
       : public std::unordered_multimap<std::string, struct cred>
     {
+        //usernames by auth_id for the incremental updates
+        std::unordered_multimap<auth_id_type, std::string> usernames;
+
         void add(auth_id_type id, const std::string &username, const std::string &password);
+        void remove(auth_id_type id);
+        void swap(CredentialsContainer &other);
     } credentials;
     AmMutex credentials_mutex;
 
@@ -55,6 +60,10 @@ class Auth {
     void auth_info_by_id(auth_id_type id, AmArg &ret);
 
     void reload_credentials(const AmArg &data);
+    /* apply changes from load_incoming_auth_changes().
+     * rows: id, username, password, deleted.
+     * all credentials for the changed ids are replaced by the non-deleted rows */
+    void apply_credentials_changes(const AmArg &data);
 
     /**
     * @brief check_request_auth
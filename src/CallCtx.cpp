@@ -3,6 +3,7 @@
 #include "SqlRouter.h"
 #include "AmSession.h"
 #include "sip/defs.h"
+#include "AmStatistics.h"
 
 
 int fake_logger::log(const char* buf, int len,
@@ -38,6 +39,75 @@ int fake_logger::relog(msg_logger *logger){
         cstring(),code);
 }
 
+namespace {
+
+struct CallCtxArenaCounters {
+	AtomicCounter &allocations;
+	AtomicCounter &allocated_bytes;
+	AtomicCounter &upstream_allocations;
+	AtomicCounter &upstream_bytes;
+
+	CallCtxArenaCounters()
+	  : allocations(stat_group(Counter, "yeti", "call_ctx_arena_allocations").addAtomicCounter()),
+		allocated_bytes(stat_group(Counter, "yeti", "call_ctx_arena_allocated_bytes").addAtomicCounter()),
+		upstream_allocations(stat_group(Counter, "yeti", "call_ctx_arena_upstream_allocations").addAtomicCounter()),
+		upstream_bytes(stat_group(Counter, "yeti", "call_ctx_arena_upstream_bytes").addAtomicCounter())
+	{}
+};
+
+CallCtxArenaCounters &arena_counters()
+{
+	static CallCtxArenaCounters counters;
+	return counters;
+}
+
+/* heap fallback for the arenas exhausted the inline buffer */
+class CountingUpstreamResource
+  : public std::pmr::memory_resource
+{
+  protected:
+	void *do_allocate(size_t bytes, size_t alignment) override
+	{
+		auto &c = arena_counters();
+		c.upstream_allocations.inc();
+		c.upstream_bytes.inc(bytes);
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+	void do_deallocate(void *p, size_t bytes, size_t alignment) override
+	{
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+std::pmr::memory_resource *arena_upstream()
+{
+	static CountingUpstreamResource upstream;
+	return &upstream;
+}
+
+} //namespace
+
+CallCtxArena::CallCtxArena()
+  : arena(initial_buffer, sizeof(initial_buffer), arena_upstream())
+{}
+
+void *CallCtxArena::do_allocate(size_t bytes, size_t alignment)
+{
+	auto &c = arena_counters();
+	c.allocations.inc();
+	c.allocated_bytes.inc(bytes);
+	return arena.allocate(bytes, alignment);
+}
+
+void CallCtxArena::do_deallocate(void *, size_t, size_t)
+{
+	//monotonic. memory is released with the arena
+}
+
 SqlCallProfile *CallCtx::getFirstProfile()
 {
     //DBG("%s() this = %p",FUNC_NAME,this);
@@ -151,6 +221,7 @@ vector<SdpMedia> &CallCtx::get_other_negotiated_media(bool a_leg){
 
 CallCtx::CallCtx(SqlRouter &router):
 	references(0),
+	profiles(&arena),
 	initial_invite(NULL),
 	SQLexception(false),
 	on_hold(false),
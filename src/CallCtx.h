@@ -1,6 +1,7 @@
 #pragma once
 
 #include <list>
+#include <memory_resource>
 
 #include "sip/sip_parser.h"
 #include "AmThread.h"
@@ -22,14 +23,43 @@ class fake_logger: public msg_logger {
     int relog(msg_logger *logger);
 };
 
+#define CALL_CTX_ARENA_INITIAL_SIZE 16384
+
+/* per-call monotonic arena for the routing state
+ * (profiles list nodes and profiles resources lists).
+ * served from the inline buffer first and released at once with CallCtx.
+ * not thread-safe. allocations are guarded by SBCCallLeg::call_ctx_mutex */
+class CallCtxArena
+  : public std::pmr::memory_resource
+{
+	alignas(std::max_align_t) char initial_buffer[CALL_CTX_ARENA_INITIAL_SIZE];
+	std::pmr::monotonic_buffer_resource arena;
+
+  protected:
+	void *do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+  public:
+	CallCtxArena();
+	CallCtxArena(const CallCtxArena &) = delete;
+	CallCtxArena& operator=(const CallCtxArena &) = delete;
+};
+
 struct CallCtx
 {
 	//instead of atomic_int. guarded by SBCCallLeg::call_ctx_mutex
 	unsigned int references;
 
+	//must be declared before the containers using it
+	CallCtxArena arena;
+
 	std::unique_ptr<Cdr> cdr;
-	list<SqlCallProfile> profiles;
-	list<SqlCallProfile>::iterator current_profile;
+	std::pmr::list<SqlCallProfile> profiles;
+	std::pmr::list<SqlCallProfile>::iterator current_profile;
 	AmSipRequest *initial_invite;
 	vector<SdpMedia> aleg_negotiated_media;
 	vector<SdpMedia> bleg_negotiated_media;
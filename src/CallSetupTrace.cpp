@@ -0,0 +1,200 @@
+#include "CallSetupTrace.h"
+#include "stats/StatsRegistry.h"
+#include "cfg/yeti_opts.h"
+
+#include "log.h"
+
+#include <algorithm>
+
+CallSetupTrace::CallSetupTrace()
+  : origin_time(0),
+    finish_us(unset)
+{
+    std::fill(std::begin(begin_us), std::end(begin_us), unset);
+    std::fill(std::begin(end_us), std::end(end_us), unset);
+}
+
+uint32_t CallSetupTrace::now_offset() const
+{
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+        clock::now() - origin).count();
+    if(us < 0) return 0;
+    if(us >= unset) return unset - 1;
+    return static_cast<uint32_t>(us);
+}
+
+void CallSetupTrace::start()
+{
+    origin = clock::now();
+    origin_time = time(nullptr);
+}
+
+void CallSetupTrace::finish()
+{
+    if(!isStarted() || isFinished()) return;
+    finish_us = now_offset();
+}
+
+void CallSetupTrace::begin(Stage stage)
+{
+    if(!isStarted() || isFinished()) return;
+    if(begin_us[stage] == unset)
+        begin_us[stage] = now_offset();
+}
+
+void CallSetupTrace::end(Stage stage)
+{
+    if(!isStarted() || isFinished()) return;
+    if(begin_us[stage] != unset)
+        end_us[stage] = now_offset();
+}
+
+int64_t CallSetupTrace::getStageDuration(Stage stage) const
+{
+    if(begin_us[stage] == unset || end_us[stage] == unset)
+        return -1;
+    return static_cast<int64_t>(end_us[stage]) - begin_us[stage];
+}
+
+int64_t CallSetupTrace::getStageBegin(Stage stage) const
+{
+    if(begin_us[stage] == unset) return -1;
+    return begin_us[stage];
+}
+
+int64_t CallSetupTrace::getTotal() const
+{
+    if(!isFinished()) return -1;
+    return finish_us;
+}
+
+const char *CallSetupTrace::getStageName(Stage stage)
+{
+    static const char *names[] = {
+        "pre_auth",
+        "digest_auth",
+        "identity_certs",
+        "getprofile",
+        "radius_auth",
+        "aor_lookup",
+        "resources_check",
+        "sdp_processing"
+    };
+    static_assert(sizeof(names)/sizeof(names[0]) == MaxStage,
+                  "stages names mismatch");
+    return names[stage];
+}
+
+void CallSetupTrace::getInfo(AmArg &ret) const
+{
+    ret.assertStruct();
+    ret["start_time"] = static_cast<long long>(origin_time);
+    ret["total_us"] = static_cast<long long>(getTotal());
+
+    auto &stages = ret["stages"];
+    stages.assertStruct();
+    for(int i = 0; i < MaxStage; i++) {
+        auto stage = static_cast<Stage>(i);
+        auto duration = getStageDuration(stage);
+        if(duration < 0) continue;
+        auto &s = stages[getStageName(stage)];
+        s["offset_us"] = static_cast<long long>(getStageBegin(stage));
+        s["duration_us"] = static_cast<long long>(duration);
+    }
+}
+
+CallSetupTraceCollector::CallSetupTraceCollector()
+  : enabled(true),
+    sampling(0),
+    traces_count(0),
+    total_latency(StatsRegistry::instance()->histogram(
+        "call_setup_total", "time from the INVITE arrival to the first B-leg INVITE")),
+    samples_next(0),
+    samples_size(0)
+{
+    auto &registry = *StatsRegistry::instance();
+    for(int i = 0; i < CallSetupTrace::MaxStage; i++) {
+        string name(CallSetupTrace::getStageName(static_cast<CallSetupTrace::Stage>(i)));
+        stages_latency[i] = &registry.histogram(
+            "call_setup_" + name, "call setup stage '" + name + "' duration");
+    }
+}
+
+int CallSetupTraceCollector::configure(cfg_t *yeti_cfg)
+{
+    cfg_t *sec = cfg_getsec(yeti_cfg, section_name_call_setup_trace);
+    if(!sec) return 0;
+
+    auto sampling_cfg = cfg_getint(sec, opt_call_setup_trace_sampling);
+    auto samples_cfg = cfg_getint(sec, opt_call_setup_trace_samples);
+    if(sampling_cfg < 0 || samples_cfg < 0) {
+        ERROR("call_setup_trace: negative %s or %s",
+              opt_call_setup_trace_sampling, opt_call_setup_trace_samples);
+        return -1;
+    }
+
+    configure(cfg_getbool(sec, opt_call_setup_trace_enabled),
+              static_cast<unsigned int>(sampling_cfg),
+              static_cast<size_t>(samples_cfg));
+
+    if(enabled && sampling && samples_size) {
+        INFO("call_setup_trace: keep every %u trace. ring buffer size: %zd",
+             sampling, samples_size);
+    }
+
+    return 0;
+}
+
+void CallSetupTraceCollector::configure(bool in_enabled, unsigned int in_sampling, size_t in_samples_size)
+{
+    enabled = in_enabled;
+    sampling = in_sampling;
+
+    AmLock l(samples_mutex);
+    samples_size = in_samples_size;
+    samples.clear();
+    samples.reserve(samples_size);
+    samples_next = 0;
+}
+
+void CallSetupTraceCollector::record(const CallSetupTrace &trace, const string &local_tag)
+{
+    if(!enabled || !trace.isFinished()) return;
+
+    for(int i = 0; i < CallSetupTrace::MaxStage; i++) {
+        auto duration = trace.getStageDuration(static_cast<CallSetupTrace::Stage>(i));
+        if(duration >= 0)
+            stages_latency[i]->record(static_cast<uint64_t>(duration));
+    }
+    total_latency.record(static_cast<uint64_t>(trace.getTotal()));
+
+    if(!sampling || !samples_size) return;
+    if(traces_count.fetch_add(1, std::memory_order_relaxed) % sampling) return;
+
+    AmLock l(samples_mutex);
+    if(samples.size() < samples_size) {
+        samples.push_back({ local_tag, trace });
+    } else {
+        auto &s = samples[samples_next];
+        s.local_tag = local_tag;
+        s.trace = trace;
+    }
+    samples_next = (samples_next + 1) % samples_size;
+}
+
+void CallSetupTraceCollector::getSamples(AmArg &ret)
+{
+    ret.assertArray();
+
+    AmLock l(samples_mutex);
+
+    //samples_next points to the oldest entry once the buffer is full
+    size_t start = samples.size() < samples_size ? 0 : samples_next;
+    for(size_t i = 0; i < samples.size(); i++) {
+        auto &s = samples[(start + i) % samples.size()];
+        ret.push(AmArg());
+        auto &a = ret.back();
+        s.trace.getInfo(a);
+        a["local_tag"] = s.local_tag;
+    }
+}
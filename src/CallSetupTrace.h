@@ -0,0 +1,106 @@
+#pragma once
+
+#include "AmArg.h"
+#include "AmThread.h"
+#include "stats/LatencyHistogram.h"
+
+#include <confuse.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+using std::string;
+
+/* per-call timestamps of the call setup stages
+ * between the initial INVITE arrival and the first B-leg INVITE.
+ *
+ * stores fixed-size arrays of monotonic offsets from the INVITE arrival
+ * and does not allocate, so it is cheap to keep in every call leg */
+class CallSetupTrace {
+  public:
+    enum Stage {
+        PreAuth = 0,
+        DigestAuth,
+        IdentityCerts,
+        GetProfile,
+        RadiusAuth,
+        AorLookup,
+        ResourcesCheck,
+        SdpProcessing,
+        MaxStage
+    };
+
+    using clock = std::chrono::steady_clock;
+    static const uint32_t unset = UINT32_MAX;
+
+  private:
+    clock::time_point origin;
+    time_t origin_time;
+    uint32_t begin_us[MaxStage];
+    uint32_t end_us[MaxStage];
+    uint32_t finish_us;
+
+    uint32_t now_offset() const;
+
+  public:
+    CallSetupTrace();
+
+    //INVITE arrival
+    void start();
+    //first B-leg INVITE. stage marks are ignored after it
+    void finish();
+
+    //the first begin and the last end are kept for the repeated stages
+    void begin(Stage stage);
+    void end(Stage stage);
+
+    bool isStarted() const { return origin_time != 0; }
+    bool isFinished() const { return finish_us != unset; }
+
+    //microseconds. -1 if the stage was not passed completely
+    int64_t getStageDuration(Stage stage) const;
+    int64_t getStageBegin(Stage stage) const;
+    int64_t getTotal() const;
+
+    static const char *getStageName(Stage stage);
+
+    void getInfo(AmArg &ret) const;
+};
+
+/* aggregates finished traces into the per-stage histograms
+ * and keeps every Nth trace in the ring buffer for 'show stats call_setup' */
+class CallSetupTraceCollector {
+    struct sample {
+        string local_tag;
+        CallSetupTrace trace;
+    };
+
+    bool enabled;
+    unsigned int sampling;
+    std::atomic<uint64_t> traces_count;
+
+    LatencyHistogram *stages_latency[CallSetupTrace::MaxStage];
+    LatencyHistogram &total_latency;
+
+    AmMutex samples_mutex;
+    std::vector<sample> samples;
+    size_t samples_next;
+    size_t samples_size;
+
+  public:
+    CallSetupTraceCollector();
+
+    int configure(cfg_t *yeti_cfg);
+    void configure(bool enabled, unsigned int sampling, size_t samples_size);
+
+    bool isEnabled() const { return enabled; }
+
+    void record(const CallSetupTrace &trace, const string &local_tag);
+
+    //sampled traces. the oldest first
+    void getSamples(AmArg &ret);
+};
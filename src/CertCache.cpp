@@ -229,11 +229,7 @@ void CertCache::processHttpReply(const HttpGetResponseEvent& resp)
 
 bool CertCache::isTrustedRepositoryUnsafe(const string &url)
 {
-    for(const auto &r: trusted_repositories) {
-        if(std::regex_match(url, r.regex))
-            return true;
-    }
-    return false;
+    return trusted_repositories_matcher.match(url);
 }
 
 void CertCache::renewCertEntry(HashType::value_type &entry)
@@ -278,13 +274,16 @@ void CertCache::reloadTrustedRepositories(const AmArg &data)
 {
     AmLock l(mutex);
     trusted_repositories.clear();
+    trusted_repositories_matcher.clear();
     if(!isArgArray(data)) return;
     for(size_t i = 0; i < data.size(); i++) {
         AmArg &a = data[i];
         try {
+            string url_pattern = a["url_pattern"].asCStr();
+            trusted_repositories_matcher.add(url_pattern);
             trusted_repositories.emplace_back(
                 a["id"].asInt(),
-                a["url_pattern"].asCStr(),
+                url_pattern,
                 a["validate_https_certificate"].asBool());
         } catch(std::regex_error& e) {
             ERROR("CertCache row regex_error: %s", e.what());
@@ -8,6 +8,7 @@
 #include "db/DbConfig.h"
 #include "cfg/YetiCfg.h"
 #include "DbConfigStates.h"
+#include "TrustedRepositoryMatcher.h"
 
 #include "confuse.h"
 
@@ -16,7 +17,6 @@
 #include <botan/pkcs8.h>
 
 #include <unordered_map>
-#include <regex>
 
 using namespace std;
 
@@ -115,18 +115,17 @@ class CertCache
         unsigned long id;
         string url_pattern;
         bool validate_https_certificate;
-        std::regex regex;
             TrustedRepositoryEntry(
             unsigned long id,
             string url_pattern,
             bool validate_https_certificate)
           : id(id),
             url_pattern(url_pattern),
-            validate_https_certificate(validate_https_certificate),
-            regex(url_pattern)
+            validate_https_certificate(validate_https_certificate)
         {}
     };
     vector<TrustedRepositoryEntry> trusted_repositories;
+    TrustedRepositoryMatcher trusted_repositories_matcher;
 
     bool isTrustedRepositoryUnsafe(const string &url);
     void renewCertEntry(HashType::value_type &entry);
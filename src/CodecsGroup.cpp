@@ -108,9 +108,21 @@ bool CodecsGroupEntry::add_codec(string c, string sdp_params, int dyn_payload_id
 	}
 
 	codecs_payloads.push_back(p);
+
+	string name = p.encoding_name;
+	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+	auto id = static_cast<unsigned int>(names_ids.size());
+	codecs_ids.push_back(names_ids.emplace(std::move(name), id).first->second);
+
 	return true;
 }
 
+unsigned int CodecsGroupEntry::get_codec_id(const string &lowercased_name) const
+{
+	auto it = names_ids.find(lowercased_name);
+	return it == names_ids.end() ? CODEC_ID_UNKNOWN : it->second;
+}
+
 void CodecsGroupEntry::getConfig(AmArg &ret) const {
 	vector<SdpPayload>::const_iterator it = codecs_payloads.begin();
 	for(;it!=codecs_payloads.end();++it){
@@ -131,7 +143,7 @@ int CodecsGroups::configure(AmConfigReader & )
 
 void CodecsGroups::load_codecs(const AmArg &data)
 {
-	map<unsigned int,CodecsGroupEntry> _m;
+	map<unsigned int,std::shared_ptr<CodecsGroupEntry>> _m;
 
 	if(isArgArray(data)) {
 		for(size_t i = 0; i < data.size(); i++) {
@@ -160,6 +172,6 @@ void CodecsGroups::GetConfig(AmArg& ret) {
 	AmArg &groups = ret["groups"];
 	AmLock l(codec_groups_mutex);
 	for(const auto &g : codec_groups) {
-		g.second.getConfig(groups[int2str(g.first)]);
+		g.second->getConfig(groups[int2str(g.first)]);
 	}
 }
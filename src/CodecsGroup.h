@@ -11,27 +11,45 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <unordered_map>
 using namespace std;
 
 #define NO_DYN_PAYLOAD -1
+//id of the codec name which is absent in the group
+#define CODEC_ID_UNKNOWN (~0u)
 
 struct CodecsGroupException : public InternalException {
 	CodecsGroupException(unsigned int code,unsigned int codecs_group);
 };
 
+/* lowercased encoding names of the group codecs are interned on load
+ * to the dense ids [0, get_codecs_ids_count()).
+ * SDP payloads are matched by the ids instead of the names comparison */
 class CodecsGroupEntry {
 	vector<SdpPayload> codecs_payloads;
+	//codec name ids in the same order as codecs_payloads
+	vector<unsigned int> codecs_ids;
+	unordered_map<string, unsigned int> names_ids;
   public:
 	CodecsGroupEntry();
 	~CodecsGroupEntry(){}
 	bool add_codec(string codec,string sdp_params, int dyn_payload_id);
-	vector<SdpPayload> &get_payloads() { return codecs_payloads; }
+	const vector<SdpPayload> &get_payloads() const { return codecs_payloads; }
+	const vector<unsigned int> &get_payloads_ids() const { return codecs_ids; }
+	//CODEC_ID_UNKNOWN if the group has no codec with the lowercased name
+	unsigned int get_codec_id(const string &lowercased_name) const;
+	size_t get_codecs_ids_count() const { return names_ids.size(); }
 	void getConfig(AmArg &ret) const;
 };
 
+using CodecsGroupEntryPtr = std::shared_ptr<const CodecsGroupEntry>;
+
 class CodecsGroups {
 	static CodecsGroups* _instance;
-	map<unsigned int,CodecsGroupEntry> codec_groups;
+	/* entries are immutable after loading and shared with the callers.
+	 * reload replaces the whole map */
+	map<unsigned int,std::shared_ptr<CodecsGroupEntry>> codec_groups;
 	AmMutex codec_groups_mutex;
 
   public:
@@ -47,7 +65,7 @@ class CodecsGroups {
 	int configure(AmConfigReader &cfg);
 	void load_codecs(const AmArg &data);
 
-	void get(int group_id, CodecsGroupEntry &e)
+	CodecsGroupEntryPtr get(int group_id)
 	{
 		AmLock l(codec_groups_mutex);
 		auto  i = codec_groups.find(group_id);
@@ -55,17 +73,26 @@ class CodecsGroups {
 			ERROR("can't find codecs group %d",group_id);
 			throw CodecsGroupException(FC_CG_GROUP_NOT_FOUND,group_id);
 		}
-		e = i->second;
+		return i->second;
 	}
 
 	bool insert(
-		map<unsigned int,CodecsGroupEntry> &dst,
+		map<unsigned int,std::shared_ptr<CodecsGroupEntry>> &dst,
 		unsigned int group_id,
 		string codec,
 		string sdp_params,
 		int dyn_payload_id = NO_DYN_PAYLOAD)
 	{
-		return dst[group_id].add_codec(codec,sdp_params,dyn_payload_id);
+		auto &e = dst[group_id];
+		if(!e) e = std::make_shared<CodecsGroupEntry>();
+		return e->add_codec(codec,sdp_params,dyn_payload_id);
+	}
+
+	//exchanges the loaded groups with 'groups'. allows to save and restore the state
+	void swap(map<unsigned int,std::shared_ptr<CodecsGroupEntry>> &groups)
+	{
+		AmLock l(codec_groups_mutex);
+		codec_groups.swap(groups);
 	}
 
 	void clear(){ codec_groups.clear(); }
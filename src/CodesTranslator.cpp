@@ -19,8 +19,27 @@ InternalException::InternalException(unsigned int code, int override_id):
 	);
 }
 
+CodesTranslator::stats::stats()
+  : unknown_response_codes(StatsRegistry::instance()->counter("translator_unknown_response_codes")),
+	missed_response_configs(StatsRegistry::instance()->counter("translator_missed_response_configs")),
+	unknown_internal_codes(StatsRegistry::instance()->counter("translator_unknown_internal_codes"))
+{}
+
+void CodesTranslator::stats::clear()
+{
+	unknown_response_codes.reset();
+	missed_response_configs.reset();
+	unknown_internal_codes.reset();
+}
+
+void CodesTranslator::stats::get(AmArg &arg)
+{
+	arg["unknown_code_resolves"] = (long)unknown_response_codes.get();
+	arg["missed_response_configs"] = (long)missed_response_configs.get();
+	arg["unknown_internal_codes"] = (long)unknown_internal_codes.get();
+}
+
 CodesTranslator::CodesTranslator(){
-	stat.clear();
 }
 
 CodesTranslator::~CodesTranslator(){
@@ -276,7 +295,7 @@ void CodesTranslator::rewrite_response(
 			code,treason.c_str(),
 			out_code,out_reason.c_str());
 	} else {
-		stat.unknown_response_codes++;
+		stat.unknown_response_codes.inc();
 		DBG("no translation for response with code '%d'. leave it 'as is'",code);
 		out_code = code;
 		out_reason = reason;
@@ -313,7 +332,7 @@ bool CodesTranslator::stop_hunting(unsigned int code,int override_id)
 		ret = it->second.is_stop_hunting;
 		DBG("stop_hunting = %d for code '%d'",ret,code);
 	} else {
-		stat.missed_response_configs++;
+		stat.missed_response_configs.inc();
 		DBG("no preference for code '%d', so simply stop hunting",code);
 	}
 	return ret;
@@ -378,7 +397,7 @@ bool CodesTranslator::translate_db_code(
 
 	const auto it = icode2resp.find(code);
 	if(it==icode2resp.end()) {
-		stat.unknown_internal_codes++;
+		stat.unknown_internal_codes.inc();
 		DBG("no translation for db code '%d'. reply with 500",code);
 		internal_code = response_code = 500;
 		internal_reason = "Internal code "+int2str(code);
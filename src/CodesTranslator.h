@@ -6,6 +6,7 @@
 #include "AmArg.h"
 #include <map>
 #include "db/DbConfig.h"
+#include "stats/StatsRegistry.h"
 
 //fail codes for TS
 #define	FC_PARSE_FROM_FAILED		114
@@ -111,20 +112,13 @@ class CodesTranslator {
 	Icode2RespOverridesContainer icode2resp_overrides;
 	AmMutex icode2resp_mutex;
 
-	struct {
-		unsigned int unknown_response_codes;
-		unsigned int missed_response_configs;
-		unsigned int unknown_internal_codes;
-		void clear(){
-			unknown_response_codes = 0;
-			missed_response_configs = 0;
-			unknown_internal_codes = 0;
-		}
-		void get(AmArg &arg){
-			arg["unknown_code_resolves"] = (long)unknown_response_codes;
-			arg["missed_response_configs"] = (long)missed_response_configs;
-			arg["unknown_internal_codes"] = (long)unknown_internal_codes;
-		}
+	struct stats {
+		ShardedCounter &unknown_response_codes;
+		ShardedCounter &missed_response_configs;
+		ShardedCounter &unknown_internal_codes;
+		stats();
+		void clear();
+		void get(AmArg &arg);
 	} stat;
 
 	bool apply_internal_code_translation(
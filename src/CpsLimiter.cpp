@@ -0,0 +1,267 @@
+#include "CpsLimiter.h"
+#include "cfg/yeti_opts.h"
+#include "AmUtils.h"
+#include "log.h"
+#include "sip/defs.h"
+#include "sip/ip_util.h"
+
+#include <netinet/in.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+bool CpsLimiter::Key::fromAddr(const sockaddr_storage &addr, Key &key)
+{
+    switch(addr.ss_family) {
+    case AF_INET: {
+        uint32_t a;
+        memcpy(&a, &reinterpret_cast<const sockaddr_in &>(addr).sin_addr, sizeof(a));
+        key.hi = 0;
+        key.lo = 0xffff00000000ULL | ntohl(a);
+    } return true;
+    case AF_INET6: {
+        const auto &a = reinterpret_cast<const sockaddr_in6 &>(addr).sin6_addr;
+        memcpy(&key.hi, a.s6_addr, sizeof(key.hi));
+        memcpy(&key.lo, a.s6_addr + sizeof(key.hi), sizeof(key.lo));
+    } return true;
+    default:
+        return false;
+    }
+}
+
+bool CpsLimiter::Key::fromString(const string &ip, Key &key)
+{
+    sockaddr_storage addr;
+    memset(&addr, 0, sizeof(sockaddr_storage));
+    if(!am_inet_pton(ip.c_str(), &addr))
+        return false;
+    return fromAddr(addr, key);
+}
+
+uint64_t CpsLimiter::Key::hash() const
+{
+    //splitmix64 finalizer over the folded address
+    uint64_t h = hi * 0x9e3779b97f4a7c15ULL ^ lo;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+/* check() may be called with the timestamp taken before the one of the
+ * concurrent call processed earlier under the shard lock */
+static inline uint64_t elapsed_ms(uint64_t now_ms, uint64_t since_ms)
+{
+    return now_ms > since_ms ? now_ms - since_ms : 0;
+}
+
+CpsLimiter::Shard::Shard()
+  : buckets(CPS_LIMITER_SHARD_INITIAL_SIZE),
+    used(0),
+    last_purge_ms(0)
+{}
+
+CpsLimiter::Bucket *CpsLimiter::Shard::find(const Key &key, uint64_t h, bool &found)
+{
+    const size_t mask = buckets.size() - 1;
+    for(size_t i = h & mask;; i = (i + 1) & mask) {
+        auto &b = buckets[i];
+        if(!b.limit) {
+            found = false;
+            return &b;
+        }
+        if(b.key == key) {
+            found = true;
+            return &b;
+        }
+    }
+}
+
+void CpsLimiter::Shard::rebuild(size_t size, uint64_t now_ms)
+{
+    std::vector<Bucket> old(size);
+    old.swap(buckets);
+    used = 0;
+    last_purge_ms = std::max(last_purge_ms, now_ms);
+
+    const size_t mask = size - 1;
+    for(const auto &b : old) {
+        if(!b.limit || elapsed_ms(now_ms, b.last_ms) >= CPS_LIMITER_IDLE_TIMEOUT_MS)
+            continue;
+        size_t i = b.key.hash() & mask;
+        while(buckets[i].limit) i = (i + 1) & mask;
+        buckets[i] = b;
+        used++;
+    }
+}
+
+CpsLimiter::CpsLimiter()
+  : enabled(false),
+    default_limit(0),
+    max_sources(1048576),
+    max_shard_size(0),
+    reply_code(503),
+    reply_reason("CPS Limit Exceeded"),
+    retry_after(0),
+    rejected(stat_group(Counter, "yeti", "cps_limiter_rejected").addAtomicCounter()),
+    overflows(stat_group(Counter, "yeti", "cps_limiter_overflows").addAtomicCounter()),
+    evicted(stat_group(Counter, "yeti", "cps_limiter_evicted").addAtomicCounter())
+{
+    setLimits(default_limit, max_sources);
+}
+
+int CpsLimiter::configure(cfg_t *yeti_cfg)
+{
+    cfg_t *sec = cfg_getsec(yeti_cfg, section_name_cps_limit);
+    if(!sec) return 0;
+
+    reply_code = cfg_getint(sec, opt_cps_limit_reply_code);
+    reply_reason = cfg_getstr(sec, opt_cps_limit_reply_reason);
+    retry_after = cfg_getint(sec, opt_cps_limit_retry_after);
+
+    if(reply_code < 300 || reply_code > 699) {
+        ERROR("cps_limit: invalid %s %u",
+              opt_cps_limit_reply_code, reply_code);
+        return -1;
+    }
+
+    reply_hdrs.clear();
+    if(retry_after)
+        reply_hdrs = "Retry-After: " + int2str(retry_after) + CRLF;
+
+    setLimits(cfg_getint(sec, opt_cps_limit_default_limit),
+              cfg_getint(sec, opt_cps_limit_max_sources));
+    enabled = cfg_getbool(sec, opt_cps_limit_enabled);
+
+    if(enabled) {
+        INFO("cps_limit: default_limit:%u, max_sources:%u, reply: %u %s",
+             default_limit, max_sources,
+             reply_code, reply_reason.data());
+    }
+
+    return 0;
+}
+
+void CpsLimiter::configure(unsigned int in_default_limit, unsigned int in_max_sources)
+{
+    enabled = true;
+    setLimits(in_default_limit, in_max_sources);
+}
+
+void CpsLimiter::setLimits(unsigned int in_default_limit, unsigned int in_max_sources)
+{
+    default_limit = in_default_limit;
+    max_sources = std::max(in_max_sources, 1u);
+
+    //keep shard tables load factor under 1/2 for max_sources
+    max_shard_size = CPS_LIMITER_SHARD_INITIAL_SIZE;
+    while(max_shard_size * CPS_LIMITER_SHARDS < static_cast<size_t>(max_sources) * 2)
+        max_shard_size <<= 1;
+}
+
+uint64_t CpsLimiter::now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CpsLimiter::check(const string &ip, unsigned int limit)
+{
+    if(!enabled) return true;
+
+    if(!limit) limit = default_limit;
+    if(!limit) return true;
+
+    Key key;
+    if(!Key::fromString(ip, key)) {
+        DBG("cps_limit: failed to parse IP address: %s", ip.data());
+        return true;
+    }
+
+    return check(key, limit, now_ms());
+}
+
+bool CpsLimiter::check(const Key &key, unsigned int limit, uint64_t now_ms)
+{
+    if(!limit) limit = default_limit;
+    if(!limit) return true;
+
+    const auto h = key.hash();
+    auto &shard = shards[h >> (64 - CPS_LIMITER_SHARDS_BITS)];
+
+    AmLock l(shard.mutex);
+
+    bool found;
+    auto b = shard.find(key, h, found);
+
+    if(found) {
+        if(b->limit != limit) {
+            b->limit = limit;
+            b->tokens = std::min<float>(b->tokens, limit);
+        }
+        b->tokens = std::min<float>(
+            limit,
+            b->tokens + elapsed_ms(now_ms, b->last_ms) * limit / 1000.0f);
+        b->last_ms = std::max(b->last_ms, now_ms);
+
+        if(b->tokens < 1) {
+            rejected.inc();
+            return false;
+        }
+
+        b->tokens -= 1;
+        return true;
+    }
+
+    //new source
+    const size_t size = shard.buckets.size();
+    if((shard.used + 1) * 2 > size) {
+        //drop idle buckets first. grow if the shard is still more than half full
+        auto used = shard.used;
+        if(elapsed_ms(now_ms, shard.last_purge_ms) >= CPS_LIMITER_IDLE_TIMEOUT_MS / 2)
+            shard.rebuild(size, now_ms);
+        if((shard.used + 1) * 2 > size && size < max_shard_size)
+            shard.rebuild(size * 2, now_ms);
+        evicted.inc(used - shard.used);
+
+        if((shard.used + 1) * 4 > shard.buckets.size() * 3) {
+            //table is full of active sources. do not limit the new one
+            overflows.inc();
+            return true;
+        }
+
+        b = shard.find(key, h, found);
+    }
+
+    b->key = key;
+    b->last_ms = now_ms;
+    b->limit = limit;
+    b->tokens = limit - 1;
+    shard.used++;
+
+    return true;
+}
+
+size_t CpsLimiter::getSourcesCount()
+{
+    size_t ret = 0;
+    for(auto &shard : shards) {
+        AmLock l(shard.mutex);
+        ret += shard.used;
+    }
+    return ret;
+}
+
+void CpsLimiter::getState(AmArg &ret)
+{
+    ret["enabled"] = enabled;
+    ret["default_limit"] = default_limit;
+    ret["max_sources"] = max_sources;
+    ret["sources"] = static_cast<unsigned int>(getSourcesCount());
+    ret["rejected"] = static_cast<unsigned int>(rejected.get());
+    ret["overflows"] = static_cast<unsigned int>(overflows.get());
+    ret["evicted"] = static_cast<unsigned int>(evicted.get());
+    ret["reply_code"] = reply_code;
+    ret["reply_reason"] = reply_reason;
+    ret["retry_after"] = retry_after;
+}
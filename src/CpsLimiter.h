@@ -0,0 +1,111 @@
+#pragma once
+
+#include "AmArg.h"
+#include "AmThread.h"
+#include "AmStatistics.h"
+#include "confuse.h"
+
+#include <sys/socket.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+
+#define CPS_LIMITER_SHARDS_BITS 6
+#define CPS_LIMITER_SHARDS (1 << CPS_LIMITER_SHARDS_BITS)
+#define CPS_LIMITER_SHARD_INITIAL_SIZE 64
+//bucket is refilled to the full burst within 1s. keep some margin
+#define CPS_LIMITER_IDLE_TIMEOUT_MS 2000
+
+/* per-source INVITEs rate limiter
+ *
+ * token bucket per source address with rate and burst equal to the CPS limit.
+ * source is the origination IP determined by OriginationPreAuth
+ * (X-AUTH-IP value for the trusted balancers, remote IP otherwise).
+ * limit comes from the matched ip_auth entry cps_limit
+ * or from cps_limit.default_limit (0 means no limit).
+ *
+ * buckets are stored in the sharded open addressing tables
+ * (linear probing, 32 bytes per bucket) keyed by 16 bytes address.
+ * idle buckets (fully refilled ones) are dropped on the shard table rebuild.
+ * new sources are not limited when the shard table reaches
+ * max_sources/CPS_LIMITER_SHARDS entries and has no idle buckets */
+class CpsLimiter
+{
+  public:
+    struct Key {
+        uint64_t hi;
+        uint64_t lo;
+
+        bool operator==(const Key &k) const { return hi == k.hi && lo == k.lo; }
+        //IPv4 addresses are mapped to ::ffff:0:0/96
+        static bool fromAddr(const sockaddr_storage &addr, Key &key);
+        static bool fromString(const string &ip, Key &key);
+        uint64_t hash() const;
+    };
+
+  private:
+    struct Bucket {
+        Key key;
+        uint64_t last_ms;
+        float tokens;
+        //0 for the empty slot
+        uint32_t limit;
+    };
+    static_assert(sizeof(Bucket) == 32, "unexpected CpsLimiter::Bucket size");
+
+    struct alignas(64) Shard {
+        AmMutex mutex;
+        std::vector<Bucket> buckets;
+        size_t used;
+        uint64_t last_purge_ms;
+
+        Shard();
+        Bucket *find(const Key &key, uint64_t h, bool &found);
+        void rebuild(size_t size, uint64_t now_ms);
+    };
+
+    bool enabled;
+    unsigned int default_limit;
+    unsigned int max_sources;
+    size_t max_shard_size;
+    unsigned int reply_code;
+    string reply_reason;
+    unsigned int retry_after;
+    string reply_hdrs;
+
+    std::array<Shard, CPS_LIMITER_SHARDS> shards;
+
+    AtomicCounter &rejected;
+    AtomicCounter &overflows;
+    AtomicCounter &evicted;
+
+    void setLimits(unsigned int default_limit, unsigned int max_sources);
+
+  public:
+    CpsLimiter();
+
+    int configure(cfg_t *yeti_cfg);
+    //for tests
+    void configure(unsigned int default_limit, unsigned int max_sources);
+
+    bool isEnabled() const { return enabled; }
+
+    static uint64_t now_ms();
+
+    /* false if the INVITE from the source must be rejected
+     * with getReplyCode/getReplyReason/getReplyHeaders.
+     * limit 0 means default_limit */
+    bool check(const string &ip, unsigned int limit);
+    bool check(const Key &key, unsigned int limit, uint64_t now_ms);
+
+    unsigned int getReplyCode() const { return reply_code; }
+    const string &getReplyReason() const { return reply_reason; }
+    const string &getReplyHeaders() const { return reply_hdrs; }
+
+    size_t getSourcesCount();
+    void getState(AmArg &ret);
+};
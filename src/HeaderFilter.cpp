@@ -24,6 +24,7 @@
  */
 
 #include "HeaderFilter.h"
+#include "SipHeaderIndex.h"
 #include "sip/parse_common.h"
 #include "log.h"
 #include "AmUtils.h"
@@ -190,51 +191,65 @@ int skip_header(const std::string& hdr, size_t start_pos,
     return 0;
 }
 
-int inplaceHeaderFilter(string& hdrs, const vector<FilterEntry>& filter_list) {
-    if (!hdrs.length() || ! filter_list.size())
-	return 0;
-
-    DBG("applying %zd header filters", filter_list.size());
-
-    for (vector<FilterEntry>::const_iterator fe =
-	     filter_list.begin(); fe != filter_list.end(); fe++) {
-	const set<string>& headerfilter_list = fe->filter_list;
-	const FilterType& f_type = fe->filter_type; 
-
-	if (!isActiveFilter(f_type))
-	  continue;
-
-	// todo: multi-line header support
-
-	size_t start_pos = 0;
-	while (start_pos<hdrs.length()) {
-	    size_t name_end, val_begin, val_end, hdr_end;
-	    int res;
-	    if ((res = skip_header(hdrs, start_pos, name_end, val_begin,
-				   val_end, hdr_end)) != 0) {
-		return res;
-	    }
-	    string hdr_name = hdrs.substr(start_pos, name_end-start_pos);
-	    std::transform(hdr_name.begin(), hdr_name.end(), hdr_name.begin(), ::tolower);
-	    bool erase = false;
-	    if (f_type == Whitelist) {
-		erase = headerfilter_list.find(hdr_name)==headerfilter_list.end();
-	    } else if (f_type == Blacklist) {
-		erase = headerfilter_list.find(hdr_name)!=headerfilter_list.end();
+/** apply all active filters within the single pass over the headers
+ *  header is kept if it passes every filter from the list */
+template<typename Matcher>
+static int inplaceHeaderFilterIndexed(string& hdrs, const vector<FilterEntry>& filter_list,
+				      const Matcher &match)
+{
+    SipHeaderIndex index(hdrs);
+    if (index.failed())
+	return MALFORMED_SIP_MSG;
+
+    string hdr_name, filtered;
+    bool erased = false;
+
+    for (const auto &e : index.headers()) {
+	hdr_name.assign(index.name(e));
+	std::transform(hdr_name.begin(), hdr_name.end(), hdr_name.begin(), ::tolower);
+
+	bool erase = false;
+	for (const auto &fe : filter_list) {
+	    if (fe.filter_type == Whitelist) {
+		erase = !match(hdr_name, fe.filter_list);
+	    } else if (fe.filter_type == Blacklist) {
+		erase = match(hdr_name, fe.filter_list);
 	    }
 	    if (erase) {
-		DBG("erasing header '%s' by %s", hdr_name.c_str(), FilterType2String(f_type));
-		hdrs.erase(start_pos, hdr_end-start_pos);
-	    } else {
-		start_pos = hdr_end;
+		DBG("erasing header '%s' by %s", hdr_name.c_str(), FilterType2String(fe.filter_type));
+		break;
 	    }
 	}
 
+	if (erase) {
+	    if (!erased) {
+		filtered.reserve(hdrs.size());
+		filtered.assign(hdrs, 0, e.name_begin);
+		erased = true;
+	    }
+	} else if (erased) {
+	    filtered.append(hdrs, e.name_begin, e.hdr_end - e.name_begin);
+	}
     }
 
+    if (erased)
+	hdrs.swap(filtered);
+
     return 0;
 }
 
+int inplaceHeaderFilter(string& hdrs, const vector<FilterEntry>& filter_list) {
+    if (!hdrs.length() || ! filter_list.size())
+	return 0;
+
+    DBG("applying %zd header filters", filter_list.size());
+
+    return inplaceHeaderFilterIndexed(hdrs, filter_list,
+	[](const string &hdr_name, const set<string> &l) {
+	    return l.find(hdr_name)!=l.end();
+	});
+}
+
 
 class PatternMatchFunctor
 {
@@ -285,42 +300,5 @@ int inplaceHeaderPatternFilter(string& hdrs, const vector<FilterEntry>& filter_l
 
 	DBG("applying %zd header pattern filters", filter_list.size());
 
-	for (vector<FilterEntry>::const_iterator fe =
-		 filter_list.begin(); fe != filter_list.end(); fe++)
-	{
-		const set<string>& headerfilter_list = fe->filter_list;
-		const FilterType& f_type = fe->filter_type;
-
-		if (!isActiveFilter(f_type))
-			continue;
-
-		size_t start_pos = 0;
-		while (start_pos<hdrs.length()) {
-			int res;
-			size_t name_end, val_begin, val_end, hdr_end;
-
-			if ((res = skip_header(hdrs, start_pos, name_end, val_begin,
-				val_end, hdr_end)) != 0)
-			{
-				return res;
-			}
-
-			string hdr_name = hdrs.substr(start_pos, name_end-start_pos);
-			std::transform(hdr_name.begin(), hdr_name.end(), hdr_name.begin(), ::tolower);
-
-			bool erase = false;
-			if (f_type == Whitelist) {
-				erase = !matchListPattern(hdr_name,headerfilter_list);
-			} else if (f_type == Blacklist) {
-				erase = matchListPattern(hdr_name,headerfilter_list);
-			}
-			if (erase) {
-				DBG("erasing header '%s' by %s", hdr_name.c_str(), FilterType2String(f_type));
-				hdrs.erase(start_pos, hdr_end-start_pos);
-			} else {
-				start_pos = hdr_end;
-			}
-		}
-	}
-	return 0;
+	return inplaceHeaderFilterIndexed(hdrs, filter_list, matchListPattern);
 }
@@ -1,7 +1,7 @@
 #include "OriginationPreAuth.h"
 #include "AmLcConfig.h"
-#include "HeaderFilter.h"
 #include <exception>
+#include <algorithm>
 #include "db/DbHelpers.h"
 
 OriginationPreAuth::OriginationPreAuth(YetiCfg &ycfg)
@@ -30,6 +30,8 @@ OriginationPreAuth::IPAuthData::IPAuthData(const AmArg &r)
     x_yeti_auth = DbAmArg_hash_get_str(r,"x_yeti_auth");
     require_incoming_auth = DbAmArg_hash_get_bool(r,"require_incoming_auth");
     require_identity_parsing = DbAmArg_hash_get_bool(r,"require_identity_parsing");
+    //optional column
+    cps_limit = std::max(0, DbAmArg_hash_get_int(r,"cps_limit"));
 
     if(!subnet.parse(ip))
         throw string("failed to parse IP");
@@ -43,6 +45,7 @@ OriginationPreAuth::IPAuthData::operator AmArg() const
     a["x_yeti_auth"] = x_yeti_auth;
     a["require_incoming_auth"] = require_incoming_auth;
     a["require_identity_parsing"] = require_identity_parsing;
+    a["cps_limit"] = cps_limit;
     return a;
 }
 
@@ -115,7 +118,10 @@ void OriginationPreAuth::ShowIPAuth(const AmArg &arg, AmArg& ret)
     //ret["tree"] = subnets_tree;
 }
 
-bool OriginationPreAuth::onInvite(const AmSipRequest &req, Reply &reply)
+bool OriginationPreAuth::onInvite(
+    const AmSipRequest &req,
+    const SipHeaderIndex &hdrs_index,
+    Reply &reply)
 {
     /* determine src IP to match:
      * use X-AUTH-IP header value if exists
@@ -125,57 +131,31 @@ bool OriginationPreAuth::onInvite(const AmSipRequest &req, Reply &reply)
     /* keep old behavior for no matched failover */
     reply.require_incoming_auth = false;
     reply.require_identity_parsing = true;
+    reply.cps_limit = 0;
 
     static string x_yeti_auth_hdr("X-YETI-AUTH");
 
-    size_t start_pos = 0;
-    while (start_pos<req.hdrs.length()) {
-        size_t name_end, val_begin, val_end, hdr_end;
-        int res;
-        if ((res = skip_header(req.hdrs, start_pos, name_end, val_begin,
-            val_end, hdr_end)) != 0)
-        {
-            break;
-        }
-        if(0==strncasecmp(req.hdrs.c_str() + start_pos,
-                          ycfg.ip_auth_hdr.c_str(), name_end-start_pos))
-        {
-            //req.hdrs.substr(val_begin, val_end-val_begin);
-            if(reply.orig_ip.empty()) {
-                DBG("found first %s hdr. checking for trusted balancer",
-                    ycfg.ip_auth_hdr.data());
-                AmLock l(mutex);
-                for(const auto &lb : load_balancers) {
-                    if(lb.signalling_ip==req.remote_ip) {
-                        reply.orig_ip = req.hdrs.substr(val_begin, val_end-val_begin);
-                        DBG("remote IP %s matched with load balancer %lu/%s. "
-                            "use %s value %s as source IP",
-                            req.remote_ip.data(), lb.id, lb.name.data(),
-                            ycfg.ip_auth_hdr.data(),
-                            reply.orig_ip.data());
-                        break;
-                    }
-                }
-            }
-        /*} else if(0==strncasecmp(req.hdrs.c_str() + start_pos,
-                                 x_orig_port_hdr.c_str(), name_end-start_pos))
-        {
-            str2int(req.hdrs.substr(val_begin, val_end-val_begin), reply.orig_port);
-        } else if(0==strncasecmp(req.hdrs.c_str() + start_pos,
-                                 x_orig_proto_hdr.c_str(), name_end-start_pos))
-        {
-            str2int(req.hdrs.substr(val_begin, val_end-val_begin), reply.orig_proto);*/
-        } else if(0==strncasecmp(req.hdrs.c_str() + start_pos,
-                                 x_yeti_auth_hdr.c_str(), name_end-start_pos))
-        {
-            if(reply.x_yeti_auth.empty()) {
-                reply.x_yeti_auth = req.hdrs.substr(val_begin, val_end-val_begin);
-                DBG("found first X-YETI-AUTH hdr with value: %s", reply.x_yeti_auth.data());
+    if(hdrs_index.exists(ycfg.ip_auth_hdr)) {
+        DBG("found first %s hdr. checking for trusted balancer",
+            ycfg.ip_auth_hdr.data());
+        AmLock l(mutex);
+        for(const auto &lb : load_balancers) {
+            if(lb.signalling_ip==req.remote_ip) {
+                reply.orig_ip = hdrs_index.getFirst(ycfg.ip_auth_hdr);
+                DBG("remote IP %s matched with load balancer %lu/%s. "
+                    "use %s value %s as source IP",
+                    req.remote_ip.data(), lb.id, lb.name.data(),
+                    ycfg.ip_auth_hdr.data(),
+                    reply.orig_ip.data());
+                break;
             }
         }
-        start_pos = hdr_end;
     }
 
+    reply.x_yeti_auth = hdrs_index.getFirst(x_yeti_auth_hdr);
+    if(!reply.x_yeti_auth.empty())
+        DBG("found first X-YETI-AUTH hdr with value: %s", reply.x_yeti_auth.data());
+
     if(reply.orig_ip.empty()) {
         DBG("no %s hdr or request was from not trusted balancer",
             ycfg.ip_auth_hdr.data());
@@ -221,6 +201,7 @@ bool OriginationPreAuth::onInvite(const AmSipRequest &req, Reply &reply)
 
         reply.require_incoming_auth = auth.require_incoming_auth;
         reply.require_identity_parsing = auth.require_identity_parsing;
+        reply.cps_limit = auth.cps_limit;
 
         return true;
     }
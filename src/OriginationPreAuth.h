@@ -3,6 +3,7 @@
 #include "cfg/YetiCfg.h"
 #include "IPTree.h"
 #include "DbConfigStates.h"
+#include "SipHeaderIndex.h"
 
 #include <chrono>
 #include <cstdint>
@@ -27,6 +28,7 @@ class OriginationPreAuth final
         string x_yeti_auth;
         bool require_incoming_auth;
         bool require_identity_parsing;
+        unsigned int cps_limit;
 
         IPAuthData(const AmArg &r);
         operator AmArg() const;
@@ -44,6 +46,8 @@ class OriginationPreAuth final
         string x_yeti_auth;
         bool require_incoming_auth;
         bool require_identity_parsing;
+        //0 for cps_limit.default_limit
+        unsigned int cps_limit;
     };
 
     OriginationPreAuth(YetiCfg &cfg);
@@ -53,5 +57,8 @@ class OriginationPreAuth final
     void ShowTrustedBalancers(AmArg& ret);
     void ShowIPAuth(const AmArg &arg, AmArg& ret);
 
-    bool onInvite(const AmSipRequest &req, Reply &reply);
+    bool onInvite(
+        const AmSipRequest &req,
+        const SipHeaderIndex &hdrs_index,
+        Reply &reply);
 };
@@ -35,6 +35,7 @@
 #include "sip/parse_route.h"
 #include "SBC.h" // for RegexMapper SBCFactory::regex_mappings
 #include <algorithm>
+#include <unordered_map>
 #include <stdlib.h>
 
 int replaceParsedParam(
@@ -118,51 +119,62 @@ int replaceParsedParam(
 /* IMPORTANT: be sure to free() the returned string after use */
 char *url_encode(const char *str);
 
-string replaceParameters(
-    const string& s,
-    const char* r_type,
-    const AmSipRequest& req,
-    const SBCCallProfile* call_profile,
-    const string& app_param,
-    const string& outbound_interface_host,
-    AmUriParser& ruri_parser, 
-    AmUriParser& from_parser,
-    AmUriParser& to_parser,
-    bool rebuild_ruri,
-    bool rebuild_from,
-    bool rebuild_to)
+namespace {
+
+struct ReplaceEnv
 {
-    string res;
-    bool is_replaced = false;
-    size_t p = 0;
-    bool is_escaped = false;
-    const string& used_hdrs = req.hdrs; //(hdrs == NULL) ? req.hdrs : *hdrs;
-    while (p<s.length()) {
-        size_t skip_chars = 1;
-
-        if (is_escaped) {
-            switch (s[p]) {
-            case 'r': res += '\r'; break;
-            case 'n': res += '\n'; break;
-            case 't': res += '\t'; break;
-            default: res += s[p]; break;
-            }
-            is_escaped = false;
-        } else { // not escaped
-            if (s[p]=='\\') {
-                if (p==s.length()-1) {
-                    res += '\\'; // add single \ at the end
-                } else {
-                    is_escaped = true;
-                    is_replaced = true;
-                }
-            } else if ((s[p]=='$') && (s.length() >= p+1)) {
-                is_replaced = true;
-                p++;
-                switch (s[p]) {
+    const char* r_type;
+    const AmSipRequest& req;
+    const SBCCallProfile* call_profile;
+    const string& app_param;
+    const string& outbound_interface_host;
+    AmUriParser& ruri_parser;
+    AmUriParser& from_parser;
+    AmUriParser& to_parser;
+    bool rebuild_ruri;
+    bool rebuild_from;
+    bool rebuild_to;
+    ParamReplacerCache& cache;
+};
+
+} // namespace
+
+static string replaceString(const string& s, ReplaceEnv& env);
+
+static inline char unescapeChar(char c)
+{
+    switch (c) {
+    case 'r': return '\r';
+    case 'n': return '\n';
+    case 't': return '\t';
+    default: return c;
+    }
+}
+
+/* replaces single $xy parameter.
+ * p points to the char after '$'. returns skip_chars:
+ * the next not processed position is p+skip_chars+1 */
+static size_t replaceParam(
+    const string& s, size_t p,
+    ReplaceEnv& env, string& res)
+{
+    size_t skip_chars = 1;
+
+    const char* r_type = env.r_type;
+    const AmSipRequest& req = env.req;
+    const SBCCallProfile* call_profile = env.call_profile;
+    const string& app_param = env.app_param;
+    const string& outbound_interface_host = env.outbound_interface_host;
+    AmUriParser& ruri_parser = env.ruri_parser;
+    AmUriParser& from_parser = env.from_parser;
+    AmUriParser& to_parser = env.to_parser;
+    ParamReplacerCache& cache = env.cache;
+    const string& used_hdrs = req.hdrs;
+
+    switch (s[p]) {
     case 'f': { // from
         if ((s.length() == p+1) || (s[p+1] == '.')) {
-            if (rebuild_from) {
+            if (env.rebuild_from) {
                 res += from_parser.nameaddr_str();
             } else {
                 res += req.from;
@@ -188,7 +200,7 @@ string replaceParameters(
 
     case 't': { // to
         if ((s.length() == p+1) || (s[p+1] == '.')) {
-            if (rebuild_to) {
+            if (env.rebuild_to) {
                 res += to_parser.nameaddr_str();
             } else {
                 res += req.to;
@@ -214,7 +226,7 @@ string replaceParameters(
 
     case 'r': { // r-uri
         if ((s.length() == p+1) || (s[p+1] == '.')) {
-            if (rebuild_ruri) {
+            if (env.rebuild_ruri) {
                 res += ruri_parser.uri_str();
             } else {
                 res += req.r_uri;
@@ -264,25 +276,31 @@ string replaceParameters(
         }
 
         if(!call_profile->next_hop.empty()) {
-            cstring _next_hop = stl2cstr(call_profile->next_hop);
-            list<sip_destination> dest_list;
-            if(parse_next_hop(_next_hop,dest_list)) {
-                WARN("parse_next_hop %.*s failed",
-                    _next_hop.len, _next_hop.s);
-                break;
-            }
+            if(cache.next_hop != call_profile->next_hop) {
+                cstring _next_hop = stl2cstr(call_profile->next_hop);
+                list<sip_destination> dest_list;
+                if(parse_next_hop(_next_hop,dest_list)) {
+                    WARN("parse_next_hop %.*s failed",
+                        _next_hop.len, _next_hop.s);
+                    break;
+                }
 
-            if(dest_list.size() == 0) {
-                WARN("next-hop is not empty, but the resulting destination list is");
-                break;
+                if(dest_list.size() == 0) {
+                    WARN("next-hop is not empty, but the resulting destination list is");
+                    break;
+                }
+
+                const sip_destination& dest = dest_list.front();
+                cache.next_hop = call_profile->next_hop;
+                cache.next_hop_ip = c2stlstr(dest.host);
+                cache.next_hop_port = int2str(dest.port);
             }
 
-            const sip_destination& dest = dest_list.front();
             if (s[p+1] == 'i') { // $di remote UAS IP address
-                res += c2stlstr(dest.host);
+                res += cache.next_hop_ip;
                 break;
             } else if (s[p+1] == 'p') { // $dp remote UAS port
-                res += int2str(dest.port);
+                res += cache.next_hop_port;
                 break;
             }
 
@@ -358,19 +376,26 @@ string replaceParameters(
         WARN("unknown replacement $O%c", s[p+1]);
     }; break;
 
-#define case_HDR(pv_char, pv_name, hdr_name) \
+#define case_HDR(pv_char, pv_name, hdr_name, hdr_cache) \
     case pv_char: { \
-        AmUriParser uri_parser; \
-        uri_parser.uri = getHeader(used_hdrs, hdr_name); \
+        string hdr_value = getHeader(used_hdrs, hdr_name); \
         if ((s.length() == p+1) || (s[p+1] == '.')) { \
-            res += uri_parser.uri; \
+            res += hdr_value; \
             break; \
         } \
 \
-        if (!uri_parser.parse_uri()) { \
-            WARN("Error parsing " pv_name " URI '%s'", uri_parser.uri.c_str()); \
-            break; \
+        ParamReplacerCache::uri& cached = cache.hdr_cache; \
+        if (!cached.parsed || cached.value != hdr_value) { \
+            cached.parser = AmUriParser(); \
+            cached.parser.uri = hdr_value; \
+            cached.parsed = cached.parser.parse_uri(); \
+            cached.value.swap(hdr_value); \
+            if (!cached.parsed) { \
+                WARN("Error parsing " pv_name " URI '%s'", cached.value.c_str()); \
+                break; \
+            } \
         } \
+        const AmUriParser& uri_parser = cached.parser; \
         if (s[p+1] == 'i') { \
             res+=uri_parser.uri_user+"@"+uri_parser.uri_host; \
             if (!uri_parser.uri_port.empty()) \
@@ -380,8 +405,8 @@ string replaceParameters(
         } \
     }; break;
 
-    case_HDR('a', "PAI", SIP_HDR_P_ASSERTED_IDENTITY);  // P-Asserted-Identity
-    case_HDR('p', "PPI", SIP_HDR_P_PREFERRED_IDENTITY); // P-Preferred-Identity
+    case_HDR('a', "PAI", SIP_HDR_P_ASSERTED_IDENTITY, pai);  // P-Asserted-Identity
+    case_HDR('p', "PPI", SIP_HDR_P_PREFERRED_IDENTITY, ppi); // P-Preferred-Identity
 
     case 'P': { // app-params
         if (s[p+1] != '(') {
@@ -478,12 +503,9 @@ string replaceParameters(
         }
 
         string br_str = s.substr(p+3, skip_p-p-3);
-        string br_str_replaced = 
-            replaceParameters(
-                br_str, "$_*(...)",
-                req, call_profile, app_param, outbound_interface_host,
-                ruri_parser, from_parser, to_parser,
-                rebuild_ruri, rebuild_from, rebuild_to);
+        ReplaceEnv br_env(env);
+        br_env.r_type = "$_*(...)";
+        string br_str_replaced = replaceString(br_str, br_env);
 
         br_str = br_str_replaced;
         switch(operation) {
@@ -553,12 +575,7 @@ string replaceParameters(
         }
 
         string expr_str = s.substr(p+2, skip_p-p-2);
-        string expr_replaced = 
-            replaceParameters(
-                expr_str, r_type, req,
-                call_profile, app_param, outbound_interface_host,
-                ruri_parser, from_parser, to_parser,
-                rebuild_ruri, rebuild_from, rebuild_to);
+        string expr_replaced = replaceString(expr_str, env);
 
         char* val_escaped = url_encode(expr_replaced.c_str());
         res += string(val_escaped);
@@ -572,24 +589,290 @@ string replaceParameters(
             s[p], s[p+1], r_type, s.c_str());
     }; break;
 
-                }; //switch (s[p])
+    }; //switch (s[p])
 
-                p+=skip_chars; // skip $.X
-            } else {
-                res += s[p];
+    return skip_chars;
+}
+
+// interprets s starting from the position p
+static void replaceFrom(
+    const string& s, size_t p,
+    ReplaceEnv& env, string& res,
+    bool& is_replaced)
+{
+    while (p<s.length()) {
+        size_t next = s.find_first_of("\\$", p);
+        if (next == string::npos) {
+            res.append(s, p, string::npos);
+            return;
+        }
+        res.append(s, p, next-p);
+        p = next;
+
+        if (s[p]=='\\') {
+            if (p==s.length()-1) {
+                res += '\\'; // add single \ at the end
+                return;
             }
-        } // end not escaped
+            is_replaced = true;
+            res += unescapeChar(s[p+1]);
+            p+=2;
+            continue;
+        }
 
+        is_replaced = true;
         p++;
-    } //while (p<s.length())
+        p += replaceParam(s, p, env, res) + 1; // skip $.X
+    }
+}
+
+static string replaceString(const string& s, ReplaceEnv& env)
+{
+    string res;
+    bool is_replaced = false;
+
+    res.reserve(s.length());
+    replaceFrom(s, 0, env, res, is_replaced);
 
     if (is_replaced) {
-        DBG("%s pattern replace: '%s' -> '%s'", r_type, s.c_str(), res.c_str());
+        DBG("%s pattern replace: '%s' -> '%s'", env.r_type, s.c_str(), res.c_str());
+    }
+
+    return res;
+}
+
+string replaceParameters(
+    const string& s,
+    const char* r_type,
+    const AmSipRequest& req,
+    const SBCCallProfile* call_profile,
+    const string& app_param,
+    const string& outbound_interface_host,
+    AmUriParser& ruri_parser, 
+    AmUriParser& from_parser,
+    AmUriParser& to_parser,
+    bool rebuild_ruri,
+    bool rebuild_from,
+    bool rebuild_to)
+{
+    ParamReplacerCache cache;
+    ReplaceEnv env{
+        r_type, req, call_profile,
+        app_param, outbound_interface_host,
+        ruri_parser, from_parser, to_parser,
+        rebuild_ruri, rebuild_from, rebuild_to,
+        cache
+    };
+    return replaceString(s, env);
+}
+
+static size_t closingBracket(const string& s, size_t p)
+{
+    for (;p<s.length() && s[p] != ')';p++) { }
+    return p;
+}
+
+// skip_chars of replaceParsedParam() for the successfully parsed URI
+static size_t parsedParamExtent(const string& s, size_t p)
+{
+    if ((s[p+1] == 'P') && (s.length() > p+3) && (s[p+2] == '(')) {
+        size_t skip_p = closingBracket(s, p+3);
+        if (skip_p != s.length())
+            return skip_p-p;
+    }
+    return 1;
+}
+
+/* skip_chars of replaceParam() known from the string itself.
+ * actual value differs only if the replacement fails in the middle
+ * (e.g. not parsable URI) */
+static size_t paramExtent(const string& s, size_t p)
+{
+    switch (s[p]) {
+    case 'f':
+    case 't':
+        if ((s.length() == p+1) || (s[p+1] == '.') || (s[p+1] == 't'))
+            return 1;
+        return parsedParamExtent(s, p);
+    case 'r':
+        if ((s.length() == p+1) || (s[p+1] == '.'))
+            return 1;
+        return parsedParamExtent(s, p);
+    case 'a':
+    case 'p':
+        if ((s.length() == p+1) || (s[p+1] == '.') || (s[p+1] == 'i'))
+            return 1;
+        return parsedParamExtent(s, p);
+    case 'P': {
+        if ((s[p+1] != '(') || (s.length()<p+3))
+            return 1;
+        size_t skip_p = closingBracket(s, p+2);
+        return skip_p==s.length() ? 1 : skip_p-p;
+    }
+    case 'H': {
+        size_t name_offset = 2;
+        if (s[p+1] != '(') {
+            if (s[p+2] != '(')
+                return 1;
+            name_offset = 3;
+        }
+        if (s.length()<name_offset+1)
+            return 1;
+        size_t skip_p = closingBracket(s, p+name_offset);
+        if (skip_p==s.length() || (name_offset == 3 && s[p+1] == '.'))
+            return 1;
+        return skip_p-p;
     }
+    case '_':
+        if ((s.length()<p+4) || (s[p+2] != '('))
+            return 1;
+        return skip_to_end_of_brackets(s, p+3)-p;
+    case '#':
+        if ((s[p+1] != '(') || (s.length()<p+3))
+            return 1;
+        return skip_to_end_of_brackets(s, p+2)-p;
+    default:
+        return 1;
+    }
+}
+
+ParamReplacerTemplate::ParamReplacerTemplate()
+  : is_replaced(false),
+    params_count(0)
+{}
+
+ParamReplacerTemplate::ParamReplacerTemplate(const string& s)
+  : ParamReplacerTemplate()
+{
+    compile(s);
+}
+
+void ParamReplacerTemplate::addLiteral(size_t& literal_start)
+{
+    if (literals.length() > literal_start) {
+        ops.push_back({ false, literal_start, literals.length() - literal_start });
+        literal_start = literals.length();
+    }
+}
+
+void ParamReplacerTemplate::compile(const string& s)
+{
+    src = s;
+    literals.clear();
+    ops.clear();
+    is_replaced = false;
+    params_count = 0;
+
+    size_t p = 0, literal_start = 0;
+    while (p<s.length()) {
+        size_t next = s.find_first_of("\\$", p);
+        if (next == string::npos) {
+            literals.append(s, p, string::npos);
+            break;
+        }
+        literals.append(s, p, next-p);
+        p = next;
+
+        if (s[p]=='\\') {
+            if (p==s.length()-1) {
+                literals += '\\';
+                break;
+            }
+            is_replaced = true;
+            literals += unescapeChar(s[p+1]);
+            p+=2;
+            continue;
+        }
+
+        is_replaced = true;
+        addLiteral(literal_start);
+        p++;
+        size_t next_p = p + paramExtent(s, p) + 1;
+        ops.push_back({ true, p, next_p });
+        params_count++;
+        p = next_p;
+    }
+    addLiteral(literal_start);
+}
+
+string ParamReplacerTemplate::evaluate(
+    const char* r_type,
+    const AmSipRequest& req,
+    ParamReplacerCtx& ctx) const
+{
+    if (!params_count) {
+        if (is_replaced) {
+            DBG("%s pattern replace: '%s' -> '%s'", r_type, src.c_str(), literals.c_str());
+        }
+        return literals;
+    }
+
+    ReplaceEnv env{
+        r_type, req, ctx.call_profile,
+        ctx.app_param, ctx.outbound_interface_host,
+        ctx.ruri_parser, ctx.from_parser, ctx.to_parser,
+        ctx.ruri_modified, ctx.from_modified, ctx.to_modified,
+        ctx.cache
+    };
+
+    string res;
+    res.reserve(literals.length() + params_count*32);
+    for (const auto& o : ops) {
+        if (!o.is_param) {
+            res.append(literals, o.offset, o.length);
+            continue;
+        }
+        size_t next_p = o.offset + replaceParam(src, o.offset, env, res) + 1;
+        if (next_p != o.length) {
+            // replacement failed in the middle. continue with the interpreter
+            bool replaced;
+            replaceFrom(src, next_p, env, res, replaced);
+            break;
+        }
+    }
+
+    DBG("%s pattern replace: '%s' -> '%s'", r_type, src.c_str(), res.c_str());
 
     return res;
 }
 
+/* compiled templates for the strings with replacements.
+ * profiles are loaded from the database for each call,
+ * so templates are shared by the source string between the calls */
+static const ParamReplacerTemplate& getCompiledTemplate(const string& s)
+{
+    static const size_t max_templates = 4096;
+    static thread_local std::unordered_map<string, ParamReplacerTemplate> templates;
+
+    auto it = templates.find(s);
+    if (it != templates.end())
+        return it->second;
+
+    if (templates.size() >= max_templates)
+        templates.clear();
+
+    return templates.emplace(s, ParamReplacerTemplate(s)).first->second;
+}
+
+string ParamReplacerCtx::replaceParameters(
+    const string& s,
+    const char* r_type,
+    const AmSipRequest& req)
+{
+    if (s.find_first_of("\\$") == string::npos)
+        return s;
+
+    return getCompiledTemplate(s).evaluate(r_type, req, *this);
+}
+
+string ParamReplacerCtx::replaceParameters(
+    const ParamReplacerTemplate& t,
+    const char* r_type,
+    const AmSipRequest& req)
+{
+    return t.evaluate(r_type, req, *this);
+}
+
 
 // URL encoding functions
 // source code from http://www.geekhideout.com/urlcode.shtml
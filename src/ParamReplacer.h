@@ -27,6 +27,7 @@
 #define _ParamReplacer_h_
 
 #include <string>
+#include <vector>
 using std::string;
 
 #include "AmSipMsg.h"
@@ -48,6 +49,59 @@ string replaceParameters(const string& s,
     bool rebuild_from,
     bool rebuild_to);
 
+// parsed values reused by the replacements within the request processing
+struct ParamReplacerCache
+{
+    struct uri {
+        string value;
+        AmUriParser parser;
+        bool parsed;
+        uri(): parsed(false) {}
+    };
+
+    uri pai;
+    uri ppi;
+
+    string next_hop;
+    string next_hop_ip;
+    string next_hop_port;
+};
+
+struct ParamReplacerCtx;
+
+/* $xy parameters string compiled to the sequence of
+ * literal chunks (escapes resolved) and parameters */
+class ParamReplacerTemplate
+{
+    struct op {
+        bool is_param;
+        size_t offset; // literal: offset in literals. param: position after '$' in src
+        size_t length; // literal: length. param: expected position of the next op in src
+    };
+
+    string src;
+    string literals;
+    std::vector<op> ops;
+    bool is_replaced;
+    size_t params_count;
+
+    void addLiteral(size_t& literal_start);
+
+  public:
+    ParamReplacerTemplate();
+    explicit ParamReplacerTemplate(const string& s);
+
+    void compile(const string& s);
+
+    const string& source() const { return src; }
+    bool hasParams() const { return params_count != 0; }
+
+    string evaluate(
+        const char* r_type,
+        const AmSipRequest& req,
+        ParamReplacerCtx& ctx) const;
+};
+
 struct ParamReplacerCtx
 {
     string app_param;
@@ -62,6 +116,8 @@ struct ParamReplacerCtx
 
     const SBCCallProfile* call_profile;
 
+    ParamReplacerCache cache;
+
     ParamReplacerCtx(const SBCCallProfile* call_profile=NULL)
       : ruri_modified(false),
         from_modified(false),
@@ -69,23 +125,16 @@ struct ParamReplacerCtx
         call_profile(call_profile)
     {}
 
+    // uses the compiled template shared between the calls
     string replaceParameters(
         const string& s,
         const char* r_type,
-        const AmSipRequest& req)
-    {
-        return ::replaceParameters(
-            s,r_type,req,
-            call_profile,
-            app_param,
-            outbound_interface_host,
-            ruri_parser,
-            from_parser,
-            to_parser,
-            ruri_modified,
-            from_modified,
-            to_modified);
-    }
+        const AmSipRequest& req);
+
+    string replaceParameters(
+        const ParamReplacerTemplate& t,
+        const char* r_type,
+        const AmSipRequest& req);
 };
 
 #endif
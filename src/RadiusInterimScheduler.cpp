@@ -0,0 +1,195 @@
+#include "RadiusInterimScheduler.h"
+#include "stats/StatsRegistry.h"
+
+#include "ampi/RadiusClientAPI.h"
+#include "AmSessionContainer.h"
+#include "AmUtils.h"
+#include "log.h"
+
+#include <algorithm>
+
+static const PlaceholdersHash::key_id_t call_duration_float_key =
+    PlaceholdersHash::key("call_duration_float");
+static const PlaceholdersHash::key_id_t call_duration_int_key =
+    PlaceholdersHash::key("call_duration_int");
+
+static void post_interim_batch(RadiusInterimScheduler::batch_t &batch)
+{
+    for(auto &r : batch) {
+        DBG("[%s] post acc_interim event to the radius module with profile id: %d",
+            r.local_tag.c_str(), r.profile_id);
+
+        AmSessionContainer::instance()->postEvent(
+            RADIUS_EVENT_QUEUE,
+            new RadiusRequestEvent(
+                RadiusRequestEvent::Interim, r.profile_id,
+                r.local_tag, r.placeholders.get()));
+    }
+}
+
+RadiusInterimScheduler::RadiusInterimScheduler(send_func_t send_func)
+  : last_id(0),
+    current_tick(0),
+    start_time(std::chrono::steady_clock::now()),
+    send_func(send_func ? send_func : post_interim_batch),
+    sent_counter(StatsRegistry::instance()->counter(
+        "radius_interim_sent", "interim accounting requests sent to the radius module")),
+    queue_depth(stat_group(Gauge, "yeti", "radius_interim_queue_depth").addAtomicCounter()),
+    rate_sample_time(start_time),
+    rate_sample_sent(0),
+    total_sent(0),
+    send_rate(0)
+{
+    stat_group(Gauge, "yeti", "radius_interim_queue_depth").setHelp(
+        "calls with the scheduled interim accounting");
+}
+
+void RadiusInterimScheduler::setDuration(
+    PlaceholdersHash &placeholders,
+    const timeval &connect_time, const timeval &now)
+{
+    if(timerisset(&connect_time)) {
+        timeval duration;
+        timersub(&now, &connect_time, &duration);
+        placeholders.set(call_duration_float_key, duration, PlaceholdersHash::TimeFloat);
+        placeholders.set(call_duration_int_key, static_cast<long long>(duration.tv_sec));
+    } else {
+        placeholders.set(call_duration_float_key, string("0.0"));
+        placeholders.set(call_duration_int_key, 0LL);
+    }
+}
+
+void RadiusInterimScheduler::schedule(entry_id_t id, entry &e, unsigned int ticks)
+{
+    e.rounds = (ticks - 1) / RADIUS_INTERIM_WHEEL_SLOTS;
+    wheel[(current_tick + ticks) % RADIUS_INTERIM_WHEEL_SLOTS].push_back(id);
+}
+
+RadiusInterimScheduler::entry_id_t RadiusInterimScheduler::add(
+    int profile_id, const string &local_tag,
+    const PlaceholdersHash &placeholders,
+    const timeval &connect_time, unsigned int interval)
+{
+    unsigned int interval_ticks = std::max(
+        1u, (interval * 1000 + RADIUS_INTERIM_TICK_MSEC - 1) / RADIUS_INTERIM_TICK_MSEC);
+    /* phase of the first interim within [interval - interval/k, interval].
+     * the first request is never sent later than the interval after the start */
+    unsigned int jitter_ticks = interval_ticks / RADIUS_INTERIM_JITTER_DIVISOR;
+    unsigned int phase = interval_ticks - std::hash<string>()(local_tag) % (jitter_ticks + 1);
+
+    AmLock l(mutex);
+
+    entry_id_t id = ++last_id;
+    auto &e = entries.emplace(id, entry{
+        { profile_id, local_tag, placeholders, connect_time },
+        interval_ticks, 0 }).first->second;
+    schedule(id, e, phase);
+
+    profiles[profile_id].queued++;
+    queue_depth.inc();
+
+    return id;
+}
+
+void RadiusInterimScheduler::remove(entry_id_t id)
+{
+    AmLock l(mutex);
+
+    auto it = entries.find(id);
+    if(it == entries.end()) return;
+
+    profiles[it->second.req.profile_id].queued--;
+    queue_depth.dec();
+    entries.erase(it);
+}
+
+void RadiusInterimScheduler::tick(batch_t &batch)
+{
+    current_tick++;
+
+    std::vector<entry_id_t> slot;
+    slot.swap(wheel[current_tick % RADIUS_INTERIM_WHEEL_SLOTS]);
+
+    for(auto id : slot) {
+        auto it = entries.find(id);
+        if(it == entries.end()) continue;
+
+        entry &e = it->second;
+        if(e.rounds) {
+            e.rounds--;
+            wheel[current_tick % RADIUS_INTERIM_WHEEL_SLOTS].push_back(id);
+            continue;
+        }
+
+        batch.push_back(e.req);
+        schedule(id, e, e.interval_ticks);
+    }
+}
+
+void RadiusInterimScheduler::send(batch_t &batch)
+{
+    std::stable_sort(batch.begin(), batch.end(),
+        [](const request &a, const request &b) { return a.profile_id < b.profile_id; });
+
+    timeval now;
+    gettimeofday(&now, nullptr);
+    for(auto &r : batch)
+        setDuration(r.placeholders, r.connect_time, now);
+
+    send_func(batch);
+
+    sent_counter.inc(batch.size());
+
+    total_sent += batch.size();
+    for(const auto &r : batch)
+        profiles[r.profile_id].sent++;
+}
+
+void RadiusInterimScheduler::onTimer(const time_point &now)
+{
+    batch_t batch;
+
+    /* the batch is posted under the lock. so no interim of the entry
+     * is posted after remove() returns and the Stop request posted by
+     * the call leg after remove() is always the last one */
+    AmLock l(mutex);
+
+    uint64_t now_tick = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - start_time).count() / RADIUS_INTERIM_TICK_MSEC;
+    while(current_tick < now_tick)
+        tick(batch);
+
+    if(!batch.empty())
+        send(batch);
+
+    auto elapsed = std::chrono::duration<double>(now - rate_sample_time).count();
+    if(elapsed >= 1) {
+        send_rate = (total_sent - rate_sample_sent) / elapsed;
+        rate_sample_sent = total_sent;
+        rate_sample_time = now;
+    }
+}
+
+size_t RadiusInterimScheduler::size()
+{
+    AmLock l(mutex);
+    return entries.size();
+}
+
+void RadiusInterimScheduler::getStats(AmArg &ret)
+{
+    AmLock l(mutex);
+
+    ret["tick_msec"] = RADIUS_INTERIM_TICK_MSEC;
+    ret["queue_depth"] = static_cast<long long>(entries.size());
+    ret["sent"] = static_cast<long long>(total_sent);
+    ret["send_rate"] = send_rate;
+
+    AmArg &a = ret["profiles"];
+    a.assertStruct();
+    for(const auto &it : profiles) {
+        AmArg &p = a[int2str(it.first)];
+        p["queue_depth"] = it.second.queued;
+        p["sent"] = static_cast<long long>(it.second.sent);
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "SBCCallProfile.h"
+#include "stats/ShardedCounter.h"
+
+#include "AmArg.h"
+#include "AmThread.h"
+#include "AmStatistics.h"
+
+#include <sys/time.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#define RADIUS_INTERIM_TICK_MSEC 100
+#define RADIUS_INTERIM_WHEEL_SLOTS 1024
+//first interim is sent within the last 1/RADIUS_INTERIM_JITTER_DIVISOR of the interval
+#define RADIUS_INTERIM_JITTER_DIVISOR 4
+
+/* module-level scheduler of the interim accounting requests
+ *
+ * replaces per-call interim timers with the hashed timing wheel
+ * advanced by the single timer of the yeti thread.
+ * wheel has RADIUS_INTERIM_WHEEL_SLOTS slots of RADIUS_INTERIM_TICK_MSEC,
+ * longer intervals are handled by the rounds counter of the entry.
+ *
+ * the first interim of the call is sent at the phase derived from the local tag
+ * within [interval - interval/RADIUS_INTERIM_JITTER_DIVISOR, interval] after the start
+ * and every interval after it. so the calls connected at the same time
+ * do not produce synchronized bursts and no interim is sent later than the interval.
+ *
+ * entry keeps the copy of the call placeholders taken at accounting start
+ * (shared row and interned values). the leg changes them after the start only
+ * for the Stop request, so the copy has the same values the leg would send.
+ * call duration is set and the values are formatted at send time only.
+ * requests due on the tick are sent as the batch ordered by the accounting profile.
+ * batch is sent under the lock, no interim of the entry is sent after remove() */
+class RadiusInterimScheduler
+{
+  public:
+    typedef uint64_t entry_id_t;
+
+    struct request {
+        int profile_id;
+        string local_tag;
+        PlaceholdersHash placeholders;
+        timeval connect_time;
+    };
+
+    typedef std::vector<request> batch_t;
+    typedef std::function<void (batch_t &batch)> send_func_t;
+
+  private:
+    typedef std::chrono::steady_clock::time_point time_point;
+
+    struct entry {
+        request req;
+        unsigned int interval_ticks;
+        unsigned int rounds;
+    };
+
+    struct profile_stats {
+        long long queued;
+        unsigned long long sent;
+        profile_stats()
+          : queued(0),
+            sent(0)
+        {}
+    };
+
+    AmMutex mutex;
+    std::unordered_map<entry_id_t, entry> entries;
+    //ids of the removed entries are dropped when their slot is processed
+    std::vector<entry_id_t> wheel[RADIUS_INTERIM_WHEEL_SLOTS];
+    std::map<int, profile_stats> profiles;
+    entry_id_t last_id;
+    uint64_t current_tick;
+    time_point start_time;
+
+    send_func_t send_func;
+
+    ShardedCounter &sent_counter;
+    AtomicCounter &queue_depth;
+
+    //send rate sampled by onTimer()
+    time_point rate_sample_time;
+    unsigned long long rate_sample_sent;
+    unsigned long long total_sent;
+    double send_rate;
+
+    void schedule(entry_id_t id, entry &e, unsigned int ticks);
+    void tick(batch_t &batch);
+    //called with the mutex locked
+    void send(batch_t &batch);
+
+  public:
+    //posts RadiusRequestEvent::Interim to RADIUS_EVENT_QUEUE by default
+    RadiusInterimScheduler(send_func_t send_func = send_func_t());
+
+    /* returns id to be passed to remove(). interval is in seconds
+     * and rounded up to the ticks */
+    entry_id_t add(int profile_id, const string &local_tag,
+                   const PlaceholdersHash &placeholders,
+                   const timeval &connect_time, unsigned int interval);
+    void remove(entry_id_t id);
+
+    //advances the wheel to now sending all due requests
+    void onTimer(const time_point &now = std::chrono::steady_clock::now());
+
+    size_t size();
+    void getStats(AmArg &ret);
+
+    //sets call_duration placeholders for the time passed since connect_time
+    static void setDuration(PlaceholdersHash &placeholders,
+                            const timeval &connect_time, const timeval &now);
+};
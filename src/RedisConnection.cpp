@@ -32,11 +32,12 @@ int RedisScript::load(RedisConnection* c, const string &script_path, int reply_t
     }
 }
 
-RedisConnection::RedisConnection(const char* name, RedisConnectionPool* pool)
+RedisConnection::RedisConnection(const char* name, RedisConnectionPool* pool, RedisIoThread* io_thread)
   : async_context(0),
     connected(false),
     name(name),
-    pool(pool)
+    pool(pool),
+    io_thread(io_thread)
 {
     RedisConnection::host = "127.0.0.1";
     RedisConnection::port = 6379;
@@ -181,7 +182,7 @@ void RedisConnection::on_reconnect()
 
 void RedisConnection::on_connect() {
     connected = true;
-    pool->on_connect(this);
+    pool->notify_connect(this);
 }
 void RedisConnection::on_disconnect() {
     connected = false;
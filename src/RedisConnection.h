@@ -19,6 +19,7 @@ inline unsigned int len_in_chars(T s)
 
 class RedisConnection;
 class RedisConnectionPool;
+class RedisIoThread;
 
 struct RedisScript
   : AmObject
@@ -51,18 +52,22 @@ class RedisConnection
   protected:
     string name;
     RedisConnectionPool* pool;
+    //nullptr for the connections served by the pool thread
+    RedisIoThread* io_thread;
 
     friend class RedisConnectionPool;
+    friend class RedisIoLoop;
     void on_reconnect();
     void on_connect();
     void on_disconnect();
   public:
 
-    RedisConnection(const char* name, RedisConnectionPool* pool);
+    RedisConnection(const char* name, RedisConnectionPool* pool, RedisIoThread* io_thread = nullptr);
     virtual ~RedisConnection();
     int init(int epoll_fd, const string &host, int port);
 
     redisAsyncContext* get_async_context() {return async_context; }
+    RedisIoThread* get_io_thread() { return io_thread; }
     void cleanup();
     bool is_connected() { return connected.get(); }
 
@@ -1,6 +1,8 @@
 #include "RedisConnectionPool.h"
 #include "RedisConnection.h"
+#include "stats/StatsRegistry.h"
 #include <AmEventDispatcher.h>
+#include <AmUtils.h>
 
 #define EPOLL_MAX_EVENTS 2048
 
@@ -14,6 +16,8 @@ RedisRequestEvent::~RedisRequestEvent()
 
 RedisReplyEvent::RedisReplyEvent(redisReply *reply, RedisReplyCtx &ctx)
   : AmEvent(REDIS_REPLY_EVENT_ID),
+    raw_reply(redis::detachReply(reply)),
+    data_converted(false),
     user_data(std::move(ctx.user_data)),
     user_type_id(ctx.user_type_id)
 {
@@ -21,23 +25,21 @@ RedisReplyEvent::RedisReplyEvent(redisReply *reply, RedisReplyCtx &ctx)
         result = IOError;
         return;
     }
-    //serialize redisReply to AmArg
-    if(redis::isReplyError(reply)) {
+
+    //take the reply tree instead of the AmArg serialization in the pool thread
+    if(redis::isReplyError(raw_reply.get())) {
         result = ErrorReply;
-        //data = string("error: ") + string(reply->str,reply->len);
-    } else if(redis::isReplyStatus(reply)) {
+    } else if(redis::isReplyStatus(raw_reply.get())) {
         result = StatusReply;
-        //data = string("status: ") + string(reply->str,reply->len);
     } else {
         result = SuccessReply;
     }
-
-    redisReply2Amarg(data, reply);
 }
 
 RedisReplyEvent::RedisReplyEvent(result_type result, RedisRequestEvent &request)
   : AmEvent(REDIS_REPLY_EVENT_ID),
     result(result),
+    data_converted(false),
     user_data(std::move(request.user_data)),
     user_type_id(request.user_type_id)
 { }
@@ -45,10 +47,26 @@ RedisReplyEvent::RedisReplyEvent(result_type result, RedisRequestEvent &request)
 RedisReplyEvent::~RedisReplyEvent()
 {}
 
+AmArg &RedisReplyEvent::data() const
+{
+    if(!data_converted) {
+        reply().toAmArg(converted_data);
+        data_converted = true;
+    }
+    return converted_data;
+}
+
 static void redis_request_cb_static(redisAsyncContext *, void *r, void *privdata)
 {
+    static LatencyHistogram &redis_rtt = StatsRegistry::instance()->histogram(
+        "redis_rtt", "redis commands round trip time");
+
     RedisReplyCtx *ctx = static_cast<RedisReplyCtx *>(privdata);
     redisReply* reply = static_cast<redisReply *>(r);
+
+    //persistent contexts are used for subscriptions. no request to measure
+    if(!ctx->persistent_ctx)
+        redis_rtt.record(std::chrono::steady_clock::now() - ctx->sent_at);
     //DBG("got reply from redis");
     if(reply == nullptr) {
         ERROR("%s: I/O error", ctx->src_id.c_str());
@@ -65,34 +83,263 @@ static void redis_request_cb_static(redisAsyncContext *, void *r, void *privdata
     if(!ctx->persistent_ctx) delete ctx;
 }
 
-RedisConnectionPool::RedisConnectionPool(const char* name, const string &queue_name)
-  : AmEventFdQueue(this),
-    epoll_fd(-1),
-    name(name),
-    queue_name(queue_name),
-    stopped(false)
+RedisIoLoop::RedisIoLoop(const char *name)
+  : epoll_fd(-1),
+    name(name)
 {}
 
-RedisConnectionPool::~RedisConnectionPool()
+RedisIoLoop::~RedisIoLoop()
 {
-    CLASS_DBG("RedisConnectionPool::~RedisConnectionPool()");
     for(auto &ctx: persistent_reply_contexts)
         delete ctx;
 }
 
-int RedisConnectionPool::init()
+int RedisIoLoop::init_loop()
 {
     if((epoll_fd = epoll_create(10)) == -1) {
         ERROR("epoll_create call failed");
         return -1;
     }
 
-    stop_event.link(epoll_fd,true);
-
     reconnect_timer.link(epoll_fd,true);
     reconnect_timer.set(2e6,true);
 
+    return 0;
+}
+
+void RedisIoLoop::close_loop()
+{
+    close(epoll_fd);
+}
+
+bool RedisIoLoop::process_loop_event(struct epoll_event &e)
+{
+    void *p = e.data.ptr;
+    if(p==&reconnect_timer) {
+        reconnect_timer.read();
+        reconnect_all();
+        return true;
+    }
+
+    for(auto &c : connections) {
+        if(c->get_async_context() != p)
+            continue;
+        if(e.events & EPOLLIN) {
+            redis::redisAsyncHandleRead((redisAsyncContext*)p);
+        }
+        if(e.events & EPOLLOUT) {
+            redis::redisAsyncHandleWrite((redisAsyncContext*)p);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void RedisIoLoop::send_request(RedisRequestEvent& event)
+{
+    RedisConnection* c = event.getConnection();
+    redisAsyncContext* context = c->get_async_context();
+    if(c->is_connected()) {
+        if(!event.src_id.empty()) {
+            if(event.user_data && event.persistent_ctx) {
+                ERROR("%s:%d user_data is not allowed for persistent context. clear it",
+                    event.src_id.data(), event.user_type_id);
+                event.user_data.reset();
+            }
+
+            auto ctx = new RedisReplyCtx(c,event);
+            if(REDIS_OK!=redis::redisAsyncFormattedCommand(
+                context,
+                &redis_request_cb_static, ctx,
+                event.cmd.get(),event.cmd_size))
+            {
+                AmSessionContainer::instance()->postEvent(
+                    ctx->src_id,
+                    new RedisReplyEvent(RedisReplyEvent::FailedToSend,event));
+                delete ctx;
+                return;
+            }
+            //set reply ctx for persistent contexts
+            if(ctx->persistent_ctx) {
+                persistent_reply_contexts.push_back(ctx);
+            }
+        } else {
+            if(REDIS_OK!=redis::redisAsyncFormattedCommand(
+                context,
+                nullptr, nullptr,
+                event.cmd.get(),event.cmd_size))
+            { }
+        }
+    } else {
+        if(!event.src_id.empty())
+            AmSessionContainer::instance()->postEvent(
+                event.src_id,
+                new RedisReplyEvent(RedisReplyEvent::NotConnected,event));
+    }
+}
+
+void RedisIoLoop::disconnect(RedisConnection *c)
+{
+    if(c->is_connected())
+        redis::redisAsyncDisconnect(c->get_async_context());
+}
+
+void RedisIoLoop::disconnect_all()
+{
+    for(auto& connection : connections)
+        disconnect(connection);
+}
+
+void RedisIoLoop::reconnect_all()
+{
+    for(auto& connection : connections){
+        connection->on_reconnect();
+    }
+}
+
+RedisConnection* RedisIoLoop::add_loop_connection(
+    RedisConnectionPool *pool, RedisIoThread *io_thread,
+    const string &host, int port)
+{
+    RedisConnection* conn = new RedisConnection(name, pool, io_thread);
+    if(conn->init(epoll_fd, host, port)) {
+        delete conn;
+        return 0;
+    }
+
+    connections.push_back(conn);
+    return conn;
+}
+
+RedisIoThread::RedisIoThread(const char *name, unsigned int idx)
+  : AmEventFdQueue(this),
+    RedisIoLoop(name),
+    thread_name(string(name) + "-io" + int2str(idx)),
+    stopped(false),
+    running(false)
+{}
+
+int RedisIoThread::init()
+{
+    if(init_loop())
+        return -1;
+
+    stop_event.link(epoll_fd,true);
     epoll_link(epoll_fd,true);
+
+    return 0;
+}
+
+void RedisIoThread::run()
+{
+    int ret;
+    void *p;
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+
+    setThreadName(thread_name.data());
+
+    DBG("start async redis I/O thread '%s'", thread_name.data());
+
+    auto self_queue_ptr = dynamic_cast<AmEventFdQueue *>(this);
+    running = true;
+    do {
+        ret = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, -1);
+
+        if(ret == -1 && errno != EINTR){
+            ERROR("epoll_wait: %s",strerror(errno));
+        }
+
+        if(ret < 1)
+            continue;
+
+        for (int n = 0; n < ret; ++n) {
+            struct epoll_event &e = events[n];
+            p = e.data.ptr;
+            if(p==&stop_event) {
+                disconnect_all();
+                stop_event.read();
+                running = false;
+                break;
+            } else if(p==self_queue_ptr) {
+                processEvents();
+            } else if(!p) {
+                CLASS_ERROR("got event on null async_context. ignore");
+            } else if(!process_loop_event(e)) {
+                CLASS_ERROR("got event on unknown async_context. ignore");
+            }
+        }
+    } while(running);
+
+    epoll_unlink(epoll_fd);
+    close_loop();
+
+    DBG("async redis I/O thread '%s' stopped", thread_name.data());
+
+    stopped.set(true);
+}
+
+void RedisIoThread::on_stop()
+{
+    stop_event.fire();
+    stopped.wait_for();
+}
+
+void RedisIoThread::process(AmEvent* ev)
+{
+    switch(ev->event_id) {
+    case REDIS_REQUEST_EVENT_ID:
+        if(RedisRequestEvent *e = dynamic_cast<RedisRequestEvent*>(ev)) {
+            send_request(*e);
+            return;
+        }
+        break;
+    case REDIS_DISCONNECT_EVENT_ID:
+        if(RedisConnectionEvent *e = dynamic_cast<RedisConnectionEvent*>(ev)) {
+            disconnect(e->c);
+            return;
+        }
+        break;
+    }
+    ERROR("%s: got unexpected event", thread_name.data());
+}
+
+bool RedisIoThread::post_request(RedisRequestEvent *ev)
+{
+    if(!running)
+        return false;
+    postEvent(ev);
+    return true;
+}
+
+RedisConnectionPool::RedisConnectionPool(const char* name, const string &queue_name)
+  : AmEventFdQueue(this),
+    RedisIoLoop(name),
+    queue_name(queue_name),
+    stopped(false),
+    io_threads_count(0),
+    next_io_thread(0)
+{}
+
+RedisConnectionPool::~RedisConnectionPool()
+{
+    CLASS_DBG("RedisConnectionPool::~RedisConnectionPool()");
+}
+
+int RedisConnectionPool::init()
+{
+    if(init_loop())
+        return -1;
+
+    stop_event.link(epoll_fd,true);
+    epoll_link(epoll_fd,true);
+
+    for(unsigned int i = 0; i < io_threads_count; i++) {
+        io_threads.emplace_back(new RedisIoThread(name, i));
+        if(io_threads.back()->init())
+            return -1;
+    }
+
     return 0;
 }
 
@@ -106,7 +353,10 @@ void RedisConnectionPool::run()
     setThreadName(name);
     AmEventDispatcher::instance()->addEventQueue(queue_name, this);
 
-    DBG("start async redis '%s'", name);
+    DBG("start async redis '%s' with %u I/O threads", name, io_threads_count);
+
+    for(auto &t : io_threads)
+        t->start();
 
     auto self_queue_ptr = dynamic_cast<AmEventFdQueue *>(this);
     running = true;
@@ -123,27 +373,17 @@ void RedisConnectionPool::run()
         for (int n = 0; n < ret; ++n) {
             struct epoll_event &e = events[n];
             p = e.data.ptr;
-            if(p==&reconnect_timer) {
-                reconnect_timer.read();
-                on_reconnect();
-            } else if(p==&stop_event) {
+            if(p==&stop_event) {
                 process_stop_event();
                 stop_event.read();
                 running = false;
                 break;
             } else if(p==self_queue_ptr) {
                 processEvents();
-            } else {
-                if(!p) {
-                    CLASS_ERROR("got event on null async_context. ignore");
-                    continue;
-                }
-                if(e.events & EPOLLIN) {
-                    redis::redisAsyncHandleRead((redisAsyncContext*)p);
-                }
-                if(e.events & EPOLLOUT) {
-                    redis::redisAsyncHandleWrite((redisAsyncContext*)p);
-                }
+            } else if(!p) {
+                CLASS_ERROR("got event on null async_context. ignore");
+            } else if(!process_loop_event(e)) {
+                CLASS_ERROR("got event on unknown async_context. ignore");
             }
         }
     } while(running);
@@ -151,7 +391,7 @@ void RedisConnectionPool::run()
     AmEventDispatcher::instance()->delEventQueue(queue_name);
 
     epoll_unlink(epoll_fd);
-    close(epoll_fd);
+    close_loop();
 
     DBG("async redis '%s' stopped", name);
 
@@ -180,78 +420,81 @@ void RedisConnectionPool::process(AmEvent* ev)
             return;
         }
         break;
+    case REDIS_CONNECT_EVENT_ID:
+        if(RedisConnectionEvent *e = dynamic_cast<RedisConnectionEvent*>(ev)) {
+            if(e->c->is_connected())
+                on_connect(e->c);
+            return;
+        }
+        break;
     }
     ERROR("%s: got unexpected event", name);
 }
 
 void RedisConnectionPool::process_request_event(RedisRequestEvent& event)
 {
-    RedisConnection* c = event.getConnection();
-    redisAsyncContext* context = c->get_async_context();
-    if(c->is_connected()) {
-        if(!event.src_id.empty()) {
-            if(event.user_data && event.persistent_ctx) {
-                ERROR("%s:%d user_data is not allowed for persistent context. clear it",
-                    event.src_id.data(), event.user_type_id);
-                event.user_data.reset();
-            }
+    RedisIoThread *io_thread = event.getConnection()->get_io_thread();
+    if(!io_thread) {
+        send_request(event);
+        return;
+    }
 
-            auto ctx = new RedisReplyCtx(c,event);
-            if(REDIS_OK!=redis::redisAsyncFormattedCommand(
-                context,
-                &redis_request_cb_static, ctx,
-                event.cmd.get(),event.cmd_size))
-            {
-                AmSessionContainer::instance()->postEvent(
-                    ctx->src_id,
-                    new RedisReplyEvent(RedisReplyEvent::FailedToSend,event));
-                delete ctx;
-                return;
-            }
-            //set reply ctx for persistent contexts
-            if(ctx->persistent_ctx) {
-                persistent_reply_contexts.push_back(ctx);
-            }
-        } else {
-            if(REDIS_OK!=redis::redisAsyncFormattedCommand(
-                context,
-                nullptr, nullptr,
-                event.cmd.get(),event.cmd_size))
-            { }
-        }
-    } else {
+    //posted to the pool queue by name. pass to the thread serving the connection
+    if(!io_thread->is_running()) {
         if(!event.src_id.empty())
             AmSessionContainer::instance()->postEvent(
                 event.src_id,
                 new RedisReplyEvent(RedisReplyEvent::NotConnected,event));
+        return;
+    }
+    auto ev = new RedisRequestEvent(std::move(event));
+    if(!io_thread->post_request(ev)) {
+        //stopped after the check above
+        if(!ev->src_id.empty())
+            AmSessionContainer::instance()->postEvent(
+                ev->src_id,
+                new RedisReplyEvent(RedisReplyEvent::NotConnected,*ev));
+        delete ev;
     }
 }
 
 void RedisConnectionPool::process_stop_event()
 {
-    for(auto& connection : connections){
-        if(connection->is_connected())
-            redis::redisAsyncDisconnect(connection->get_async_context());
-    }
+    disconnect_all();
+    for(auto &t : io_threads)
+        t->stop(true);
 }
 
 RedisConnection * RedisConnectionPool::addConnection(const std::string& _host, int _port)
 {
-    RedisConnection* conn = new RedisConnection(name, this);
-    if(conn->init(epoll_fd, _host, _port)) {
-        delete conn;
-        return 0;
+    if(io_threads.empty())
+        return add_loop_connection(this, nullptr, _host, _port);
+
+    auto &t = io_threads[next_io_thread++ % io_threads.size()];
+    return t->add_loop_connection(this, t.get(), _host, _port);
+}
+
+void RedisConnectionPool::notify_connect(RedisConnection* c)
+{
+    if(!c->get_io_thread()) {
+        on_connect(c);
+        return;
     }
+    postEvent(new RedisConnectionEvent(REDIS_CONNECT_EVENT_ID, c));
+}
 
-    connections.push_back(conn);
-    return conn;
+void RedisConnectionPool::disconnect(RedisConnection* c)
+{
+    if(RedisIoThread *io_thread = c->get_io_thread()) {
+        io_thread->postEvent(new RedisConnectionEvent(REDIS_DISCONNECT_EVENT_ID, c));
+        return;
+    }
+    RedisIoLoop::disconnect(c);
 }
 
 void RedisConnectionPool::on_reconnect()
 {
-    for(auto& connection : connections){
-        connection->on_reconnect();
-    }
+    reconnect_all();
 }
 
 void RedisConnectionPool::on_stop()
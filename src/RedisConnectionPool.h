@@ -4,13 +4,23 @@
 #include <AmArg.h>
 #include <AmEventFdQueue.h>
 #include <AmSessionContainer.h>
+#include <AmEventDispatcher.h>
 
 #include "RedisInstance.h"
+#include "RedisConnection.h"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
 
 #define REDIS_REQUEST_EVENT_ID 0
 #define REDIS_REPLY_EVENT_ID 1
+#define REDIS_CONNECT_EVENT_ID 2
+#define REDIS_DISCONNECT_EVENT_ID 3
 
 class RedisConnection;
+class RedisConnectionPool;
+class RedisIoThread;
 
 struct RedisRequestEvent
   : public AmEvent
@@ -58,17 +68,23 @@ struct RedisReplyCtx {
     string src_id;
     std::unique_ptr<AmObject> user_data;
     int user_type_id;
+    std::chrono::steady_clock::time_point sent_at;
 
     RedisReplyCtx(RedisConnection *c, RedisRequestEvent &r)
       : c(c),
         persistent_ctx(r.persistent_ctx),
         src_id(std::move(r.src_id)),
         user_data(std::move(r.user_data)),
-        user_type_id(r.user_type_id)
+        user_type_id(r.user_type_id),
+        sent_at(std::chrono::steady_clock::now())
     {}
     //~RedisReplyCtx() { CLASS_DBG("~RedisReplyCtx()"); }
 };
 
+struct RedisReplyDeleter {
+    void operator()(redisReply *reply) const { redis::freeDetachedReply(reply); }
+};
+
 struct RedisReplyEvent
   : public AmEvent
 {
@@ -81,31 +97,116 @@ struct RedisReplyEvent
         FailedToSend
     } result;
 
-    AmArg data;
+  private:
+    //detached from hiredis in the pool thread. converted to AmArg on demand only
+    std::unique_ptr<redisReply, RedisReplyDeleter> raw_reply;
+    mutable AmArg converted_data;
+    mutable bool data_converted;
+
+  public:
     std::unique_ptr<AmObject> user_data;
     int user_type_id;
 
     RedisReplyEvent(redisReply *reply, RedisReplyCtx &ctx);
     RedisReplyEvent(result_type result, RedisRequestEvent &request);
     virtual ~RedisReplyEvent();
+
+    //zero-copy access to the reply. NIL for the replies without data
+    RedisReplyView reply() const { return RedisReplyView(raw_reply.get()); }
+    //whole reply converted to AmArg on the first call
+    AmArg &data() const;
+};
+
+//connection state change passed between the pool and the I/O threads
+struct RedisConnectionEvent
+  : public AmEvent
+{
+    RedisConnection *c;
+
+    RedisConnectionEvent(int event_id, RedisConnection *c)
+      : AmEvent(event_id),
+        c(c)
+    {}
+};
+
+/* sockets I/O and replies parsing for the connections linked to epoll_fd.
+ * must be used from the single thread running the loop only */
+class RedisIoLoop
+{
+  protected:
+    int epoll_fd;
+    const char *name;
+
+    AmTimerFd reconnect_timer;
+
+    std::list<RedisReplyCtx *> persistent_reply_contexts;
+    std::list<RedisConnection*> connections;
+
+    RedisIoLoop(const char *name);
+    virtual ~RedisIoLoop();
+
+    int init_loop();
+    void close_loop();
+    //returns false for the events not related to the loop
+    bool process_loop_event(struct epoll_event &e);
+
+    void send_request(RedisRequestEvent &event);
+    void disconnect(RedisConnection *c);
+    void disconnect_all();
+    void reconnect_all();
+    RedisConnection* add_loop_connection(RedisConnectionPool *pool, RedisIoThread *io_thread,
+                                         const string &host, int port);
+};
+
+/* serves the part of the pool connections in the separate thread.
+ * connection is bound to the single thread for the whole lifetime
+ * so the requests order is kept per connection */
+class RedisIoThread
+  : public AmThread,
+    public AmEventFdQueue,
+    public AmEventHandler,
+    public RedisIoLoop
+{
+    string thread_name;
+
+    AmEventFd stop_event;
+    AmCondition<bool> stopped;
+    std::atomic<bool> running;
+
+    friend class RedisConnectionPool;
+
+  public:
+    RedisIoThread(const char *name, unsigned int idx);
+
+    int init();
+    void run() override;
+    void on_stop() override;
+    void process(AmEvent* ev) override;
+
+    /* enqueues the request to the thread without the global queues lookup.
+     * the request is not deleted if the thread is stopped */
+    bool post_request(RedisRequestEvent *ev);
+    bool is_running() { return running; }
 };
 
 class RedisConnectionPool
   : public AmThread,
     public AmEventFdQueue,
-    public AmEventHandler
+    public AmEventHandler,
+    protected RedisIoLoop
 {
-    int epoll_fd;
-    const char *name;
     string queue_name;
 
     AmEventFd stop_event;
     AmCondition<bool> stopped;
 
-    AmTimerFd reconnect_timer;
+    unsigned int io_threads_count;
+    std::vector<std::unique_ptr<RedisIoThread>> io_threads;
+    size_t next_io_thread;
 
-    std::list<RedisReplyCtx *> persistent_reply_contexts;
-    std::list<RedisConnection*> connections;
+    friend class RedisConnection;
+    //called from the thread serving the connection
+    void notify_connect(RedisConnection* c);
 protected:
     int init();
 public:
@@ -121,24 +222,45 @@ public:
     RedisConnection* addConnection(const string &_host, int _port);
     string get_queue_name() { return queue_name; }
 
+    /* connections are spread over count threads in the round-robin order
+     * leaving the pool thread for the replies processing.
+     * 0 to serve them in the pool thread. must be called before init() */
+    void set_io_threads(unsigned int count) { io_threads_count = count; }
+    unsigned int get_io_threads() { return io_threads_count; }
+    //safe to call from any thread
+    void disconnect(RedisConnection* c);
+
     virtual void process_reply_event(RedisReplyEvent& event) = 0;
+    //called from the pool thread
     virtual void on_connect(RedisConnection* c){}
+    //called from the thread serving the connection before the replies for the lost requests
     virtual void on_disconnect(RedisConnection* c){}
 };
 
+/* user_data is owned by the request after the successful post.
+ * it is not deleted if the request is not posted */
 static inline bool postRedisRequest(RedisConnection* c, const string &queue_name, const string &src_tag,
                                     char *cmd, size_t cmd_size,
                                     bool cmd_allocated_by_redis,
                                     bool persistent_ctx = false,
                                     AmObject *user_data = nullptr, int user_type_id = 0)
 {
-    return AmSessionContainer::instance()->postEvent(
-        queue_name,
-        new RedisRequestEvent(c, src_tag,
-                              cmd,cmd_size,
-                              cmd_allocated_by_redis,
-                              persistent_ctx,
-                              user_data,user_type_id));
+    auto ev = new RedisRequestEvent(c, src_tag,
+                                    cmd,cmd_size,
+                                    cmd_allocated_by_redis,
+                                    persistent_ctx,
+                                    user_data,user_type_id);
+    bool posted;
+    if(RedisIoThread *io_thread = c ? c->get_io_thread() : nullptr)
+        posted = io_thread->post_request(ev);
+    else
+        posted = AmEventDispatcher::instance()->post(queue_name, ev);
+
+    if(!posted) {
+        ev->user_data.release();
+        delete ev;
+    }
+    return posted;
 }
 
 static inline bool postRedisRequestFmt(RedisConnection* c, const string &queue_name,
@@ -6,6 +6,7 @@
 #include <netinet/in.h>
 #include <fcntl.h>
 #include <string.h>
+#include <errno.h>
 #include <log.h>
 #include <AmUtils.h>
 
@@ -404,6 +405,30 @@ void redisFreeCommand(char* cmd)
     ::redisFreeCommand(cmd);
 }
 
+redisReply* detachReply(redisReply* reply)
+{
+    if(!reply) return nullptr;
+
+    redisReply* ret = (redisReply*)malloc(sizeof(redisReply));
+    memcpy(ret, reply, sizeof(redisReply));
+
+    reply->type = REDIS_REPLY_NIL;
+    reply->str = nullptr;
+    reply->len = 0;
+    reply->element = nullptr;
+    reply->elements = 0;
+
+    return ret;
+}
+
+void freeDetachedReply(redisReply* reply)
+{
+    if(!reply) return;
+    //test instance allocates replies on its own
+    if(_instance_) _instance_->freeReplyObject(reply);
+    else ::freeReplyObject(reply);
+}
+
 int redisAsyncFormattedCommand(redisAsyncContext *ac, redisCallbackFn *fn, void *privdata, const char *cmd, size_t len)
 {
     redisInstanceContext* context = (redisInstanceContext*)ac;
@@ -599,6 +624,90 @@ void redisReply2Amarg(AmArg &a, redisReply *reply)
     }
 }
 
+int RedisReplyView::getType() const
+{
+    return reply ? reply->type : REDIS_REPLY_NIL;
+}
+
+bool RedisReplyView::isNil() const
+{
+    return !reply || reply->type == REDIS_REPLY_NIL;
+}
+
+bool RedisReplyView::isString() const
+{
+    return reply && reply->type == REDIS_REPLY_STRING;
+}
+
+bool RedisReplyView::isInteger() const
+{
+    return reply && reply->type == REDIS_REPLY_INTEGER;
+}
+
+bool RedisReplyView::isArray() const
+{
+    return reply && reply->type == REDIS_REPLY_ARRAY;
+}
+
+bool RedisReplyView::isStatus() const
+{
+    return reply && reply->type == REDIS_REPLY_STATUS;
+}
+
+bool RedisReplyView::isError() const
+{
+    return reply && reply->type == REDIS_REPLY_ERROR;
+}
+
+std::string_view RedisReplyView::str() const
+{
+    if(!reply || !reply->str) return std::string_view();
+    switch(reply->type) {
+    case REDIS_REPLY_STRING:
+    case REDIS_REPLY_STATUS:
+    case REDIS_REPLY_ERROR:
+        return std::string_view(reply->str, reply->len);
+    default:
+        return std::string_view();
+    }
+}
+
+long long RedisReplyView::integer() const
+{
+    return isInteger() ? reply->integer : 0;
+}
+
+bool RedisReplyView::toInt(long long &value) const
+{
+    if(isInteger()) {
+        value = reply->integer;
+        return true;
+    }
+    if(!isString() || !reply->len) return false;
+
+    //reply strings are null-terminated by hiredis
+    char *end;
+    errno = 0;
+    value = strtoll(reply->str, &end, 10);
+    return !errno && end == reply->str + reply->len;
+}
+
+size_t RedisReplyView::size() const
+{
+    return isArray() ? reply->elements : 0;
+}
+
+RedisReplyView RedisReplyView::operator[](size_t i) const
+{
+    if(i >= size()) return RedisReplyView();
+    return RedisReplyView(reply->element[i]);
+}
+
+void RedisReplyView::toAmArg(AmArg &a) const
+{
+    if(reply) redisReply2Amarg(a, const_cast<redisReply *>(reply));
+}
+
 static bool isArgNumber(const AmArg& arg) {
     return isArgInt(arg) || isArgLongLong(arg) || isArgDouble(arg);
 }
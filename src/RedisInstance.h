@@ -4,6 +4,8 @@
 #include <time.h>
 #include <AmArg.h>
 
+#include <string_view>
+
 struct redisContext;
 struct redisAsyncContext;
 struct redisReply;
@@ -60,6 +62,11 @@ void freeReplyObject(redisContext* context, void *reply);
 int redisvFormatCommand(char** cmd, const  char* fmt, va_list args);
 int redisFormatCommand(char** cmd, const  char* fmt, ...);
 void redisFreeCommand(char* cmd);
+
+/* moves the reply tree to the new top-level object in O(1)
+ * leaving the empty NIL reply to be freed by hiredis after the callback */
+redisReply* detachReply(redisReply* reply);
+void freeDetachedReply(redisReply* reply);
 }
 
 struct GetReplyException {
@@ -86,4 +93,37 @@ AmArg runMultiCommand(redisContext * ctx, const std::vector<std::string>& comman
 void redisReply2Amarg(AmArg &a, redisReply *r);
 void Amarg2redisReply(const AmArg &a, redisReply **r);
 
+/* read-only view of the hiredis reply.
+ * allows to parse the reply without the deep copy to AmArg */
+class RedisReplyView {
+    const redisReply *reply;
+
+  public:
+    RedisReplyView(const redisReply *reply = nullptr)
+      : reply(reply)
+    {}
+
+    //REDIS_REPLY_* type. absent reply is treated as NIL
+    int getType() const;
+    bool isNil() const;
+    bool isString() const;
+    bool isInteger() const;
+    bool isArray() const;
+    bool isStatus() const;
+    bool isError() const;
+
+    //string, status and error replies. empty for the other types
+    std::string_view str() const;
+    long long integer() const;
+    /* integer or numeric string reply.
+     * returns false for the other types or non-numeric strings */
+    bool toInt(long long &value) const;
+
+    //array elements count. 0 for the other types
+    size_t size() const;
+    RedisReplyView operator[](size_t i) const;
+
+    void toAmArg(AmArg &a) const;
+};
+
 #endif/*REDIS_INSTANCE_H*/
@@ -6,14 +6,18 @@
 #define REDIS_REPLY_SCRIPT_LOAD 0
 #define REDIS_REPLY_SUBSCRIPTION 1
 #define REDIS_REPLY_CONTACTS_DATA 2
+#define REDIS_REPLY_NOTIFY_CONFIG 3
 
 static const string REGISTAR_QUEUE_NAME("registrar");
 
 RegistrarRedisConnection::ContactsSubscriptionConnection::ContactsSubscriptionConnection(
-    KeepAliveContexts &keepalive_contexts)
+    KeepAliveContexts &keepalive_contexts,
+    AorLookupCache &aor_cache)
   : RedisConnectionPool("reg_sub", "reg_async_redis_sub"),
     keepalive_contexts(keepalive_contexts),
-    load_contacts_data("load_contacts_data", get_queue_name())
+    aor_cache(aor_cache),
+    load_contacts_data("load_contacts_data", get_queue_name()),
+    notify_config_valid(false)
 {}
 
 void RegistrarRedisConnection::ContactsSubscriptionConnection::on_connect(RedisConnection* c)
@@ -22,28 +26,35 @@ void RegistrarRedisConnection::ContactsSubscriptionConnection::on_connect(RedisC
     load_contacts_data.load(c, "/etc/yeti/scripts/load_contacts.lua", REDIS_REPLY_SCRIPT_LOAD);
 }
 
+void RegistrarRedisConnection::ContactsSubscriptionConnection::on_disconnect(RedisConnection*)
+{
+    //keyspace events will be lost until the resubscription
+    aor_cache.setReady(false);
+    notify_config_valid = false;
+}
+
 void RegistrarRedisConnection::ContactsSubscriptionConnection::process_reply_event(RedisReplyEvent &event)
 {
     /*DBG("ContactsSubscriptionConnection got event %d. data: %s",
-        event.user_type_id, AmArg::print(event.data).c_str());*/
+        event.user_type_id, AmArg::print(event.data()).c_str());*/
 
     if(event.result!=RedisReplyEvent::SuccessReply) {
-        DBG("non-succ reply: %d, data: %s",event.result, AmArg::print(event.data).data());
+        DBG("non-succ reply: %d, data: %s",event.result, AmArg::print(event.data()).data());
         if(REDIS_REPLY_SCRIPT_LOAD == event.user_type_id) event.user_data.release();
+        if(REDIS_REPLY_NOTIFY_CONFIG == event.user_type_id) {
+            ERROR("failed to get notify-keyspace-events config. AoR lookup cache will not be used");
+        }
         return;
     }
 
     switch(event.user_type_id) {
     case REDIS_REPLY_SUBSCRIPTION:
-        if(isArgArray(event.data) &&
-           event.data.size() == 3)
-        {
-            process_expired_key(event.data[2]);
-        }
+        if(event.reply().size() == 3)
+            process_subscription_message(event.reply());
         break;
     case REDIS_REPLY_SCRIPT_LOAD: {
         auto script = dynamic_cast<RedisScript *>(event.user_data.release());
-        script->hash = event.data.asCStr();
+        script->hash = event.reply().str();
         DBG("script '%s' loaded with hash '%s'",
             script->name.c_str(),script->hash.c_str());
         //execute load_contacts script
@@ -57,7 +68,10 @@ void RegistrarRedisConnection::ContactsSubscriptionConnection::process_reply_eve
         }
     } break;
     case REDIS_REPLY_CONTACTS_DATA:
-        process_loaded_contacts(event.data);
+        process_loaded_contacts(event.reply());
+        break;
+    case REDIS_REPLY_NOTIFY_CONFIG:
+        process_notify_config(event.reply());
         break;
     default:
         ERROR("unexpected reply event with type: %d",event.user_type_id);
@@ -107,28 +121,33 @@ void RegistrarRedisConnection::KeepAliveContexts::dump(AmArg &ret)
     }
 }
 
-void RegistrarRedisConnection::ContactsSubscriptionConnection::process_loaded_contacts(const AmArg &data)
+void RegistrarRedisConnection::ContactsSubscriptionConnection::process_loaded_contacts(const RedisReplyView &data)
 {
     AmLock l(keepalive_contexts.mutex);
 
     keepalive_contexts.clear();
 
-    if(!isArgArray(data))
+    if(!data.isArray())
         return;
 
     KeepAliveContexts::iterator it;
 
     DBG("process_loaded_contacts");
-    int n = static_cast<int>(data.size());
-    for(int i = 0; i < n; i++) {
-        AmArg &d = data[i];
-        if(!isArgArray(d) || d.size() != 4) //validate
+    size_t n = data.size();
+    for(size_t i = 0; i < n; i++) {
+        RedisReplyView d = data[i];
+        if(!d.isArray() || d.size() != 4) //validate
+            continue;
+        long long node_id, interface_id;
+        if(!d[0].toInt(node_id) || node_id != AmConfig.node_id) //skip other nodes registrations
             continue;
-        if(arg2int(d[0]) != AmConfig.node_id) //skip other nodes registrations
+        if(!d[2].toInt(interface_id)) {
+            ERROR("wrong interface_id for the contact %zd. skip it", i);
             continue;
-        DBG("process contact: %s",AmArg::print(d).c_str());
+        }
 
-        string key(d[3].asCStr());
+        string key(d[3].str());
+        DBG("process contact: %s",key.c_str());
 
         auto pos = key.find_first_of(':');
         if(pos == string::npos) {
@@ -145,40 +164,104 @@ void RegistrarRedisConnection::ContactsSubscriptionConnection::process_loaded_co
         keepalive_contexts.emplace(std::make_pair(
             key,
             keepalive_ctx_data(
-                key.substr(pos),  //aor
-                d[1].asCStr(),    //path
-                arg2int(d[2])))); // interface_id
+                key.substr(pos),                        //aor
+                string(d[1].str()),                     //path
+                static_cast<int>(interface_id))));      //interface_id
     }
 
     //keepalive_contexts.dump();
 
+    /* AoR lookup cache invalidation relies on the hset/del/expired keyevent
+     * notifications. check server config before the subscription
+     * (the connection accepts only subscription commands after it) */
+    if(aor_cache.isEnabled() &&
+       !postRedisRequestFmt(conn,
+            get_queue_name(), get_queue_name(), false,
+            nullptr, REDIS_REPLY_NOTIFY_CONFIG,
+            "CONFIG GET notify-keyspace-events"))
+    {
+        ERROR("failed to get notify-keyspace-events config");
+    }
+
     //subscribe to del/expire events
+    //and to hset events to invalidate AoR lookup cache on bindings changes
     if(!postRedisRequestFmt(conn,
         get_queue_name(), get_queue_name(), true,
         nullptr, REDIS_REPLY_SUBSCRIPTION,
         //"PSUBSCRIBE __keyspace@0__:c:*",
-        "SUBSCRIBE __keyevent@0__:expired __keyevent@0__:del"))
+        aor_cache.isEnabled() ?
+            "SUBSCRIBE __keyevent@0__:expired __keyevent@0__:del __keyevent@0__:hset" :
+            "SUBSCRIBE __keyevent@0__:expired __keyevent@0__:del"))
     {
         ERROR("failed to subscribe");
     }
 }
 
-void RegistrarRedisConnection::ContactsSubscriptionConnection::process_expired_key(const AmArg &key_arg)
+void RegistrarRedisConnection::ContactsSubscriptionConnection::process_notify_config(const RedisReplyView &data)
+{
+    //[ "notify-keyspace-events", flags ]
+    if(!data.isArray() || data.size() != 2 || !data[1].isString()) {
+        AmArg a;
+        data.toAmArg(a);
+        ERROR("unexpected notify-keyspace-events config reply: %s. "
+              "AoR lookup cache will not be used",
+              AmArg::print(a).data());
+        return;
+    }
+
+    string flags(data[1].str());
+    notify_config_valid = AorLookupCache::checkNotifyKeyspaceEvents(flags);
+    if(!notify_config_valid) {
+        ERROR("redis notify-keyspace-events '%s' has no keyevent notifications "
+              "for hash/generic/expired commands (expected: 'E' with 'A' or 'hgx'). "
+              "AoR lookup cache will not be used",
+              flags.c_str());
+    }
+}
+
+void RegistrarRedisConnection::ContactsSubscriptionConnection::process_subscription_message(const RedisReplyView &data)
+{
+    /* [ "subscribe", channel, subscriptions count ]
+     * [ "message", channel, key ] */
+    if(!data[0].isString() || !data[1].isString())
+        return;
+
+    if(data[0].str() == "subscribe") {
+        if(notify_config_valid)
+            aor_cache.setReady(true);
+        return;
+    }
+
+    if(!data[2].isString())
+        return;
+
+    string key(data[2].str());
+    aor_cache.invalidateKey(key.c_str());
+
+    static const char hset_channel[] = "__keyevent@0__:hset";
+    if(data[1].str() == hset_channel)
+        return;
+
+    process_expired_key(data[2]);
+}
+
+void RegistrarRedisConnection::ContactsSubscriptionConnection::process_expired_key(const RedisReplyView &key_arg)
 {
-    if(!isArgCStr(key_arg)) //skip 'subscription' replies
+    if(!key_arg.isString()) //skip 'subscription' replies
         return;
 
-    DBG("process expired/removed key: '%s'", key_arg.asCStr());
+    string key(key_arg.str());
+    DBG("process expired/removed key: '%s'", key.c_str());
 
     keepalive_contexts.mutex.lock();
-    keepalive_contexts.erase(key_arg.asCStr());
+    keepalive_contexts.erase(key);
     //keepalive_contexts.dump();
     keepalive_contexts.mutex.unlock();
 }
 
 RegistrarRedisConnection::RegistrarRedisConnection()
   : RedisConnectionPool("reg", REGISTAR_QUEUE_NAME),
-     contacts_subscription(keepalive_contexts),
+     contacts_subscription(keepalive_contexts, aor_cache),
      yeti_register("yeti_register", REGISTAR_QUEUE_NAME),
      yeti_aor_lookup("yeti_aor_lookup", REGISTAR_QUEUE_NAME),
      yeti_rpc_aor_lookup("yeti_rpc_aor_lookup", REGISTAR_QUEUE_NAME),
@@ -236,13 +319,13 @@ void RegistrarRedisConnection::process(AmEvent* ev)
 }
 void RegistrarRedisConnection::process_reply_event(RedisReplyEvent &event)
 {
-    //DBG("got event. data: %s",AmArg::print(event.data).c_str());
+    //DBG("got event. data: %s",AmArg::print(event.data()).c_str());
     RedisScript *script;
     switch(event.user_type_id) {
     case REDIS_REPLY_SCRIPT_LOAD:
         script = dynamic_cast<RedisScript *>(event.user_data.release());
         if(event.result==RedisReplyEvent::SuccessReply) {
-            script->hash = event.data.asCStr();
+            script->hash = event.reply().str();
             DBG("script '%s' loaded with hash '%s'",
                 script->name.c_str(),script->hash.c_str());
         }
@@ -255,28 +338,40 @@ void RegistrarRedisConnection::process_reply_event(RedisReplyEvent &event)
 
 bool RegistrarRedisConnection::fetch_all(const AmSipRequest &req, Auth::auth_id_type auth_id)
 {
-    return postRedisRequestFmt(
+    std::unique_ptr<AmSipRequest> ctx(new AmSipRequest(req));
+    if(!postRedisRequestFmt(
         conn,
         get_queue_name(),
         YETI_QUEUE_NAME,
         false,
-        new AmSipRequest(req), YETI_REDIS_REGISTER_TYPE_ID,
+        ctx.get(), YETI_REDIS_REGISTER_TYPE_ID,
         "EVALSHA %s 1 %d",
         yeti_register.hash.c_str(),
-        auth_id);
+        auth_id))
+    {
+        return false;
+    }
+    ctx.release();
+    return true;
 }
 
 bool RegistrarRedisConnection::unbind_all(const AmSipRequest &req, Auth::auth_id_type auth_id)
 {
-    return postRedisRequestFmt(
+    std::unique_ptr<AmSipRequest> ctx(new AmSipRequest(req));
+    if(!postRedisRequestFmt(
         conn,
         get_queue_name(),
         YETI_QUEUE_NAME,
         false,
-        new AmSipRequest(req), YETI_REDIS_REGISTER_TYPE_ID,
+        ctx.get(), YETI_REDIS_REGISTER_TYPE_ID,
         "EVALSHA %s 1 %d 0",
         yeti_register.hash.c_str(),
-        auth_id);
+        auth_id))
+    {
+        return false;
+    }
+    ctx.release();
+    return true;
 }
 
 bool RegistrarRedisConnection::bind(
@@ -286,18 +381,24 @@ bool RegistrarRedisConnection::bind(
     const string &user_agent,
     const string &path)
 {
-    return postRedisRequestFmt(
+    std::unique_ptr<AmSipRequest> ctx(new AmSipRequest(req));
+    if(!postRedisRequestFmt(
         conn,
         get_queue_name(),
         YETI_QUEUE_NAME,
         false,
-        new AmSipRequest(req), YETI_REDIS_REGISTER_TYPE_ID,
+        ctx.get(), YETI_REDIS_REGISTER_TYPE_ID,
         "EVALSHA %s 1 %d %d %s %d %d %s %s",
         yeti_register.hash.c_str(),
         auth_id, expires,
         contact.c_str(),
         AmConfig.node_id, req.local_if,
-        user_agent.c_str(), path.c_str());
+        user_agent.c_str(), path.c_str()))
+    {
+        return false;
+    }
+    ctx.release();
+    return true;
 }
 
 void RegistrarRedisConnection::resolve_aors(
@@ -309,6 +410,10 @@ void RegistrarRedisConnection::resolve_aors(
 
     DBG("got %ld AoR ids to resolve", aor_ids.size());
 
+    //to fill the local cache with the reply (see SBCCallLeg::onRedisReply)
+    std::unique_ptr<AorLookupCache::LookupRequest> lookup_request(
+        aor_cache.createLookupRequest(aor_ids));
+
     if(yeti_aor_lookup.hash.empty()) {
         ERROR("empty yeti_aor_lookup.hash. lua scripting error");
         throw AmSession::Exception(500, SIP_REPLY_SERVER_INTERNAL_ERROR);
@@ -332,11 +437,15 @@ void RegistrarRedisConnection::resolve_aors(
         conn,
         get_queue_name(),
         local_tag,
-        cmd.release(),cmd_size, false))
+        cmd.release(),cmd_size, false,
+        false,
+        lookup_request.get()))
     {
         ERROR("failed to post auth_id resolve request");
         throw AmSession::Exception(500, SIP_REPLY_SERVER_INTERNAL_ERROR);
     }
+    //owned by the request
+    lookup_request.release();
 }
 
 void RegistrarRedisConnection::rpc_resolve_aors_blocking(
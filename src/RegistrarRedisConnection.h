@@ -3,6 +3,7 @@
 #include "RedisConnectionPool.h"
 #include "RedisConnection.h"
 #include "Auth.h"
+#include "AorLookupCache.h"
 
 #include <unordered_map>
 
@@ -54,20 +55,29 @@ class RegistrarRedisConnection
     std::unordered_map<std::string, AmSipDialog* > uac_dlgs;
     AmMutex uac_dlgs_mutex;
 
+    AorLookupCache aor_cache;
+
     class ContactsSubscriptionConnection
       : public RedisConnectionPool
     {
         RedisConnection* conn;
         KeepAliveContexts &keepalive_contexts;
+        AorLookupCache &aor_cache;
         RedisScript load_contacts_data;
+        bool notify_config_valid;
 
-        void process_loaded_contacts(const AmArg &key_arg);
-        void process_expired_key(const AmArg &key_arg);
+        void process_loaded_contacts(const RedisReplyView &data);
+        void process_notify_config(const RedisReplyView &data);
+        void process_subscription_message(const RedisReplyView &data);
+        void process_expired_key(const RedisReplyView &key_arg);
       protected:
         void on_connect(RedisConnection* c) override;
+        void on_disconnect(RedisConnection* c) override;
 
       public:
-        ContactsSubscriptionConnection(KeepAliveContexts &keepalive_contexts);
+        ContactsSubscriptionConnection(
+            KeepAliveContexts &keepalive_contexts,
+            AorLookupCache &aor_cache);
         void process_reply_event(RedisReplyEvent &event) override;
         int init(const string& host, int port);
     } contacts_subscription;
@@ -136,5 +146,6 @@ class RegistrarRedisConnection
         const string &path,
         int interface_id);
     void dumpKeepAliveContexts(AmArg &ret) { keepalive_contexts.dump(ret); }
+    AorLookupCache &getAorCache() { return aor_cache; }
     void on_keepalive_timer();
 };
@@ -90,9 +90,10 @@ void assertEndCRLF(string& s) {
 
 SBCCallLeg* CallLegCreator::create(fake_logger *logger,
                                    OriginationPreAuth::Reply &ip_auth_data,
+                                   const SipHeaderIndex &hdrs_index,
                                    Auth::auth_id_type auth_result_id)
 {
-    return new SBCCallLeg(logger, ip_auth_data, auth_result_id, new AmSipDialog());
+    return new SBCCallLeg(logger, ip_auth_data, hdrs_index, auth_result_id, new AmSipDialog());
 }
 
 SBCCallLeg* CallLegCreator::create(SBCCallLeg* caller, AmSipDialog* dlg)
@@ -216,7 +217,24 @@ AmSession* SBCFactory::onInvite(
     const string&,
     const map<string,string>&)
 {
+    CallSetupTrace setup_trace;
+    if(yeti->call_setup_traces.isEnabled())
+        setup_trace.start();
+
+    auto &admission_control = yeti->router.getAdmissionControl();
+    if(!admission_control.admit()) {
+        DBG("INVITE %s from %s:%hu rejected by admission control",
+            req.r_uri.data(), req.remote_ip.data(), req.remote_port);
+        AmSipDialog::reply_error(
+            req,
+            admission_control.getReplyCode(),
+            admission_control.getReplyReason(),
+            admission_control.getReplyHeaders());
+        return nullptr;
+    }
+
     OriginationPreAuth::Reply ip_auth_data;
+    SipHeaderIndex hdrs_index(req.hdrs);
 
     fake_logger *early_trying_logger = new fake_logger();
     inc_ref(early_trying_logger);
@@ -224,9 +242,11 @@ AmSession* SBCFactory::onInvite(
     if(yeti->config.early_100_trying)
         answer_100_trying(req,early_trying_logger);
 
+    setup_trace.begin(CallSetupTrace::PreAuth);
     PROF_START(pre_auth);
-    auto pre_auth_result = yeti->orig_pre_auth.onInvite(req, ip_auth_data);
+    auto pre_auth_result = yeti->orig_pre_auth.onInvite(req, hdrs_index, ip_auth_data);
     PROF_END(pre_auth);
+    setup_trace.end(CallSetupTrace::PreAuth);
     PROF_PRINT("orig pre auth", pre_auth);
 
     DBG("pre auth result: %d", pre_auth_result);
@@ -248,8 +268,23 @@ AmSession* SBCFactory::onInvite(
         }
     }
 
+    if(!yeti->cps_limiter.check(ip_auth_data.orig_ip, ip_auth_data.cps_limit)) {
+        DBG("INVITE %s from %s:%hu (orig_ip:%s) rejected by CPS limit",
+            req.r_uri.data(), req.remote_ip.data(), req.remote_port,
+            ip_auth_data.orig_ip.data());
+        AmSipDialog::reply_error(
+            req,
+            yeti->cps_limiter.getReplyCode(),
+            yeti->cps_limiter.getReplyReason(),
+            yeti->cps_limiter.getReplyHeaders());
+        dec_ref(early_trying_logger);
+        return nullptr;
+    }
+
     AmArg ret;
+    setup_trace.begin(CallSetupTrace::DigestAuth);
     auto auth_result_id = yeti->router.check_request_auth(req,ret);
+    setup_trace.end(CallSetupTrace::DigestAuth);
     if(auth_result_id > 0) {
         DBG("successfully authorized with id %d",auth_result_id);
         if(!yeti->router.is_skip_logging_invite_success())
@@ -279,6 +314,7 @@ AmSession* SBCFactory::onInvite(
     SBCCallLeg* leg = callLegCreator->create(
         early_trying_logger,
         ip_auth_data,
+        hdrs_index,
         auth_result_id);
 
     if(!leg) {
@@ -287,6 +323,8 @@ AmSession* SBCFactory::onInvite(
         return nullptr;
     }
 
+    leg->setCallSetupTrace(setup_trace);
+
     /* not functional here after DB routing was moved to the SBCCallLeg
 
     SBCCallProfile& call_profile = leg->getCallProfile();
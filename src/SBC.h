@@ -55,6 +55,7 @@ using std::string;
 struct CallLegCreator {
   virtual SBCCallLeg* create(fake_logger *logger,
                              OriginationPreAuth::Reply &ip_auth_data,
+                             const SipHeaderIndex &hdrs_index,
                              Auth::auth_id_type auth_result_id);
   virtual SBCCallLeg* create(SBCCallLeg* caller, AmSipDialog* dlg);
   virtual ~CallLegCreator() {}
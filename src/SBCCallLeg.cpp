@@ -162,6 +162,7 @@ void PayloadIdMapping::reset()
 SBCCallLeg::SBCCallLeg(
     fake_logger *early_logger,
     OriginationPreAuth::Reply &ip_auth_data,
+    const SipHeaderIndex &hdrs_index,
     Auth::auth_id_type auth_result_id,
     AmSipDialog* p_dlg,
     AmSipSubscription* p_subs)
@@ -171,15 +172,18 @@ SBCCallLeg::SBCCallLeg(
     sdp_session_version(0),
     sdp_session_offer_last_cseq(0),
     sdp_session_answer_last_cseq(0),
+    uac_hdrs_index(hdrs_index),
     call_ctx(nullptr),
     early_trying_logger(early_logger),
     ip_auth_data(ip_auth_data),
     auth_result_id(auth_result_id),
     auth(nullptr),
     placeholders_hash(call_profile.placeholders_hash),
+    radius_interim_id(0),
     logger(nullptr),
     sensor(nullptr),
     memory_logger_enabled(false),
+    profile_request_active(false),
     router(yeti.router),
     cdr_list(yeti.cdr_list),
     rctl(yeti.rctl)
@@ -210,9 +214,11 @@ SBCCallLeg::SBCCallLeg(
     auth(nullptr),
     call_profile(caller->getCallProfile()),
     placeholders_hash(caller->getPlaceholders()),
+    radius_interim_id(0),
     logger(nullptr),
     sensor(nullptr),
     memory_logger_enabled(caller->getMemoryLoggerEnabled()),
+    profile_request_active(false),
     router(yeti.router),
     cdr_list(yeti.cdr_list),
     rctl(yeti.rctl)
@@ -330,11 +336,20 @@ void SBCCallLeg::processAorResolving()
         return;
     }
 
+    setup_trace.begin(CallSetupTrace::AorLookup);
+
     if(!yeti.config.registrar_enabled) {
         ERROR("registrar feature disabled for node, but routing returned profiles with registered_aor_id set");
         throw AmSession::Exception(500, SIP_REPLY_SERVER_INTERNAL_ERROR);
     }
 
+    AorLookupCache::AorsMap aors;
+    if(yeti.registrar_redis.getAorCache().lookup(aor_ids, aors)) {
+        DBG("%s all AoR ids resolved from the local cache", getLocalTag().data());
+        onAorsResolved(aors);
+        return;
+    }
+
     yeti.registrar_redis.resolve_aors(aor_ids, getLocalTag());
 }
 
@@ -358,6 +373,7 @@ void SBCCallLeg::processResourcesAndSdp()
     try {
 
     PROF_START(rchk);
+    setup_trace.begin(CallSetupTrace::ResourcesCheck);
     do {
         DBG("%s() check resources for profile. attempt %d",FUNC_NAME,attempt);
         rctl_ret = rctl.get(call_ctx->getCurrentResourceList(),
@@ -449,6 +465,7 @@ void SBCCallLeg::processResourcesAndSdp()
 
     PROF_END(rchk);
     PROF_PRINT("check and grab resources",rchk);
+    setup_trace.end(CallSetupTrace::ResourcesCheck);
 
     AmControlledLock call_ctx_lock(*call_ctx_mutex);
 
@@ -457,6 +474,7 @@ void SBCCallLeg::processResourcesAndSdp()
     updateCallProfile(*profile);
 
     PROF_START(sdp_processing);
+    setup_trace.begin(CallSetupTrace::SdpProcessing);
 
     //filterSDP
     int res = processSdpOffer(this, call_profile,
@@ -481,6 +499,7 @@ void SBCCallLeg::processResourcesAndSdp()
     }
     PROF_END(sdp_processing);
     PROF_PRINT("initial sdp processing",sdp_processing);
+    setup_trace.end(CallSetupTrace::SdpProcessing);
 
     call_ctx->bleg_negotiated_media = call_ctx->bleg_initial_offer.media;
 
@@ -748,8 +767,33 @@ bool SBCCallLeg::connectCalleeRequest(const AmSipRequest &orig_req)
     return false;
 }
 
+void SBCCallLeg::finishProfileRequest(bool replied)
+{
+    if(!profile_request_active) return;
+    profile_request_active = false;
+    if(replied) setup_trace.end(CallSetupTrace::GetProfile);
+    router.onProfileRequestFinished(profile_request_start_time, replied);
+}
+
+void SBCCallLeg::finishCallSetupTrace()
+{
+    if(!a_leg || !setup_trace.isStarted() || setup_trace.isFinished())
+        return;
+
+    setup_trace.finish();
+    yeti.call_setup_traces.record(setup_trace, getLocalTag());
+
+    AmLock call_ctx_lock(*call_ctx_mutex);
+    if(call_ctx) {
+        with_cdr_for_read {
+            cdr->setup_trace = setup_trace;
+        }
+    }
+}
+
 void SBCCallLeg::onPostgresResponse(PGResponse &e)
 {
+    finishProfileRequest(true);
     router.update_counters(profile_request_start_time);
 
     AmControlledLock call_ctx_lock(*call_ctx_mutex);
@@ -831,6 +875,8 @@ void SBCCallLeg::onPostgresResponseError(PGResponseError &e)
 {
     ERROR("getprofile db error: %s", e.error.data());
 
+    finishProfileRequest(true);
+
     delete call_ctx;
     call_ctx = nullptr;
 
@@ -845,6 +891,8 @@ void SBCCallLeg::onPostgresTimeout(PGTimeout &)
 {
     ERROR("getprofile timeout");
 
+    finishProfileRequest(true);
+
     delete call_ctx;
     call_ctx = nullptr;
 
@@ -1019,6 +1067,7 @@ void SBCCallLeg::onProfilesReady(AmControlledLock &call_ctx_lock)
     radius_auth(this,*call_ctx->cdr,call_profile,uac_req);
 
     httpCallStartedHook();
+    setup_trace.begin(CallSetupTrace::RadiusAuth);
     if(!radius_auth_post_event(this,call_profile)) {
         processAorResolving();
     }
@@ -1028,6 +1077,8 @@ void SBCCallLeg::onRadiusReply(const RadiusReplyEvent &ev)
 {
     DBG("got radius reply for %s",getLocalTag().c_str());
 
+    setup_trace.end(CallSetupTrace::RadiusAuth);
+
     if(AmBasicSipDialog::Cancelling==dlg->getStatus()) {
         DBG("[%s] ignore radius reply in Cancelling state",getLocalTag().c_str());
         return;
@@ -1061,6 +1112,46 @@ void SBCCallLeg::onRadiusReply(const RadiusReplyEvent &ev)
     }
 }
 
+static void replace_profile_fields(const AorLookupCache::Binding &aor, SqlCallProfile &p)
+{
+    //replace ruri
+    switch(p.registered_aor_mode_id) {
+    case SqlCallProfile::REGISTERED_AOR_MODE_AS_IS:
+        p.ruri = aor.contact;
+        break;
+    case SqlCallProfile::REGISTERED_AOR_MODE_REPLACE_USERPART: {
+        AmUriParser parser;
+        string ruri_user;
+
+        parser.uri = p.ruri;
+        if(parser.parse_uri()) {
+            ruri_user = parser.uri_user;
+
+            //parse AoR and replace userpart
+            parser.uri = aor.contact;
+            if(parser.parse_uri()) {
+                DBG("replace AoR user '%s' -> '%s'",
+                    parser.uri_user.data(), ruri_user.data());
+
+                parser.uri_user = ruri_user;
+                p.ruri = parser.uri_str();
+            } else {
+                ERROR("failed to parse AoR Contact. fallback to the full replace");
+                p.ruri = aor.contact;
+            }
+        } else {
+            ERROR("failed to parse RURI. fallback to the full replace");
+            p.ruri = aor.contact;
+        }
+    } break;
+    }
+
+    //replace route
+    if(!aor.path.empty()) {
+        p.route = aor.path;
+    }
+}
+
 struct aor_lookup_reply {
     /* reply layout:
      * [
@@ -1079,56 +1170,7 @@ struct aor_lookup_reply {
      * ]
      */
 
-    struct aor_data {
-        string contact;
-        string path;
-        aor_data(const char *contact, const char *path)
-          : contact(contact),
-            path(path)
-        {}
-
-        void replace_profile_fields(SqlCallProfile &p)
-        {
-            //replace ruri
-            switch(p.registered_aor_mode_id) {
-            case SqlCallProfile::REGISTERED_AOR_MODE_AS_IS:
-                p.ruri = contact;
-                break;
-            case SqlCallProfile::REGISTERED_AOR_MODE_REPLACE_USERPART: {
-                AmUriParser parser;
-                string ruri_user;
-
-                parser.uri = p.ruri;
-                if(parser.parse_uri()) {
-                    ruri_user = parser.uri_user;
-
-                    //parse AoR and replace userpart
-                    parser.uri = contact;
-                    if(parser.parse_uri()) {
-                        DBG("replace AoR user '%s' -> '%s'",
-                            parser.uri_user.data(), ruri_user.data());
-
-                        parser.uri_user = ruri_user;
-                        p.ruri = parser.uri_str();
-                    } else {
-                        ERROR("failed to parse AoR Contact. fallback to the full replace");
-                        p.ruri = contact;
-                    }
-                } else {
-                    ERROR("failed to parse RURI. fallback to the full replace");
-                    p.ruri = contact;
-                }
-            } break;
-            }
-
-            //replace route
-            if(!path.empty()) {
-                p.route = path;
-            }
-        }
-    };
-
-    std::map<int, std::list<aor_data> > aors;
+    AorLookupCache::AorsMap aors;
 
     //return false on errors
     bool parse(const RedisReplyEvent &e)
@@ -1136,43 +1178,40 @@ struct aor_lookup_reply {
         if(RedisReplyEvent::SuccessReply!=e.result) {
             ERROR("error reply from redis %d %s",
                 e.result,
-                AmArg::print(e.data).c_str());
+                AmArg::print(e.data()).c_str());
             return false;
         }
-        if(!isArgArray(e.data) || e.data.size()%2!=0) {
-            ERROR("unexpected redis reply layout: %s", AmArg::print(e.data).data());
+
+        RedisReplyView data = e.reply();
+        if(!data.isArray() || data.size()%2!=0) {
+            ERROR("unexpected redis reply layout: %s", AmArg::print(e.data()).data());
             return false;
         }
-        int n = static_cast<int>(e.data.size())-1;
-        for(int i = 0; i < n; i+=2) {
-            AmArg &id_arg = e.data[i];
-            if(!isArgLongLong(id_arg)) {
+        size_t n = data.size();
+        for(size_t i = 0; i < n; i+=2) {
+            RedisReplyView id_arg = data[i];
+            if(!id_arg.isInteger()) {
                 ERROR("unexpected auth_id type. skip entry");
                 continue;
             }
-            int auth_id = static_cast<int>(id_arg.asLongLong());
+            int auth_id = static_cast<int>(id_arg.integer());
 
-            AmArg &aor_data_arg = e.data[i+1];
-            if(!isArgArray(aor_data_arg) || aor_data_arg.size()%2!=0) {
+            RedisReplyView aor_data_arg = data[i+1];
+            if(!aor_data_arg.isArray() || aor_data_arg.size()%2!=0) {
                 ERROR("unexpected aor_data_arg layout. skip entry");
                 continue;
             }
 
-            int m = static_cast<int>(aor_data_arg.size())-1;
-            for(int j = 0; j < m; j+=2) {
-                AmArg &contact_arg = aor_data_arg[j];
-                AmArg &path_arg = aor_data_arg[j+1];
-                if(!isArgCStr(contact_arg) || !isArgCStr(path_arg)) {
+            size_t m = aor_data_arg.size();
+            for(size_t j = 0; j < m; j+=2) {
+                RedisReplyView contact_arg = aor_data_arg[j];
+                RedisReplyView path_arg = aor_data_arg[j+1];
+                if(!contact_arg.isString() || !path_arg.isString()) {
                     ERROR("unexpected contact_arg||path_arg type. skip entry");
                     continue;
                 }
 
-                auto it = aors.find(auth_id);
-                if(it == aors.end()) {
-                    it = aors.insert(aors.begin(),
-                        std::pair<int, std::list<aor_data> >(auth_id,  std::list<aor_data>()));
-                }
-                it->second.emplace_back(contact_arg.asCStr(), path_arg.asCStr());
+                aors[auth_id].emplace_back(string(contact_arg.str()), string(path_arg.str()));
             }
         }
         return true;
@@ -1183,10 +1222,7 @@ void SBCCallLeg::onRedisReply(const RedisReplyEvent &e)
 {
     DBG("%s onRedisReply",getLocalTag().c_str());
     DBG("%s raw redis reply data: '%s'",
-        getLocalTag().data(), AmArg::print(e.data).data());
-
-    AmControlledLock call_ctx_lock(*call_ctx_mutex);
-    getCtx_void;
+        getLocalTag().data(), AmArg::print(e.data()).data());
 
     //preprocess redis reply data
     aor_lookup_reply r;
@@ -1194,8 +1230,21 @@ void SBCCallLeg::onRedisReply(const RedisReplyEvent &e)
         throw AmSession::Exception(500, SIP_REPLY_SERVER_INTERNAL_ERROR);
     }
 
+    if(auto lookup_request = dynamic_cast<AorLookupCache::LookupRequest *>(e.user_data.get()))
+        yeti.registrar_redis.getAorCache().update(*lookup_request, r.aors);
+
+    onAorsResolved(r.aors);
+}
+
+void SBCCallLeg::onAorsResolved(const AorLookupCache::AorsMap &aors)
+{
+    setup_trace.end(CallSetupTrace::AorLookup);
+
+    AmControlledLock call_ctx_lock(*call_ctx_mutex);
+    getCtx_void;
+
     DBG("%s parsed AoRs:", getLocalTag().data());
-    for(const auto &aor_entry: r.aors) {
+    for(const auto &aor_entry: aors) {
         for(const auto &d: aor_entry.second) {
             DBG("aor_id: %d, contact: '%s', path: '%s'",
                 aor_entry.first, d.contact.data(), d.path.data());
@@ -1222,8 +1271,8 @@ void SBCCallLeg::onRedisReply(const RedisReplyEvent &e)
             continue;
         }
 
-        auto a = r.aors.find(p.registered_aor_id);
-        if(a == r.aors.end()) {
+        auto a = aors.find(p.registered_aor_id);
+        if(a == aors.end()) {
             p.skip_code_id = SC_NOT_REGISTERED;
             ++it;
             DBG("< mark profile %u as not registered using disconnect code %d",
@@ -1236,7 +1285,7 @@ void SBCCallLeg::onRedisReply(const RedisReplyEvent &e)
         sub_profile_idx = 0;
         auto aor_it = aors_list.begin();
 
-        aor_it->replace_profile_fields(p);
+        replace_profile_fields(*aor_it, p);
 
         DBG("< set profile %d.%d ruri to: %s",
             profile_idx, sub_profile_idx, p.ruri.data());
@@ -1248,14 +1297,15 @@ void SBCCallLeg::onRedisReply(const RedisReplyEvent &e)
 
         ++aor_it;
         while(aor_it != aors_list.end()) {
-            SqlCallProfile *cloned_p = p.copy();
             sub_profile_idx++;
             ++it;
-            it = profiles.insert(it, *cloned_p);
+            //filters, ACLs and other cow_ptr blocks are shared with the source profile
+            it = profiles.insert(it, p);
+            auto cloned_p = &*it;
             DBG("< clone profile %d.0 to %d.%d because user resolved to the multiple AoRs",
                 profile_idx, profile_idx, sub_profile_idx);
 
-            aor_it->replace_profile_fields(*cloned_p);
+            replace_profile_fields(*aor_it, *cloned_p);
 
             DBG("< set profile %d.%d ruri to: %s",
                 profile_idx, sub_profile_idx, cloned_p->ruri.data());
@@ -1398,14 +1448,6 @@ bool SBCCallLeg::onTimerEvent(int timer_id)
             call_ctx->setRingingTimeout();
             dlg->cancel();
             return true;
-        case YETI_RADIUS_INTERIM_TIMER:
-            DBG("interim accounting timer fired for %s",getLocalTag().c_str());
-            if(call_ctx->cdr) {
-                radius_accounting_interim(this,*call_ctx->cdr);
-                call_ctx_lock.release();
-                radius_accounting_interim_post_event_set_timer(this);
-            }
-            return true;
         case YETI_FAKE_RINGING_TIMER:
             onFakeRingingTimer();
             return true;
@@ -1416,11 +1458,20 @@ bool SBCCallLeg::onTimerEvent(int timer_id)
     return false;
 }
 
-void SBCCallLeg::onInterimRadiusTimer()
+void SBCCallLeg::scheduleRadiusInterim(int profile_id, const timeval &connect_time, unsigned int interval)
 {
-    DBG("interim accounting timer fired for %s",getLocalTag().c_str());
-    if(call_ctx->cdr)
-        radius_accounting_interim(this,*call_ctx->cdr);
+    DBG("[%s] schedule interim accounting with profile id: %d, interval: %u",
+        getLocalTag().c_str(), profile_id, interval);
+    cancelRadiusInterim();
+    radius_interim_id = yeti.radius_interim.add(
+        profile_id, getLocalTag(), placeholders_hash, connect_time, interval);
+}
+
+void SBCCallLeg::cancelRadiusInterim()
+{
+    if(!radius_interim_id) return;
+    yeti.radius_interim.remove(radius_interim_id);
+    radius_interim_id = 0;
 }
 
 void SBCCallLeg::onFakeRingingTimer()
@@ -1494,6 +1545,7 @@ void SBCCallLeg::updateCallProfile(const SBCCallProfile &new_profile)
 {
     call_profile = new_profile;
     placeholders_hash.update(call_profile.placeholders_hash);
+    sdp_offer_cache.clear();
 }
 
 void SBCCallLeg::applyAProfile()
@@ -1987,6 +2039,11 @@ SBCCallLeg::~SBCCallLeg()
 {
     DBG("~SBCCallLeg[%p]",to_void(this));
 
+    //session destroyed before getprofile reply
+    finishProfileRequest(false);
+
+    cancelRadiusInterim();
+
     if (auth) delete auth;
     if (logger) dec_ref(logger);
     if(sensor) dec_ref(sensor);
@@ -2898,39 +2955,32 @@ void SBCCallLeg::onInvite(const AmSipRequest& req)
     gettimeofday(&call_start_time,nullptr);
 
     uac_req = req;
+    uac_hdrs_index.bind(uac_req.hdrs);
 
     //process Identity headers
     if(yeti.config.identity_enabled && ip_auth_data.require_identity_parsing) {
+        setup_trace.begin(CallSetupTrace::IdentityCerts);
         static string identity_header_name("identity");
-        size_t start_pos = 0;
-        while (start_pos<req.hdrs.length()) {
-            size_t name_end, val_begin, val_end, hdr_end;
-            if (skip_header(
-                    req.hdrs, start_pos, name_end,
-                    val_begin, val_end, hdr_end))
-            {
-                ERROR("failed to parse headers: %s", req.hdrs.data());
-                AmSipDialog::reply_error(req,500,SIP_REPLY_SERVER_INTERNAL_ERROR);
-                dlg->drop();
-                dlg->dropTransactions();
-                setStopped();
-                return;
-            }
-            string hdr_name = req.hdrs.substr(start_pos, name_end-start_pos);
-            std::transform(hdr_name.begin(), hdr_name.end(), hdr_name.begin(), ::tolower);
-            if(hdr_name==identity_header_name) {
-                string hdr_value = req.hdrs.substr(val_begin, val_end - val_begin);
-                if(hdr_value.find(',')!=string::npos) {
-                    auto values = explode(hdr_value,",", false);
-                    for(auto const &v : values) {
-                        addIdentityHdr(trim(v," \n"));
-                    }
-                } else {
-                    addIdentityHdr(trim(hdr_value, " \n"));
+        if(uac_hdrs_index.failed()) {
+            ERROR("failed to parse headers: %s", req.hdrs.data());
+            AmSipDialog::reply_error(req,500,SIP_REPLY_SERVER_INTERNAL_ERROR);
+            dlg->drop();
+            dlg->dropTransactions();
+            setStopped();
+            return;
+        }
+        uac_hdrs_index.forEach(identity_header_name, [this](std::string_view value) {
+            string hdr_value(value);
+            if(hdr_value.find(',')!=string::npos) {
+                auto values = explode(hdr_value,",", false);
+                for(auto const &v : values) {
+                    addIdentityHdr(trim(v," \n"));
                 }
+            } else {
+                addIdentityHdr(trim(hdr_value, " \n"));
             }
-            start_pos = hdr_end;
-        }
+            return true;
+        });
 
         if(awaited_identity_certs.empty())
             onIdentityReady();
@@ -2977,6 +3027,8 @@ void SBCCallLeg::addIdentityHdr(const string &header_value)
 
 void SBCCallLeg::onIdentityReady()
 {
+    setup_trace.end(CallSetupTrace::IdentityCerts);
+
     AmArg *identity_data_ptr = nullptr;
     if(yeti.config.identity_enabled) {
         string error_reason;
@@ -3005,7 +3057,11 @@ void SBCCallLeg::onIdentityReady()
                 e.identity.get_x5u_url(), cert_is_valid));
             if(key.get()) {
                 if(cert_is_valid) {
-                    bool verified = e.identity.verify(key.get(), yeti.cert_cache.getExpires());
+                    bool verified;
+                    {
+                        LatencyTimer t(yeti.counters.identity_verify_latency);
+                        verified = e.identity.verify(key.get(), yeti.cert_cache.getExpires());
+                    }
                     if(!verified) {
                         auto error_code = e.identity.get_last_error(error_reason);
                         switch(error_code) {
@@ -3054,13 +3110,17 @@ void SBCCallLeg::onIdentityReady()
     call_ctx->references++;
 
     gettimeofday(&profile_request_start_time, nullptr);
+    setup_trace.begin(CallSetupTrace::GetProfile);
     try {
         router.db_async_get_profiles(
             call_ctx_lock,
             getLocalTag(),
             uac_req,
+            uac_hdrs_index,
             auth_result_id,
             identity_data_ptr);
+        profile_request_active = true;
+        router.onProfileRequestStarted();
     } catch(GetProfileException &e) {
         DBG("GetProfile exception on %s thread: fatal = %d code  = '%d'",
             e.fatal, e.code);
@@ -3212,6 +3272,7 @@ void SBCCallLeg::onRoutingReady()
         connectCallee(to, ruri, from,
                       aleg_modified_req, modified_req,
                       callee_dlg.release());
+        finishCallSetupTrace();
     }
 }
 
@@ -3419,11 +3480,12 @@ void SBCCallLeg::onCallConnected(const AmSipReply&)
                         cdr->update_with_action(BlegConnect);
                     }
                     radius_accounting_start(this,*cdr,call_profile);
+                    timeval leg_connect_time = a_leg ? cdr->connect_time : cdr->bleg_connect_time;
                     call_ctx_lock.release();
                     if(a_leg) {
                         httpCallConnectedHook();
                     }
-                    radius_accounting_start_post_event_set_timers(this, call_profile);
+                    radius_accounting_start_post_event_schedule_interim(this, call_profile, leg_connect_time);
                 }
             } else if(!a_leg) {
                 //we got final positive reply for Bleg. clear xfer intermediate state
@@ -3537,7 +3599,7 @@ void SBCCallLeg::onCallStatusChange(const StatusChangeCause &cause)
                 }
             } break;
         case CallLeg::Disconnected:
-            removeTimer(YETI_RADIUS_INTERIM_TIMER);
+            cancelRadiusInterim();
             if(a_leg && call_profile.fake_ringing_timeout) {
                 removeTimer(YETI_FAKE_RINGING_TIMER);
             } break;
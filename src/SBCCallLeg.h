@@ -3,6 +3,7 @@
 
 #include "SBC.h"
 #include "CallCtx.h"
+#include "SdpOfferCache.h"
 #include "sbc_events.h"
 #include "RateLimit.h"
 #include "ampi/RadiusClientAPI.h"
@@ -84,6 +85,7 @@ class SBCCallLeg : public CallLeg, public CredentialHolder
   unsigned int sdp_session_version;
   unsigned int sdp_session_offer_last_cseq;
   unsigned int sdp_session_answer_last_cseq;
+  SipHeaderIndex uac_hdrs_index;
 
   string global_tag;
 
@@ -107,6 +109,7 @@ class SBCCallLeg : public CallLeg, public CredentialHolder
   std::queue< unique_ptr<B2BSipReplyEvent> > postponed_replies;
 
   timeval call_start_time;
+  CallSetupTrace setup_trace;
 
   OriginationPreAuth::Reply ip_auth_data;
   Auth::auth_id_type auth_result_id;
@@ -121,9 +124,11 @@ class SBCCallLeg : public CallLeg, public CredentialHolder
    * answer). We can not use call_profile.transcoder.audio_codecs for storing
    * the payload IDs because they need to be remembered per media stream. */
   PayloadIdMapping transcoder_payload_mapping;
+  SdpOfferCache sdp_offer_cache;
 
   SBCCallProfile call_profile;
   PlaceholdersHash placeholders_hash;
+  RadiusInterimScheduler::entry_id_t radius_interim_id;
   AmArg identity_data;
 
   // Rate limiting
@@ -138,6 +143,9 @@ class SBCCallLeg : public CallLeg, public CredentialHolder
   bool memory_logger_enabled;
 
   struct timeval profile_request_start_time;
+  bool profile_request_active;
+  void finishProfileRequest(bool replied);
+  void finishCallSetupTrace();
 
   struct identity_entry {
     AmIdentity identity;
@@ -202,10 +210,10 @@ class SBCCallLeg : public CallLeg, public CredentialHolder
 
   void onRadiusReply(const RadiusReplyEvent &ev);
   void onRedisReply(const RedisReplyEvent &e);
+  void onAorsResolved(const AorLookupCache::AorsMap &aors);
   void onCertCacheReply(const CertCacheResponseEvent &e);
   void onRtpTimeoutOverride(const AmRtpTimeoutEvent &rtp_event);
   bool onTimerEvent(int timer_id);
-  void onInterimRadiusTimer();
   void onFakeRingingTimer();
   void onControlEvent(SBCControlEvent *event);
   void onTearDown();
@@ -233,6 +241,7 @@ class SBCCallLeg : public CallLeg, public CredentialHolder
 
   SBCCallLeg(fake_logger *early_trying_logger,
              OriginationPreAuth::Reply &ip_auth_data,
+             const SipHeaderIndex &hdrs_index,
              Auth::auth_id_type auth_result_id,
              AmSipDialog* dlg=NULL, AmSipSubscription* p_subs=NULL);
   SBCCallLeg(SBCCallLeg* caller,
@@ -290,15 +299,21 @@ class SBCCallLeg : public CallLeg, public CredentialHolder
   SBCCallProfile &getCallProfile() { return call_profile; }
   void updateCallProfile(const SBCCallProfile &new_profile);
   PlaceholdersHash &getPlaceholders() { return placeholders_hash; }
+  //interim accounting is sent by the module-level scheduler. interval in seconds
+  void scheduleRadiusInterim(int profile_id, const timeval &connect_time, unsigned int interval);
+  void cancelRadiusInterim();
   CallStatus getCallStatus() { return CallLeg::getCallStatus(); }
 
   AmSipRequest &getAlegModifiedReq() { return aleg_modified_req; }
   AmSipRequest &getModifiedReq() { return modified_req; }
 
   PayloadIdMapping &getTranscoderMapping() { return  transcoder_payload_mapping; }
+  SdpOfferCache &getSdpOfferCache() { return sdp_offer_cache; }
 
   const string &getGlobalTag() const { return global_tag; }
 
+  void setCallSetupTrace(const CallSetupTrace &trace) { setup_trace = trace; }
+
   SharedMutex *getSharedMutex() { return call_ctx_mutex; }
   CallCtx *getCallCtxUnsafe() { return call_ctx; }
   CallCtx *getCallCtx();
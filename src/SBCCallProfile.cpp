@@ -26,9 +26,12 @@
 #include "SBCCallProfile.h"
 #include "SBC.h"
 #include <algorithm>
+#include <deque>
+#include <unordered_map>
 
 #include "log.h"
 #include "AmUtils.h"
+#include "AmThread.h"
 #include "AmPlugIn.h"
 #include "AmLcConfig.h"
 
@@ -37,19 +40,136 @@
 #include "SDPFilter.h"
 
 #include "sip/pcap_logger.h"
+#include "jsonArg.h"
 
 typedef vector<SdpPayload>::iterator PayloadIterator;
 //static string payload2str(const SdpPayload &p);
 
+namespace {
+
+struct PlaceholdersKeys {
+    AmMutex mutex;
+    std::unordered_map<string, PlaceholdersHash::key_id_t> ids;
+    std::deque<string> names;
+};
+
+PlaceholdersKeys &placeholders_keys()
+{
+    static PlaceholdersKeys keys;
+    return keys;
+}
+
+} //namespace
+
+PlaceholdersHash::key_id_t PlaceholdersHash::key(const string &name)
+{
+    auto &keys = placeholders_keys();
+    AmLock l(keys.mutex);
+
+    auto it = keys.ids.find(name);
+    if(it != keys.ids.end())
+        return it->second;
+
+    key_id_t id = static_cast<key_id_t>(keys.names.size());
+    keys.names.push_back(name);
+    keys.ids.emplace(name, id);
+    return id;
+}
+
+string PlaceholdersHash::value::format() const
+{
+    switch(type) {
+    case String:
+        return s;
+    case Integer:
+        return std::to_string(i);
+    case Time:
+        switch(time_format) {
+        case TimeStr: return timeval2str(tv);
+        case TimeFloat: return timeval2str_usec(tv);
+        case TimeNtp: return timeval2str_ntp(tv);
+        }
+        break;
+    case Unset:
+        break;
+    }
+    return string();
+}
+
+const std::map<string,string> &PlaceholdersHash::Row::get() const
+{
+    std::call_once(formatted_once, [this]() {
+        if(!isArgStruct(columns)) return;
+        for(const auto &f: columns)
+            formatted.emplace_hint(formatted.end(), f.first, arg2json(f.second));
+    });
+    return formatted;
+}
+
+PlaceholdersHash::value &PlaceholdersHash::get_value(key_id_t key)
+{
+    if(key >= values.size())
+        values.resize(key + 1);
+    return values[key];
+}
+
+void PlaceholdersHash::setRow(const AmArg &r)
+{
+    row = std::make_shared<const Row>(r);
+}
+
+void PlaceholdersHash::set(key_id_t key, const string &v)
+{
+    value &val = get_value(key);
+    val.type = value::String;
+    val.s = v;
+}
+
+void PlaceholdersHash::set(key_id_t key, long long v)
+{
+    value &val = get_value(key);
+    val.type = value::Integer;
+    val.i = v;
+}
+
+void PlaceholdersHash::set(key_id_t key, const struct timeval &tv, TimeFormat format)
+{
+    value &val = get_value(key);
+    val.type = value::Time;
+    val.time_format = format;
+    val.tv = tv;
+}
+
 void PlaceholdersHash::update(const PlaceholdersHash &h)
 {
-    for(PlaceholdersHash::const_iterator i = h.begin();
-        i != h.end(); i++)
-    {
-        (*this)[i->first] = i->second;
+    if(h.row)
+        row = h.row;
+
+    if(values.size() < h.values.size())
+        values.resize(h.values.size());
+    for(size_t i = 0; i < h.values.size(); i++) {
+        if(h.values[i].type != value::Unset)
+            values[i] = h.values[i];
     }
 }
 
+std::map<string,string> PlaceholdersHash::get() const
+{
+    std::map<string,string> ret;
+    if(row)
+        ret = row->get();
+
+    auto &keys = placeholders_keys();
+    AmLock l(keys.mutex);
+    for(size_t i = 0; i < values.size(); i++) {
+        const value &v = values[i];
+        if(v.type == value::Unset) continue;
+        ret[keys.names[i]] = v.format();
+    }
+
+    return ret;
+}
+
 //////////////////////////////////////////////////////////////////////////////////
 // helper defines for parameter evaluation
 
@@ -252,10 +372,10 @@ string SBCCallProfile::print() const {
 
   res += transcoder.print();
 
-  if (reply_translations.size()) {
+  if (reply_translations->size()) {
     string reply_trans_codes;
     for(map<unsigned int, std::pair<unsigned int, string> >::const_iterator it=
-	  reply_translations.begin(); it != reply_translations.end(); it++)
+	  reply_translations->begin(); it != reply_translations->end(); it++)
       reply_trans_codes += int2str(it->first)+"=>"+
 	int2str(it->second.first)+" " + it->second.second+", ";
     reply_trans_codes.erase(reply_trans_codes.length()-2);
@@ -35,21 +35,94 @@
 #include "ampi/RadiusClientAPI.h"
 #include "sip/resolver.h"
 #include "sip/types.h"
+#include "AmArg.h"
 
 #include <set>
 #include <string>
 #include <map>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sys/time.h>
 
 using std::string;
 using std::map;
 using std::set;
 using std::pair;
 
-class PlaceholdersHash: public std::map<string,string>
+/* values for the RADIUS attributes placeholders.
+ *
+ * routing columns are kept in the row shared by the profile copies
+ * and formatted when the first request is posted to the RADIUS module.
+ * values set during the call are stored typed in the flat vector
+ * indexed by the interned key id and take precedence over the row columns */
+class PlaceholdersHash
 {
   public:
+    typedef unsigned int key_id_t;
+
+    enum TimeFormat {
+        TimeStr,    // timeval2str
+        TimeFloat,  // timeval2str_usec
+        TimeNtp     // timeval2str_ntp
+    };
+
+  private:
+    struct value {
+        enum Type {
+            Unset,
+            String,
+            Integer,
+            Time
+        } type;
+        TimeFormat time_format;
+        string s;
+        long long i;
+        struct timeval tv;
+
+        value()
+          : type(Unset),
+            time_format(TimeStr),
+            i(0)
+        {
+            timerclear(&tv);
+        }
+
+        string format() const;
+    };
+
+    //routing columns formatted once on the first request
+    class Row {
+        AmArg columns;
+        mutable std::once_flag formatted_once;
+        mutable std::map<string,string> formatted;
+      public:
+        explicit Row(const AmArg &in_columns)
+          : columns(in_columns)
+        {}
+        const std::map<string,string> &get() const;
+    };
+
+    std::shared_ptr<const Row> row;
+    std::vector<value> values;
+
+    value &get_value(key_id_t key);
+
+  public:
+    //returns the same id for the same name. ids are never released
+    static key_id_t key(const string &name);
+
+    void setRow(const AmArg &r);
+
+    void set(key_id_t key, const string &v);
+    void set(key_id_t key, long long v);
+    void set(key_id_t key, const struct timeval &tv, TimeFormat format);
+
     void update(const PlaceholdersHash &h);
+
+    //formatted values for the RadiusRequestEvent
+    std::map<string,string> get() const;
 };
 
 #define DTMF_RX_MODE_RFC2833			0x1		// telephone-event RTP payload
@@ -82,6 +155,40 @@ class ref_counted_ptr
 
 };
 
+/* copy-on-write holder for the large and rarely changed profile parts.
+ * profile copies share the same immutable block until the first write() */
+template <class T>
+class cow_ptr
+{
+  private:
+    std::shared_ptr<const T> ptr;
+
+    static const std::shared_ptr<const T> &empty()
+    {
+        static const std::shared_ptr<const T> e(std::make_shared<T>());
+        return e;
+    }
+
+  public:
+    cow_ptr(): ptr(empty()) { }
+
+    const T &operator*() const { return *ptr; }
+    const T *operator->() const { return ptr.get(); }
+    operator const T&() const { return *ptr; }
+
+    /* detach shared block if needed and return it for modification */
+    T &write()
+    {
+        if (ptr.use_count() != 1)
+            ptr = std::make_shared<T>(*ptr);
+        return const_cast<T &>(*ptr);
+    }
+
+    bool shared() const { return ptr.use_count() > 1; }
+
+    bool operator==(const cow_ptr &rhs) const { return ptr == rhs.ptr || *ptr == *rhs.ptr; }
+};
+
 class PayloadDesc {
   protected:
     std::string name;
@@ -180,13 +287,13 @@ struct SBCCallProfile
   bool suppress_early_media;
   bool force_one_way_early_media;
 
-  vector<FilterEntry> headerfilter_a2b;
-  vector<FilterEntry> headerfilter_b2a;
+  cow_ptr<vector<FilterEntry>> headerfilter_a2b;
+  cow_ptr<vector<FilterEntry>> headerfilter_b2a;
 
-  vector<FilterEntry> sdpfilter;
-  vector<FilterEntry> sdpalinesfilter;
-  vector<FilterEntry> bleg_sdpalinesfilter;
-  vector<FilterEntry> mediafilter;
+  cow_ptr<vector<FilterEntry>> sdpfilter;
+  cow_ptr<vector<FilterEntry>> sdpalinesfilter;
+  cow_ptr<vector<FilterEntry>> bleg_sdpalinesfilter;
+  cow_ptr<vector<FilterEntry>> mediafilter;
 
   bool aleg_relay_prack,bleg_relay_prack;
   bool aleg_relay_reinvite,bleg_relay_reinvite;
@@ -221,7 +328,7 @@ struct SBCCallProfile
   bool auth_aleg_enabled;
   UACAuthCred auth_aleg_credentials;
 
-  ReplyTranslationMap reply_translations;
+  cow_ptr<ReplyTranslationMap> reply_translations;
 
   string append_headers;
   string append_headers_req;
@@ -298,8 +405,8 @@ struct SBCCallProfile
   TransProt bleg_media_transport;
   bool  bleg_media_allow_zrtp;
 
-  std::vector<AmSubnet> aleg_rtp_acl;
-  std::vector<AmSubnet> bleg_rtp_acl;
+  cow_ptr<std::vector<AmSubnet>> aleg_rtp_acl;
+  cow_ptr<std::vector<AmSubnet>> bleg_rtp_acl;
 
   int ss_crt_id;
   int ss_attest_id;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <AmSdp.h>
+#include "CodecsGroup.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+
+using std::string;
+using std::vector;
+
+/* result of the last processSdpOffer() for the leg
+ *
+ * session refresh re-INVITEs/UPDATEs usually repeat the same offer,
+ * so the filtered body and negotiated media are reused if the offer body
+ * and the processing parameters are the same.
+ * codecs group is compared by the entry identity which changes on reload.
+ * must be cleared on the call profile change */
+struct SdpOfferCache {
+    bool valid;
+    size_t offer_hash;
+    string offer;
+    CodecsGroupEntryPtr codecs_group;
+    bool single_codec;
+
+    string body;
+    vector<SdpMedia> negotiated_media;
+
+    SdpOfferCache()
+      : valid(false)
+    {}
+
+    static size_t hash(std::string_view offer) {
+        return std::hash<std::string_view>{}(offer);
+    }
+
+    bool match(size_t h, std::string_view in_offer,
+               const CodecsGroupEntryPtr &group, bool in_single_codec) const
+    {
+        return valid &&
+            offer_hash == h &&
+            codecs_group == group &&
+            single_codec == in_single_codec &&
+            offer == in_offer;
+    }
+
+    void clear()
+    {
+        valid = false;
+        offer.clear();
+        codecs_group.reset();
+        body.clear();
+        negotiated_media.clear();
+    }
+};
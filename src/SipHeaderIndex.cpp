@@ -0,0 +1,136 @@
+#include "SipHeaderIndex.h"
+#include "HeaderFilter.h"
+
+#include <strings.h>
+#include <cctype>
+#include <functional>
+
+static size_t content_hash(const string &hdrs)
+{
+    return std::hash<std::string_view>()(hdrs);
+}
+
+SipHeaderIndex::SipHeaderIndex()
+  : hdrs(nullptr)
+{
+    reset();
+}
+
+SipHeaderIndex::SipHeaderIndex(const string &hdrs)
+  : hdrs(&hdrs)
+{
+    reset();
+}
+
+void SipHeaderIndex::bind(const string &new_hdrs)
+{
+    if(built && content_hash(new_hdrs) != built_hash)
+        reset();
+    hdrs = &new_hdrs;
+}
+
+void SipHeaderIndex::reset() const
+{
+    built = false;
+    parse_failed = false;
+    built_hash = 0;
+    entries.clear();
+    for(uint32_t i = 0; i < BUCKETS_COUNT; i++)
+        bucket_head[i] = bucket_tail[i] = -1;
+}
+
+uint32_t SipHeaderIndex::hash(const char *s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for(size_t i = 0; i < len; i++) {
+        h ^= static_cast<unsigned char>(tolower(static_cast<unsigned char>(s[i])));
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void SipHeaderIndex::build() const
+{
+    built = true;
+
+    if(!hdrs) return;
+
+    built_hash = content_hash(*hdrs);
+
+    size_t start_pos = 0;
+    while(start_pos < hdrs->length()) {
+        size_t name_end, val_begin, val_end, hdr_end;
+        if(skip_header(*hdrs, start_pos, name_end, val_begin, val_end, hdr_end)) {
+            parse_failed = true;
+            break;
+        }
+
+        auto &e = entries.emplace_back();
+        e.name_begin = static_cast<uint32_t>(start_pos);
+        e.name_len = static_cast<uint32_t>(name_end - start_pos);
+        e.val_begin = static_cast<uint32_t>(val_begin);
+        e.val_len = static_cast<uint32_t>(val_end - val_begin);
+        e.hdr_end = static_cast<uint32_t>(hdr_end);
+        e.hash = hash(hdrs->data() + start_pos, e.name_len);
+        e.next = -1;
+
+        int32_t idx = static_cast<int32_t>(entries.size() - 1);
+        auto bucket = e.hash % BUCKETS_COUNT;
+        if(bucket_tail[bucket] < 0) {
+            bucket_head[bucket] = idx;
+        } else {
+            entries[bucket_tail[bucket]].next = idx;
+        }
+        bucket_tail[bucket] = idx;
+
+        start_pos = hdr_end;
+    }
+}
+
+const SipHeaderIndex::Entry *SipHeaderIndex::first(std::string_view name) const
+{
+    ensure();
+
+    auto h = hash(name.data(), name.size());
+    for(auto idx = bucket_head[h % BUCKETS_COUNT]; idx >= 0; idx = entries[idx].next) {
+        const auto &e = entries[idx];
+        if(e.hash == h && e.name_len == name.size() &&
+           0==strncasecmp(hdrs->data() + e.name_begin, name.data(), name.size()))
+        {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+const SipHeaderIndex::Entry *SipHeaderIndex::next(const Entry *e, std::string_view name) const
+{
+    auto h = e->hash;
+    for(auto idx = e->next; idx >= 0; idx = entries[idx].next) {
+        const auto &n = entries[idx];
+        if(n.hash == h && n.name_len == name.size() &&
+           0==strncasecmp(hdrs->data() + n.name_begin, name.data(), name.size()))
+        {
+            return &n;
+        }
+    }
+    return nullptr;
+}
+
+string SipHeaderIndex::getFirst(std::string_view name) const
+{
+    auto e = first(name);
+    if(!e) return string();
+    return string(value(*e));
+}
+
+string SipHeaderIndex::getAll(std::string_view name) const
+{
+    string ret;
+    forEach(name, [&ret](std::string_view v) {
+        if(!ret.empty()) ret += ", ";
+        ret.append(v);
+        return true;
+    });
+    return ret;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+using std::string;
+using std::vector;
+
+/* Single-pass index over the SIP headers block (AmSipRequest::hdrs).
+ *
+ * built lazily on the first lookup. keeps offsets of each header name/value
+ * bucketed by the hash of the lowercased header name,
+ * so the same request can be queried by the pre-auth, identity parsing,
+ * routing headers and filters without rescanning the headers */
+class SipHeaderIndex
+{
+  public:
+    struct Entry {
+        uint32_t name_begin;
+        uint32_t name_len;
+        uint32_t val_begin;
+        uint32_t val_len;
+        uint32_t hdr_end;
+        uint32_t hash;
+        int32_t next; //next entry within the same bucket
+    };
+
+  private:
+    static constexpr uint32_t BUCKETS_COUNT = 32;
+
+    const string *hdrs;
+
+    mutable bool built;
+    mutable bool parse_failed;
+    //content hash of the indexed headers to validate bind()
+    mutable size_t built_hash;
+    mutable vector<Entry> entries;
+    mutable int32_t bucket_head[BUCKETS_COUNT];
+    mutable int32_t bucket_tail[BUCKETS_COUNT];
+
+    void reset() const;
+    void build() const;
+    void ensure() const { if(!built) build(); }
+
+    const Entry *first(std::string_view name) const;
+    const Entry *next(const Entry *e, std::string_view name) const;
+
+  public:
+    SipHeaderIndex();
+    SipHeaderIndex(const string &hdrs);
+
+    /* rebind index to the copy of the indexed headers
+     * (e.g. after AmSipRequest copying).
+     * index is invalidated if the content differs.
+     * previously bound string is not accessed, it can be destroyed already */
+    void bind(const string &hdrs);
+
+    /* lowercased FNV-1a hash of the header name */
+    static uint32_t hash(const char *s, size_t len);
+
+    /* true if skip_header() failed on some header.
+     * entries before the failed one are indexed anyway */
+    bool failed() const { ensure(); return parse_failed; }
+
+    /* all headers in the original order */
+    const vector<Entry> &headers() const { ensure(); return entries; }
+
+    std::string_view name(const Entry &e) const {
+        return std::string_view(hdrs->data() + e.name_begin, e.name_len);
+    }
+    std::string_view value(const Entry &e) const {
+        return std::string_view(hdrs->data() + e.val_begin, e.val_len);
+    }
+
+    /* calls f(std::string_view value) for each header with the name
+     * (case-insensitive) in the original order.
+     * stops iteration if f returns false */
+    template<typename F>
+    void forEach(std::string_view name, F f) const
+    {
+        for(auto e = first(name); e; e = next(e, name)) {
+            if(!f(value(*e))) break;
+        }
+    }
+
+    bool exists(std::string_view name) const { return first(name) != nullptr; }
+
+    /* value of the first header with the name. empty if not found */
+    string getFirst(std::string_view name) const;
+
+    /* values of all headers with the name joined by ", "
+     * (same as getHeader(hdrs, name) without 'single' flag) */
+    string getAll(std::string_view name) const;
+};
@@ -15,6 +15,27 @@ SqlCallProfile::SqlCallProfile():
 	bleg_override_id(0)
 {}
 
+SqlCallProfile::SqlCallProfile(const allocator_type &alloc):
+	aleg_override_id(0),
+	bleg_override_id(0),
+	rl(alloc)
+{}
+
+SqlCallProfile::SqlCallProfile(const SqlCallProfile &other, const allocator_type &alloc):
+	SBCCallProfile(other),
+	time_limit(other.time_limit),
+	disconnect_code_id(other.disconnect_code_id),
+	session_refresh_method_id(other.session_refresh_method_id),
+	aleg_session_refresh_method_id(other.aleg_session_refresh_method_id),
+	aleg_override_id(other.aleg_override_id),
+	bleg_override_id(other.bleg_override_id),
+	dump_level_id(other.dump_level_id),
+	trusted_hdrs_gw(other.trusted_hdrs_gw),
+	dyn_fields(other.dyn_fields),
+	resources(other.resources),
+	rl(other.rl, alloc)
+{}
+
 SqlCallProfile::~SqlCallProfile(){ }
 
 static void readMediaAcl(const AmArg &t, const char key[], std::vector<AmSubnet> &acl)
@@ -68,9 +89,7 @@ bool SqlCallProfile::readFromTuple(const AmArg &t,const DynFieldsT &df){
 	}
 
 	if(Yeti::instance().config.use_radius){
-		for(const auto &f: t) {
-			placeholders_hash[f.first] = arg2json(f.second);
-		}
+		placeholders_hash.setRow(t);
 	}
 
 	disconnect_code_id = DbAmArg_hash_get_int(t,"disconnect_code_id",0);
@@ -96,28 +115,28 @@ bool SqlCallProfile::readFromTuple(const AmArg &t,const DynFieldsT &df){
 	patch_ruri_next_hop = DbAmArg_hash_get_bool(t, "patch_ruri_next_hop", false);
 	aleg_next_hop = DbAmArg_hash_get_str(t, "aleg_next_hop");
 
-	if(!readFilterSet(t,"transit_headers_a2b",headerfilter_a2b)) {
+	if(!readFilterSet(t,"transit_headers_a2b",headerfilter_a2b.write())) {
 		ERROR("failed to read transit_headers_a2b");
 		return false;
 	}
 
-	if(!readFilterSet(t,"transit_headers_b2a",headerfilter_b2a)) {
+	if(!readFilterSet(t,"transit_headers_b2a",headerfilter_b2a.write())) {
 		ERROR("failed to read transit_headers_b2a");
 		return false;
 	}
 
-	if (!readFilter(t, "sdp_filter", sdpfilter, true)) {
+	if (!readFilter(t, "sdp_filter", sdpfilter.write(), true)) {
 		ERROR("failed to read sdp_filter");
 		return false;
 	}
 
 	// SDP alines filter
-	if (!readFilter(t, "sdp_alines_filter", sdpalinesfilter, false)) {
+	if (!readFilter(t, "sdp_alines_filter", sdpalinesfilter.write(), false)) {
 		ERROR("failed to read sdp_alines_filter");
 		return false;
 	}
 
-	if (!readFilter(t, "bleg_sdp_alines_filter", bleg_sdpalinesfilter, false, FILTER_TYPE_WHITELIST)) {
+	if (!readFilter(t, "bleg_sdp_alines_filter", bleg_sdpalinesfilter.write(), false, FILTER_TYPE_WHITELIST)) {
 		ERROR("failed to read bleg_sdp_alines_filter");
 		return false;
 	}
@@ -223,7 +242,7 @@ bool SqlCallProfile::readFromTuple(const AmArg &t,const DynFieldsT &df){
 			s_pos++;
 		// DBG("got translation %u => %u %s",
 		// 	from_code, to_code, to_reply.substr(s_pos).c_str());
-		reply_translations[from_code] = make_pair(to_code, to_reply.substr(s_pos));
+		reply_translations.write()[from_code] = make_pair(to_code, to_reply.substr(s_pos));
 	}
 	
 	append_headers_req = DbAmArg_hash_get_str(t, "append_headers_req");
@@ -350,8 +369,8 @@ bool SqlCallProfile::readFromTuple(const AmArg &t,const DynFieldsT &df){
 	aleg_media_encryption_mode_id = DbAmArg_hash_get_int(t,"aleg_media_encryption_mode_id",0);
 	bleg_media_encryption_mode_id = DbAmArg_hash_get_int(t,"bleg_media_encryption_mode_id",0);
 
-	readMediaAcl(t, "aleg_rtp_acl", aleg_rtp_acl);
-	readMediaAcl(t, "bleg_rtp_acl", bleg_rtp_acl);
+	readMediaAcl(t, "aleg_rtp_acl", aleg_rtp_acl.write());
+	readMediaAcl(t, "bleg_rtp_acl", bleg_rtp_acl.write());
 
 	ss_crt_id = DbAmArg_hash_get_int(t, "ss_crt_id", 0);
 	ss_attest_id = DbAmArg_hash_get_int(t, "ss_attest_id", 3 /* attest level C */);
@@ -424,18 +443,18 @@ void SqlCallProfile::infoPrint(const DynFieldsT &df){
 
 		string filter_type; size_t filter_elems;
 
-		filter_type = sdpfilter.size() ? FilterType2String(sdpfilter.back().filter_type) : "disabled";
-		filter_elems = sdpfilter.size() ? sdpfilter.back().filter_list.size() : 0;
+		filter_type = sdpfilter->size() ? FilterType2String(sdpfilter->back().filter_type) : "disabled";
+		filter_elems = sdpfilter->size() ? sdpfilter->back().filter_list.size() : 0;
 		DBG("SDP filter is %sabled, %s, %zd items in list",
-		sdpfilter.size()?"en":"dis", filter_type.c_str(), filter_elems);
+		sdpfilter->size()?"en":"dis", filter_type.c_str(), filter_elems);
 
-		filter_type = sdpalinesfilter.size() ? FilterType2String(sdpalinesfilter.back().filter_type) : "disabled";
-		filter_elems = sdpalinesfilter.size() ? sdpalinesfilter.back().filter_list.size() : 0;
-		DBG("SDP alines-filter is %sabled, %s, %zd items in list", sdpalinesfilter.size()?"en":"dis", filter_type.c_str(), filter_elems);
+		filter_type = sdpalinesfilter->size() ? FilterType2String(sdpalinesfilter->back().filter_type) : "disabled";
+		filter_elems = sdpalinesfilter->size() ? sdpalinesfilter->back().filter_list.size() : 0;
+		DBG("SDP alines-filter is %sabled, %s, %zd items in list", sdpalinesfilter->size()?"en":"dis", filter_type.c_str(), filter_elems);
 
-		filter_type = bleg_sdpalinesfilter.size() ? FilterType2String(bleg_sdpalinesfilter.back().filter_type) : "disabled";
-		filter_elems = bleg_sdpalinesfilter.size() ? bleg_sdpalinesfilter.back().filter_list.size() : 0;
-		DBG("SDP Bleg alines-filter is %sabled, %s, %zd items in list", bleg_sdpalinesfilter.size()?"en":"dis", filter_type.c_str(), filter_elems);
+		filter_type = bleg_sdpalinesfilter->size() ? FilterType2String(bleg_sdpalinesfilter->back().filter_type) : "disabled";
+		filter_elems = bleg_sdpalinesfilter->size() ? bleg_sdpalinesfilter->back().filter_list.size() : 0;
+		DBG("SDP Bleg alines-filter is %sabled, %s, %zd items in list", bleg_sdpalinesfilter->size()?"en":"dis", filter_type.c_str(), filter_elems);
 
 		DBG("RTP relay %sabled", rtprelay_enabled?"en":"dis");
 		if (rtprelay_enabled) {
@@ -494,10 +513,10 @@ void SqlCallProfile::infoPrint(const DynFieldsT &df){
 		DBG("SIP auth %sabled", auth_enabled?"en":"dis");
 		DBG("SIP auth for A leg %sabled", auth_aleg_enabled?"en":"dis");
 
-		if (reply_translations.size()) {
+		if (reply_translations->size()) {
 			string reply_trans_codes;
-			for(map<unsigned int, std::pair<unsigned int, string> >::iterator it=
-					reply_translations.begin(); it != reply_translations.end(); it++)
+			for(map<unsigned int, std::pair<unsigned int, string> >::const_iterator it=
+					reply_translations->begin(); it != reply_translations->end(); it++)
 				reply_trans_codes += int2str(it->first)+", ";
 			reply_trans_codes.erase(reply_trans_codes.length()-2);
 			DBG("reply translation for  %s", reply_trans_codes.c_str());
@@ -575,8 +594,8 @@ void SqlCallProfile::infoPrint(const DynFieldsT &df){
 		DBG("aleg_rtp_filter_inband_dtmf: %d",aleg_rtp_filter_inband_dtmf);
 		DBG("bleg_rtp_filter_inband_dtmf: %d",bleg_rtp_filter_inband_dtmf);
 
-		DBG("aleg_rtp_acl size: %zd", aleg_rtp_acl.size());
-		DBG("bleg_rtp_acl size: %zd", bleg_rtp_acl.size());
+		DBG("aleg_rtp_acl size: %zd", aleg_rtp_acl->size());
+		DBG("bleg_rtp_acl size: %zd", bleg_rtp_acl->size());
 
 		DBG("disable_early_media: '%s'",suppress_early_media?"yes":"no");
 		DBG("force_one_way_early_media '%s'",force_one_way_early_media?"yes":"no");
@@ -38,7 +38,15 @@ struct SqlCallProfile
 	string resources;
 	ResourceList rl;
 
+	/* allocator-aware construction is used by CallCtx::profiles
+	 * to place resources list into the per-call arena */
+	using allocator_type = std::pmr::polymorphic_allocator<char>;
+
 	SqlCallProfile();
+	explicit SqlCallProfile(const allocator_type &alloc);
+	SqlCallProfile(const SqlCallProfile &other) = default;
+	SqlCallProfile(const SqlCallProfile &other, const allocator_type &alloc);
+	SqlCallProfile &operator=(const SqlCallProfile &other) = default;
 	~SqlCallProfile();
 
 	bool readFromTuple(const AmArg &t,const DynFieldsT &df);
@@ -79,12 +79,16 @@ SqlRouter::SqlRouter()
     db_hits_time(stat_group(Counter, "yeti", "router_db_hits_time").addAtomicCounter()),
     hits(stat_group(Counter, "yeti", "router_hits").addAtomicCounter()),
     active_requests(stat_group(Gauge, "yeti", "router_db_active_requests").addAtomicCounter()),
-    gt_min(0), gt_max(0),
+    getprofile_latency(StatsRegistry::instance()->histogram(
+        "router_getprofile_latency", "get_profiles() requests latency")),
+    cdr_commit_latency(StatsRegistry::instance()->histogram(
+        "cdr_commit_latency", "sampled CDR enqueue to DB commit latency")),
+    cdr_writes(0),
     gps_max(0), gps_avg(0),
+    mi_start(time(nullptr)),
     mi(5),
     gpi(0)
 {
-    time(&mi_start);
 
     INFO("SqlRouter instance[%p] created",this);
 
@@ -110,6 +114,7 @@ SqlRouter::~SqlRouter()
 void SqlRouter::stop()
 {
   DBG("SqlRouter::stop()");
+  flush_auth_log(true);
   /*if(master_pool)
     master_pool->stop();
   if(slave_pool)
@@ -141,6 +146,10 @@ int SqlRouter::load_db_interface_in_out()
 
 	auto &sync_db = Yeti::instance().sync_db;
 
+	//independent queries. post both without waiting
+	sync_db.prefetch("SELECT * from load_interface_out()", "load_interface_out");
+	sync_db.prefetch("SELECT * from load_interface_in()", "load_interface_in");
+
 	if(sync_db.exec_query("SELECT * from load_interface_out()", "load_interface_out"))
 		return 1;
 	assertArgArray(sync_db.db_reply_result);
@@ -218,6 +227,11 @@ int SqlRouter::configure(cfg_t *confuse_cfg, AmConfigReader &cfg)
     failover_to_slave = cfg.getParameterInt("failover_to_slave", 0);
     connection_lifetime = cfg_getint(routing_sec, opt_name_connection_lifetime);
 
+    if(admission_control.configure(routing_sec)) {
+        ERROR("failed to configure admission control");
+        return 1;
+    }
+
     cfg_t *auth_sec = cfg_getsec(confuse_cfg, section_name_auth);
     if(!auth_sec || 0==auth_configure(auth_sec)) {
         INFO("SqlRouter::auth_configure: config successfuly readed");
@@ -406,6 +420,11 @@ int SqlRouter::configure(cfg_t *confuse_cfg, AmConfigReader &cfg)
             cdr_cfg.batch_size = cfg_getint(cdr_section, "auth_batch_size");
         if(cfg_size(cdr_section, "auth_batch_timeout"))
             cdr_cfg.batch_timeout = cfg_getint(cdr_section, "auth_batch_timeout")/1000;
+
+        unsigned int auth_aggregation_window = 0;
+        if(cfg_size(cdr_section, "auth_aggregation_window"))
+            auth_aggregation_window = cfg_getint(cdr_section, "auth_aggregation_window");
+        auth_log_batch.configure(cdr_cfg.batch_size, std::chrono::seconds(auth_aggregation_window));
     }
 
     AmEventDispatcher::instance()->post(POSTGRESQL_QUEUE,
@@ -446,6 +465,10 @@ int SqlRouter::configure(cfg_t *confuse_cfg, AmConfigReader &cfg)
     pg_config_auth_log->addSearchPath(writecdr_schema);
     pg_config_auth_log->addSearchPath("public");
 
+    //aggregated records count as the last write_auth_log argument
+    if(auth_log_batch.isAggregationEnabled())
+        auth_log_types.push_back("integer");
+
     sql.str("");
     sql << "SELECT " << authlog_function << SqlPlaceHolderArgs(auth_log_types.size());
 
@@ -461,42 +484,59 @@ int SqlRouter::configure(cfg_t *confuse_cfg, AmConfigReader &cfg)
 void SqlRouter::update_counters(struct timeval &start_time)
 {
     struct timeval now_time,diff_time;
-    int intervals;
-    double diff,gps;
+    double gps;
 
     gettimeofday(&now_time,NULL);
 
     db_hits.inc();
 
-    //per second
-    diff = difftime(now_time.tv_sec,mi_start);
-    intervals = diff/mi;
-    if(intervals > 0){
-        mi_start = now_time.tv_sec;
-        gps = gpi/(double)mi;
+    //per second. called from the sessions threads
+    time_t interval_start = mi_start.load(std::memory_order_relaxed);
+    if(now_time.tv_sec - interval_start >= mi &&
+       mi_start.compare_exchange_strong(interval_start, now_time.tv_sec))
+    {
+        gps = gpi.exchange(1)/(double)mi;
         gps_avg = gps;
-        if(gps > gps_max)
-            gps_max = gps;
-        gpi = 1;
+        double max = gps_max.load(std::memory_order_relaxed);
+        while(gps > max && !gps_max.compare_exchange_weak(max, gps));
     } else {
-       gpi++;
+        gpi++;
     }
 
     // took
     timersub(&now_time,&start_time,&diff_time);
-    diff = timeval2double(diff_time);
-    if(diff > gt_max)
-        gt_max = diff;
-    if(!gt_min || (diff < gt_min))
-        gt_min = diff;
+    getprofile_latency.record(
+        static_cast<uint64_t>(diff_time.tv_sec)*1000000 + diff_time.tv_usec);
+
+    db_hits_time.inc(diff_time.tv_sec*1000 + diff_time.tv_usec/1000);
+}
 
-    db_hits_time.inc(diff_time.tv_sec + diff_time.tv_usec/1000);
+void SqlRouter::onProfileRequestStarted()
+{
+    active_requests.inc();
+    admission_control.onRequestStarted();
+}
+
+void SqlRouter::onProfileRequestFinished(const struct timeval &start_time, bool replied)
+{
+    active_requests.dec();
+
+    if(!replied) {
+        admission_control.onRequestFinished(-1);
+        return;
+    }
+
+    struct timeval now_time,diff_time;
+    gettimeofday(&now_time,NULL);
+    timersub(&now_time,&start_time,&diff_time);
+    admission_control.onRequestFinished(diff_time.tv_sec*1000 + diff_time.tv_usec/1000);
 }
 
 AmArg SqlRouter::db_async_get_profiles(
     AmControlledLock &call_ctx_lock,
     const std::string &local_tag,
     const AmSipRequest &req,
+    const SipHeaderIndex &hdrs_index,
     Auth::auth_id_type auth_id,
     AmArg *identity_data)
 {
@@ -514,15 +554,16 @@ AmArg SqlRouter::db_async_get_profiles(
         PGTransactionData(), true /* prepared */));
 
     auto &query_info = pg_getprofile_event.get()->qdata.info[0];
+    query_info.params.reserve(getprofile_types.size());
 
 #define invoc_field(field_value)\
-    query_info.addParam(field_value);
+    query_info.params.emplace_back(field_value);
 
 #define invoc_typed_field(type,field_value)\
     query_info.addTypedParam(type, field_value);
 
 #define invoc_null() \
-    query_info.addParam(AmArg());
+    query_info.params.emplace_back();
 
     auto &gc = Yeti::instance().config;
 
@@ -582,10 +623,11 @@ AmArg SqlRouter::db_async_get_profiles(
     }
 
     //invoc headers from sip request
+    string value;
     for(vector<UsedHeaderField>::const_iterator it = used_header_fields.begin();
             it != used_header_fields.end(); ++it){
-        string value;
-        if(it->getValue(req,value)){
+        value.clear();
+        if(it->getValue(req,hdrs_index,value)){
             invoc_field(value);
         } else {
             invoc_null();
@@ -631,12 +673,22 @@ void SqlRouter::write_cdr(std::unique_ptr<Cdr> &cdr, bool last)
     cdr->writed = true;
     cdr->is_last = last;
 
+    bool sampled = 0==cdr_writes.fetch_add(1, std::memory_order_relaxed) % CDR_COMMIT_LATENCY_SAMPLING;
+
     std::unique_ptr<PGParamExecute> pg_param_execute_event;
     pg_param_execute_event.reset(new PGParamExecute(
-        PGQueryData(
-        yeti_cdr_pg_worker, /* pg worker name */
-        cdr_statement_name, /* prepared stmt name */
-        false /*single*/),
+        sampled ?
+            PGQueryData(
+                yeti_cdr_pg_worker, /* pg worker name */
+                cdr_statement_name, /* prepared stmt name */
+                false /*single*/,
+                YETI_QUEUE_NAME,
+                CDR_WRITE_TOKEN_PREFIX + std::to_string(
+                    std::chrono::steady_clock::now().time_since_epoch().count())) :
+            PGQueryData(
+                yeti_cdr_pg_worker, /* pg worker name */
+                cdr_statement_name, /* prepared stmt name */
+                false /*single*/),
     PGTransactionData(), true /* prepared */));
     cdr->apply_params(pg_param_execute_event.get()->qdata.info.front(), dyn_fields);
 
@@ -661,8 +713,39 @@ void SqlRouter::write_cdr(std::unique_ptr<Cdr> &cdr, bool last)
   }
 }
 
-void SqlRouter::write_auth_log(const AuthCdr &auth_log)
+bool SqlRouter::isCdrWriteToken(const string &token)
+{
+    return 0==token.compare(0, sizeof(CDR_WRITE_TOKEN_PREFIX)-1, CDR_WRITE_TOKEN_PREFIX);
+}
+
+void SqlRouter::onCdrWriteReply(const string &token)
+{
+    long long enqueued_at;
+    if(!str2longlong(token.substr(sizeof(CDR_WRITE_TOKEN_PREFIX)-1), enqueued_at))
+        return;
+
+    cdr_commit_latency.record(
+        std::chrono::steady_clock::now().time_since_epoch() -
+        std::chrono::steady_clock::duration(enqueued_at));
+}
+
+void SqlRouter::write_auth_log(AuthCdr &&auth_log)
+{
+    if(auth_log_batch.add(std::move(auth_log)))
+        flush_auth_log(false);
+}
+
+void SqlRouter::onTimer()
 {
+    flush_auth_log(false);
+}
+
+void SqlRouter::flush_auth_log(bool force)
+{
+    vector<AuthCdr> records;
+    if(!auth_log_batch.take(records, force))
+        return;
+
     std::unique_ptr<PGParamExecute> pg_param_execute_event;
     pg_param_execute_event.reset(new PGParamExecute(
         PGQueryData(
@@ -671,19 +754,30 @@ void SqlRouter::write_auth_log(const AuthCdr &auth_log)
         false /*single*/),
     PGTransactionData(), true /* prepared */));
 
-    auth_log.apply_params(pg_param_execute_event.get()->qdata.info.front());
+    auto &info = pg_param_execute_event->qdata.info;
+    const bool with_count = auth_log_batch.isAggregationEnabled();
+
+    info.reserve(records.size());
+    for(size_t k = 0; k < records.size(); k++) {
+        if(k) info.emplace_back(auth_log_statement_name, false /*single*/);
+        records[k].apply_params(info.back(), with_count);
+    }
 
     if(Yeti::instance().config.postgresql_debug) {
-        auto &q = pg_param_execute_event->qdata.info.front();
-        for(unsigned int i = 0; i < q.params.size(); i++) {
-            DBG("%p/auth_log %d(%s/%s): %s %s",
-                &auth_log, i+1,
-                i < auth_log_static_fields.size() ?
-                    auth_log_static_fields[i].name :
-                    used_header_fields[i - auth_log_static_fields.size()].getName().data(),
-                auth_log_types[i].data(),
-                AmArg::t2str(q.params[i].getType()),
-                AmArg::print(q.params[i]).data());
+        for(size_t k = 0; k < info.size(); k++) {
+            auto &q = info[k];
+            for(unsigned int i = 0; i < q.params.size(); i++) {
+                DBG("%p/auth_log[%zu] %d(%s/%s): %s %s",
+                    pg_param_execute_event.get(), k, i+1,
+                    i < auth_log_static_fields.size() ?
+                        auth_log_static_fields[i].name :
+                        (i - auth_log_static_fields.size() < used_header_fields.size() ?
+                            used_header_fields[i - auth_log_static_fields.size()].getName().data() :
+                            "count"),
+                    auth_log_types[i].data(),
+                    AmArg::t2str(q.params[i].getType()),
+                    AmArg::print(q.params[i]).data());
+            }
         }
     }
 
@@ -750,13 +844,16 @@ void SqlRouter::getConfig(AmArg &arg){
 void SqlRouter::getStats(AmArg &arg)
 {
     /* SqlRouter stats */
-    arg["gt_min"] = gt_min;
-    arg["gt_max"] = gt_max;
-    arg["gps_max"] = gps_max;
-    arg["gps_avg"] = gps_avg;
+    auto latency = getprofile_latency.snapshot();
+    arg["gt_min"] = latency.min / 1e6;
+    arg["gt_max"] = latency.max / 1e6;
+    arg["gps_max"] = gps_max.load();
+    arg["gps_avg"] = gps_avg.load();
 
     arg["hits"] = static_cast<unsigned int>(hits.get());
     arg["db_hits"] = static_cast<unsigned int>(db_hits.get());
+
+    auth_log_batch.getStats(arg["auth_log"]);
 }
 
 static void assertEndCRLF(string& s)
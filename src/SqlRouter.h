@@ -8,10 +8,13 @@
 #include "db/DbTypes.h"
 #include "cdr/CdrBase.h"
 #include "cdr/AuthCdr.h"
+#include "cdr/AuthLogBatch.h"
 #include "CodesTranslator.h"
 #include "UsedHeaderField.h"
 #include "Auth.h"
 #include "CallCtx.h"
+#include "AdmissionControl.h"
+#include "stats/StatsRegistry.h"
 
 #include "RedisConnection.h"
 
@@ -21,6 +24,11 @@ using std::vector;
 
 string const getprofile_sql_statement_name("getprofile");
 
+#define CDR_WRITE_TOKEN_PREFIX "cdr:"
+/* every Nth CDR write is sent with the reply token to sample cdr_commit_latency.
+ * other writes are not replied to avoid the yeti queue round trip per CDR */
+#define CDR_COMMIT_LATENCY_SAMPLING 64
+
 struct GetProfileException {
     int code;
     bool fatal; //if true we should reload pg connection
@@ -49,11 +57,13 @@ class SqlRouter
 {
     //stats
     AtomicCounter &db_hits, &db_hits_time, &hits, &active_requests;
-    double gt_min,gt_max;
-    double gps_max,gps_avg;
-    time_t mi_start;
+    LatencyHistogram &getprofile_latency;
+    LatencyHistogram &cdr_commit_latency;
+    std::atomic<unsigned long> cdr_writes;
+    std::atomic<double> gps_max,gps_avg;
+    std::atomic<time_t> mi_start;
     time_t mi;
-    unsigned int gpi;
+    std::atomic<unsigned int> gpi;
 
     //CdrWriter *cdr_writer;
 
@@ -70,7 +80,11 @@ class SqlRouter
     //PreparedQueriesT cdr_prepared_queries;
     DynFieldsT dyn_fields;
 
+    AdmissionControl admission_control;
+    AuthLogBatch auth_log_batch;
+
     int load_db_interface_in_out();
+    void flush_auth_log(bool force);
 
   public:
     SqlRouter();
@@ -82,6 +96,7 @@ class SqlRouter
         AmControlledLock &call_ctx_lock,
         const std::string &local_tag,
         const AmSipRequest&,
+        const SipHeaderIndex &hdrs_index,
         Auth::auth_id_type auth_id,
         AmArg *identity_data);
 
@@ -90,7 +105,12 @@ class SqlRouter
 
     void align_cdr(Cdr &cdr);
     void write_cdr(std::unique_ptr<Cdr> &cdr, bool last);
-    void write_auth_log(const AuthCdr &auth_log);
+    //replies for the sampled write_cdr() queries. token contains the enqueue time
+    static bool isCdrWriteToken(const string &token);
+    void onCdrWriteReply(const string &token);
+    void write_auth_log(AuthCdr &&auth_log);
+    //periodic auth log batch flush
+    void onTimer();
 
     void log_auth(
         const AmSipRequest& req,
@@ -115,4 +135,11 @@ class SqlRouter
         bool send_reply = false);
 
     void update_counters(struct timeval &start_time);
+
+    AdmissionControl &getAdmissionControl() { return admission_control; }
+
+    /* in-flight getprofile requests accounting for the admission control.
+     * replied is false if the request was dropped without DB reply */
+    void onProfileRequestStarted();
+    void onProfileRequestFinished(const struct timeval &start_time, bool replied);
 };
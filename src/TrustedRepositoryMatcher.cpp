@@ -0,0 +1,211 @@
+#include "TrustedRepositoryMatcher.h"
+
+#include <cstring>
+
+static const char regex_special_chars[] = "^$\\.*+?()[]{}|";
+
+bool TrustedRepositoryMatcher::Literal::hasWildcards(size_t begin, size_t end) const
+{
+    if(any.empty()) return false;
+    for(size_t i = begin; i < end && i < any.size(); i++) {
+        if(any[i]) return true;
+    }
+    return false;
+}
+
+bool TrustedRepositoryMatcher::Literal::match(std::string_view s, bool prefix) const
+{
+    if(prefix) {
+        if(s.size() < text.size()) return false;
+        //trailing ".*" does not match line terminators as well
+        if(s.find_first_of("\r\n", text.size()) != std::string_view::npos)
+            return false;
+    } else if(s.size() != text.size()) {
+        return false;
+    }
+
+    if(any.empty())
+        return s.compare(0, text.size(), text) == 0;
+
+    for(size_t i = 0; i < text.size(); i++) {
+        if(any[i]) {
+            //ECMAScript '.' does not match line terminators
+            if(s[i] == '\n' || s[i] == '\r') return false;
+        } else if(s[i] != text[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view TrustedRepositoryMatcher::extractHost(std::string_view url, bool &complete)
+{
+    complete = false;
+
+    auto pos = url.find("://");
+    if(pos == std::string_view::npos)
+        return std::string_view();
+    pos += 3;
+
+    auto end = url.find_first_of(":/?#", pos);
+    if(end == std::string_view::npos)
+        return url.substr(pos);
+
+    complete = true;
+    return url.substr(pos, end - pos);
+}
+
+bool TrustedRepositoryMatcher::parseLiteral(std::string_view pattern, Literal &literal)
+{
+    literal.text.clear();
+    literal.any.clear();
+
+    if(!pattern.empty() && pattern.front() == '^')
+        pattern.remove_prefix(1);
+    if(!pattern.empty() && pattern.back() == '$' &&
+       (pattern.size() < 2 || pattern[pattern.size() - 2] != '\\'))
+    {
+        pattern.remove_suffix(1);
+    }
+
+    bool has_wildcards = false;
+    vector<bool> any;
+    for(size_t i = 0; i < pattern.size(); i++) {
+        char c = pattern[i];
+        if(c == '\\') {
+            if(++i == pattern.size())
+                return false;
+            //only escaped special chars are literals. \d, \w, etc are classes
+            if(!strchr(regex_special_chars, pattern[i]) && pattern[i] != '/')
+                return false;
+            literal.text.push_back(pattern[i]);
+            any.push_back(false);
+            continue;
+        }
+        if(c == '.') {
+            literal.text.push_back(c);
+            any.push_back(true);
+            has_wildcards = true;
+            continue;
+        }
+        if(strchr(regex_special_chars, c))
+            return false;
+        literal.text.push_back(c);
+        any.push_back(false);
+    }
+
+    if(has_wildcards)
+        literal.any.swap(any);
+
+    return true;
+}
+
+void TrustedRepositoryMatcher::add(const string &url_pattern)
+{
+    //compile anyway to reject invalid patterns the same way as before
+    std::regex regex(url_pattern);
+
+    memo.clear();
+
+    Literal literal;
+    if(parseLiteral(url_pattern, literal)) {
+        if(literal.any.empty())
+            exact.emplace(std::move(literal.text));
+        else
+            exact_wildcards.emplace_back(std::move(literal));
+        return;
+    }
+
+    std::string_view pattern(url_pattern);
+    if(pattern.size() > 2 && pattern.substr(pattern.size() - 2) == ".*" &&
+       parseLiteral(pattern.substr(0, pattern.size() - 2), literal))
+    {
+        bool complete;
+        auto host = extractHost(literal.text, complete);
+        size_t host_end = host.data() + host.size() - literal.text.data();
+        if(complete && !literal.hasWildcards(0, host_end)) {
+            host_prefixes[string(host)].emplace_back(std::move(literal));
+        } else {
+            prefixes.emplace_back(std::move(literal));
+        }
+        return;
+    }
+
+    regexes.emplace_back(std::move(regex));
+}
+
+void TrustedRepositoryMatcher::clear()
+{
+    exact.clear();
+    exact_wildcards.clear();
+    host_prefixes.clear();
+    prefixes.clear();
+    regexes.clear();
+    memo.clear();
+}
+
+bool TrustedRepositoryMatcher::matchUncached(const string &url) const
+{
+    if(exact.count(url))
+        return true;
+
+    for(const auto &l : exact_wildcards) {
+        if(l.match(url, false))
+            return true;
+    }
+
+    if(!host_prefixes.empty()) {
+        bool complete;
+        auto host = extractHost(url, complete);
+        if(complete) {
+            auto it = host_prefixes.find(string(host));
+            if(it != host_prefixes.end()) {
+                for(const auto &l : it->second) {
+                    if(l.match(url, true))
+                        return true;
+                }
+            }
+        }
+    }
+
+    for(const auto &l : prefixes) {
+        if(l.match(url, true))
+            return true;
+    }
+
+    for(const auto &r : regexes) {
+        if(std::regex_match(url, r))
+            return true;
+    }
+
+    return false;
+}
+
+bool TrustedRepositoryMatcher::match(const string &url) const
+{
+    auto it = memo.find(url);
+    if(it != memo.end())
+        return it->second;
+
+    bool ret = matchUncached(url);
+
+    if(memo.size() >= TRUSTED_REPOSITORY_MATCHER_MEMO_SIZE)
+        memo.clear();
+    memo.emplace(url, ret);
+
+    return ret;
+}
+
+TrustedRepositoryMatcher::Stats TrustedRepositoryMatcher::getStats() const
+{
+    Stats s;
+    s.exact = exact.size();
+    s.exact_wildcards = exact_wildcards.size();
+    s.host_prefixes = 0;
+    for(const auto &it : host_prefixes)
+        s.host_prefixes += it.second.size();
+    s.prefixes = prefixes.size();
+    s.regexes = regexes.size();
+    s.memo = memo.size();
+    return s;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <regex>
+#include <unordered_map>
+#include <unordered_set>
+
+using std::string;
+using std::vector;
+
+#define TRUSTED_REPOSITORY_MATCHER_MEMO_SIZE 4096
+
+/* x5u URL matcher compiled from the trusted repositories url patterns
+ *
+ * patterns are classified on add():
+ *   literal          - exact URLs set
+ *   literal + ".*"   - prefix table indexed by the URL host
+ *                      (or the linear prefixes list if the host is not literal)
+ *   other            - std::regex fallback
+ * unescaped '.' within literal is kept as the any char wildcard.
+ * match results are memorized per URL until clear() or memo overflow.
+ * semantics are the same as std::regex_match() against each pattern.
+ * not thread-safe */
+class TrustedRepositoryMatcher
+{
+  public:
+    struct Literal {
+        string text;
+        vector<bool> any; //wildcard positions. empty if there are no wildcards
+
+        bool hasWildcards(size_t begin, size_t end) const;
+        bool match(std::string_view s, bool prefix) const;
+    };
+
+  private:
+    std::unordered_set<string> exact;
+    vector<Literal> exact_wildcards;
+    std::unordered_map<string, vector<Literal>> host_prefixes;
+    vector<Literal> prefixes;
+    vector<std::regex> regexes;
+
+    mutable std::unordered_map<string, bool> memo;
+
+    bool matchUncached(const string &url) const;
+
+  public:
+    struct Stats {
+        size_t exact;
+        size_t exact_wildcards;
+        size_t host_prefixes;
+        size_t prefixes;
+        size_t regexes;
+        size_t memo;
+    };
+
+    /* throws std::regex_error for invalid patterns */
+    void add(const string &url_pattern);
+    void clear();
+
+    bool match(const string &url) const;
+
+    Stats getStats() const;
+
+    /* returns host part of the URL ("scheme://host[:port][/...]")
+     * complete is set to false if the string ends within the host */
+    static std::string_view extractHost(std::string_view url, bool &complete);
+
+    /* unescapes regex literal. returns false if pattern contains
+     * regex special characters except of '.'.
+     * leading '^' and trailing '$' are allowed */
+    static bool parseLiteral(std::string_view pattern, Literal &literal);
+};
@@ -116,6 +116,11 @@ UsedHeaderField::UsedHeaderField(const AmArg &a)
 }
 
 bool UsedHeaderField::getValue(const AmSipRequest &req,string &val) const
+{
+    return getValue(req, SipHeaderIndex(req.hdrs), val);
+}
+
+bool UsedHeaderField::getValue(const AmSipRequest &req,const SipHeaderIndex &hdrs_index,string &val) const
 {
     string hdr;
     sip_nameaddr na;
@@ -123,7 +128,7 @@ bool UsedHeaderField::getValue(const AmSipRequest &req,string &val) const
     sip_uri uri;
 
     if(!getInternalHeader(req,name,hdr))
-        hdr = getHeader(req.hdrs,name);
+        hdr = hdrs_index.getAll(name);
 
     if(hdr.empty()) {
         DBG("no header '%s' in SipRequest",name.c_str());
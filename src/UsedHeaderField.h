@@ -2,6 +2,7 @@
 #define USEDHEADERFIELD_H
 
 #include "AmSipMsg.h"
+#include "SipHeaderIndex.h"
 
 #include <string>
 
@@ -40,6 +41,7 @@ class UsedHeaderField {
     UsedHeaderField(const AmArg &a);
 
     bool getValue(const AmSipRequest &req,string &val) const;
+    bool getValue(const AmSipRequest &req,const SipHeaderIndex &hdrs_index,string &val) const;
     void getInfo(AmArg &arg) const;
     const char*type2str() const;
     const char*part2str() const;
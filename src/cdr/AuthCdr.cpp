@@ -87,7 +87,8 @@ AuthCdr::AuthCdr(
     code(code),
     reason(reason),
     internal_reason(internal_reason),
-    auth_id(auth_id)
+    auth_id(auth_id),
+    count(1)
 {
     for(const auto &h: hdrs_to_parse) {
         dynamic_fields.emplace_back();
@@ -107,16 +108,31 @@ AuthCdr::AuthCdr(
     fixup_utf8_inplace(realm);
 }
 
-void AuthCdr::apply_params(QueryInfo &query_info) const
+string AuthCdr::aggregation_key() const
 {
+    string key;
+    key.reserve(remote_ip.size() + username.size() + internal_reason.size() + 16);
+    key.append(remote_ip).append(1, '\0');
+    key.append(username).append(1, '\0');
+    key.append(1, success ? '1' : '0');
+    key.append(int2str(code)).append(1, '\0');
+    key.append(internal_reason);
+    return key;
+}
+
+void AuthCdr::apply_params(QueryInfo &query_info, bool with_count) const
+{
+    query_info.params.reserve(
+        auth_log_static_fields.size() + dynamic_fields.size() + (with_count ? 1 : 0));
+
 #define invoc(field_value) \
-    query_info.addParam(field_value);
+    query_info.params.emplace_back(field_value);
 
 #define invoc_typed(type,field_value)\
     query_info.addTypedParam(type, field_value);
 
 #define invoc_null() \
-    query_info.addParam(AmArg());
+    query_info.params.emplace_back();
 
 #define invoc_cond(field_value,condition)\
     if(condition) { invoc(field_value); }\
@@ -155,6 +171,9 @@ void AuthCdr::apply_params(QueryInfo &query_info) const
     for(const auto &f : dynamic_fields)
         invoc_cond(f, !f.empty());
 
+    if(with_count)
+        invoc(count);
+
 #undef invoc_cond_typed
 #undef invoc_cond
 #undef invoc_null
@@ -169,4 +188,5 @@ void AuthCdr::info(AmArg &s)
     s["remote_port"] = remote_port;
     s["r_uri"] = r_uri;
     s["method"] = method;
+    s["count"] = count;
 }
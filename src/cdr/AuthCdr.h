@@ -40,6 +40,9 @@ class AuthCdr
 
     vector<string> dynamic_fields;
 
+    //identical records merged into this one within the aggregation window
+    unsigned int count;
+
   public:
     AuthCdr(const AmSipRequest& req,
             const vector<UsedHeaderField> &hdrs_to_parse,
@@ -49,6 +52,11 @@ class AuthCdr
             const string &internal_reason,
             Auth::auth_id_type auth_id);
 
-    void apply_params(QueryInfo &query_info) const;
+    //source IP, username and result
+    string aggregation_key() const;
+    void aggregate() { count++; }
+    unsigned int get_count() const { return count; }
+
+    void apply_params(QueryInfo &query_info, bool with_count = false) const;
     void info(AmArg &s) override;
 };
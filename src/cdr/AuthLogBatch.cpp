@@ -0,0 +1,78 @@
+#include "AuthLogBatch.h"
+
+#define AUTH_LOG_DEFAULT_BATCH_SIZE 100
+
+AuthLogBatch::AuthLogBatch()
+  : batch_size(AUTH_LOG_DEFAULT_BATCH_SIZE),
+    aggregation_window(0),
+    window_start(std::chrono::steady_clock::now()),
+    events(stat_group(Counter, "yeti", "auth_log_events").addAtomicCounter()),
+    rows(stat_group(Counter, "yeti", "auth_log_rows").addAtomicCounter())
+{}
+
+void AuthLogBatch::configure(unsigned int in_batch_size, std::chrono::seconds in_aggregation_window)
+{
+    AmLock l(mutex);
+    batch_size = in_batch_size ? in_batch_size : 1;
+    aggregation_window = in_aggregation_window;
+    records.reserve(batch_size);
+}
+
+bool AuthLogBatch::add(AuthCdr &&record)
+{
+    events.inc();
+
+    AmLock l(mutex);
+
+    if(isAggregationEnabled()) {
+        auto ret = aggregated.try_emplace(record.aggregation_key(), records.size());
+        if(!ret.second) {
+            records[ret.first->second].aggregate();
+            return false;
+        }
+    }
+
+    records.emplace_back(std::move(record));
+    return records.size() >= batch_size;
+}
+
+bool AuthLogBatch::take(
+    std::vector<AuthCdr> &out, bool force,
+    std::chrono::steady_clock::time_point now)
+{
+    AmLock l(mutex);
+
+    if(records.empty()) {
+        window_start = now;
+        return false;
+    }
+
+    if(!force && records.size() < batch_size &&
+       now - window_start < aggregation_window)
+    {
+        return false;
+    }
+
+    out.swap(records);
+    records.clear();
+    records.reserve(batch_size);
+    aggregated.clear();
+    window_start = now;
+
+    rows.inc(out.size());
+
+    return true;
+}
+
+void AuthLogBatch::getStats(AmArg &ret)
+{
+    auto events_count = events.get();
+    auto rows_count = rows.get();
+
+    ret["events"] = static_cast<unsigned int>(events_count);
+    ret["rows"] = static_cast<unsigned int>(rows_count);
+    ret["aggregation_ratio"] = rows_count ?
+        static_cast<double>(events_count) / rows_count : 0.0;
+    ret["aggregation_window"] = static_cast<int>(aggregation_window.count());
+    ret["batch_size"] = batch_size;
+}
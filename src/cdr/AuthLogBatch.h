@@ -0,0 +1,47 @@
+#pragma once
+
+#include "AuthCdr.h"
+#include "AmThread.h"
+#include "AmStatistics.h"
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+/* auth log records accumulated between the DB writes
+ *
+ * records are taken for writing when batch_size rows are collected
+ * or on the periodic flush (each second, or each aggregation_window if set).
+ * with aggregation_window identical records (see AuthCdr::aggregation_key)
+ * are merged into the first one within the window and written as a single
+ * row with count */
+class AuthLogBatch
+{
+    AmMutex mutex;
+
+    unsigned int batch_size;
+    std::chrono::seconds aggregation_window;
+
+    std::vector<AuthCdr> records;
+    std::unordered_map<string, size_t> aggregated;
+    std::chrono::steady_clock::time_point window_start;
+
+    AtomicCounter &events;
+    AtomicCounter &rows;
+
+  public:
+    AuthLogBatch();
+
+    void configure(unsigned int batch_size, std::chrono::seconds aggregation_window);
+    bool isAggregationEnabled() const { return aggregation_window.count() != 0; }
+
+    //returns true if the batch is full and must be taken
+    bool add(AuthCdr &&record);
+
+    /* moves accumulated records to 'out' if the batch is full,
+     * the window is elapsed or 'force' is set */
+    bool take(std::vector<AuthCdr> &out, bool force = false,
+              std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    void getStats(AmArg &ret);
+};
@@ -788,6 +788,21 @@ char *Cdr::serialize_timers_data()
     add_num2json(time_limit);
     add_num2json(isup_propagation_delay);
 
+    if(setup_trace.isFinished()) {
+        cJSON *t = cJSON_CreateObject();
+        cJSON_AddNumberToObject(t, "total_us", setup_trace.getTotal());
+        for(int k = 0; k < CallSetupTrace::MaxStage; k++) {
+            auto stage = static_cast<CallSetupTrace::Stage>(k);
+            auto duration = setup_trace.getStageDuration(stage);
+            if(duration < 0) continue;
+            cJSON *st = cJSON_CreateObject();
+            cJSON_AddNumberToObject(st, "offset_us", setup_trace.getStageBegin(stage));
+            cJSON_AddNumberToObject(st, "duration_us", duration);
+            cJSON_AddItemToObject(t, CallSetupTrace::getStageName(stage), st);
+        }
+        cJSON_AddItemToObject(j, "setup_trace", t);
+    }
+
     s = cJSON_PrintUnformatted(j);
     cJSON_Delete(j);
     return s;
@@ -966,14 +981,18 @@ void Cdr::apply_params(
     QueryInfo &query_info,
     const DynFieldsT &df)
 {
+    /* construct params in place with the storage for all the statement
+     * arguments. addParam() copies the AmArg converted from the field */
+    query_info.params.reserve(WRITECDR_STATIC_FIELDS_COUNT);
+
 #define invoc(field_value) \
-    query_info.addParam(field_value);
+    query_info.params.emplace_back(field_value);
 
 #define invoc_typed(type,field_value)\
     query_info.addTypedParam(type, field_value);
 
 #define invoc_null() \
-    query_info.addParam(AmArg());
+    query_info.params.emplace_back();
 
 #define invoc_cond(field_value,condition)\
     if(condition) { invoc(field_value); }\
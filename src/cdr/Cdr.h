@@ -10,6 +10,7 @@
 #include "ampi/PostgreSqlAPI.h"
 #include "CdrBase.h"
 #include "CdrHeaders.h"
+#include "../CallSetupTrace.h"
 
 #include <unordered_set>
 
@@ -73,6 +74,9 @@ struct Cdr
     struct timeval sip_18x_time;
     bool sip_early_media_present;
 
+    //first attempt only. written as 'setup_trace' within the timers data
+    CallSetupTrace setup_trace;
+
     string legB_remote_ip, legB_local_ip;
     unsigned short legB_remote_port, legB_local_port,
                    legB_transport_protocol_id;
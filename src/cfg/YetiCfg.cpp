@@ -70,6 +70,13 @@ int YetiCfg::configure(cfg_t *cfg, AmConfigReader &am_cfg)
     aleg_cdr_headers = cfg_aleg_cdr_headers;
     bleg_reply_cdr_headers = cfg_bleg_reply_cdr_headers;
     postgresql_debug = cfg_getbool(cfg, opt_name_postgresql_debug);
+    db_snapshot_dir = cfg_getstr(cfg, opt_name_db_snapshot_dir);
+    db_delta_reloads = cfg_getbool(cfg, opt_name_db_delta_reloads);
+    db_notify_channel = cfg_getstr(cfg, opt_name_db_notify_channel);
+    if(!db_notify_channel.empty()) {
+        //check_states() polling is the safety net for the missed notifications
+        db_refresh_interval = std::chrono::seconds(cfg_getint(cfg, opt_name_db_notify_refresh_interval));
+    }
 
     serialize_to_amconfig(cfg, am_cfg);
 
@@ -94,6 +101,9 @@ int YetiCfg::configure(cfg_t *cfg, AmConfigReader &am_cfg)
         return -1;
     audio_recorder_compress = am_cfg.getParameterInt("audio_recorder_compress",1)==1;
 
+    if(!db_snapshot_dir.empty() && check_dir_write_permissions(db_snapshot_dir))
+        return -1;
+
     routing_db_master.cfg2dbcfg(am_cfg, "master");
 
     if(!am_cfg.hasParameter("routing_schema")) {
@@ -145,6 +155,8 @@ void YetiCfg::serialize_to_amconfig(cfg_t *y, AmConfigReader &out)
 		//resources
 		c = cfg_getsec(y,"resources");
 		add2hash(c,"reject_on_cache_error","reject_on_error",out);
+		add2hash(c,"max_inflight_batches","max_inflight_batches",out);
+		add2hash(c,"resources_io_threads","io_threads",out);
 			//write
 			apply_redis_pool_cfg(cfg_getsec(c,"write"),"write_redis_",out);
 			//read
@@ -160,9 +172,12 @@ void YetiCfg::serialize_to_amconfig(cfg_t *y, AmConfigReader &out)
 		add2hash(c,"registrar_expires_min","expires_min",out);
 		add2hash(c,"registrar_expires_max","expires_max",out);
 		add2hash(c,"registrar_expires_default","expires_default",out);
+		add2hash(c,"registrar_aor_cache","aor_cache",out);
+		add2hash(c,"registrar_aor_cache_ttl","aor_cache_ttl",out);
 			c = cfg_getsec(c, "redis");
 			add2hash(c,"registrar_redis_host","host",out);
 			add2hash(c,"registrar_redis_port","port",out);
+			add2hash(c,"registrar_redis_io_threads","io_threads",out);
 
 		//rpc
 		c = cfg_getsec(y,"rpc");
@@ -16,6 +16,9 @@ struct YetiCfg {
     DbConfig routing_db_master;
 
     std::chrono::seconds db_refresh_interval;
+    string db_snapshot_dir;
+    bool db_delta_reloads;
+    string db_notify_channel;
 
     string msg_logger_dir;
     string audio_recorder_dir;
@@ -30,10 +33,13 @@ struct YetiCfg {
     bool registrar_enabled;
     string registrar_redis_host;
     int registrar_redis_port;
+    int registrar_redis_io_threads;
     int registrar_keepalive_interval;
     int registrar_expires_min;
     int registrar_expires_max;
     int registrar_expires_default;
+    bool registrar_aor_cache;
+    int registrar_aor_cache_ttl;
 
     cdr_headers_t aleg_cdr_headers;
     cdr_headers_t bleg_reply_cdr_headers;
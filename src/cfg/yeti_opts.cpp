@@ -26,6 +26,10 @@ char section_name_statistics[] = "statistics";
 char opt_name_core_options_handling[] = "core_options_handling";
 char opt_name_pcap_memory_logger[] = "pcap_memory_logger";
 char opt_name_db_refresh_interval[] = "db_refresh_interval";
+char opt_name_db_snapshot_dir[] = "db_snapshot_dir";
+char opt_name_db_delta_reloads[] = "db_delta_reloads";
+char opt_name_db_notify_channel[] = "db_notify_channel";
+char opt_name_db_notify_refresh_interval[] = "db_notify_refresh_interval";
 char opt_name_ip_auth_reject_if_no_matched[] = "ip_auth_reject_if_no_matched";
 char opt_name_ip_auth_header[] = "ip_auth_header";
 char opt_name_postgresql_debug[] = "postgresql_debug";
@@ -39,6 +43,28 @@ char opt_identity_certs_cache_failed_verify_ttl[] = "certs_cache_failed_verify_t
 
 char opt_func_name_header[] = "header";
 
+char section_name_admission_control[] = "admission_control";
+char opt_admission_control_enabled[] = "enabled";
+char opt_admission_control_target_latency[] = "target_latency";
+char opt_admission_control_min_active_requests[] = "min_active_requests";
+char opt_admission_control_max_active_requests[] = "max_active_requests";
+char opt_admission_control_reply_code[] = "reply_code";
+char opt_admission_control_reply_reason[] = "reply_reason";
+char opt_admission_control_retry_after[] = "retry_after";
+
+char section_name_cps_limit[] = "cps_limit";
+char opt_cps_limit_enabled[] = "enabled";
+char opt_cps_limit_default_limit[] = "default_limit";
+char opt_cps_limit_max_sources[] = "max_sources";
+char opt_cps_limit_reply_code[] = "reply_code";
+char opt_cps_limit_reply_reason[] = "reply_reason";
+char opt_cps_limit_retry_after[] = "retry_after";
+
+char section_name_call_setup_trace[] = "call_setup_trace";
+char opt_call_setup_trace_enabled[] = "enabled";
+char opt_call_setup_trace_sampling[] = "sampling";
+char opt_call_setup_trace_samples[] = "samples";
+
 int add_aleg_cdr_header(cfg_t *cfg, cfg_opt_t *opt, int argc, const char **argv);
 int add_bleg_reply_cdr_header(cfg_t *cfg, cfg_opt_t *opt, int argc, const char **argv);
 
@@ -52,6 +78,17 @@ cfg_opt_t sig_yeti_routing_pool_opts[] = {
 	CFG_END()
 };
 
+cfg_opt_t sig_yeti_routing_admission_control_opts[] = {
+	CFG_BOOL(opt_admission_control_enabled, cfg_false, CFGF_NONE),
+	CFG_INT(opt_admission_control_target_latency, 500 /* msec */, CFGF_NONE),
+	CFG_INT(opt_admission_control_min_active_requests, 10, CFGF_NONE),
+	CFG_INT(opt_admission_control_max_active_requests, 1000, CFGF_NONE),
+	CFG_INT(opt_admission_control_reply_code, 503, CFGF_NONE),
+	CFG_STR(opt_admission_control_reply_reason, "Service Unavailable", CFGF_NONE),
+	CFG_INT(opt_admission_control_retry_after, 5 /* sec. 0 to omit Retry-After */, CFGF_NONE),
+	CFG_END()
+};
+
 cfg_opt_t sig_yeti_routing_opts[] = {
 	DCFG_STR(schema),
 	DCFG_STR(function),
@@ -60,6 +97,7 @@ cfg_opt_t sig_yeti_routing_opts[] = {
 	CFG_INT(opt_name_connection_lifetime,0,CFGF_NONE),
 	DCFG_SEC(master_pool,sig_yeti_routing_pool_opts,CFGF_NONE),
 	DCFG_SEC(slave_pool,sig_yeti_routing_pool_opts,CFGF_NONE),
+	CFG_SEC(section_name_admission_control,sig_yeti_routing_admission_control_opts,CFGF_NONE),
 	CFG_END()
 };
 
@@ -82,6 +120,7 @@ cfg_opt_t sig_yeti_cdr_opts[] = {
 	DCFG_INT(auth_batch_size),
 	DCFG_INT(batch_timeout),
 	DCFG_INT(auth_batch_timeout),
+	DCFG_INT(auth_aggregation_window),
 	CFG_INT(opt_name_connection_lifetime,0,CFGF_NONE),
 	DCFG_STR(dir),
 	DCFG_STR(completed_dir),
@@ -100,6 +139,8 @@ cfg_opt_t sig_yeti_resources_pool_opts[] = {
 
 cfg_opt_t sig_yeti_resources_opts[] = {
 	DCFG_BOOL(reject_on_error),
+	DCFG_INT(max_inflight_batches),
+	DCFG_INT(io_threads),
 	DCFG_SEC(write,sig_yeti_resources_pool_opts,CFGF_NONE),
 	DCFG_SEC(read,sig_yeti_resources_pool_opts,CFGF_NONE),
 	CFG_END()
@@ -122,6 +163,7 @@ cfg_opt_t sig_yeti_reg_opts[] = {
 cfg_opt_t sig_yeti_registrar_redis_opts[] = {
     DCFG_STR(host),
     DCFG_INT(port),
+    DCFG_INT(io_threads),
     CFG_END()
 };
 
@@ -130,6 +172,8 @@ cfg_opt_t sig_yeti_registrar_opts[] = {
     DCFG_INT(expires_min),
     DCFG_INT(expires_max),
     DCFG_INT(expires_default),
+    DCFG_BOOL(aor_cache),
+    DCFG_INT(aor_cache_ttl),
     DCFG_SEC(redis,sig_yeti_registrar_redis_opts,CFGF_NONE),
     CFG_END()
 };
@@ -161,6 +205,23 @@ cfg_opt_t identity_opts[] {
     CFG_END()
 };
 
+cfg_opt_t cps_limit_opts[] {
+    CFG_BOOL(opt_cps_limit_enabled, cfg_false, CFGF_NONE),
+    CFG_INT(opt_cps_limit_default_limit, 0 /* 0 for no limit */, CFGF_NONE),
+    CFG_INT(opt_cps_limit_max_sources, 1048576, CFGF_NONE),
+    CFG_INT(opt_cps_limit_reply_code, 503, CFGF_NONE),
+    CFG_STR(opt_cps_limit_reply_reason, "CPS Limit Exceeded", CFGF_NONE),
+    CFG_INT(opt_cps_limit_retry_after, 0 /* sec. 0 to omit Retry-After */, CFGF_NONE),
+    CFG_END()
+};
+
+cfg_opt_t call_setup_trace_opts[] {
+    CFG_BOOL(opt_call_setup_trace_enabled, cfg_true, CFGF_NONE),
+    CFG_INT(opt_call_setup_trace_sampling, 0 /* keep every Nth trace. 0 to disable */, CFGF_NONE),
+    CFG_INT(opt_call_setup_trace_samples, 128 /* ring buffer size */, CFGF_NONE),
+    CFG_END()
+};
+
 //yeti
 cfg_opt_t yeti_opts[] = {
     DCFG_INT(pop_id),
@@ -176,11 +237,17 @@ cfg_opt_t yeti_opts[] = {
     CFG_SEC(section_name_statistics, sig_yeti_statistics_opts, CFGF_NONE),
     DCFG_SEC(auth,sig_yeti_auth_opts,CFGF_NONE),
     CFG_SEC(section_name_identity, identity_opts, CFGF_NODEFAULT),
+    CFG_SEC(section_name_cps_limit, cps_limit_opts, CFGF_NONE),
+    CFG_SEC(section_name_call_setup_trace, call_setup_trace_opts, CFGF_NONE),
     CFG_SEC(section_name_lega_cdr_headers,lega_cdr_headers_opts, CFGF_NONE),
     CFG_SEC(section_name_legb_reply_cdr_headers,legb_reply_cdr_headers_opts, CFGF_NONE),
     CFG_BOOL(opt_name_core_options_handling, cfg_true, CFGF_NONE),
     CFG_BOOL(opt_name_pcap_memory_logger, cfg_false, CFGF_NONE),
     CFG_INT(opt_name_db_refresh_interval, 300 /* 5 min */,CFGF_NONE),
+    CFG_STR(opt_name_db_snapshot_dir, "" /* empty to disable */,CFGF_NONE),
+    CFG_BOOL(opt_name_db_delta_reloads, cfg_false, CFGF_NONE),
+    CFG_STR(opt_name_db_notify_channel, "" /* empty to disable */,CFGF_NONE),
+    CFG_INT(opt_name_db_notify_refresh_interval, 1800 /* 30 min */,CFGF_NONE),
     CFG_BOOL(opt_name_ip_auth_reject_if_no_matched, cfg_false, CFGF_NONE),
     CFG_BOOL(opt_name_auth_feedback, cfg_false, CFGF_NONE),
     CFG_STR(opt_name_http_events_destination,"",CFGF_NONE),
@@ -24,6 +24,10 @@ extern char section_name_statistics[];
 extern char opt_name_core_options_handling[];
 extern char opt_name_pcap_memory_logger[];
 extern char opt_name_db_refresh_interval[];
+extern char opt_name_db_snapshot_dir[];
+extern char opt_name_db_delta_reloads[];
+extern char opt_name_db_notify_channel[];
+extern char opt_name_db_notify_refresh_interval[];
 extern char opt_name_ip_auth_reject_if_no_matched[];
 extern char opt_name_ip_auth_header[];
 extern char opt_name_postgresql_debug[];
@@ -37,11 +41,34 @@ extern char opt_identity_certs_cache_failed_verify_ttl[];
 
 extern char opt_func_name_header[];
 
+extern char section_name_admission_control[];
+extern char opt_admission_control_enabled[];
+extern char opt_admission_control_target_latency[];
+extern char opt_admission_control_min_active_requests[];
+extern char opt_admission_control_max_active_requests[];
+extern char opt_admission_control_reply_code[];
+extern char opt_admission_control_reply_reason[];
+extern char opt_admission_control_retry_after[];
+
+extern char section_name_cps_limit[];
+extern char opt_cps_limit_enabled[];
+extern char opt_cps_limit_default_limit[];
+extern char opt_cps_limit_max_sources[];
+extern char opt_cps_limit_reply_code[];
+extern char opt_cps_limit_reply_reason[];
+extern char opt_cps_limit_retry_after[];
+
+extern char section_name_call_setup_trace[];
+extern char opt_call_setup_trace_enabled[];
+extern char opt_call_setup_trace_sampling[];
+extern char opt_call_setup_trace_samples[];
+
 //extern int add_aleg_cdr_header(cfg_t *cfg, cfg_opt_t *opt, int argc, const char **argv);
 
 //routing
 extern cfg_opt_t sig_yeti_routing_pool_opts[];
 extern cfg_opt_t sig_yeti_routing_cache_opts[];
+extern cfg_opt_t sig_yeti_routing_admission_control_opts[];
 extern cfg_opt_t sig_yeti_routing_opts[];
 
 //cdr
@@ -69,5 +96,8 @@ extern cfg_opt_t lega_cdr_headers_opts[];
 //identity
 extern cfg_opt_t identity_opts[];
 
+//cps_limit
+extern cfg_opt_t cps_limit_opts[];
+
 //yeti
 extern cfg_opt_t yeti_opts[];
@@ -0,0 +1,249 @@
+#include "DbConfigNotifyListener.h"
+#include "log.h"
+
+#include <libpq-fe.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#define EPOLL_MAX_EVENTS 2
+#define DEFAULT_RECONNECT_INTERVAL_MS 5000
+#define CONNECT_TIMEOUT_MS 10000
+
+DbConfigNotifyListener::Notification
+DbConfigNotifyListener::Notification::parse(const string &payload)
+{
+    Notification n;
+    n.version = -1;
+
+    auto pos = payload.rfind(':');
+    if(pos == string::npos) {
+        n.key = payload;
+        return n;
+    }
+
+    char *end;
+    auto v = strtoll(payload.data() + pos + 1, &end, 10);
+    if(end == payload.data() + pos + 1 || *end != '\0' || v < 0) {
+        //not a version suffix
+        n.key = payload;
+        return n;
+    }
+
+    n.key = payload.substr(0, pos);
+    n.version = v;
+    return n;
+}
+
+DbConfigNotifyListener::DbConfigNotifyListener()
+  : reconnect_interval_ms(DEFAULT_RECONNECT_INTERVAL_MS),
+    epoll_fd(-1),
+    stopped(false),
+    connected(false),
+    notifications(stat_group(Counter, "yeti", "db_notify_notifications").addAtomicCounter()),
+    reconnects(stat_group(Counter, "yeti", "db_notify_reconnects").addAtomicCounter())
+{}
+
+DbConfigNotifyListener::~DbConfigNotifyListener()
+{
+    if(epoll_fd != -1)
+        close(epoll_fd);
+}
+
+int DbConfigNotifyListener::configure(
+    const string &in_conninfo, const string &in_channel,
+    NotifyCallback in_on_notify, ConnectedCallback in_on_connected)
+{
+    conninfo = in_conninfo;
+    channel = in_channel;
+    on_notify = in_on_notify;
+    on_connected = in_on_connected;
+
+    if((epoll_fd = epoll_create(EPOLL_MAX_EVENTS)) == -1) {
+        ERROR("epoll_create() call failed");
+        return -1;
+    }
+    stop_event.link(epoll_fd);
+
+    return 0;
+}
+
+bool DbConfigNotifyListener::wait_reconnect()
+{
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    int ret = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, reconnect_interval_ms);
+    for(int n = 0; n < ret; ++n) {
+        if(events[n].data.fd == stop_event) {
+            stop_event.read();
+            return false;
+        }
+    }
+    return true;
+}
+
+PGconn *DbConfigNotifyListener::connect(bool &stop_requested)
+{
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+
+    PGconn *conn = PQconnectStart(conninfo.data());
+    if(!conn) {
+        ERROR("db notify listener: failed to allocate connection");
+        return nullptr;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(CONNECT_TIMEOUT_MS);
+    auto poll_status = PQstatus(conn) == CONNECTION_BAD ?
+        PGRES_POLLING_FAILED : PGRES_POLLING_WRITING;
+
+    while(poll_status != PGRES_POLLING_OK && poll_status != PGRES_POLLING_FAILED) {
+        auto timeout_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if(timeout_ms <= 0) {
+            ERROR("db notify listener: connection timeout");
+            break;
+        }
+
+        //libpq can switch the socket while trying the hosts/addresses
+        int sock = PQsocket(conn);
+        struct epoll_event ev;
+        ev.events = poll_status == PGRES_POLLING_READING ? EPOLLIN : EPOLLOUT;
+        ev.data.fd = sock;
+        if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &ev) == -1) {
+            ERROR("db notify listener: epoll_ctl: %s", strerror(errno));
+            break;
+        }
+
+        int ret = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, timeout_ms);
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sock, nullptr);
+
+        bool ready = false;
+        for(int n = 0; n < ret; ++n) {
+            if(events[n].data.fd == stop_event) {
+                stop_event.read();
+                stop_requested = true;
+            } else {
+                ready = true;
+            }
+        }
+        if(stop_requested) break;
+
+        if(ready) poll_status = PQconnectPoll(conn);
+    }
+
+    if(poll_status != PGRES_POLLING_OK) {
+        if(!stop_requested && poll_status == PGRES_POLLING_FAILED)
+            ERROR("db notify listener: failed to connect: %s", PQerrorMessage(conn));
+        PQfinish(conn);
+        return nullptr;
+    }
+
+    return conn;
+}
+
+void DbConfigNotifyListener::run()
+{
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    bool running = true;
+
+    setThreadName("yeti-db-notify");
+
+    while(running) {
+        bool stop_requested = false;
+        PGconn *conn = connect(stop_requested);
+        if(stop_requested)
+            break;
+        if(!conn) {
+            reconnects.inc();
+            running = wait_reconnect();
+            continue;
+        }
+
+        char *escaped_channel = PQescapeIdentifier(conn, channel.data(), channel.size());
+        string listen_query("LISTEN ");
+        listen_query += escaped_channel;
+        PQfreemem(escaped_channel);
+
+        PGresult *res = PQexec(conn, listen_query.data());
+        if(PQresultStatus(res) != PGRES_COMMAND_OK) {
+            ERROR("db notify listener: '%s' failed: %s",
+                  listen_query.data(), PQerrorMessage(conn));
+            PQclear(res);
+            PQfinish(conn);
+            reconnects.inc();
+            running = wait_reconnect();
+            continue;
+        }
+        PQclear(res);
+
+        int sock = PQsocket(conn);
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = sock;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &ev);
+
+        INFO("db notify listener: listening on channel '%s'", channel.data());
+        connected = true;
+        if(on_connected) on_connected();
+
+        bool conn_ok = true;
+        while(running && conn_ok) {
+            int ret = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, -1);
+            if(ret == -1 && errno != EINTR) {
+                ERROR("epoll_wait: %s", strerror(errno));
+            }
+
+            for(int n = 0; n < ret; ++n) {
+                if(events[n].data.fd == stop_event) {
+                    stop_event.read();
+                    running = false;
+                    break;
+                }
+
+                if(!PQconsumeInput(conn)) {
+                    ERROR("db notify listener: connection error: %s", PQerrorMessage(conn));
+                    conn_ok = false;
+                    break;
+                }
+
+                while(PGnotify *notify = PQnotifies(conn)) {
+                    DBG("db notify listener: got '%s' on '%s'",
+                        notify->extra, notify->relname);
+                    notifications.inc();
+                    on_notify(notify->extra);
+                    PQfreemem(notify);
+                }
+            }
+        }
+
+        connected = false;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sock, nullptr);
+        PQfinish(conn);
+
+        if(running) {
+            reconnects.inc();
+            running = wait_reconnect();
+        }
+    }
+
+    stopped.set(true);
+}
+
+void DbConfigNotifyListener::on_stop()
+{
+    if(!isEnabled()) return;
+
+    stop_event.fire();
+    stopped.wait_for();
+}
+
+void DbConfigNotifyListener::getStats(AmArg &ret)
+{
+    ret["enabled"] = isEnabled();
+    ret["channel"] = channel;
+    ret["connected"] = connected.load();
+    ret["notifications"] = static_cast<unsigned int>(notifications.get());
+    ret["reconnects"] = static_cast<unsigned int>(reconnects.get());
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "AmArg.h"
+#include "AmThread.h"
+#include "AmEventFdQueue.h"
+#include "AmStatistics.h"
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+using std::string;
+
+typedef struct pg_conn PGconn;
+
+/* dedicated routing DB connection which LISTENs on the configured channel
+ * and passes NOTIFY payloads to the callback from its own thread.
+ *
+ * payload format: '<check_states key>[:<version>]'.
+ * empty or unknown payload means 'something changed' (check_states() is requested).
+ * on_connected is called after each successful LISTEN
+ * to catch up the changes possibly missed while disconnected */
+class DbConfigNotifyListener
+  : public AmThread
+{
+  public:
+    using NotifyCallback = std::function<void (const string &payload)>;
+    using ConnectedCallback = std::function<void ()>;
+
+    struct Notification {
+        string key;
+        long long version; //-1 if not specified
+        static Notification parse(const string &payload);
+    };
+
+  private:
+    string conninfo;
+    string channel;
+    int reconnect_interval_ms;
+    NotifyCallback on_notify;
+    ConnectedCallback on_connected;
+
+    int epoll_fd;
+    AmEventFd stop_event;
+    AmCondition<bool> stopped;
+    std::atomic<bool> connected;
+
+    AtomicCounter &notifications;
+    AtomicCounter &reconnects;
+
+    //returns false on stop event
+    bool wait_reconnect();
+    /* non-blocking connect polled together with stop_event.
+     * nullptr on failure, timeout or stop */
+    PGconn *connect(bool &stop_requested);
+
+  public:
+    DbConfigNotifyListener();
+    ~DbConfigNotifyListener();
+
+    int configure(
+        const string &conninfo, const string &channel,
+        NotifyCallback on_notify, ConnectedCallback on_connected);
+    bool isEnabled() const { return !channel.empty(); }
+
+    void run() override;
+    void on_stop() override;
+
+    void getStats(AmArg &ret);
+};
@@ -0,0 +1,100 @@
+#include "DbConfigReloadStats.h"
+
+#include <cstring>
+
+void DbConfigReloadStats::onRequest(const string &key)
+{
+    AmLock l(mutex);
+    tables[key].requested_at = std::chrono::steady_clock::now();
+}
+
+void DbConfigReloadStats::onApplied(
+    const string &key, bool delta, const AmArg &data,
+    std::chrono::steady_clock::duration apply_duration,
+    std::chrono::steady_clock::time_point now)
+{
+    auto bytes = estimateSize(data);
+
+    AmLock l(mutex);
+
+    auto &t = tables[key];
+
+    auto requested_at = t.requested_at;
+    if(requested_at == std::chrono::steady_clock::time_point()) {
+        auto state_it = tables.find(key.substr(0, key.find('.')));
+        if(state_it != tables.end())
+            requested_at = state_it->second.requested_at;
+    }
+
+    if(delta) t.delta_reloads++;
+    else t.full_reloads++;
+
+    t.last_delta = delta;
+    t.last_rows = isArgArray(data) ? data.size() : 0;
+    t.last_bytes = bytes;
+    t.total_bytes += bytes;
+    t.last_request_ms = requested_at == std::chrono::steady_clock::time_point() ?
+        -1 : std::chrono::duration_cast<std::chrono::milliseconds>(now - requested_at).count();
+    t.last_apply_us = std::chrono::duration_cast<std::chrono::microseconds>(apply_duration).count();
+}
+
+void DbConfigReloadStats::onDeltaFallback(const string &key)
+{
+    AmLock l(mutex);
+    tables[key].delta_fallbacks++;
+}
+
+void DbConfigReloadStats::getStats(AmArg &ret)
+{
+    ret.assertStruct();
+
+    AmLock l(mutex);
+    for(const auto &it : tables) {
+        const auto &t = it.second;
+        if(!t.full_reloads && !t.delta_reloads && !t.delta_fallbacks)
+            continue;
+
+        auto &a = ret[it.first];
+        a["full_reloads"] = static_cast<long long>(t.full_reloads);
+        a["delta_reloads"] = static_cast<long long>(t.delta_reloads);
+        a["delta_fallbacks"] = static_cast<long long>(t.delta_fallbacks);
+        a["last_delta"] = t.last_delta;
+        a["last_rows"] = static_cast<long long>(t.last_rows);
+        a["last_bytes"] = static_cast<long long>(t.last_bytes);
+        a["total_bytes"] = static_cast<long long>(t.total_bytes);
+        a["last_request_ms"] = t.last_request_ms;
+        a["last_apply_us"] = t.last_apply_us;
+    }
+}
+
+size_t DbConfigReloadStats::estimateSize(const AmArg &a)
+{
+    switch(a.getType()) {
+    case AmArg::Undef:
+        return 0;
+    case AmArg::Bool:
+        return 1;
+    case AmArg::Int:
+        return 4;
+    case AmArg::LongLong:
+    case AmArg::Double:
+        return 8;
+    case AmArg::CStr:
+        return strlen(a.asCStr());
+    case AmArg::Array: {
+        size_t ret = 0;
+        for(size_t i = 0; i < a.size(); i++)
+            ret += estimateSize(a.get(i));
+        return ret;
+    }
+    case AmArg::Struct: {
+        //values only. column names are not transferred per row
+        size_t ret = 0;
+        for(const auto &it : *a.asStruct())
+            ret += estimateSize(it.second);
+        return ret;
+    }
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "AmArg.h"
+#include "AmThread.h"
+
+#include <chrono>
+#include <map>
+#include <string>
+
+using std::string;
+
+/* per dataset reload statistics for the db_config_timer_mappings:
+ * full/delta reloads count, rows and approximate bytes transferred,
+ * DB request and apply durations */
+class DbConfigReloadStats
+{
+    struct TableStats {
+        unsigned long full_reloads;
+        unsigned long delta_reloads;
+        unsigned long delta_fallbacks;
+        size_t last_rows;
+        size_t last_bytes;
+        unsigned long long total_bytes;
+        long long last_request_ms;
+        long long last_apply_us;
+        bool last_delta;
+        std::chrono::steady_clock::time_point requested_at;
+
+        TableStats()
+          : full_reloads(0),
+            delta_reloads(0),
+            delta_fallbacks(0),
+            last_rows(0),
+            last_bytes(0),
+            total_bytes(0),
+            last_request_ms(-1),
+            last_apply_us(0),
+            last_delta(false)
+        {}
+    };
+
+    AmMutex mutex;
+    std::map<string, TableStats> tables;
+
+  public:
+    void onRequest(const string &key);
+    //subkeys ('translations.dc_rewrite') use the request time of their state key
+    void onApplied(
+        const string &key, bool delta, const AmArg &data,
+        std::chrono::steady_clock::duration apply_duration,
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+    void onDeltaFallback(const string &key);
+
+    void getStats(AmArg &ret);
+
+    //approximate payload size of the PG reply
+    static size_t estimateSize(const AmArg &a);
+};
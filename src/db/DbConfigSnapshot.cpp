@@ -0,0 +1,331 @@
+#include "DbConfigSnapshot.h"
+#include "log.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#define SNAPSHOT_MAGIC "YDBS"
+#define SNAPSHOT_FORMAT_VERSION 1
+//snapshots contain credentials and signing keys
+#define SNAPSHOT_FILE_MODE (S_IRUSR | S_IWUSR)
+#define SNAPSHOT_DIR_MODE S_IRWXU
+
+#define TAG_UNDEF    'u'
+#define TAG_INT      'i'
+#define TAG_LONGLONG 'l'
+#define TAG_BOOL     'b'
+#define TAG_DOUBLE   'd'
+#define TAG_CSTR     's'
+#define TAG_ARRAY    'a'
+#define TAG_STRUCT   'x'
+
+template<typename T>
+static void write_raw(string &out, T v)
+{
+    out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template<typename T>
+static bool read_raw(const char *&p, const char *end, T &v)
+{
+    if(end - p < static_cast<ptrdiff_t>(sizeof(T)))
+        return false;
+    memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+static void write_str(string &out, const char *s, uint32_t len)
+{
+    write_raw(out, len);
+    out.append(s, len);
+}
+
+static bool read_str(const char *&p, const char *end, string &s)
+{
+    uint32_t len;
+    if(!read_raw(p, end, len) || end - p < static_cast<ptrdiff_t>(len))
+        return false;
+    s.assign(p, len);
+    p += len;
+    return true;
+}
+
+DbConfigSnapshot::DbConfigSnapshot()
+  : saved(stat_group(Counter, "yeti", "db_snapshot_saved").addAtomicCounter()),
+    save_errors(stat_group(Counter, "yeti", "db_snapshot_save_errors").addAtomicCounter()),
+    loaded(stat_group(Counter, "yeti", "db_snapshot_loaded").addAtomicCounter())
+{}
+
+void DbConfigSnapshot::configure(const string &in_dir, const string &in_context)
+{
+    dir = in_dir;
+    context = in_context;
+
+    struct stat st;
+    if(stat(dir.data(), &st)) {
+        WARN("failed to stat snapshots dir %s: %s", dir.data(), strerror(errno));
+        return;
+    }
+
+    if((st.st_mode & ALLPERMS) != SNAPSHOT_DIR_MODE) {
+        WARN("set snapshots dir %s mode %o to %o",
+             dir.data(), st.st_mode & ALLPERMS, SNAPSHOT_DIR_MODE);
+        if(chmod(dir.data(), SNAPSHOT_DIR_MODE))
+            ERROR("failed to chmod %s: %s", dir.data(), strerror(errno));
+    }
+}
+
+static bool write_file(const string &path, const string &data)
+{
+    //stale file left by the interrupted save could have another mode
+    unlink(path.data());
+
+    int fd = open(path.data(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, SNAPSHOT_FILE_MODE);
+    if(fd < 0) return false;
+
+    const char *p = data.data();
+    size_t left = data.size();
+    while(left) {
+        ssize_t n = write(fd, p, left);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            close(fd);
+            return false;
+        }
+        p += n;
+        left -= n;
+    }
+
+    return close(fd) == 0;
+}
+
+string DbConfigSnapshot::getPath(const string &key) const
+{
+    return dir + "/" + key + ".snapshot";
+}
+
+bool DbConfigSnapshot::save(const string &key, long long version, const AmArg &data)
+{
+    if(!isEnabled()) return false;
+
+    string out(SNAPSHOT_MAGIC);
+    write_raw<uint32_t>(out, SNAPSHOT_FORMAT_VERSION);
+    write_str(out, context.data(), context.size());
+    write_raw<int64_t>(out, version);
+
+    if(!serialize(data, out)) {
+        ERROR("failed to serialize '%s' data for the snapshot", key.data());
+        save_errors.inc();
+        return false;
+    }
+
+    //write to the temporary file and rename to keep the previous snapshot on failures
+    auto path = getPath(key);
+    auto tmp_path = path + ".tmp";
+    if(!write_file(tmp_path, out)) {
+        ERROR("failed to write snapshot file %s: %s", tmp_path.data(), strerror(errno));
+        std::remove(tmp_path.data());
+        save_errors.inc();
+        return false;
+    }
+
+    if(0!=std::rename(tmp_path.data(), path.data())) {
+        ERROR("failed to rename %s to %s: %s",
+              tmp_path.data(), path.data(), strerror(errno));
+        std::remove(tmp_path.data());
+        save_errors.inc();
+        return false;
+    }
+
+    DBG("saved snapshot for '%s' version %lld (%zd bytes)",
+        key.data(), version, out.size());
+    saved.inc();
+
+    return true;
+}
+
+bool DbConfigSnapshot::load(const string &key, long long &version, AmArg &data)
+{
+    if(!isEnabled()) return false;
+
+    auto path = getPath(key);
+    std::ifstream f(path, std::ios::binary);
+    if(!f.is_open()) {
+        DBG("no snapshot for '%s'", key.data());
+        return false;
+    }
+
+    std::stringstream buf;
+    buf << f.rdbuf();
+    const string &in = buf.str();
+
+    const char *p = in.data(), *end = in.data() + in.size();
+    uint32_t format_version;
+    string snapshot_context;
+    int64_t snapshot_version;
+
+    if(end - p < 4 || memcmp(p, SNAPSHOT_MAGIC, 4)) {
+        ERROR("snapshot %s: wrong magic", path.data());
+        return false;
+    }
+    p += 4;
+
+    if(!read_raw(p, end, format_version) ||
+       format_version != SNAPSHOT_FORMAT_VERSION ||
+       !read_str(p, end, snapshot_context) ||
+       !read_raw(p, end, snapshot_version))
+    {
+        ERROR("snapshot %s: wrong header", path.data());
+        return false;
+    }
+
+    if(snapshot_context != context) {
+        INFO("snapshot %s: context '%s' does not match to '%s'. ignore it",
+             path.data(), snapshot_context.data(), context.data());
+        return false;
+    }
+
+    data = AmArg();
+    if(!deserialize(p, end, data) || p != end) {
+        ERROR("snapshot %s: malformed data", path.data());
+        data = AmArg();
+        return false;
+    }
+
+    version = snapshot_version;
+    loaded.inc();
+
+    return true;
+}
+
+bool DbConfigSnapshot::serialize(const AmArg &a, string &out)
+{
+    switch(a.getType()) {
+    case AmArg::Undef:
+        out.push_back(TAG_UNDEF);
+        break;
+    case AmArg::Int:
+        out.push_back(TAG_INT);
+        write_raw<int32_t>(out, a.asInt());
+        break;
+    case AmArg::LongLong:
+        out.push_back(TAG_LONGLONG);
+        write_raw<int64_t>(out, a.asLongLong());
+        break;
+    case AmArg::Bool:
+        out.push_back(TAG_BOOL);
+        out.push_back(a.asBool() ? 1 : 0);
+        break;
+    case AmArg::Double:
+        out.push_back(TAG_DOUBLE);
+        write_raw<double>(out, a.asDouble());
+        break;
+    case AmArg::CStr:
+        out.push_back(TAG_CSTR);
+        write_str(out, a.asCStr(), strlen(a.asCStr()));
+        break;
+    case AmArg::Array:
+        out.push_back(TAG_ARRAY);
+        write_raw<uint32_t>(out, a.size());
+        for(size_t i = 0; i < a.size(); i++) {
+            if(!serialize(a.get(i), out))
+                return false;
+        }
+        break;
+    case AmArg::Struct:
+        out.push_back(TAG_STRUCT);
+        write_raw<uint32_t>(out, a.size());
+        for(const auto &it : *a.asStruct()) {
+            write_str(out, it.first.data(), it.first.size());
+            if(!serialize(it.second, out))
+                return false;
+        }
+        break;
+    default:
+        ERROR("unsupported AmArg type %d", a.getType());
+        return false;
+    }
+
+    return true;
+}
+
+bool DbConfigSnapshot::deserialize(const char *&p, const char *end, AmArg &a)
+{
+    if(p >= end) return false;
+
+    switch(*p++) {
+    case TAG_UNDEF:
+        a = AmArg();
+        break;
+    case TAG_INT: {
+        int32_t v;
+        if(!read_raw(p, end, v)) return false;
+        a = v;
+    } break;
+    case TAG_LONGLONG: {
+        int64_t v;
+        if(!read_raw(p, end, v)) return false;
+        a = static_cast<long long>(v);
+    } break;
+    case TAG_BOOL: {
+        char v;
+        if(!read_raw(p, end, v)) return false;
+        a = (v != 0);
+    } break;
+    case TAG_DOUBLE: {
+        double v;
+        if(!read_raw(p, end, v)) return false;
+        a = v;
+    } break;
+    case TAG_CSTR: {
+        string v;
+        if(!read_str(p, end, v)) return false;
+        a = v;
+    } break;
+    case TAG_ARRAY: {
+        uint32_t n;
+        if(!read_raw(p, end, n)) return false;
+        a.assertArray();
+        for(uint32_t i = 0; i < n; i++) {
+            a.push(AmArg());
+            if(!deserialize(p, end, a.back()))
+                return false;
+        }
+    } break;
+    case TAG_STRUCT: {
+        uint32_t n;
+        if(!read_raw(p, end, n)) return false;
+        a.assertStruct();
+        for(uint32_t i = 0; i < n; i++) {
+            string key;
+            if(!read_str(p, end, key) ||
+               !deserialize(p, end, a[key]))
+            {
+                return false;
+            }
+        }
+    } break;
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+void DbConfigSnapshot::getStats(AmArg &ret)
+{
+    ret["enabled"] = isEnabled();
+    ret["dir"] = dir;
+    ret["saved"] = static_cast<unsigned int>(saved.get());
+    ret["save_errors"] = static_cast<unsigned int>(save_errors.get());
+    ret["loaded"] = static_cast<unsigned int>(loaded.get());
+}
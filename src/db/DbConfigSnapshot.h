@@ -0,0 +1,41 @@
+#pragma once
+
+#include "AmArg.h"
+#include "AmStatistics.h"
+
+#include <string>
+
+using std::string;
+
+/* local on-disk copies of the datasets loaded from the routing DB
+ *
+ * one file per dataset: <dir>/<key>.snapshot
+ * versioned by the check_states() values (0 for the startup queries without state).
+ * 'context' (node_id/pop_id) is stored within the snapshot
+ * to ignore files written with the different node settings */
+class DbConfigSnapshot
+{
+    string dir;
+    string context;
+
+    AtomicCounter &saved;
+    AtomicCounter &save_errors;
+    AtomicCounter &loaded;
+
+    string getPath(const string &key) const;
+
+  public:
+    DbConfigSnapshot();
+
+    void configure(const string &dir, const string &context);
+    bool isEnabled() const { return !dir.empty(); }
+
+    bool save(const string &key, long long version, const AmArg &data);
+    bool load(const string &key, long long &version, AmArg &data);
+
+    //type-preserving binary encoding for the PG replies
+    static bool serialize(const AmArg &a, string &out);
+    static bool deserialize(const char *&p, const char *end, AmArg &a);
+
+    void getStats(AmArg &ret);
+};
@@ -0,0 +1,41 @@
+#include "CallsPageSelector.h"
+
+#include <algorithm>
+
+CallsPageSelector::CallsPageSelector(const string &cursor, size_t limit)
+  : cursor(cursor),
+    limit(limit),
+    matched(0)
+{}
+
+void CallsPageSelector::offer(const string &local_tag)
+{
+    if(!cursor.empty() && local_tag <= cursor)
+        return;
+
+    matched++;
+
+    if(!limit) return;
+
+    if(selected.size() < limit) {
+        selected.push(local_tag);
+        return;
+    }
+
+    if(local_tag < selected.top()) {
+        selected.pop();
+        selected.push(local_tag);
+    }
+}
+
+vector<string> CallsPageSelector::finish()
+{
+    vector<string> ret;
+    ret.reserve(selected.size());
+    while(!selected.empty()) {
+        ret.emplace_back(selected.top());
+        selected.pop();
+    }
+    std::reverse(ret.begin(), ret.end());
+    return ret;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <queue>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/* selects the page of active calls ordered by local_tag
+ * without materializing the whole calls list.
+ *
+ * calls are offered in arbitrary order (AmEventDispatcher iteration).
+ * keeps at most 'limit' smallest local tags greater than the cursor
+ * (empty cursor means the first page) */
+class CallsPageSelector
+{
+    string cursor;
+    size_t limit;
+    size_t matched;
+    std::priority_queue<string> selected;
+
+  public:
+    CallsPageSelector(const string &cursor, size_t limit);
+
+    void offer(const string &local_tag);
+
+    //selected local tags in ascending order. destructive
+    vector<string> finish();
+
+    //calls left after the selected page
+    bool hasMore() const { return matched > limit; }
+    size_t getMatched() const { return matched; }
+};
@@ -1,4 +1,5 @@
 #include "CdrList.h"
+#include "CallsPageSelector.h"
 #include "log.h"
 
 #include "../yeti.h"
@@ -89,60 +90,54 @@ int CdrList::getCall(const string &local_tag,AmArg &call,const SqlRouter *router
     return 0;
 }
 
-void CdrList::getCalls(AmArg &calls, const SqlRouter *router)
+bool CdrList::getCalls(AmArg &calls, const SqlRouter *router, size_t limit)
 {
-    auto &gc = Yeti::instance().config;
-
-    const get_calls_ctx ctx(AmConfig.node_id,gc.pop_id,router);
-
-    calls.assertArray();
-
-    PROF_START(calls_serialization);
-
-    AmEventDispatcher::instance()->iterate(
-        [&](const string &,
-            const AmEventDispatcher::QueueEntry &entry)
-    {
-        auto leg = dynamic_cast<SBCCallLeg *>(entry.q);
-        if(!leg) return;
-
-        if(!leg->isALeg()) return;
-
-        auto call_ctx = leg->getCallCtx();
-        if(!call_ctx) return;
+    AmArg params;
+    params.assertArray();
+    return serializeCallsPage(calls, router, string(), limit, params).empty();
+}
 
-        if(call_ctx->cdr && !call_ctx->profiles.empty()) {
-            calls.push(AmArg());
-            cdr2arg(calls.back(),call_ctx->cdr.get(),ctx);
-        }
+bool CdrList::getCallsFields(
+    AmArg &calls,
+    const SqlRouter *router, const AmArg &params, size_t limit)
+{
+    return serializeCallsPage(calls, router, string(), limit, params).empty();
+}
 
-        leg->putCallCtx();
-    });
+void CdrList::getCallsPage(
+    AmArg &ret, const SqlRouter *router,
+    const string &cursor, size_t limit, const AmArg &params)
+{
+    auto next_cursor = serializeCallsPage(ret["calls"], router, cursor, limit, params);
 
-    PROF_END(calls_serialization);
-    PROF_PRINT("active calls serialization",calls_serialization);
+    ret["limit"] = static_cast<long long>(limit);
+    if(!next_cursor.empty())
+        ret["next_cursor"] = next_cursor;
 }
 
-void CdrList::getCallsFields(
-    AmArg &calls,
-    const SqlRouter *router, const AmArg &params)
+string CdrList::serializeCallsPage(
+    AmArg &calls, const SqlRouter *router,
+    const string &cursor, size_t limit, const AmArg &params)
 {
-    calls.assertArray();
     auto &gc = Yeti::instance().config;
 
     cmp_rules filter_rules;
     vector<string> fields;
 
-    parse_fields(filter_rules, params, fields);
-
-    validate_fields(fields,router);
+    if(params.size()) {
+        parse_fields(filter_rules, params, fields);
+        validate_fields(fields,router);
+    }
 
-    const get_calls_ctx ctx(AmConfig.node_id,gc.pop_id,router,&fields);
+    const get_calls_ctx ctx(AmConfig.node_id,gc.pop_id,router,
+                            fields.empty() ? nullptr : &fields);
 
     PROF_START(calls_serialization);
 
+    //select local tags of the page. O(calls*log(limit)), no serialization
+    CallsPageSelector selector(cursor, limit);
     AmEventDispatcher::instance()->iterate(
-        [&](const string &,
+        [&](const string &local_tag,
             const AmEventDispatcher::QueueEntry &entry)
     {
         auto leg = dynamic_cast<SBCCallLeg *>(entry.q);
@@ -153,18 +148,48 @@ void CdrList::getCallsFields(
         auto call_ctx = leg->getCallCtx();
         if(!call_ctx) return;
 
-        if(call_ctx->cdr && !call_ctx->profiles.empty()) {
-            if(apply_filter_rules(call_ctx->cdr.get(),filter_rules)) {
-                calls.push(AmArg());
-                cdr2arg_filtered(calls.back(),call_ctx->cdr.get(),ctx);
-            }
+        if(call_ctx->cdr && !call_ctx->profiles.empty() &&
+           apply_filter_rules(call_ctx->cdr.get(),filter_rules))
+        {
+            selector.offer(local_tag);
         }
 
         leg->putCallCtx();
     });
 
+    bool has_more = selector.hasMore();
+    auto local_tags = selector.finish();
+
+    //serialize selected calls only. calls finished meanwhile are skipped
+    calls.assertArray();
+    for(const auto &local_tag : local_tags) {
+        AmEventDispatcher::instance()->apply(local_tag,
+            [&](const AmEventDispatcher::QueueEntry &entry)
+        {
+            auto leg = dynamic_cast<SBCCallLeg *>(entry.q);
+            if(!leg) return;
+
+            auto call_ctx = leg->getCallCtx();
+            if(!call_ctx) return;
+
+            if(call_ctx->cdr) {
+                calls.push(AmArg());
+                if(ctx.fields)
+                    cdr2arg_filtered(calls.back(),call_ctx->cdr.get(),ctx);
+                else
+                    cdr2arg(calls.back(),call_ctx->cdr.get(),ctx);
+            }
+
+            leg->putCallCtx();
+        });
+    }
+
     PROF_END(calls_serialization);
-    PROF_PRINT("active calls serialization",calls_serialization);
+    PROF_PRINT("active calls page serialization",calls_serialization);
+
+    if(has_more && !local_tags.empty())
+        return local_tags.back();
+    return string();
 }
 
 void CdrList::getFields(AmArg &ret,SqlRouter *r)
@@ -78,13 +78,28 @@ class CdrList
 
     void parse_field(const AmArg &field);
 
+    /* serializes at most 'limit' calls with local_tag greater than the cursor
+     * ordered by local_tag to the 'calls' array.
+     * returns the last serialized local_tag if there are more calls after it */
+    string serializeCallsPage(
+        AmArg &calls, const SqlRouter *router,
+        const string &cursor, size_t limit, const AmArg &params);
+
   public:
     CdrList();
     ~CdrList();
 
     long int getCallsCount();
-    void getCalls(AmArg &calls, const SqlRouter *router);
-    void getCallsFields(AmArg &calls, const SqlRouter *router, const AmArg &params);
+    /* first 'limit' calls ordered by local_tag.
+     * return false if the list is truncated */
+    bool getCalls(AmArg &calls, const SqlRouter *router, size_t limit);
+    bool getCallsFields(AmArg &calls, const SqlRouter *router, const AmArg &params, size_t limit);
+    /* at most 'limit' calls with local_tag greater than the cursor
+     * ordered by local_tag. params are optional fields and WHERE rules
+     * in the 'show calls filtered' format */
+    void getCallsPage(
+        AmArg &ret, const SqlRouter *router,
+        const string &cursor, size_t limit, const AmArg &params);
     int getCall(const string &local_tag, AmArg &call, const SqlRouter *router);
 
     void onSessionFinalize(Cdr *cdr);
@@ -3,25 +3,52 @@
 #include "SBCCallLeg.h"
 #include "cdr/Cdr.h"
 #include "yeti.h"
+#include "RadiusInterimScheduler.h"
+
+/* interned keys of the placeholders set by the hooks */
+namespace radius_placeholders {
+	static const PlaceholdersHash::key_id_t call_local_tag = PlaceholdersHash::key("call_local_tag");
+	static const PlaceholdersHash::key_id_t call_orig_call_id = PlaceholdersHash::key("call_orig_call_id");
+	static const PlaceholdersHash::key_id_t call_time_start = PlaceholdersHash::key("call_time_start");
+	static const PlaceholdersHash::key_id_t time_start = PlaceholdersHash::key("time_start");
+	static const PlaceholdersHash::key_id_t time_start_float = PlaceholdersHash::key("time_start_float");
+	static const PlaceholdersHash::key_id_t time_start_int = PlaceholdersHash::key("time_start_int");
+	static const PlaceholdersHash::key_id_t aleg_remote_ip = PlaceholdersHash::key("aleg_remote_ip");
+	static const PlaceholdersHash::key_id_t aleg_remote_port = PlaceholdersHash::key("aleg_remote_port");
+	static const PlaceholdersHash::key_id_t aleg_local_ip = PlaceholdersHash::key("aleg_local_ip");
+	static const PlaceholdersHash::key_id_t aleg_local_port = PlaceholdersHash::key("aleg_local_port");
+	static const PlaceholdersHash::key_id_t time_connect = PlaceholdersHash::key("time_connect");
+	static const PlaceholdersHash::key_id_t time_connect_float = PlaceholdersHash::key("time_connect_float");
+	static const PlaceholdersHash::key_id_t time_connect_int = PlaceholdersHash::key("time_connect_int");
+	static const PlaceholdersHash::key_id_t bleg_remote_ip = PlaceholdersHash::key("bleg_remote_ip");
+	static const PlaceholdersHash::key_id_t bleg_remote_port = PlaceholdersHash::key("bleg_remote_port");
+	static const PlaceholdersHash::key_id_t bleg_local_ip = PlaceholdersHash::key("bleg_local_ip");
+	static const PlaceholdersHash::key_id_t bleg_local_port = PlaceholdersHash::key("bleg_local_port");
+	static const PlaceholdersHash::key_id_t leg_disconnect_code = PlaceholdersHash::key("leg_disconnect_code");
+	static const PlaceholdersHash::key_id_t leg_disconnect_reason = PlaceholdersHash::key("leg_disconnect_reason");
+	static const PlaceholdersHash::key_id_t time_end = PlaceholdersHash::key("time_end");
+	static const PlaceholdersHash::key_id_t time_end_float = PlaceholdersHash::key("time_end_float");
+	static const PlaceholdersHash::key_id_t time_end_int = PlaceholdersHash::key("time_end_int");
+}
 
 static inline void radius_auth(SBCCallLeg *call, const Cdr &cdr, SBCCallProfile &call_profile, const AmSipRequest &req){
 	PlaceholdersHash &v = call->getPlaceholders();
 	const string &local_tag = call->getLocalTag();
 
-	v["call_local_tag"] = local_tag;
-	v["call_orig_call_id"] = req.callid;
+	v.set(radius_placeholders::call_local_tag, local_tag);
+	v.set(radius_placeholders::call_orig_call_id, req.callid);
 
-	v["call_time_start"] = timeval2str_ntp(cdr.start_time);
+	v.set(radius_placeholders::call_time_start, cdr.start_time, PlaceholdersHash::TimeNtp);
 
-	v["time_start"] = timeval2str(cdr.start_time);
-	v["time_start_float"] = timeval2str_usec(cdr.start_time);
-	v["time_start_int"] = long2str(cdr.start_time.tv_sec);
+	v.set(radius_placeholders::time_start, cdr.start_time, PlaceholdersHash::TimeStr);
+	v.set(radius_placeholders::time_start_float, cdr.start_time, PlaceholdersHash::TimeFloat);
+	v.set(radius_placeholders::time_start_int, static_cast<long long>(cdr.start_time.tv_sec));
 
-	v["aleg_remote_ip"] = cdr.legA_remote_ip;
-	v["aleg_remote_port"] = int2str(cdr.legA_remote_port);
+	v.set(radius_placeholders::aleg_remote_ip, cdr.legA_remote_ip);
+	v.set(radius_placeholders::aleg_remote_port, static_cast<long long>(cdr.legA_remote_port));
 
-	v["aleg_local_ip"] = cdr.legA_local_ip;
-	v["aleg_local_port"] = int2str(cdr.legA_local_port);
+	v.set(radius_placeholders::aleg_local_ip, cdr.legA_local_ip);
+	v.set(radius_placeholders::aleg_local_port, static_cast<long long>(cdr.legA_local_port));
 }
 
 static inline bool radius_auth_post_event(SBCCallLeg *call, SBCCallProfile &call_profile)
@@ -37,7 +64,7 @@ static inline bool radius_auth_post_event(SBCCallLeg *call, SBCCallProfile &call
 			RADIUS_EVENT_QUEUE,
 			new RadiusRequestEvent(
 				call_profile.radius_profile_id,
-				local_tag,v));
+				local_tag,v.get()));
 		return true;
 	}
 	return false;
@@ -47,22 +74,22 @@ static inline void radius_accounting_start(SBCCallLeg *call, const Cdr &cdr, SBC
 	PlaceholdersHash &v = call->getPlaceholders();
 
 	if(call->isALeg()) {
-		v["time_connect"] = timeval2str(cdr.connect_time);
-		v["time_connect_float"] = timeval2str_usec(cdr.connect_time);
-		v["time_connect_int"] = long2str(cdr.connect_time.tv_sec);
+		v.set(radius_placeholders::time_connect, cdr.connect_time, PlaceholdersHash::TimeStr);
+		v.set(radius_placeholders::time_connect_float, cdr.connect_time, PlaceholdersHash::TimeFloat);
+		v.set(radius_placeholders::time_connect_int, static_cast<long long>(cdr.connect_time.tv_sec));
 	} else { //bleg
-		v["time_connect"] = timeval2str(cdr.bleg_connect_time);
-		v["time_connect_float"] = timeval2str_usec(cdr.bleg_connect_time);
-		v["time_connect_int"] = long2str(cdr.bleg_connect_time.tv_sec);
-
-		v["bleg_remote_ip"] = cdr.legB_remote_ip;
-		v["bleg_remote_port"] = int2str(cdr.legB_remote_port);
-		v["bleg_local_ip"] = cdr.legB_local_ip;
-		v["bleg_local_port"] = int2str(cdr.legB_local_port);
+		v.set(radius_placeholders::time_connect, cdr.bleg_connect_time, PlaceholdersHash::TimeStr);
+		v.set(radius_placeholders::time_connect_float, cdr.bleg_connect_time, PlaceholdersHash::TimeFloat);
+		v.set(radius_placeholders::time_connect_int, static_cast<long long>(cdr.bleg_connect_time.tv_sec));
+
+		v.set(radius_placeholders::bleg_remote_ip, cdr.legB_remote_ip);
+		v.set(radius_placeholders::bleg_remote_port, static_cast<long long>(cdr.legB_remote_port));
+		v.set(radius_placeholders::bleg_local_ip, cdr.legB_local_ip);
+		v.set(radius_placeholders::bleg_local_port, static_cast<long long>(cdr.legB_local_port));
 	}
 }
 
-static inline void radius_accounting_start_post_event_set_timers(SBCCallLeg *call, SBCCallProfile &call_profile)
+static inline void radius_accounting_start_post_event_schedule_interim(SBCCallLeg *call, SBCCallProfile &call_profile, const timeval &leg_connect_time)
 {
 	PlaceholdersHash &v = call->getPlaceholders();
 
@@ -77,13 +104,14 @@ static inline void radius_accounting_start_post_event_set_timers(SBCCallLeg *cal
 				RADIUS_EVENT_QUEUE,
 				new RadiusRequestEvent(
 					RadiusRequestEvent::Start, call_profile.aleg_radius_acc_profile_id,
-					call->getLocalTag(), v));
+					call->getLocalTag(), v.get()));
 		}
 		if(call_profile.aleg_radius_acc_rules.enable_interim_accounting
 		   && call_profile.aleg_radius_acc_rules.interim_accounting_interval)
 		{
-			call->setTimer(
-				YETI_RADIUS_INTERIM_TIMER,
+			call->scheduleRadiusInterim(
+				call_profile.aleg_radius_acc_profile_id,
+				leg_connect_time,
 				call_profile.aleg_radius_acc_rules.interim_accounting_interval);
 		}
 	} else { //bleg
@@ -97,75 +125,25 @@ static inline void radius_accounting_start_post_event_set_timers(SBCCallLeg *cal
 				RADIUS_EVENT_QUEUE,
 				new RadiusRequestEvent(
 					RadiusRequestEvent::Start, call_profile.bleg_radius_acc_profile_id,
-					call->getLocalTag(), v));
+					call->getLocalTag(), v.get()));
 		}
 		if(call_profile.bleg_radius_acc_rules.enable_interim_accounting
 		   && call_profile.bleg_radius_acc_rules.interim_accounting_interval)
 		{
-			call->setTimer(
-				YETI_RADIUS_INTERIM_TIMER,
+			call->scheduleRadiusInterim(
+				call_profile.bleg_radius_acc_profile_id,
+				leg_connect_time,
 				call_profile.bleg_radius_acc_rules.interim_accounting_interval);
 		}
 	}
 }
 
 
-static inline void radius_accounting_interim(SBCCallLeg *call, const Cdr &cdr)
-{
-	const struct timeval *leg_connect_time;
-	timeval duration, now;
-
-	//SBCCallProfile &call_profile = call->getCallProfile();
-	PlaceholdersHash &v = call->getPlaceholders();
-
-	if(call->isALeg()){
-		leg_connect_time = &cdr.connect_time;
-	} else {
-		leg_connect_time = &cdr.bleg_connect_time;
-	}
-
-	if(timerisset(leg_connect_time)){
-		gettimeofday(&now,NULL);
-		timersub(&now,leg_connect_time,&duration);
-		v["call_duration_float"] = timeval2str_usec(duration);
-		v["call_duration_int"] = long2str(duration.tv_sec);
-	} else {
-		v["call_duration_float"] = "0.0";
-		v["call_duration_int"] = "0";
-	}
-}
-
-static inline void radius_accounting_interim_post_event_set_timer(SBCCallLeg *call)
-{
-	int profile_id, interval;
-	SBCCallProfile &call_profile = call->getCallProfile();
-	PlaceholdersHash &v = call->getPlaceholders();
-
-	if(call->isALeg()){
-		profile_id = call_profile.aleg_radius_acc_profile_id;
-		interval = call_profile.aleg_radius_acc_rules.interim_accounting_interval;
-	} else {
-		profile_id = call_profile.bleg_radius_acc_profile_id;
-		interval = call_profile.bleg_radius_acc_rules.interim_accounting_interval;
-	}
-
-	DBG("[%s] post acc_interim event to the radius module with profile id: %d",
-		call->getLocalTag().c_str(), profile_id);
-
-	AmSessionContainer::instance()->postEvent(
-		RADIUS_EVENT_QUEUE,
-		new RadiusRequestEvent(
-			RadiusRequestEvent::Interim, profile_id,
-			call->getLocalTag(), v));
-
-	call->setTimer(YETI_RADIUS_INTERIM_TIMER, interval);
-}
-
 static inline void radius_accounting_stop(SBCCallLeg *call, const Cdr &cdr)
 {
 	//int profile_id;
 	const struct timeval *leg_connect_time;
-	timeval duration, now;
+	timeval now;
 
 	gettimeofday(&now,NULL);
 
@@ -179,8 +157,8 @@ static inline void radius_accounting_stop(SBCCallLeg *call, const Cdr &cdr)
 
 		leg_connect_time = &cdr.connect_time;
 
-		v["leg_disconnect_code"] = int2str(cdr.disconnect_rewrited_code);
-		v["leg_disconnect_reason"] = cdr.disconnect_rewrited_reason;
+		v.set(radius_placeholders::leg_disconnect_code, static_cast<long long>(cdr.disconnect_rewrited_code));
+		v.set(radius_placeholders::leg_disconnect_reason, cdr.disconnect_rewrited_reason);
 
 	} else {
 
@@ -189,26 +167,21 @@ static inline void radius_accounting_stop(SBCCallLeg *call, const Cdr &cdr)
 
 		leg_connect_time = &cdr.bleg_connect_time;
 
-		v["leg_disconnect_code"] = int2str(cdr.disconnect_code);
-		v["leg_disconnect_reason"] = cdr.disconnect_reason;
+		v.set(radius_placeholders::leg_disconnect_code, static_cast<long long>(cdr.disconnect_code));
+		v.set(radius_placeholders::leg_disconnect_reason, cdr.disconnect_reason);
 
 	}
 
-	if(timerisset(leg_connect_time)){
-		timersub(&now,leg_connect_time,&duration);
-		v["call_duration_float"] = timeval2str_usec(duration);
-		v["call_duration_int"] = long2str(duration.tv_sec);
-	} else {
-		v["call_duration_float"] = "0.0";
-		v["call_duration_int"] = "0";
-		v["time_connect"] = "";
-		v["time_connect_float"] = "0.0";
-		v["time_connect_int"] = "0";
+	RadiusInterimScheduler::setDuration(v, *leg_connect_time, now);
+	if(!timerisset(leg_connect_time)){
+		v.set(radius_placeholders::time_connect, string());
+		v.set(radius_placeholders::time_connect_float, string("0.0"));
+		v.set(radius_placeholders::time_connect_int, 0LL);
 	}
 
-	v["time_end"] = timeval2str(now);
-	v["time_end_float"] = timeval2str_usec(now);
-	v["time_end_int"] = long2str(now.tv_sec);
+	v.set(radius_placeholders::time_end, now, PlaceholdersHash::TimeStr);
+	v.set(radius_placeholders::time_end_float, now, PlaceholdersHash::TimeFloat);
+	v.set(radius_placeholders::time_end_int, static_cast<long long>(now.tv_sec));
 }
 
 static inline void radius_accounting_stop_post_event(SBCCallLeg *call)
@@ -234,5 +207,5 @@ static inline void radius_accounting_stop_post_event(SBCCallLeg *call)
 		RADIUS_EVENT_QUEUE,
 		new RadiusRequestEvent(
 			RadiusRequestEvent::End, profile_id,
-			call->getLocalTag(), v));
+			call->getLocalTag(), v.get()));
 }
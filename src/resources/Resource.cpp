@@ -56,6 +56,7 @@ string Resource::print() const{
 	s << "takes: " << takes << ", ";
 	s << "failover_to_next: " << failover_to_next << ", ";
 	s << "active: " << active << ", ";
-	s << "taken: " << taken;
+	s << "taken: " << taken << ", ";
+	s << "leased: " << leased;
 	return s.str();
 }
@@ -3,6 +3,7 @@
 //#include <vector>
 #include <list>
 #include <string>
+#include <memory_resource>
 
 #include <AmThread.h>
 
@@ -22,9 +23,11 @@ struct Resource {
 	bool taken,				//resource grabbed
 		 active,			//whether we should grab resource after checking phase
 		 failover_to_next;	//whether we should use resource which follows if current overloaded
+	unsigned int leased;	//generation of the node-local lease resource was taken from. 0 for redis
 	Resource():
 		id(0),type(0),takes(0),limit(0),
-		taken(false), active(false), failover_to_next(false) {}
+		taken(false), active(false), failover_to_next(false),
+		leased(0) {}
 	string print() const;
 };
 
@@ -41,8 +44,22 @@ public:
     : Resource(res), op(op_){}
 };
 
+/* allocator-aware to be placed into the per-call arena (see CallCtx).
+ * copies are made with the default memory resource */
 template <typename Res>
-struct ResList: public list<Res>, AmMutex {
+struct ResList: public std::pmr::list<Res>, AmMutex {
+	using allocator_type = typename std::pmr::list<Res>::allocator_type;
+
+	ResList() = default;
+	explicit ResList(const allocator_type &alloc)
+	  : std::pmr::list<Res>(alloc)
+	{}
+	ResList(const ResList &other) = default;
+	ResList(const ResList &other, const allocator_type &alloc)
+	  : std::pmr::list<Res>(other, alloc)
+	{}
+	ResList &operator=(const ResList &other) = default;
+
 	void parse(const string s);
 };
 
@@ -54,15 +54,44 @@ string ResourceConfig::print() const{
 	s << "id: " << id << ", ";
 	s << "name: '" << name << "'', ";
 	s << "internal_code_id: " << internal_code_id << ", ";
-	s << "action: " << str_action;
+	s << "action: " << str_action << ", ";
+	s << "lease_size: " << lease_size;
 	return s.str();
 }
 
+ResourceControl::stats::stats()
+  : hits(StatsRegistry::instance()->counter("resource_control_hits")),
+	overloaded(StatsRegistry::instance()->counter("resource_control_overloaded")),
+	rejected(StatsRegistry::instance()->counter("resource_control_rejected")),
+	nextroute(StatsRegistry::instance()->counter("resource_control_nextroute")),
+	errors(StatsRegistry::instance()->counter("resource_control_errors")),
+	check_latency(StatsRegistry::instance()->histogram(
+		"resource_control_check_latency", "resources check latency"))
+{}
+
+void ResourceControl::stats::clear()
+{
+	hits.reset();
+	overloaded.reset();
+	rejected.reset();
+	nextroute.reset();
+	errors.reset();
+	check_latency.reset();
+}
+
+void ResourceControl::stats::get(AmArg &arg)
+{
+	arg["hits"] = (long)hits.get();
+	arg["overloaded"] = (long)overloaded.get();
+	arg["rejected"] = (long)rejected.get();
+	arg["nextroute"] = (long)nextroute.get();
+	arg["errors"] = (long)errors.get();
+}
+
 ResourceControl::ResourceControl():
 	container_ready(false)
 {
 	_instance = this;
-	stat.clear();
 }
 
 int ResourceControl::configure(AmConfigReader &cfg)
@@ -143,12 +172,17 @@ int ResourceControl::load_resources_config()
 			id,
 			a["name"].asCStr(),
 			DbAmArg_hash_get_int(a, "internal_code_id", 0),
-			DbAmArg_hash_get_int(a, "action_id", 0));
+			DbAmArg_hash_get_int(a, "action_id", 0),
+			DbAmArg_hash_get_int(a, "lease_size", 0));
 	}
 
+	map<int,int> type2lease_size;
 	for(const auto &it: type2cfg) {
 		DBG("resource cfg:     <%s>",it.second.print().c_str());
+		if(it.second.lease_size > 0)
+			type2lease_size.emplace(it.first, it.second.lease_size);
 	}
+	redis_conn.configure_leases(type2lease_size);
 
 	return 0;
 }
@@ -172,11 +206,12 @@ ResourceCtlResponse ResourceControl::get(
 		DBG("empty resources list. do nothing");
 		return RES_CTL_OK;
 	}
-	stat.hits++;
+	stat.hits.inc();
 
 	ResourceResponse ret;
 
 	if(container_ready.get()){
+		LatencyTimer t(stat.check_latency);
 		ret = redis_conn.get(rl,rli);
 	} else {
 		WARN("attempt to get resource from unready container");
@@ -198,14 +233,14 @@ ResourceCtlResponse ResourceControl::get(
 			return RES_CTL_OK;
 		} break;
 		case RES_BUSY: {
-			stat.overloaded++;
+			stat.overloaded.inc();
 			map<int,ResourceConfig>::iterator ti = type2cfg.find(rli->type);
 			if(ti==type2cfg.end()) {
 				resource_config.internal_code_id = DC_RESOURCE_UNKNOWN_TYPE;
 				/*resource_config.reject_code = 404;
 				resource_config.reject_reason =
 					"Resource with unknown type "+int2str(rli->type)+" overloaded";*/
-				stat.rejected++;
+				stat.rejected.inc();
 				return RES_CTL_REJECT;
 			} else {
 				ResourceConfig &rc  = ti->second;
@@ -217,17 +252,17 @@ ResourceCtlResponse ResourceControl::get(
 					ResourceConfig::ActionType a = rc.action;
 
 					if(a==ResourceConfig::NextRoute){
-						stat.nextroute++;
+						stat.nextroute.inc();
 						return RES_CTL_NEXT;
 					} else {
-						stat.rejected++;
+						stat.rejected.inc();
 						return RES_CTL_REJECT;
 					}
 				}
 			}
 		} break;
 		case RES_ERR: {
-			stat.errors++;
+			stat.errors.inc();
 			ERROR("cache error reject_on_error = %d",reject_on_error);
 			if(reject_on_error) {
 				resource_config.internal_code_id = DC_RESOURCE_CACHE_ERROR;
@@ -295,6 +330,7 @@ void ResourceControl::GetConfig(AmArg& ret,bool types_only){
 			p["name"] =  c.name;
 			p["internal_code_id"] = c.internal_code_id;
 			p["action"] = c.str_action;
+			p["lease_size"] = c.lease_size;
 		}
 		return;
 	}
@@ -407,3 +443,7 @@ void ResourceControl::showResourcesById(int id, AmArg &ret){
 
 	handlers_lock.unlock();
 }
+
+void ResourceControl::showResourceLeases(AmArg &ret){
+	redis_conn.get_leases_info(ret);
+}
@@ -7,6 +7,7 @@
 #include <map>
 #include "log.h"
 #include "../db/DbConfig.h"
+#include "../stats/StatsRegistry.h"
 
 using namespace std;
 
@@ -26,17 +27,20 @@ struct ResourceConfig {
 		Accept
 	} action;
 	string str_action;
+	int lease_size;	//units leased by node at once. 0 to check every call in redis
 
-	ResourceConfig(int i,string n, int internal_code_id, int a)
+	ResourceConfig(int i,string n, int internal_code_id, int a, int lease_size = 0)
 	  : id(i),
 		name(n),
-		internal_code_id(internal_code_id)
+		internal_code_id(internal_code_id),
+		lease_size(lease_size)
 	{
 		set_action(a);
 	}
 	ResourceConfig()
 	  : id(0),
-		internal_code_id(0)
+		internal_code_id(0),
+		lease_size(0)
 	{}
 	void set_action(int a);
 	string print() const;
@@ -82,26 +86,16 @@ class ResourceControl
 	int load_resources_config();
 	int reject_on_error;
 
-	struct {
-		unsigned int hits;
-		unsigned int overloaded;
-		unsigned int rejected;
-		unsigned int nextroute;
-		unsigned int errors;
-		void clear(){
-			hits = 0;
-			overloaded = 0;
-			rejected = 0;
-			nextroute = 0;
-			errors = 0;
-		}
-		void get(AmArg &arg){
-			arg["hits"] = (long)hits;
-			arg["overloaded"] = (long)overloaded;
-			arg["rejected"] = (long)rejected;
-			arg["nextroute"] = (long)nextroute;
-			arg["errors"] = (long)errors;
-		}
+	struct stats {
+		ShardedCounter &hits;
+		ShardedCounter &overloaded;
+		ShardedCounter &rejected;
+		ShardedCounter &nextroute;
+		ShardedCounter &errors;
+		LatencyHistogram &check_latency;
+		stats();
+		void clear();
+		void get(AmArg &arg);
 	} stat;
 
 public:
@@ -136,6 +130,7 @@ public:
 	void showResourceByHandler(const string &h, AmArg &ret);
 	void showResourceByLocalTag(const string &tag, AmArg &ret);
 	void showResourcesById(int id, AmArg &ret);
+	void showResourceLeases(AmArg &ret);
 };
 
 #endif // RESOURCECONTROL_H
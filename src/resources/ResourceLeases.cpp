@@ -0,0 +1,320 @@
+#include "ResourceLeases.h"
+#include "../stats/StatsRegistry.h"
+
+#include "AmUtils.h"
+#include "log.h"
+
+#include <chrono>
+
+static const uint64_t used_mask = 0xffffffffULL;
+
+static inline uint64_t lease_state(uint64_t leased, uint64_t used)
+{
+    return (leased << 32) | used;
+}
+
+static inline uint64_t get_leased(uint64_t state) { return state >> 32; }
+static inline uint64_t get_used(uint64_t state) { return state & used_mask; }
+
+static inline int64_t now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static ResourceOperation lease_operation(
+    ResourceOperation::Operation op,
+    int type, int id, uint64_t units, unsigned int generation)
+{
+    Resource r;
+    r.type = type;
+    r.id = id;
+    r.takes = static_cast<int>(units);
+    r.active = true;
+    r.taken = true;
+    r.leased = generation;
+    return ResourceOperation(op, r);
+}
+
+ResourceLeases::lease::lease()
+  : state(0),
+    limit(0),
+    renew_pending(false),
+    draining(false),
+    denied_at_ms(0),
+    hits(0),
+    renewals(0),
+    denials(0)
+{}
+
+void ResourceLeases::lease::clear()
+{
+    state.store(0);
+    renew_pending.store(false);
+    draining.store(false);
+    denied_at_ms.store(0);
+}
+
+ResourceLeases::stats::stats()
+  : hits(StatsRegistry::instance()->counter(
+        "resource_lease_hits", "calls served from the node-local resources leases")),
+    misses(StatsRegistry::instance()->counter(
+        "resource_lease_misses", "calls passed to the strict redis check because of the exhausted lease")),
+    renewals(StatsRegistry::instance()->counter(
+        "resource_lease_renewals", "resources lease blocks granted")),
+    denials(StatsRegistry::instance()->counter(
+        "resource_lease_denials", "resources lease blocks denied because of the limit"))
+{}
+
+ResourceLeases::ResourceLeases()
+  : retry_interval_ms(RESOURCE_LEASE_RETRY_INTERVAL_MSEC),
+    generation(1)
+{}
+
+void ResourceLeases::configure(const std::map<int, int> &lease_sizes, int64_t in_retry_interval_ms)
+{
+    retry_interval_ms = in_retry_interval_ms;
+    type2lease_size.clear();
+    for(const auto &it : lease_sizes) {
+        if(it.second <= 0) continue;
+        DBG("resources of the type %d are leased by %d units", it.first, it.second);
+        type2lease_size.emplace(it.first, it.second);
+    }
+}
+
+int ResourceLeases::get_lease_size(int type) const
+{
+    auto it = type2lease_size.find(type);
+    if(it == type2lease_size.end()) return 0;
+    return it->second;
+}
+
+ResourceLeases::lease &ResourceLeases::get_lease(int type, int id)
+{
+    AmLock l(leases_mutex);
+    return leases.try_emplace(std::make_pair(type, id)).first->second;
+}
+
+ResourceLeases::lease *ResourceLeases::find_lease(int type, int id)
+{
+    AmLock l(leases_mutex);
+    auto it = leases.find(std::make_pair(type, id));
+    if(it == leases.end()) return nullptr;
+    return &it->second;
+}
+
+bool ResourceLeases::need_renew(lease &l)
+{
+    if(now_ms() - l.denied_at_ms.load() < retry_interval_ms)
+        return false;
+    bool expected = false;
+    return l.renew_pending.compare_exchange_strong(expected, true);
+}
+
+//clamps used units at zero because leases can be reset concurrently
+static void release_units(std::atomic<uint64_t> &state, uint64_t units)
+{
+    uint64_t s = state.load(), used;
+    do {
+        used = get_used(s);
+        used = used > units ? used - units : 0;
+    } while(!state.compare_exchange_weak(s, lease_state(get_leased(s), used)));
+}
+
+bool ResourceLeases::take(ResourceList &rl, std::vector<renew_request> &renew)
+{
+    std::vector<std::pair<Resource *, lease *>> taken;
+    unsigned int gen = generation.load();
+    bool chain_head = true, ret = true, miss = false;
+
+    for(auto &r : rl) {
+        bool head = chain_head;
+        chain_head = !r.failover_to_next;
+        //failover alternatives are resolved by the strict path only
+        if(!head) continue;
+
+        int lease_size = get_lease_size(r.type);
+        if(!lease_size || r.takes <= 0) {
+            ret = false;
+            break;
+        }
+
+        lease &l = get_lease(r.type, r.id);
+        l.limit.store(r.limit);
+
+        uint64_t takes = static_cast<uint64_t>(r.takes);
+        uint64_t s = l.state.load(), leased, used;
+        bool fit;
+        do {
+            leased = get_leased(s);
+            used = get_used(s);
+            fit = used + takes <= leased;
+            if(!fit) break;
+        } while(!l.state.compare_exchange_weak(s, s + takes));
+
+        if((!fit || 2 * (leased - used - takes) < static_cast<uint64_t>(lease_size)) &&
+           need_renew(l))
+        {
+            renew.push_back({ r.type, r.id, r.limit, lease_size, gen });
+        }
+
+        if(!fit) {
+            ret = false;
+            miss = true;
+            break;
+        }
+
+        taken.emplace_back(&r, &l);
+    }
+
+    //leases were reset while taking
+    if(ret && gen != generation.load())
+        ret = false;
+
+    if(!ret) {
+        for(auto &t : taken)
+            release_units(t.second->state, static_cast<uint64_t>(t.first->takes));
+        if(miss) stat.misses.inc();
+        return false;
+    }
+
+    for(auto &t : taken) {
+        Resource &r = *t.first;
+        r.active = true;
+        r.taken = true;
+        r.leased = gen;
+        t.second->hits++;
+    }
+    stat.hits.inc();
+
+    return true;
+}
+
+void ResourceLeases::put(const Resource &r, ResourceOperationList &ops)
+{
+    if(r.leased != generation.load()) {
+        DBG("resource %d:%d was taken from the reset lease. ignore put", r.type, r.id);
+        return;
+    }
+
+    lease *l = find_lease(r.type, r.id);
+    if(!l) return;
+
+    uint64_t lease_size = static_cast<uint64_t>(get_lease_size(r.type));
+    uint64_t takes = static_cast<uint64_t>(r.takes);
+    uint64_t s = l->state.load(), leased, used, free, returned;
+    do {
+        leased = get_leased(s);
+        used = get_used(s);
+        used = used > takes ? used - takes : 0;
+        free = leased - used;
+
+        if(l->draining.load()) returned = free;
+        else if(free > 2 * lease_size) returned = free - lease_size;
+        else returned = 0;
+    } while(!l->state.compare_exchange_weak(s, lease_state(leased - returned, used)));
+
+    if(returned)
+        ops.push_back(lease_operation(ResourceOperation::RES_PUT, r.type, r.id, returned, r.leased));
+}
+
+void ResourceLeases::on_renew(const renew_request &req, bool granted, long long total, ResourceOperationList &ops)
+{
+    lease *l = nullptr;
+    //lease was reset while the request was in flight
+    if(req.generation == generation.load())
+        l = find_lease(req.type, req.id);
+
+    if(!l) {
+        //return the block granted after the node field reset
+        if(granted) {
+            ops.push_back(lease_operation(
+                ResourceOperation::RES_PUT, req.type, req.id,
+                static_cast<uint64_t>(req.lease_size), generation.load()));
+        }
+        return;
+    }
+
+    if(granted) {
+        l->state.fetch_add(static_cast<uint64_t>(req.lease_size) << 32);
+        l->draining.store(false);
+        l->renewals++;
+        stat.renewals.inc();
+    } else {
+        DBG("lease for %d:%d denied. used %lld of %d on all nodes. drain it",
+            req.type, req.id, total, req.limit);
+
+        l->draining.store(true);
+        l->denied_at_ms.store(now_ms());
+        l->denials++;
+        stat.denials.inc();
+
+        //leave the free units to the other nodes
+        uint64_t s = l->state.load(), free;
+        do {
+            free = get_leased(s) - get_used(s);
+        } while(!l->state.compare_exchange_weak(s, lease_state(get_used(s), get_used(s))));
+
+        if(free) {
+            ops.push_back(lease_operation(
+                ResourceOperation::RES_PUT, req.type, req.id, free, req.generation));
+        }
+    }
+
+    l->renew_pending.store(false);
+}
+
+void ResourceLeases::on_renew_error(const renew_request &req)
+{
+    if(req.generation != generation.load()) return;
+
+    lease *l = find_lease(req.type, req.id);
+    if(!l) return;
+
+    //retry after the interval
+    l->denied_at_ms.store(now_ms());
+    l->renew_pending.store(false);
+}
+
+void ResourceLeases::reset(ResourceOperationList &queue)
+{
+    generation++;
+
+    AmLock l(leases_mutex);
+    if(!leases.empty())
+        INFO("reset %zd resources leases", leases.size());
+    for(auto &it : leases)
+        it.second.clear();
+
+    queue.remove_if([](const ResourceOperation &op) { return op.leased != 0; });
+}
+
+void ResourceLeases::info(AmArg &ret)
+{
+    ret.assertStruct();
+    ret["generation"] = static_cast<long long>(generation.load());
+
+    AmArg &types = ret["types"];
+    types.assertStruct();
+    for(const auto &it : type2lease_size)
+        types[int2str(it.first)] = it.second;
+
+    AmArg &a = ret["leases"];
+    a.assertStruct();
+
+    AmLock lk(leases_mutex);
+    for(const auto &it : leases) {
+        const lease &l = it.second;
+        uint64_t s = l.state.load();
+
+        AmArg &i = a["r:" + int2str(it.first.first) + ":" + int2str(it.first.second)];
+        i["leased"] = static_cast<long long>(get_leased(s));
+        i["used"] = static_cast<long long>(get_used(s));
+        i["limit"] = l.limit.load();
+        i["draining"] = l.draining.load();
+        i["renew_pending"] = l.renew_pending.load();
+        i["hits"] = static_cast<long long>(l.hits.load());
+        i["renewals"] = static_cast<long long>(l.renewals.load());
+        i["denials"] = static_cast<long long>(l.denials.load());
+    }
+}
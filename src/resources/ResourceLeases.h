@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Resource.h"
+#include "../stats/ShardedCounter.h"
+
+#include <AmArg.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#define RESOURCE_LEASE_RETRY_INTERVAL_MSEC 1000
+
+/* node-local quota leasing for the resource types with lease_size configured.
+ *
+ * node reserves blocks of lease_size units in its own redis field of the resource
+ * and serves get/put from the local counter without redis round trips.
+ * block is renewed asynchronously when less than half of the block is free
+ * and returned when more than two blocks are free.
+ *
+ * renewal is denied when the block does not fit into the limit
+ * together with the usage of all nodes. the check and the increment
+ * of the node field are done atomically in redis (resource_lease.lua).
+ * lease is drained on the denial:
+ * free units are returned and calls go through the strict redis check
+ * until the next successful renewal */
+class ResourceLeases {
+  public:
+    struct renew_request {
+        int type;
+        int id;
+        int limit;
+        int lease_size;
+        unsigned int generation;
+    };
+
+  private:
+    struct lease {
+        //leased units in the high half, used units in the low half
+        std::atomic<uint64_t> state;
+        std::atomic<int> limit;
+        std::atomic<bool> renew_pending;
+        std::atomic<bool> draining;
+        std::atomic<int64_t> denied_at_ms;
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> renewals;
+        std::atomic<uint64_t> denials;
+
+        lease();
+        void clear();
+    };
+
+    std::map<int, int> type2lease_size;
+    int64_t retry_interval_ms;
+    std::map<std::pair<int, int>, lease> leases;    //guarded by leases_mutex
+    AmMutex leases_mutex;
+    std::atomic<unsigned int> generation;
+
+    struct stats {
+        ShardedCounter &hits;
+        ShardedCounter &misses;
+        ShardedCounter &renewals;
+        ShardedCounter &denials;
+        stats();
+    } stat;
+
+    int get_lease_size(int type) const;
+    lease &get_lease(int type, int id);
+    lease *find_lease(int type, int id);
+    bool need_renew(lease &l);
+
+  public:
+    ResourceLeases();
+
+    /* type -> lease_size. types with zero lease_size are served by the strict path.
+     * renewal is not retried within retry_interval_ms after the denial or error */
+    void configure(const std::map<int, int> &lease_sizes,
+                   int64_t retry_interval_ms = RESOURCE_LEASE_RETRY_INTERVAL_MSEC);
+    bool is_enabled() const { return !type2lease_size.empty(); }
+    unsigned int get_generation() const { return generation.load(); }
+
+    /* serves the resources list from the local leases.
+     * the first resource of every failover chain must be of the leasing type
+     * and fit into the free leased units.
+     * on success chain heads are marked as taken with the current generation,
+     * the list is left untouched otherwise.
+     * leases to be renewed are appended to renew in both cases */
+    bool take(ResourceList &rl, std::vector<renew_request> &renew);
+
+    //releases units taken by take(). returned blocks are appended to ops
+    void put(const Resource &r, ResourceOperationList &ops);
+
+    /* granted block is already added to the node field in redis.
+     * total is the sum of the resource fields for all nodes before the grant.
+     * returned blocks are appended to ops */
+    void on_renew(const renew_request &req, bool granted, long long total, ResourceOperationList &ops);
+    void on_renew_error(const renew_request &req);
+
+    /* drops all the leases because node fields are going to be reset by invalidation.
+     * lease operations are removed from the not sent queue */
+    void reset(ResourceOperationList &queue);
+
+    void info(AmArg &ret);
+};
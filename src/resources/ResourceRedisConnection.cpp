@@ -1,5 +1,6 @@
 #include "ResourceRedisConnection.h"
 #include "../yeti.h"
+#include "../stats/StatsRegistry.h"
 
 enum RpcMethodId {
     MethodGetResourceState
@@ -7,10 +8,22 @@ enum RpcMethodId {
 
 const string RESOURCE_QUEUE_NAME("resource");
 
+ResourceRedisConnection::stats::stats()
+  : operations(StatsRegistry::instance()->counter(
+        "resource_operations", "resources get/put operations queued to redis")),
+    batches(StatsRegistry::instance()->counter(
+        "resource_batches", "resources operations transactions sent to redis")),
+    commands(StatsRegistry::instance()->counter(
+        "resource_commands", "HINCRBY commands sent to redis after operations merging"))
+{}
+
 ResourceRedisConnection::ResourceRedisConnection(const string& queue_name)
   : RedisConnectionPool("resources", queue_name),
     write_async(nullptr), read_async(nullptr),
-    write_async_is_busy(false),
+    max_inflight_batches(RESOURCES_DEFAULT_MAX_INFLIGHT_BATCHES),
+    write_async_inflight(0),
+    write_generation(0),
+    lease_script("resource_lease", queue_name),
     inv_seq(this),
     resources_inited(false),
     resources_initialized_cb(nullptr),
@@ -26,6 +39,21 @@ int ResourceRedisConnection::configure(const AmConfigReader& cfg)
         return -1;
     }
 
+    int inflight = static_cast<int>(
+        cfg.getParameterInt("max_inflight_batches", RESOURCES_DEFAULT_MAX_INFLIGHT_BATCHES));
+    if(inflight < 1) {
+        ERROR("invalid max_inflight_batches: %d. must be positive", inflight);
+        return -1;
+    }
+    max_inflight_batches = static_cast<unsigned int>(inflight);
+
+    int io_threads = static_cast<int>(cfg.getParameterInt("resources_io_threads", 0));
+    if(io_threads < 0) {
+        ERROR("invalid io_threads: %d", io_threads);
+        return -1;
+    }
+    set_io_threads(static_cast<unsigned int>(io_threads));
+
     return 0;
 }
 
@@ -55,39 +83,46 @@ bool ResourceRedisConnection::is_ready()
     return write_async && write_async->is_connected() && resources_inited.get();
 }
 
-void ResourceRedisConnection::process_operations_queue()
+void ResourceRedisConnection::flush_operations_queue()
 {
-    AmLock l(queue_and_state_mutex);
+    if(resource_operations_queue.empty() ||
+       !is_ready() || write_async_inflight >= max_inflight_batches)
+    {
+        //operations are accumulated and merged while all the batches are in flight
+        return;
+    }
 
-    if(!is_ready() || write_async_is_busy) return;
+    unique_ptr<OperationResources> op_seq(
+        new OperationResources(this, resource_operations_queue, write_generation));
+    resource_operations_queue.clear();
 
-    if(resource_operations_queue.size()) {
-        unique_ptr<OperationResources> op_seq(new OperationResources(this, resource_operations_queue));
-        if(op_seq->perform()) {
-            write_async_is_busy = true;
-            op_seq.release(); //will be deleted by redis thread
-        }
-        resource_operations_queue.clear();
+    ops_stats.operations.inc(op_seq->get_operations_count());
+    if(op_seq->perform()) {
+        write_async_inflight++;
+        ops_stats.batches.inc();
+        ops_stats.commands.inc(op_seq->get_deltas().size());
+        op_seq.release(); //will be deleted by redis thread
     }
 }
 
-void ResourceRedisConnection::process_operations_list(ResourceOperationList& rol)
+void ResourceRedisConnection::process_operations_queue()
 {
     AmLock l(queue_and_state_mutex);
+    flush_operations_queue();
+}
 
-    if(is_ready() && !write_async_is_busy) {
-        unique_ptr<OperationResources> op_seq(new OperationResources(this, rol));
-        if(op_seq->perform()) {
-            write_async_is_busy = true;
-            op_seq.release(); //will be deleted by redis thread
-        }
-    } else {
-        resource_operations_queue.splice(resource_operations_queue.end(), rol);
-    }
+void ResourceRedisConnection::process_operations_list(ResourceOperationList& rol)
+{
+    AmLock l(queue_and_state_mutex);
+    resource_operations_queue.splice(resource_operations_queue.end(), rol);
+    flush_operations_queue();
 }
 
 void ResourceRedisConnection::on_connect(RedisConnection* c){
     if(c == write_async) {
+        //posted before the invalidation, so the hash is set before the resources are ready
+        lease_script.load(c, "/etc/yeti/scripts/resource_lease.lua",
+                          ResourceSequenceBase::REDIS_REPLY_LEASE_SCRIPT_LOAD);
         if(!resources_inited.get()) {
             if(inv_seq.get_state()) {
                 WARN("initialization of the resources is not finished. Reset the sequence and try again");
@@ -102,9 +137,14 @@ void ResourceRedisConnection::on_connect(RedisConnection* c){
 
 void ResourceRedisConnection::on_disconnect(RedisConnection* c) {
     if(c == write_async) {
-        if(write_async_is_busy) {
+        AmLock l(queue_and_state_mutex);
+        if(write_async_inflight) {
+            //results of the batches in flight are unknown. invalidate after reconnect
             resources_inited.set(false);
-            write_async_is_busy = false;
+            write_async_inflight = 0;
+            //replies for the lost batches must not affect the new connection state
+            write_generation++;
+            leases.reset(resource_operations_queue);
         }
     }
 }
@@ -114,7 +154,9 @@ void ResourceRedisConnection::get_resource_state(const JsonRpcRequestEvent& req)
     int type, id;
     str2int(req.params.get(0).asCStr(),type);
     str2int(req.params.get(1).asCStr(),id);
-    (new GetAllResources(this, req, type, id))->perform();
+    unique_ptr<GetAllResources> seq(new GetAllResources(this, req, type, id));
+    if(seq->perform())
+        seq.release(); //will be deleted by redis thread
 }
 
 void ResourceRedisConnection::process_reply_event(RedisReplyEvent& ev)
@@ -157,19 +199,38 @@ void ResourceRedisConnection::process_reply_event(RedisReplyEvent& ev)
             //DBG("resources operation finished %s errors", seq->is_error() ? "with" : "without");
             if(operation_result_cb)
                 operation_result_cb(!seq->is_error());
-            write_async_is_busy = false;
-            if(seq->is_error()) {
-                // on error have to reset the connection and invalidate resources
-                redis::redisAsyncDisconnect(write_async->get_async_context());
-                resources_inited.set(false);
+
+            bool reset_connection = false, invalidate = false;
+            {
+                AmLock l(queue_and_state_mutex);
+                if(seq->get_generation() != write_generation) {
+                    //batch sent before the disconnect. state is already reset
+                    return;
+                }
+                //sequences performed directly (unit tests) are not accounted
+                if(write_async_inflight) write_async_inflight--;
+                if(seq->is_error()) {
+                    // on error have to reset the connection and invalidate resources
+                    resources_inited.set(false);
+                    write_async_inflight = 0;
+                    write_generation++;
+                    leases.reset(resource_operations_queue);
+                    reset_connection = true;
+                } else if(!resources_inited.get()) {
+                    // for rpc command of invalidate resources(if connection was busy)
+                    invalidate = !write_async_inflight;
+                } else {
+                    // trying the next operation after successful finished previous
+                    flush_operations_queue();
+                }
+            }
+
+            if(reset_connection) {
+                disconnect(write_async);
                 inv_seq.cleanup();
-            } else if(!resources_inited.get()) {
-                // for rpc command of invalidate resources(if connection was busy)
+            } else if(invalidate) {
                 inv_seq.cleanup();
                 inv_seq.perform();
-            } else {
-                // trying the next operation after successful finished previous
-                process_operations_queue();
             }
         }
     } else if(ev.user_type_id == ResourceSequenceBase::REDIS_REPLY_GET_ALL_KEYS_SEQ) {
@@ -194,6 +255,46 @@ void ResourceRedisConnection::process_reply_event(RedisReplyEvent& ev)
 
         if(!seq->processRedisReply(ev))
             ev.user_data.release();
+    } else if(ev.user_type_id == ResourceSequenceBase::REDIS_REPLY_LEASE_SEQ) {
+        LeaseResources* seq = dynamic_cast<LeaseResources*>(ev.user_data.get());
+        if(!seq) {
+            ERROR("incorrect user data[%p], expected lease sequence", ev.user_data.get());
+            return;
+        }
+
+        if(!seq->processRedisReply(ev))
+            ev.user_data.release();
+
+        if(seq->is_finish()) {
+            /* granted block is reset together with the node field
+             * by the invalidation in progress */
+            if(seq->is_error() || !resources_inited.get()) {
+                leases.on_renew_error(seq->get_request());
+            } else {
+                ResourceOperationList rol;
+                leases.on_renew(seq->get_request(), seq->is_granted(), seq->get_total(), rol);
+                if(!rol.empty())
+                    process_operations_list(rol);
+            }
+        }
+    } else if(ev.user_type_id == ResourceSequenceBase::REDIS_REPLY_LEASE_SCRIPT_LOAD) {
+        auto script = dynamic_cast<RedisScript *>(ev.user_data.release());
+        if(!script) {
+            ERROR("incorrect user data, expected lease script");
+            return;
+        }
+        if(ev.result == RedisReplyEvent::SuccessReply) {
+            auto hash = ev.reply().str();
+            //the same hash on reconnect. do not rewrite it under the readers
+            if(script->hash != hash) {
+                script->hash.assign(hash.data(), hash.size());
+                DBG("script '%s' loaded with hash '%s'",
+                    script->name.c_str(), script->hash.c_str());
+            }
+        } else {
+            ERROR("failed to load script '%s'. leases will not be renewed",
+                  script->name.c_str());
+        }
     }
 }
 
@@ -225,17 +326,25 @@ int ResourceRedisConnection::init()
 
 bool ResourceRedisConnection::invalidate_resources()
 {
-    if(!write_async->is_connected()) {
-        INFO("resources will be invalidated after the connect");
-    } else if(!resources_inited.get()) {
-        INFO("resources are in invalidation process");
-    } else if(write_async_is_busy) {
-        INFO("resources will be invalidated after the job finished");
-    } else {
-        inv_seq.cleanup();
-        inv_seq.perform();
+    {
+        AmLock l(queue_and_state_mutex);
+
+        //not sent operations belong to the invalidated handlers
+        resource_operations_queue.clear();
+        leases.reset(resource_operations_queue);
+
+        if(!write_async->is_connected()) {
+            INFO("resources will be invalidated after the connect");
+        } else if(!resources_inited.get()) {
+            INFO("resources are in invalidation process");
+        } else if(write_async_inflight) {
+            INFO("resources will be invalidated after the job finished");
+        } else {
+            inv_seq.cleanup();
+            inv_seq.perform();
+        }
+        resources_inited.set(false);
     }
-    resources_inited.set(false);
     return resources_inited.wait_for_to(writecfg.timeout);
 }
 
@@ -254,6 +363,11 @@ void ResourceRedisConnection::put(ResourceList& rl)
     ResourceOperationList rol;
     for(auto& res : rl) {
         if(!res.taken) continue;
+        if(res.leased) {
+            //returned lease blocks are appended to rol
+            leases.put(res, rol);
+            continue;
+        }
         rol.emplace_back(ResourceOperation::RES_PUT, res);
     }
 
@@ -284,6 +398,17 @@ ResourceResponse ResourceRedisConnection::get(ResourceList &rl, ResourceList::it
 
     resource = rl.begin();
 
+    if(leases.is_enabled() && is_ready()) {
+        std::vector<ResourceLeases::renew_request> renew;
+        bool leased = leases.take(rl, renew);
+        for(const auto &req : renew)
+            request_lease_renewal(req);
+        if(leased) {
+            DBG("resources are taken from the node-local leases");
+            return RES_SUCC;
+        }
+    }
+
     unique_ptr<CheckResources> cr_seq(new CheckResources(this, rl));
 
     if(!cr_seq->perform())
@@ -346,12 +471,47 @@ ResourceResponse ResourceRedisConnection::get(ResourceList &rl, ResourceList::it
     return ret;
 }
 
+void ResourceRedisConnection::request_lease_renewal(const ResourceLeases::renew_request &req)
+{
+    unique_ptr<LeaseResources> seq(new LeaseResources(this, req));
+    if(!seq->perform()) {
+        leases.on_renew_error(req);
+        return;
+    }
+    seq.release(); //will be deleted by redis thread
+}
+
 void ResourceRedisConnection::get_config(AmArg& ret)
 {
     AmArg& write = ret["write"];
     write["connection"] = writecfg.server+":"+int2str(writecfg.port);
     AmArg& read = ret["read"];
     read["connection"] = readcfg.server+":"+int2str(readcfg.port);
+    ret["max_inflight_batches"] = static_cast<int>(max_inflight_batches);
+    ret["io_threads"] = static_cast<int>(get_io_threads());
+    get_operations_stats(ret["operations"]);
+}
+
+void ResourceRedisConnection::get_operations_stats(AmArg& ret)
+{
+    {
+        AmLock l(queue_and_state_mutex);
+        ret["queued"] = static_cast<long long>(resource_operations_queue.size());
+        ret["inflight"] = static_cast<int>(write_async_inflight);
+    }
+    ret["operations"] = static_cast<long long>(ops_stats.operations.get());
+    ret["batches"] = static_cast<long long>(ops_stats.batches.get());
+    ret["commands"] = static_cast<long long>(ops_stats.commands.get());
+}
+
+void ResourceRedisConnection::configure_leases(const std::map<int, int> &type2lease_size)
+{
+    leases.configure(type2lease_size);
+}
+
+void ResourceRedisConnection::get_leases_info(AmArg& ret)
+{
+    leases.info(ret);
 }
 
 bool ResourceRedisConnection::get_resource_state(const std::string& connection_id,
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "ResourceSequences.h"
+#include "../stats/ShardedCounter.h"
+
+#define RESOURCES_DEFAULT_MAX_INFLIGHT_BATCHES 4
 
 extern const string RESOURCE_QUEUE_NAME;
 
@@ -25,9 +28,22 @@ class ResourceRedisConnection : public RedisConnectionPool
     RedisConnection* read_async;
 
     AmMutex queue_and_state_mutex;
-    bool write_async_is_busy;                           //guarded by queue_and_state_mutex
+    unsigned int max_inflight_batches;
+    unsigned int write_async_inflight;                  //guarded by queue_and_state_mutex
+    unsigned int write_generation;                      //guarded by queue_and_state_mutex
     ResourceOperationList resource_operations_queue;    //guarded by queue_and_state_mutex
 
+    struct stats {
+        ShardedCounter &operations;
+        ShardedCounter &batches;
+        ShardedCounter &commands;
+        stats();
+    } ops_stats;
+
+    ResourceLeases leases;
+    //loaded on the write connection. see LeaseResources
+    RedisScript lease_script;
+
     InvalidateResources inv_seq;
     AmCondition<bool> resources_inited;
 
@@ -37,12 +53,15 @@ class ResourceRedisConnection : public RedisConnectionPool
 
     void process_operations_queue();
     void process_operations_list(ResourceOperationList& rol);
+    //queue_and_state_mutex must be locked
+    void flush_operations_queue();
 
     void on_connect(RedisConnection* c) override;
     void on_disconnect(RedisConnection* c) override;
 
     void get_resource_state(const JsonRpcRequestEvent& req);
     void get(ResourceList &rl);
+    void request_lease_renewal(const ResourceLeases::renew_request &req);
 
   public:
     ResourceRedisConnection(const string& queue_name = RESOURCE_QUEUE_NAME);
@@ -52,6 +71,9 @@ class ResourceRedisConnection : public RedisConnectionPool
     int init();
     bool invalidate_resources();
     void get_config(AmArg& ret);
+    void get_operations_stats(AmArg& ret);
+    void configure_leases(const std::map<int, int> &type2lease_size);
+    void get_leases_info(AmArg& ret);
 
     void process(AmEvent* event) override;
     void process_jsonrpc_request(const JsonRpcRequestEvent& event);
@@ -73,5 +95,6 @@ class ResourceRedisConnection : public RedisConnectionPool
                             const AmArg& params);
 
     RedisConnection* get_write_conn(){ return write_async; }
+    const string &get_lease_script_hash() { return lease_script.hash; }
     RedisConnection* get_read_conn(){ return read_async; }
 };
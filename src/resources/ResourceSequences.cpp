@@ -1,6 +1,7 @@
 #include "ResourceRedisConnection.h"
 #include <sstream>
 #include <algorithm>
+#include <map>
 #include "ResourceControl.h"
 
 using namespace std; 
@@ -44,30 +45,24 @@ static string get_key(Resource &r)
     return ss.str();
 }
 
-static bool isArgNumber(const AmArg& arg)
+long int Reply2Int(const RedisReplyView &r)
 {
-    return isArgInt(arg) || isArgLongLong(arg) || isArgDouble(arg);
-}
-
-long int Reply2Int(AmArg& r)
-{
-    long int ret = 0;
-    char *s;
-    if(isArgNumber(r))
-        ret = r.asLongLong();
-    else if(isArgUndef(r))//non existent key
-        ret = 0;
-    else if(isArgCStr(r)) {//string response
-        s = (char*)r.asCStr();
-        if(!str2long(s,ret)){
-            ERROR("Reply2Int: conversion falied for: '%s'",r.asCStr());
+    long long ret = 0;
+    if(r.isNil()) //non existent key
+        return 0;
+    if(r.isInteger() || r.isString()) {
+        if(!r.toInt(ret)) {
+            auto s = r.str();
+            ERROR("Reply2Int: conversion falied for: '%.*s'",
+                  static_cast<int>(s.size()), s.data());
             throw ReplyDataException("invalid response from redis");
         }
-    } else if(isArgArray(r)) { //we have array reply. return sum of all elements");
+    } else if(r.isArray()) { //we have array reply. return sum of all elements
         for(size_t i=0; i < r.size(); i++)
             ret+=Reply2Int(r[i]);
-    } else if(isArgStruct(r) && r.hasMember("error")) {
-        ERROR("reply error: '%s'",r["error"].asCStr());
+    } else if(r.isError()) {
+        auto s = r.str();
+        ERROR("reply error: '%.*s'", static_cast<int>(s.size()), s.data());
         throw ReplyDataException("unexpected reply");
     } else {
         throw ReplyTypeException("reply type is not desired",r.getType());
@@ -112,17 +107,19 @@ bool InvalidateResources::processRedisReply(RedisReplyEvent &reply)
     } else if(state == GET_KEYS) {
         if(reply.result != RedisReplyEvent::SuccessReply) {
             on_error("reply error in request: state GET_KEYS, result_type %d", reply.result);
-        } else if(isArgUndef(reply.data)){
+        } else if(reply.reply().isNil()){
             INFO("empty database. skip resources initialization");
             state = FINISH;
-        } else if(isArgArray(reply.data)) {
+        } else if(reply.reply().isArray()) {
             state = CLEAN_RES;
 
-            commands_count = reply.data.size() + 2;
+            auto keys = reply.reply();
+            commands_count = keys.size() + 2;
             SEQ_REDIS_WRITE("MULTI");
-            for(size_t i = 0; i < reply.data.size(); i++) {
-                SEQ_REDIS_WRITE("HSET %s %d 0",
-                                reply.data[i].asCStr(), AmConfig.node_id);
+            for(size_t i = 0; i < keys.size(); i++) {
+                auto key = keys[i].str();
+                SEQ_REDIS_WRITE("HSET %b %d 0",
+                                key.data(), key.size(), AmConfig.node_id);
             }
             SEQ_REDIS_WRITE("EXEC");
         } else {
@@ -155,66 +152,84 @@ void InvalidateResources::on_error(const char* error, ...)
     if(initial) kill(getpid(),SIGTERM);
 }
 
-OperationResources::OperationResources(ResourceRedisConnection* conn, const ResourceOperationList& rl)
+OperationResources::OperationResources(ResourceRedisConnection* conn, const ResourceOperationList& rl,
+                                       unsigned int generation)
   : ResourceSequenceBase(conn, REDIS_REPLY_OP_SEQ),
     state(INITIAL),
-    res_list(rl),
-    iserror(false)
-{}
-
-bool OperationResources::perform()
+    operations_count(0),
+    iserror(false),
+    generation(generation)
 {
-    if(state == INITIAL) {
-        state = MULTI_START;
-
-        for(auto res = res_list.begin(); res != res_list.end();) {
-            //filter out inactive and not taken resources
-            if(res->op == ResourceOperation::RES_GET && !res->active) {
-                DBG("found RES_GET with inactive resource. filter out");
-                res = res_list.erase(res);
-            } else if(res->op == ResourceOperation::RES_PUT && !res->taken) {
-                DBG("found RES_PUT with not taken resource. filter out");
-                res = res_list.erase(res);
-            } else if(res->op == ResourceOperation::RES_NONE) {
-                DBG("found RES_NONE. filter out");
-                res = res_list.erase(res);
-            } else {
-                res++;
-            }
+    std::map<std::pair<int, int>, long long> merged;
+
+    for(const auto &res : rl) {
+        //filter out inactive and not taken resources
+        if(res.op == ResourceOperation::RES_GET && res.active) {
+            merged[{res.type, res.id}] += res.takes;
+        } else if(res.op == ResourceOperation::RES_PUT && res.taken) {
+            merged[{res.type, res.id}] -= res.takes;
+        } else {
+            DBG("found %d operation with inactive or not taken resource %d:%d. filter out",
+                res.op, res.type, res.id);
+            continue;
         }
+        operations_count++;
+    }
 
-        if(res_list.empty()) {
-            //ask to be deleted by caller
-            return false;
-        }
+    for(const auto &it : merged) {
+        if(!it.second) continue;
+        deltas.push_back({ it.first.first, it.first.second, it.second });
+    }
+}
 
-        if(!SEQ_REDIS_WRITE("MULTI")) {
-            on_error("failed to post redis request");
-            return false;
-        }
-    } else {
+bool OperationResources::perform()
+{
+    if(state != INITIAL) {
         on_error("perform called in the not INITIAL state: %d", state);
         return false;
     }
 
+    if(deltas.empty()) {
+        //ask to be deleted by caller
+        return false;
+    }
+
+    AmLock l(commands_mutex);
+
+    state = OP_RES;
+    //only the posted commands are counted
+    commands_count = 0;
+
+    if(!SEQ_REDIS_WRITE("MULTI")) {
+        on_error("failed to post redis request");
+        return false;
+    }
+    commands_count++;
+
+    for(const auto &d : deltas) {
+        if(!SEQ_REDIS_WRITE("HINCRBY r:%d:%d %d %lld", d.type, d.id, AmConfig.node_id, d.value)) {
+            on_error("failed to post HINCRBY for the resource %d:%d", d.type, d.id);
+            break;
+        }
+        commands_count++;
+    }
+
+    /* the sequence finishes as the failed one on the replies for the posted commands.
+     * the partially queued transaction is discarded */
+    if(!SEQ_REDIS_WRITE(iserror ? "DISCARD" : "EXEC"))
+        on_error("failed to post %s", iserror ? "DISCARD" : "EXEC");
+    else
+        commands_count++;
+
     return true;
 }
 
 bool OperationResources::processRedisReply(RedisReplyEvent &reply)
 {
+    AmLock l(commands_mutex);
+
     if(state == INITIAL) {
         on_error("redis reply in the INITIAL state");
-    } else if(state == MULTI_START) {
-        state = OP_RES;
-
-        commands_count = res_list.size() + 1;
-        for(auto& res : res_list) {
-            if(res.op == ResourceOperation::RES_GET && res.active)
-                SEQ_REDIS_WRITE("HINCRBY %s %d %d", get_key(res).c_str(), AmConfig.node_id, res.takes);
-            else if(res.op == ResourceOperation::RES_PUT && res.taken)
-                SEQ_REDIS_WRITE("HINCRBY %s %d -%d", get_key(res).c_str(), AmConfig.node_id, res.takes);
-        }
-        SEQ_REDIS_WRITE("EXEC");
     } else if(state == OP_RES) {
         commands_count--;
         if((commands_count && reply.result != RedisReplyEvent::StatusReply) ||
@@ -310,16 +325,17 @@ bool GetAllResources::processRedisReply(RedisReplyEvent &reply)
         if(reply.result != RedisReplyEvent::SuccessReply){
             on_error(500, "no reply from storage");
             state = FINISH;
-        } else if(isArgUndef(reply.data) ||(
-            isArgArray(reply.data) && !reply.data.size())){
+        } else if(reply.reply().isNil() ||(
+            reply.reply().isArray() && !reply.reply().size())){
             on_error(404, "no resources matched");
             state = FINISH;
-        } else if(isArgArray(reply.data)) {
+        } else if(reply.reply().isArray()) {
             state = GET_DATA;
 
-            commands_count = reply.data.size();
-            for(size_t i = 0;i < reply.data.size(); i++)
-                keys.push_back(reply.data[i].asCStr());
+            auto data = reply.reply();
+            commands_count = data.size();
+            for(size_t i = 0;i < data.size(); i++)
+                keys.emplace_back(data[i].str());
 
             for(auto const &key : keys)
                 SEQ_REDIS_READ("HGETALL %s", key.data());
@@ -331,16 +347,17 @@ bool GetAllResources::processRedisReply(RedisReplyEvent &reply)
         commands_count--;
         if(reply.result != RedisReplyEvent::SuccessReply){
             on_error(500, "reply error in the request");
-        } else if(isArgUndef(reply.data)){
+        } else if(reply.reply().isNil()){
             on_error(500, "undesired reply from the storage");
-        } else if(isArgArray(reply.data)){
+        } else if(reply.reply().isArray()){
+            auto data = reply.reply();
             string key = keys[keys.size() - commands_count - 1];
             result.push(key,AmArg());
             AmArg &q = result[key];
-            for(size_t j = 0; j < reply.data.size(); j+=2){
+            for(size_t j = 0; j < data.size(); j+=2){
                 try {
-                    q.push(int2str((unsigned int)Reply2Int(reply.data[j])),	//node_id
-                            AmArg(Reply2Int(reply.data[j+1])));				//value*/
+                    q.push(int2str((unsigned int)Reply2Int(data[j])),	//node_id
+                            AmArg(Reply2Int(data[j+1])));				//value*/
                 } catch(...) {
                     on_error(500, "can't parse response");
                 }
@@ -419,7 +436,7 @@ bool CheckResources::processRedisReply(RedisReplyEvent &reply)
             on_error("reply error in the request");
         } else {
             try {
-                long int now = Reply2Int(reply.data);
+                long int now = Reply2Int(reply.reply());
                 result.push(now);
             } catch(...) {
                 on_error("failed to parse response");
@@ -460,3 +477,73 @@ bool CheckResources::wait_finish(int timeout)
 {
     return finished.wait_for_to(timeout);
 }
+
+LeaseResources::LeaseResources(ResourceRedisConnection* conn, const ResourceLeases::renew_request &req)
+  : ResourceSequenceBase(conn, REDIS_REPLY_LEASE_SEQ),
+    state(INITIAL),
+    req(req),
+    iserror(false),
+    granted(false),
+    total(0)
+{}
+
+bool LeaseResources::perform()
+{
+    if(state != INITIAL) {
+        on_error("perform called in the not INITIAL state: %d", state);
+        return false;
+    }
+
+    const string &hash = conn->get_lease_script_hash();
+    if(hash.empty()) {
+        on_error("resource_lease.lua is not loaded");
+        return false;
+    }
+
+    state = RENEW;
+    if(!SEQ_REDIS_WRITE("EVALSHA %s 1 r:%d:%d %d %d %d",
+                        hash.c_str(), req.type, req.id,
+                        AmConfig.node_id, req.lease_size, req.limit))
+    {
+        on_error("failed to post redis request");
+        return false;
+    }
+
+    return true;
+}
+
+bool LeaseResources::processRedisReply(RedisReplyEvent &reply)
+{
+    if(state == INITIAL) {
+        on_error("redis reply in the INITIAL state");
+    } else if(state == RENEW) {
+        long long granted_value;
+        if(reply.result != RedisReplyEvent::SuccessReply) {
+            on_error("reply error in the request: result_type %d", reply.result);
+        } else if(!reply.reply().isArray() || reply.reply().size() != 2 ||
+                  !reply.reply()[0].toInt(granted_value) ||
+                  !reply.reply()[1].toInt(total))
+        {
+            on_error("unexpected reply of resource_lease.lua");
+        } else {
+            granted = granted_value != 0;
+        }
+        state = FINISH;
+    }
+
+    return state == FINISH;
+}
+
+void LeaseResources::on_error(const char* error, ...)
+{
+    static char err[1024];
+
+    va_list argptr;
+    va_start (argptr, error);
+    vsprintf(err, error, argptr);
+    va_end(argptr);
+
+    ERROR("failed to renew lease for the resource %d:%d(%s)", req.type, req.id, err);
+
+    iserror = true;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Resource.h"
+#include "ResourceLeases.h"
 #include "../RedisConnectionPool.h"
 #include <ampi/JsonRPCEvents.h>
 
@@ -14,7 +15,9 @@ class ResourceSequenceBase
         REDIS_REPLY_INITIAL_SEQ = 1,
         REDIS_REPLY_OP_SEQ,
         REDIS_REPLY_GET_ALL_KEYS_SEQ,
-        REDIS_REPLY_CHECK_SEQ
+        REDIS_REPLY_CHECK_SEQ,
+        REDIS_REPLY_LEASE_SEQ,
+        REDIS_REPLY_LEASE_SCRIPT_LOAD
     };
 
   protected:
@@ -63,27 +66,51 @@ class InvalidateResources
     int get_state() { return state; }
 };
 
+/* applies queued GET/PUT operations as the single MULTI/EXEC transaction.
+ * operations are merged to the net delta per resource key (node field is always the same)
+ * and zero deltas are dropped, so +1/-1 pairs of the short calls do not reach redis.
+ * the whole transaction is posted at once to allow several batches in flight */
 class OperationResources
   : public ResourceSequenceBase
 {
+  public:
+    struct delta {
+        int type;
+        int id;
+        long long value;
+    };
+
+  private:
     enum {
         INITIAL = 0,
-        MULTI_START,
         OP_RES,
         FINISH
     } state;
-    ResourceOperationList res_list;
+    vector<delta> deltas;
+    size_t operations_count;
     bool iserror;
+    unsigned int generation;
+    //replies can come while perform() is still posting the commands
+    AmMutex commands_mutex;
 
   public:
-    OperationResources(ResourceRedisConnection* conn, const ResourceOperationList& rl);
+    OperationResources(ResourceRedisConnection* conn, const ResourceOperationList& rl,
+                       unsigned int generation = 0);
 
+    /* returns false if there is nothing to write or nothing is posted.
+     * sequence must be deleted by caller.
+     * on the partially posted transaction the sequence finishes with error */
     bool perform() override;
     bool processRedisReply(RedisReplyEvent &reply) override;
     void on_error(const char* error, ...);
 
     bool is_finish() { return state == FINISH; }
     bool is_error() { return iserror; }
+
+    const vector<delta> &get_deltas() const { return deltas; }
+    size_t get_operations_count() const { return operations_count; }
+    //write connection generation at the creation time
+    unsigned int get_generation() const { return generation; }
 };
 
 class GetAllResources
@@ -149,3 +176,35 @@ class CheckResources
     bool is_error() { return iserror; }
     AmArg get_result() { return result; }
 };
+
+/* renews the lease with resource_lease.lua on the write connection.
+ * the script sums the usage of all nodes and increments the node field
+ * only if the block fits into the limit, so the concurrent renewals
+ * from the several nodes can not exceed it. see ResourceLeases */
+class LeaseResources
+  : public ResourceSequenceBase
+{
+    enum {
+        INITIAL = 0,
+        RENEW,
+        FINISH
+    } state;
+    ResourceLeases::renew_request req;
+    bool iserror;
+    bool granted;
+    long long total;
+
+  public:
+    LeaseResources(ResourceRedisConnection* conn, const ResourceLeases::renew_request &req);
+
+    bool perform() override;
+    bool processRedisReply(RedisReplyEvent &reply) override;
+    void on_error(const char* error, ...);
+
+    bool is_finish() { return state == FINISH; }
+    bool is_error() { return iserror; }
+    const ResourceLeases::renew_request &get_request() const { return req; }
+    //block is already added to the node field if granted
+    bool is_granted() const { return granted; }
+    long long get_total() const { return total; }
+};
@@ -2,10 +2,13 @@
 #include "log.h"
 
 #include <algorithm>
+#include <strings.h>
 #include "SDPFilter.h"
 #include "CodecsGroup.h"
 #include "CodesTranslator.h"
 #include "CallLeg.h"
+#include "AmStatistics.h"
+#include "stats/StatsRegistry.h"
 
 #define DBG_SDP_PROCESSING
 
@@ -94,44 +97,61 @@ void dump_Sdp(const AmSdp &sdp,const string &prefix) {
 	dump_SdpMedia(sdp.media,prefix);
 }
 
-static const SdpPayload *findPayload(const std::vector<SdpPayload>& payloads, const SdpPayload &payload, int transport)
+static void lowercase_payloads_names(const std::vector<SdpPayload>& payloads, std::vector<string> &names)
+{
+	names.resize(payloads.size());
+	for(size_t i = 0; i < payloads.size(); i++) {
+		const string &src = payloads[i].encoding_name;
+		string &dst = names[i];
+		dst.resize(src.size());
+		transform(src.begin(), src.end(), dst.begin(), ::tolower);
+	}
+}
+
+/* static payload types are matched by the type or by the name.
+ * others by the name only */
+static inline bool is_static_payload(const SdpPayload &payload, int transport)
+{
+	return (transport == TP_RTPAVP || transport == TP_RTPAVPF ||
+			transport == TP_RTPSAVP || transport == TP_RTPSAVPF ||
+			transport == TP_UDPTLSRTPSAVP || transport == TP_UDPTLSRTPSAVPF)
+		&& payload.payload_type >= 0
+		&& payload.payload_type < DYNAMIC_PAYLOAD_TYPE_START;
+}
+
+/* payloads_names and pname are keys of the encoding names
+ * of the payloads and payload correspondingly:
+ * lowercased names or codec ids of the CodecsGroupEntry */
+template<typename NameKey>
+static const SdpPayload *findPayload(
+	const std::vector<SdpPayload>& payloads, const std::vector<NameKey> &payloads_names,
+	const SdpPayload &payload, const NameKey &pname, int transport)
 {
 //#define DBG_FP(...) DBG(__VA_ARGS__)
 #define DBG_FP(...) ;
 
-	string pname = payload.encoding_name;
-	transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
-
 	DBG_FP("findPayload: payloads[%p] transport = %d, payload = {%d,'%s'/%d/%d}",
 		&payloads,transport,
 		payload.payload_type,payload.encoding_name.c_str(),
 		payload.clock_rate,payload.encoding_param);
 
-	bool static_payload =
-		((transport == TP_RTPAVP || transport == TP_RTPAVPF ||
-		  transport == TP_RTPSAVP || transport == TP_RTPSAVPF ||
-		  transport == TP_UDPTLSRTPSAVP || transport == TP_UDPTLSRTPSAVPF)
-		 && payload.payload_type >= 0
-		 && payload.payload_type < DYNAMIC_PAYLOAD_TYPE_START);
+	bool static_payload = is_static_payload(payload, transport);
 
-	for (vector<SdpPayload>::const_iterator p = payloads.begin(); p != payloads.end(); ++p) {
+	for (size_t i = 0; i < payloads.size(); i++) {
+		const SdpPayload *p = &payloads[i];
 		DBG_FP("findPayload: next payload payload = {%d,'%s'/%d/%d}",
 			p->payload_type,p->encoding_name.c_str(),
 			p->clock_rate, p->encoding_param);
 		// fix for clients using non-standard names for static payload type (SPA504g: G729a)
 		if (static_payload) {
 			if (payload.payload_type != p->payload_type) {
-				string s = p->encoding_name;
-				transform(s.begin(), s.end(), s.begin(), ::tolower);
-				if (s != pname) {
+				if (payloads_names[i] != pname) {
 					DBG_FP("findPayload: static payload. types not matched. names not matched");
 					continue;
 				}
 			}
 		} else {
-			string s = p->encoding_name;
-			transform(s.begin(), s.end(), s.begin(), ::tolower);
-			if (s != pname){
+			if (payloads_names[i] != pname){
 				DBG_FP("findPayload: dynamic payload. names not matched");
 				continue;
 			}
@@ -146,12 +166,23 @@ static const SdpPayload *findPayload(const std::vector<SdpPayload>& payloads, co
 			continue;
 		}
 		DBG_FP("findPayload: payloads matched");
-		return &(*p);
+		return p;
 	}
 	return NULL;
 #undef DBG_FP
 }
 
+static const SdpPayload *findPayload(const std::vector<SdpPayload>& payloads, const SdpPayload &payload, int transport)
+{
+	std::vector<string> payloads_names;
+	lowercase_payloads_names(payloads, payloads_names);
+
+	string pname = payload.encoding_name;
+	transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
+
+	return findPayload(payloads, payloads_names, payload, pname, transport);
+}
+
 static bool containsPayload(const std::vector<SdpPayload>& payloads, const SdpPayload &payload, int transport)
 {
 	return findPayload(payloads, payload, transport) != NULL;
@@ -345,13 +376,11 @@ inline void clear_zrtp_params(AmSdp &sdp)
 }
 
 inline bool is_telephone_event(const SdpPayload &p){
-	string c = p.encoding_name;
-	std::transform(c.begin(), c.end(), c.begin(), ::toupper);
-	return (c==DTMF_ENCODING_NAME);
+	return 0==strcasecmp(p.encoding_name.c_str(), DTMF_ENCODING_NAME);
 }
 
 int filter_arrange_SDP(AmSdp& sdp,
-							  const std::vector<SdpPayload> &static_payloads,
+							  const CodecsGroupEntry &codecs_group,
 							  bool add_codecs)
 {
 	//DBG("filter_arrange_SDP() add_codecs = %s", add_codecs?"yes":"no");
@@ -361,6 +390,14 @@ int filter_arrange_SDP(AmSdp& sdp,
 	int media_idx = 0;
 	int stream_idx = 0;
 
+	const std::vector<SdpPayload> &static_payloads = codecs_group.get_payloads();
+	const std::vector<unsigned int> &static_payloads_ids = codecs_group.get_payloads_ids();
+	//media payloads names resolved to the group codec ids once per media
+	std::vector<string> media_payloads_names;
+	std::vector<unsigned int> media_payloads_ids;
+	//group codec ids present in the media
+	std::vector<bool> media_ids_present;
+
 	DBG_SDP(sdp,"filter_arrange_SDP_in");
 
 	for (vector<SdpMedia>::iterator m_it =
@@ -374,10 +411,25 @@ int filter_arrange_SDP(AmSdp& sdp,
 			continue;
 		}
 
+		lowercase_payloads_names(media.payloads, media_payloads_names);
+		media_payloads_ids.resize(media_payloads_names.size());
+		media_ids_present.assign(codecs_group.get_codecs_ids_count(), false);
+		for(size_t i = 0; i < media_payloads_names.size(); i++) {
+			auto id = codecs_group.get_codec_id(media_payloads_names[i]);
+			media_payloads_ids[i] = id;
+			if(id != CODEC_ID_UNKNOWN) media_ids_present[id] = true;
+		}
+		new_pl.reserve(static_payloads.size());
+
 		for(vector<SdpPayload>::const_iterator f_it = static_payloads.begin();
 			f_it != static_payloads.end(); ++f_it)
 		{ //iterate over arranged(!) filter entries
-			const SdpPayload *p = findPayload(media.payloads,*f_it,media.transport);
+			unsigned int id = static_payloads_ids[f_it - static_payloads.begin()];
+			//not static payloads are matched by the name only
+			const SdpPayload *p =
+				(media_ids_present[id] || is_static_payload(*f_it, media.transport)) ?
+				findPayload(media.payloads, media_payloads_ids, *f_it, id, media.transport) :
+				NULL;
 			if(p!=NULL){
 				/*! TODO: should be changed to replace with params from codec group */
 				if(add_codecs){
@@ -411,7 +463,7 @@ int filter_arrange_SDP(AmSdp& sdp,
 			media_line_left = true;
 		}
 
-		media.payloads = new_pl;
+		media.payloads.swap(new_pl);
 		media_idx++;
 		stream_idx++;
 	}
@@ -497,6 +549,25 @@ inline void reduce_codecs_to_single(std::vector<SdpMedia> &media){
 	}
 }
 
+static AtomicCounter &sdp_offer_cache_hits()
+{
+	static AtomicCounter &c = stat_group(Counter, "yeti", "sdp_offer_cache_hits").addAtomicCounter();
+	return c;
+}
+
+static AtomicCounter &sdp_offer_cache_misses()
+{
+	static AtomicCounter &c = stat_group(Counter, "yeti", "sdp_offer_cache_misses").addAtomicCounter();
+	return c;
+}
+
+static LatencyHistogram &sdp_processing_latency()
+{
+	static LatencyHistogram &h = StatsRegistry::instance()->histogram(
+		"sdp_processing_latency", "SDP offer/answer processing latency");
+	return h;
+}
+
 int processSdpOffer(SBCCallLeg *call,
 					SBCCallProfile &call_profile,
 					AmMimeBody &body, string &method,
@@ -517,8 +588,29 @@ int processSdpOffer(SBCCallLeg *call,
 			return 0;
 	}
 
+	LatencyTimer latency_timer(sdp_processing_latency());
+
+	CodecsGroupEntryPtr codecs_group = CodecsGroups::instance()->get(static_codecs_id);
+
+	/* local processing depends on negotiated_media,
+	 * so only relayed offers are cached */
+	SdpOfferCache &cache = call->getSdpOfferCache();
+	std::string_view offer(reinterpret_cast<const char *>(sdp_body->getPayload()));
+	size_t offer_hash = 0;
+	if(!local) {
+		offer_hash = SdpOfferCache::hash(offer);
+		if(cache.match(offer_hash, offer, codecs_group, single_codec)) {
+			DBG("processSdpOffer() same offer as the previous one. reuse processing result");
+			sdp_offer_cache_hits().inc();
+			negotiated_media = cache.negotiated_media;
+			sdp_body->setPayload((const unsigned char*)cache.body.c_str(), cache.body.length());
+			sdp_body->normalizeContentType();
+			return 0;
+		}
+	}
+
 	AmSdp sdp;
-	int res = sdp.parse((const char *)sdp_body->getPayload());
+	int res = sdp.parse(offer.data());
 	if (0 != res) {
 		DBG("SDP parsing failed during body filtering!");
 		return DC_REPLY_SDP_PARSING_FAILED;
@@ -548,12 +640,7 @@ int processSdpOffer(SBCCallLeg *call,
 		}
 	}
 
-	CodecsGroupEntry codecs_group;
-	CodecsGroups::instance()->get(static_codecs_id, codecs_group);
-
-	vector<SdpPayload> static_codecs_filter = codecs_group.get_payloads();
-
-	res = filter_arrange_SDP(sdp,static_codecs_filter, false);
+	res = filter_arrange_SDP(sdp, *codecs_group, false);
 	if(0 != res){
 		return res;
 	}
@@ -597,11 +684,23 @@ int processSdpOffer(SBCCallLeg *call,
 	//save negotiated result for the future usage
 	negotiated_media = sdp.media;
 
-	DBG_SDP_PAYLOAD(static_codecs_filter,"static_codecs_filter");
+	DBG_SDP_PAYLOAD(codecs_group->get_payloads(),"static_codecs_filter");
 	DBG_SDP(sdp,"negotiateRequestSdp");
 
 	string n_body;
 	sdp.print(n_body);
+
+	if(!local) {
+		sdp_offer_cache_misses().inc();
+		cache.valid = true;
+		cache.offer_hash = offer_hash;
+		cache.offer.assign(offer);
+		cache.codecs_group = codecs_group;
+		cache.single_codec = single_codec;
+		cache.body = n_body;
+		cache.negotiated_media = negotiated_media;
+	}
+
 	sdp_body->setPayload((const unsigned char*)n_body.c_str(), n_body.length());
 	sdp_body->normalizeContentType();
 
@@ -631,6 +730,8 @@ int filterSdpOffer(SBCCallLeg *call,
 			return 0;
 	}
 
+	LatencyTimer latency_timer(sdp_processing_latency());
+
 	AmSdp sdp;
 	int res = sdp.parse((const char *)sdp_body->getPayload());
 	if (0 != res) {
@@ -645,13 +746,10 @@ int filterSdpOffer(SBCCallLeg *call,
 		call->normalizeSdpVersion(sdp.origin.sessV, sip_msg.cseq, true);
 	}
 
-	CodecsGroupEntry codecs_group;
-	CodecsGroups::instance()->get(static_codecs_id,codecs_group);
-
-	std::vector<SdpPayload> &static_codecs = codecs_group.get_payloads();
+	CodecsGroupEntryPtr codecs_group = CodecsGroups::instance()->get(static_codecs_id);
 
 	res = filter_arrange_SDP(
-		sdp,static_codecs,
+		sdp,*codecs_group,
 		call_profile.rtprelay_enabled /*  do not add new codecs if media proxifying is disabled */);
 	if(0 != res)
 		return res;
@@ -847,6 +945,8 @@ int processSdpAnswer(SBCCallLeg *call,
 		return 0;
 	}
 
+	LatencyTimer latency_timer(sdp_processing_latency());
+
 	bool a_leg = call->isALeg();
 	SBCCallProfile &call_profile = call->getCallProfile();
 
@@ -8,6 +8,7 @@ using std::vector;
 
 #include <AmSdp.h>
 #include "SBCCallLeg.h"
+#include "CodecsGroup.h"
 
 #define DTMF_ENCODING_NAME "TELEPHONE-EVENT"
 
@@ -32,7 +33,7 @@ int cutNoAudioStreams(AmSdp &sdp, bool cut);
 
 int filter_arrange_SDP(
 		AmSdp& sdp,
-		const std::vector<SdpPayload> &static_payloads,
+		const CodecsGroupEntry &codecs_group,
 		bool add_codecs);
 
 int processSdpOffer(
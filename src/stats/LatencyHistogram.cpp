@@ -0,0 +1,138 @@
+#include "LatencyHistogram.h"
+
+#include <cmath>
+#include <limits>
+
+LatencyHistogram::Snapshot::Snapshot()
+  : counts(buckets_count, 0),
+    count(0),
+    sum(0),
+    min(0),
+    max(0)
+{}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double q) const
+{
+    if(!count) return 0;
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * count));
+    if(!rank) rank = 1;
+
+    uint64_t n = 0;
+    for(unsigned int i = 0; i < buckets_count; i++) {
+        n += counts[i];
+        if(n >= rank)
+            return std::min(bucketUpperBound(i), max);
+    }
+    return max;
+}
+
+uint64_t LatencyHistogram::Snapshot::countBelow(uint64_t value) const
+{
+    uint64_t n = 0;
+    for(unsigned int i = 0; i < buckets_count && bucketUpperBound(i) <= value; i++)
+        n += counts[i];
+    return n;
+}
+
+LatencyHistogram::Shard::Shard()
+{
+    reset();
+}
+
+void LatencyHistogram::Shard::reset()
+{
+    for(auto &c : counts)
+        c.store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+unsigned int LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if(value < sub_buckets)
+        return static_cast<unsigned int>(value);
+
+    unsigned int exponent = 63 - __builtin_clzll(value);
+    if(exponent > max_exponent)
+        return buckets_count - 1;
+
+    unsigned int sub = (value >> (exponent - sub_bucket_bits)) & (sub_buckets - 1);
+    return (exponent - sub_bucket_bits + 1) * sub_buckets + sub;
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(unsigned int index)
+{
+    if(index < sub_buckets)
+        return index;
+
+    unsigned int exponent = index / sub_buckets + sub_bucket_bits - 1;
+    uint64_t sub = index % sub_buckets;
+    return (sub_buckets + sub) << (exponent - sub_bucket_bits);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(unsigned int index)
+{
+    if(index < sub_buckets)
+        return index;
+
+    unsigned int exponent = index / sub_buckets + sub_bucket_bits - 1;
+    return bucketLowerBound(index) + (1ULL << (exponent - sub_bucket_bits)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t us)
+{
+    auto &s = shards[stats_shard_index() % STATS_HISTOGRAM_SHARDS];
+
+    s.counts[bucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    s.sum.fetch_add(us, std::memory_order_relaxed);
+
+    auto v = s.max.load(std::memory_order_relaxed);
+    while(us > v && !s.max.compare_exchange_weak(v, us, std::memory_order_relaxed));
+
+    v = s.min.load(std::memory_order_relaxed);
+    while(us < v && !s.min.compare_exchange_weak(v, us, std::memory_order_relaxed));
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot ret;
+    uint64_t min = std::numeric_limits<uint64_t>::max();
+
+    for(const auto &s : shards) {
+        for(unsigned int i = 0; i < buckets_count; i++)
+            ret.counts[i] += s.counts[i].load(std::memory_order_relaxed);
+        ret.count += s.count.load(std::memory_order_relaxed);
+        ret.sum += s.sum.load(std::memory_order_relaxed);
+        min = std::min(min, s.min.load(std::memory_order_relaxed));
+        ret.max = std::max(ret.max, s.max.load(std::memory_order_relaxed));
+    }
+
+    if(ret.count) ret.min = min;
+
+    return ret;
+}
+
+void LatencyHistogram::reset()
+{
+    for(auto &s : shards)
+        s.reset();
+}
+
+void LatencyHistogram::getStats(AmArg &ret) const
+{
+    auto s = snapshot();
+
+    ret["count"] = static_cast<long long>(s.count);
+    ret["sum_us"] = static_cast<long long>(s.sum);
+    ret["min_us"] = static_cast<long long>(s.min);
+    ret["max_us"] = static_cast<long long>(s.max);
+    ret["avg_us"] = s.count ? static_cast<double>(s.sum) / s.count : 0.0;
+    ret["p50_us"] = static_cast<long long>(s.percentile(0.5));
+    ret["p90_us"] = static_cast<long long>(s.percentile(0.9));
+    ret["p99_us"] = static_cast<long long>(s.percentile(0.99));
+    ret["p999_us"] = static_cast<long long>(s.percentile(0.999));
+}
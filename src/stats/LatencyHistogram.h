@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ShardedCounter.h"
+#include "AmArg.h"
+
+#include <chrono>
+#include <vector>
+
+#define STATS_HISTOGRAM_SHARDS 8
+
+/* HDR-style log-linear latency histogram in microseconds.
+ *
+ * values below 2^sub_bucket_bits are counted exactly, each power of two
+ * above is split into 2^sub_bucket_bits linear sub-buckets
+ * (relative error is below 1/2^sub_bucket_bits, ~3%).
+ * values above 2^(max_exponent+1) us (~38 hours) go to the last bucket.
+ *
+ * record() is lock-free and updates only the shard of the calling thread */
+class LatencyHistogram
+{
+  public:
+    static constexpr unsigned int sub_bucket_bits = 5;
+    static constexpr unsigned int sub_buckets = 1 << sub_bucket_bits;
+    static constexpr unsigned int max_exponent = 36;
+    static constexpr unsigned int buckets_count =
+        (max_exponent - sub_bucket_bits + 2) * sub_buckets;
+
+    struct Snapshot {
+        std::vector<uint64_t> counts;
+        uint64_t count;
+        uint64_t sum;
+        uint64_t min;
+        uint64_t max;
+
+        Snapshot();
+        //upper bound of the bucket with the q-th quantile. 0 if empty
+        uint64_t percentile(double q) const;
+        /* count of the values in the buckets which are entirely not greater
+         * than the value (prometheus 'le'). never counts values above it */
+        uint64_t countBelow(uint64_t value) const;
+    };
+
+  private:
+    struct alignas(STATS_CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> counts[buckets_count];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> min;
+        std::atomic<uint64_t> max;
+        Shard();
+        void reset();
+    };
+    Shard shards[STATS_HISTOGRAM_SHARDS];
+
+  public:
+    static unsigned int bucketIndex(uint64_t value);
+    static uint64_t bucketLowerBound(unsigned int index);
+    static uint64_t bucketUpperBound(unsigned int index);
+
+    void record(uint64_t us);
+    template<typename Rep, typename Period>
+    void record(std::chrono::duration<Rep, Period> d)
+    {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        record(us > 0 ? static_cast<uint64_t>(us) : 0);
+    }
+
+    Snapshot snapshot() const;
+    //not atomic with concurrent record()
+    void reset();
+
+    //count, sum_us, min_us, max_us, avg_us, p50, p90, p99, p999
+    void getStats(AmArg &ret) const;
+};
+
+/* records the scope execution time */
+class LatencyTimer
+{
+    LatencyHistogram &histogram;
+    std::chrono::steady_clock::time_point start;
+
+  public:
+    LatencyTimer(LatencyHistogram &histogram)
+      : histogram(histogram),
+        start(std::chrono::steady_clock::now())
+    {}
+
+    ~LatencyTimer()
+    {
+        histogram.record(std::chrono::steady_clock::now() - start);
+    }
+};
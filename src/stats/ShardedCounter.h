@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#define STATS_SHARDS 16
+#define STATS_CACHE_LINE_SIZE 64
+
+/* threads are assigned to the shards round-robin on the first use.
+ * shards are cache line aligned so hot path updates from the different
+ * threads do not contend on the same atomic or cache line */
+inline unsigned int stats_shard_index()
+{
+    static std::atomic<unsigned int> next_shard(0);
+    thread_local unsigned int shard = next_shard.fetch_add(1, std::memory_order_relaxed) % STATS_SHARDS;
+    return shard;
+}
+
+class ShardedCounter
+{
+    struct alignas(STATS_CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> value;
+        Shard(): value(0) {}
+    };
+    Shard shards[STATS_SHARDS];
+
+  public:
+    void inc(uint64_t n = 1)
+    {
+        shards[stats_shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t get() const
+    {
+        uint64_t ret = 0;
+        for(const auto &s : shards)
+            ret += s.value.load(std::memory_order_relaxed);
+        return ret;
+    }
+
+    //not atomic with concurrent inc()
+    void reset()
+    {
+        for(auto &s : shards)
+            s.value.store(0, std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,102 @@
+#include "StatsRegistry.h"
+
+const std::vector<uint64_t> _StatsRegistry::exported_buckets = {
+    100, 250, 500,
+    1000, 2500, 5000,
+    10000, 25000, 50000,
+    100000, 250000, 500000,
+    1000000, 2500000, 5000000,
+    10000000
+};
+
+_StatsRegistry::CounterEntry::CounterEntry(const string &name)
+  : exported(stat_group(Counter, "yeti", name).addAtomicCounter()),
+    flushed(0)
+{}
+
+_StatsRegistry::HistogramEntry::HistogramEntry(const string &name)
+  : count(stat_group(Counter, "yeti", name + "_count").addAtomicCounter()),
+    sum(stat_group(Counter, "yeti", name + "_sum").addAtomicCounter()),
+    flushed_count(0),
+    flushed_sum(0),
+    flushed_buckets(exported_buckets.size() + 1, 0)
+{
+    for(auto le : exported_buckets) {
+        buckets.push_back(&stat_group(Counter, "yeti", name + "_bucket").addAtomicCounter()
+            .addLabel("le", std::to_string(le)));
+    }
+    buckets.push_back(&stat_group(Counter, "yeti", name + "_bucket").addAtomicCounter()
+        .addLabel("le", "+Inf"));
+}
+
+void _StatsRegistry::flush_delta(AtomicCounter &c, uint64_t value, uint64_t &flushed)
+{
+    //value decreases only after reset. skip the period
+    if(value > flushed)
+        c.inc(value - flushed);
+    flushed = value;
+}
+
+ShardedCounter &_StatsRegistry::counter(const string &name, const string &help)
+{
+    AmLock l(mutex);
+
+    auto it = counters.find(name);
+    if(it != counters.end())
+        return it->second->counter;
+
+    auto &e = counters.emplace(name, std::make_unique<CounterEntry>(name)).first->second;
+    if(!help.empty())
+        stat_group(Counter, "yeti", name).setHelp(help);
+
+    return e->counter;
+}
+
+LatencyHistogram &_StatsRegistry::histogram(const string &name, const string &help)
+{
+    AmLock l(mutex);
+
+    auto it = histograms.find(name);
+    if(it != histograms.end())
+        return it->second->histogram;
+
+    auto &e = histograms.emplace(name, std::make_unique<HistogramEntry>(name)).first->second;
+    if(!help.empty()) {
+        stat_group(Counter, "yeti", name + "_bucket").setHelp(help + " (microseconds)");
+        stat_group(Counter, "yeti", name + "_count").setHelp(help + ". samples count");
+        stat_group(Counter, "yeti", name + "_sum").setHelp(help + ". sum in microseconds");
+    }
+
+    return e->histogram;
+}
+
+void _StatsRegistry::flush()
+{
+    AmLock l(mutex);
+
+    for(auto &it : counters) {
+        auto &e = *it.second;
+        flush_delta(e.exported, e.counter.get(), e.flushed);
+    }
+
+    for(auto &it : histograms) {
+        auto &e = *it.second;
+        auto s = e.histogram.snapshot();
+
+        flush_delta(e.count, s.count, e.flushed_count);
+        flush_delta(e.sum, s.sum, e.flushed_sum);
+
+        for(size_t i = 0; i < exported_buckets.size(); i++)
+            flush_delta(*e.buckets[i], s.countBelow(exported_buckets[i]), e.flushed_buckets[i]);
+        flush_delta(*e.buckets.back(), s.count, e.flushed_buckets.back());
+    }
+}
+
+void _StatsRegistry::getHistograms(AmArg &ret)
+{
+    ret.assertStruct();
+
+    AmLock l(mutex);
+    for(auto &it : histograms)
+        it.second->histogram.getStats(ret[it.first]);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ShardedCounter.h"
+#include "LatencyHistogram.h"
+
+#include "AmArg.h"
+#include "AmThread.h"
+#include "AmStatistics.h"
+#include <singleton.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using std::string;
+
+/* instrumentation surface for the hot paths.
+ *
+ * counters and histograms are created once by name and updated lock-free.
+ * values are exported to AmStatistics as 'yeti' counters by flush():
+ *   <name> for counters,
+ *   <name>_bucket{le="<us>"}, <name>_count, <name>_sum for histograms (microseconds)
+ * and 'show stats histograms' provides the percentiles */
+class _StatsRegistry
+{
+    struct CounterEntry {
+        ShardedCounter counter;
+        AtomicCounter &exported;
+        uint64_t flushed;
+        CounterEntry(const string &name);
+    };
+
+    struct HistogramEntry {
+        LatencyHistogram histogram;
+        AtomicCounter &count;
+        AtomicCounter &sum;
+        std::vector<AtomicCounter *> buckets;
+        uint64_t flushed_count;
+        uint64_t flushed_sum;
+        std::vector<uint64_t> flushed_buckets;
+        HistogramEntry(const string &name);
+    };
+
+    AmMutex mutex;
+    std::map<string, std::unique_ptr<CounterEntry>> counters;
+    std::map<string, std::unique_ptr<HistogramEntry>> histograms;
+
+    static void flush_delta(AtomicCounter &c, uint64_t value, uint64_t &flushed);
+
+  public:
+    //upper bounds in microseconds for the exported histograms buckets
+    static const std::vector<uint64_t> exported_buckets;
+
+    //returns the existent one for the same name
+    ShardedCounter &counter(const string &name, const string &help = string());
+    LatencyHistogram &histogram(const string &name, const string &help = string());
+
+    //export accumulated values to AmStatistics. called periodically from the Yeti thread
+    void flush();
+
+    void getHistograms(AmArg &ret);
+};
+
+typedef singleton<_StatsRegistry> StatsRegistry;
@@ -38,6 +38,9 @@
 #define DEFAULT_REGISTRAR_KEEPALIVE_INTERVAL 60
 
 #define DEFAULT_REGISTRAR_EXPIRES 1800
+#define DEFAULT_REGISTRAR_AOR_CACHE_TTL 60
+
+#define DEFAULT_CALLS_SHOW_LIMIT 100
 
 #define YETI_SIGNATURE "yeti-switch"
 #define YETI_AGENT_SIGNATURE YETI_SIGNATURE " " YETI_VERSION
@@ -97,7 +100,9 @@ Yeti::Counters::Counters()
     identity_failed_cert_invalid(stat_group(Counter,MOD_NAME, "identity_headers_failed").addAtomicCounter()
         .addLabel("reason","cert_invalid")),
     identity_failed_cert_not_available(stat_group(Counter,MOD_NAME, "identity_headers_failed").addAtomicCounter()
-        .addLabel("reason","cert_not_available"))
+        .addLabel("reason","cert_not_available")),
+    identity_verify_latency(StatsRegistry::instance()->histogram(
+        "identity_verify_latency", "identity headers signature verification latency"))
 {}
 
 Yeti::Yeti()
@@ -155,6 +160,25 @@ int Yeti::configure(const std::string& config_buf)
         config.identity_enabled = false;
     }
 
+    if(!config.db_snapshot_dir.empty()) {
+        //ignore snapshots written for another node, pop or routing DB
+        db_snapshot.configure(
+            config.db_snapshot_dir,
+            std::to_string(AmConfig.node_id) + "/" + std::to_string(config.pop_id) + "/" +
+            config.routing_db_master.host + ":" + std::to_string(config.routing_db_master.port) + "/" +
+            config.routing_db_master.name + "/" + config.routing_schema);
+    }
+
+    if(cps_limiter.configure(confuse_cfg)) {
+        ERROR("failed to configure CPS limiter");
+        return -1;
+    }
+
+    if(call_setup_traces.configure(confuse_cfg)) {
+        ERROR("failed to configure call setup tracing");
+        return -1;
+    }
+
     return 0;
 }
 
@@ -180,6 +204,7 @@ int Yeti::onLoad()
 {
     makeRedisInstance(false);
     start_time = time(nullptr);
+    startup.load_start = std::chrono::steady_clock::now();
 
     cfg.dump();
 
@@ -196,7 +221,12 @@ int Yeti::onLoad()
 
     start(); //start yeti thread
 
-    calls_show_limit = static_cast<int>(cfg.getParameterInt("calls_show_limit",100));
+    calls_show_limit = static_cast<int>(cfg.getParameterInt("calls_show_limit",DEFAULT_CALLS_SHOW_LIMIT));
+    if(calls_show_limit <= 0) {
+        WARN("invalid calls_show_limit value: %d. must be positive. use default %d",
+             calls_show_limit, DEFAULT_CALLS_SHOW_LIMIT);
+        calls_show_limit = DEFAULT_CALLS_SHOW_LIMIT;
+    }
 
     /*if(TrustedHeaders::instance()->configure(cfg)){
         ERROR("TrustedHeaders configure failed");
@@ -269,6 +299,9 @@ int Yeti::onLoad()
     each_second_timer.link(epoll_fd);
     each_second_timer.set(1e6 /* 1 second */,true);
 
+    radius_interim_timer.link(epoll_fd);
+    radius_interim_timer.set(RADIUS_INTERIM_TICK_MSEC*1000,true);
+
     db_cfg_reload_timer.link(epoll_fd);
     db_cfg_reload_timer.set(
         std::chrono::duration_cast<std::chrono::microseconds>(config.db_refresh_interval).count(),
@@ -282,10 +315,33 @@ int Yeti::onLoad()
     if(cdr_list.getSnapshotsEnabled())
         cdr_list.start();
 
+    //serve from the local snapshots until check_states() reply
+    loadDbCfgSnapshots();
+
     configuration_finished = true;
+    startup.configured_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startup.load_start).count();
+    INFO("configured in %ld ms", startup.configured_ms.load());
 
     onDbCfgReloadTimer();
 
+    if(!config.db_notify_channel.empty()) {
+        if(db_notify_listener.configure(
+            config.routing_db_master.conn_str(), config.db_notify_channel,
+            [](const string &payload) {
+                Yeti::instance().postEvent(new DbConfigNotifyEvent(payload));
+            },
+            []() {
+                //request check_states() for the changes missed while disconnected
+                Yeti::instance().postEvent(new DbConfigNotifyEvent(string()));
+            }))
+        {
+            ERROR("failed to configure db notify listener");
+            return -1;
+        }
+        db_notify_listener.start();
+    }
+
     return 0;
 }
 
@@ -302,6 +358,13 @@ int Yeti::configure_registrar()
     config.registrar_redis_port = cfg.getParameterInt("registrar_redis_port");
     if(!config.registrar_redis_port) config.registrar_redis_port = DEFAULT_REDIS_PORT;
 
+    config.registrar_redis_io_threads = cfg.getParameterInt("registrar_redis_io_threads");
+    if(config.registrar_redis_io_threads < 0) {
+        ERROR("invalid registrar redis io_threads: %d", config.registrar_redis_io_threads);
+        return -1;
+    }
+    registrar_redis.set_io_threads(static_cast<unsigned int>(config.registrar_redis_io_threads));
+
     config.registrar_keepalive_interval =
         cfg.getParameterInt("registrar_keepalive_interval", DEFAULT_REGISTRAR_KEEPALIVE_INTERVAL);
     if(config.registrar_keepalive_interval) config.registrar_keepalive_interval =
@@ -329,10 +392,21 @@ int Yeti::configure_registrar()
         return -1;
     }
 
+    config.registrar_aor_cache = cfg.getParameterInt("registrar_aor_cache");
+    config.registrar_aor_cache_ttl =
+        cfg.getParameterInt("registrar_aor_cache_ttl", DEFAULT_REGISTRAR_AOR_CACHE_TTL);
+    DBG("registrar_aor_cache: %d, ttl: %d",
+        config.registrar_aor_cache, config.registrar_aor_cache_ttl);
+
+    registrar_redis.getAorCache().configure(
+        config.registrar_aor_cache,
+        std::chrono::seconds(config.registrar_aor_cache_ttl));
+
+    //AoR lookup cache relies on the keyspace events subscription
     if(0!=registrar_redis.init(
         config.registrar_redis_host,
         config.registrar_redis_port,
-        0!=config.registrar_keepalive_interval))
+        0!=config.registrar_keepalive_interval || config.registrar_aor_cache))
     {
         return -1;
     }
@@ -377,10 +451,15 @@ void Yeti::run()
             } else if(f==db_cfg_reload_timer) {
                 onDbCfgReloadTimer();
                 db_cfg_reload_timer.read();
+            } else if(f==radius_interim_timer) {
+                radius_interim.onTimer();
+                radius_interim_timer.read();
             } else if(f==each_second_timer) {
                 const auto now(std::chrono::system_clock::now());
                 if(config.identity_enabled)
                     cert_cache.onTimer(now);
+                router.onTimer();
+                StatsRegistry::instance()->flush();
                 each_second_timer.read();
             } else if(f == -queue_fd()) {
                 clear_pending();
@@ -400,6 +479,8 @@ void Yeti::on_stop()
 
     DBG("Yeti::on_stop");
 
+    if(db_notify_listener.isEnabled())
+        db_notify_listener.stop();
     cdr_list.stop();
     rctl.stop();
     router.stop();
@@ -412,6 +493,8 @@ void Yeti::on_stop()
 #pragma GCC diagnostic pop
 }
 
+#define DB_CFG_DELTA_TOKEN_SUFFIX ":delta"
+
 #define ON_EVENT_TYPE(type) if(type *e = dynamic_cast<type *>(ev))
 
 void Yeti::process(AmEvent *ev)
@@ -419,7 +502,7 @@ void Yeti::process(AmEvent *ev)
     ON_EVENT_TYPE(RedisReplyEvent) {
         /*DBG("got RedisReplyEvent id = %d data:\n%s",
             e->user_type_id,
-            AmArg::print(e->data).c_str());*/
+            AmArg::print(e->data()).c_str());*/
         switch(e->user_type_id) {
         case YETI_REDIS_REGISTER_TYPE_ID:
             processRedisRegisterReply(*e);
@@ -436,65 +519,47 @@ void Yeti::process(AmEvent *ev)
         cert_cache.processHttpReply(*e);
     } else
     ON_EVENT_TYPE(PGResponse) {
-        if(configuration_finished) {
+        if(SqlRouter::isCdrWriteToken(e->token)) {
+            router.onCdrWriteReply(e->token);
+        } else if(configuration_finished) {
             if(e->token == "check_states") {
                 onDbCfgReloadTimerResponse(*e);
             } else {
-                auto it = db_config_timer_mappings.find(e->token);
-                if(it != db_config_timer_mappings.end()) {
-                    bool exception = true;
-                    try {
-                        DBG("call on_db_response() for '%s'", e->token.data());
-                        it->second.on_db_response(*e);
-                        exception = false;
-                    } catch(AmArg::OutOfBoundsException &) {
-                        ERROR("AmArg::OutOfBoundsException in cfg timer handler: %s",
-                            e->token.data());
-                    } catch(AmArg::TypeMismatchException &) {
-                        ERROR("AmArg::TypeMismatchException in cfg timer handler: %s",
-                            e->token.data());
-                    } catch(std::exception &exception) {
-                        ERROR("std::exception in cfg timer handler '%s': %s",
-                            e->token.data(), exception.what());
-                    } catch(std::string &s) {
-                        ERROR("cfg timer handler %s exception: %s",
-                            e->token.data(), s.data());
-                    } catch(...) {
-                        ERROR("exception in cfg timer handler: %s", e->token.data());
-                    }
-
-                    if(exception) {
-                        it->second.exceptions_counter->inc();
-                    }
-                } else {
-                    ERROR("unknown db response token: %s", e->token.data());
-                }
+                onDbCfgResponse(*e);
             }
         } else {
-            sync_db.db_reply_token = e->token;
-            sync_db.db_reply_result = e->result;
-            sync_db.db_reply_condition.set(sync_db::DB_REPLY_RESULT);
+            sync_db.on_reply(e->token, sync_db::DB_REPLY_RESULT, &e->result);
         }
     } else
     ON_EVENT_TYPE(PGResponseError) {
+        if(SqlRouter::isCdrWriteToken(e->token)) {
+            //CDR writing errors are logged and handled by the CDR PG worker
+            return;
+        }
         ERROR("got PGResponseError '%s' for token: %s",
             e->error.data(), e->token.data());
         if(configuration_finished) {
-            //pass
+            onDbCfgResponseFailed(e->token);
         } else {
-            sync_db.db_reply_token = e->token;
-            sync_db.db_reply_condition.set(sync_db::DB_REPLY_ERROR);
+            sync_db.on_reply(e->token, sync_db::DB_REPLY_ERROR);
         }
     } else
     ON_EVENT_TYPE(PGTimeout) {
+        if(SqlRouter::isCdrWriteToken(e->token)) {
+            //CDR writing errors are logged and handled by the CDR PG worker
+            return;
+        }
         ERROR("got PGTimeout for token: %s", e->token.data());
         if(configuration_finished) {
-            //pass
+            onDbCfgResponseFailed(e->token);
         } else {
-            sync_db.db_reply_token = e->token;
-            sync_db.db_reply_condition.set(sync_db::DB_REPLY_TIMEOUT);
+            sync_db.on_reply(e->token, sync_db::DB_REPLY_TIMEOUT);
         }
     } else 
+    ON_EVENT_TYPE(DbConfigNotifyEvent) {
+        if(configuration_finished)
+            onDbCfgNotify(e->payload);
+    } else
     ON_EVENT_TYPE(YetiComponentInited) {
         component_inited[e->type] = true;
     } else
@@ -514,17 +579,18 @@ void Yeti::processRedisRegisterReply(RedisReplyEvent &e)
     static string expires_param_prefix = ";expires=";
 
     const AmSipRequest &req = *dynamic_cast<AmSipRequest *>(e.user_data.get());
-    //DBG("e.data: %s",AmArg::print(e.data).c_str());
+    //DBG("e.data: %s",AmArg::print(e.data()).c_str());
 
     if(RedisReplyEvent::SuccessReply!=e.result) {
         ERROR("error reply from redis %s. for request from %s:%hu",
-              AmArg::print(e.data).c_str(),
+              AmArg::print(e.data()).c_str(),
               req.remote_ip.data(), req.remote_port);
         AmSipDialog::reply_error(req, 500, SIP_REPLY_SERVER_INTERNAL_ERROR);
         return;
     }
 
-    if(isArgUndef(e.data)) {
+    RedisReplyView data = e.reply();
+    if(data.isNil()) {
         DBG("nil reply from redis. no bindings");
         AmSipDialog::reply_error(req, 200, "OK");
         return;
@@ -538,13 +604,13 @@ void Yeti::processRedisRegisterReply(RedisReplyEvent &e)
      * ]
      */
 
-    if(!isArgArray(e.data)) {
+    if(!data.isArray()) {
         ERROR("error/unexpected reply from redis: %s for request from %s:%hu. Contact:'%s'",
-              AmArg::print(e.data).c_str(),
+              AmArg::print(e.data()).c_str(),
               req.remote_ip.data(), req.remote_port,
               req.contact.data());
-        if(e.data.is<AmArg::CStr>()) {
-            AmSipDialog::reply_error(req, 500, e.data.asCStr());
+        if(data.isString()) {
+            AmSipDialog::reply_error(req, 500, string(data.str()));
         } else {
             AmSipDialog::reply_error(req, 500, SIP_REPLY_SERVER_INTERNAL_ERROR);
         }
@@ -552,27 +618,27 @@ void Yeti::processRedisRegisterReply(RedisReplyEvent &e)
     }
 
     string hdrs;
-    int n = static_cast<int>(e.data.size());
-    for(int i = 0; i < n; i++) {
-        AmArg &d = e.data[i];
-        if(!isArgArray(d) || d.size()!=5) {
-            ERROR("unexpected AoR layout in reply from redis: %s. skip it",AmArg::print(d).c_str());
+    size_t n = data.size();
+    for(size_t i = 0; i < n; i++) {
+        RedisReplyView d = data[i];
+        if(!d.isArray() || d.size()!=5) {
+            ERROR("unexpected AoR layout in reply from redis at %zd. skip it", i);
             continue;
         }
-        AmArg &contact_arg = d[0];
-        if(!isArgCStr(contact_arg)) {
+        RedisReplyView contact_arg = d[0];
+        if(!contact_arg.isString()) {
             ERROR("unexpected contact variable type from redis. skip it");
             continue;
         }
-        string contact = contact_arg.asCStr();
+        string contact(contact_arg.str());
         if(contact.empty()) {
             ERROR("empty contact in reply from redis. skip it");
             continue;
         }
 
-        AmArg &expires_arg = d[1];
-        if(!isArgLongLong(expires_arg)) {
-            ERROR("unexpected expires value in redis reply: %s, skip it",AmArg::print(expires_arg).c_str());
+        RedisReplyView expires_arg = d[1];
+        if(!expires_arg.isInteger()) {
+            ERROR("unexpected expires value type %d in redis reply. skip it", expires_arg.getType());
             continue;
         }
 
@@ -584,16 +650,17 @@ void Yeti::processRedisRegisterReply(RedisReplyEvent &e)
         }
 
         hdrs+=contact_hdr + c.print();
-        hdrs+=expires_param_prefix+longlong2str(expires_arg.asLongLong());
+        hdrs+=expires_param_prefix+longlong2str(expires_arg.integer());
         hdrs+=CRLF;
 
         //update KeepAliveContexts
-        if(config.registrar_keepalive_interval!=0) {
+        long long interface_id;
+        if(config.registrar_keepalive_interval!=0 && d[4].toInt(interface_id)) {
             registrar_redis.updateKeepAliveContext(
-                d[2].asCStr(),  //key
-                contact,        //aor
-                d[3].asCStr(),  //path
-                arg2int(d[4])   //interface_id
+                string(d[2].str()),                 //key
+                contact,                            //aor
+                string(d[3].str()),                 //path
+                static_cast<int>(interface_id)      //interface_id
             );
         }
     }
@@ -605,7 +672,7 @@ void Yeti::processRedisRpcAorLookupReply(RedisReplyEvent &e)
 {
     DBG("processRedisRpcAorLookupReply");
     auto &ctx = *dynamic_cast<RegistrarRedisConnection::RpcAorLookupCtx *>(e.user_data.release());
-    ctx.data = e.data;
+    ctx.data = e.data();
     ctx.result = e.result;
     DBG("ctx.cond: %p",&ctx.cond);
     ctx.cond.set(true);
@@ -625,36 +692,33 @@ void Yeti::initCfgTimerMappings()
         //cert_cache
         { "stir_shaken_trusted_certificates", {
             [&](const string &key) {
-                if(!config.identity_enabled)
-                    return;
                 yeti_routing_db_query(
                     "SELECT * FROM load_stir_shaken_trusted_certificates()", key);
             },
-            [&](const PGResponse &e) {
-                cert_cache.reloadTrustedCertificates(e.result);
-            }}
+            [&](const AmArg &result) {
+                cert_cache.reloadTrustedCertificates(result);
+            },
+            [&]() { return 0!=config.identity_enabled; }}
         },
         { "stir_shaken_trusted_repositories", {
             [&](const string &key) {
-                if(!config.identity_enabled)
-                    return;
                 yeti_routing_db_query(
                     "SELECT * FROM load_stir_shaken_trusted_repositories()", key);
             },
-            [&](const PGResponse &e) {
-                cert_cache.reloadTrustedRepositories(e.result);
-            }}
+            [&](const AmArg &result) {
+                cert_cache.reloadTrustedRepositories(result);
+            },
+            [&]() { return 0!=config.identity_enabled; }}
         },
         { "stir_shaken_signing_certificates", {
             [&](const string &key) {
-                if(!config.identity_enabled)
-                    return;
                 yeti_routing_db_query(
                     "SELECT * FROM load_stir_shaken_signing_certificates()", key);
             },
-            [&](const PGResponse &e) {
-                cert_cache.reloadSigningKeys(e.result);
-            }}
+            [&](const AmArg &result) {
+                cert_cache.reloadSigningKeys(result);
+            },
+            [&]() { return 0!=config.identity_enabled; }}
         },
 
         //orig_pre_auth
@@ -671,8 +735,8 @@ void Yeti::initCfgTimerMappings()
                 query->addParam(AmConfig.node_id).addParam(config.pop_id);
                 AmEventDispatcher::instance()->post(POSTGRESQL_QUEUE, query);
             },
-            [&](const PGResponse &e) {
-                orig_pre_auth.reloadLoadIPAuth(e.result);
+            [&](const AmArg &result) {
+                orig_pre_auth.reloadLoadIPAuth(result);
             }}
         },
         { "trusted_lb", {
@@ -680,8 +744,8 @@ void Yeti::initCfgTimerMappings()
                 yeti_routing_db_query(
                     "SELECT * FROM load_trusted_lb()", key);
             },
-            [&](const PGResponse &e) {
-                orig_pre_auth.reloadLoadBalancers(e.result);
+            [&](const AmArg &result) {
+                orig_pre_auth.reloadLoadBalancers(result);
             }}
         },
 
@@ -691,8 +755,8 @@ void Yeti::initCfgTimerMappings()
                 yeti_routing_db_query(
                     "SELECT * FROM load_sensor()", key);
             },
-            [&](const PGResponse &e) {
-                Sensors::instance()->load_sensors_config(e.result);
+            [&](const AmArg &result) {
+                Sensors::instance()->load_sensors_config(result);
             }}
         },
 
@@ -708,7 +772,7 @@ void Yeti::initCfgTimerMappings()
                     it->second.on_reload(it->first);
                 }
             },
-            [&](const PGResponse &) {
+            [&](const AmArg &) {
                 //never called. alias key
             }}
         },
@@ -717,8 +781,8 @@ void Yeti::initCfgTimerMappings()
                 yeti_routing_db_query(
                     "SELECT * FROM load_disconnect_code_rerouting()", key);
             },
-            [&](const PGResponse &e) {
-                CodesTranslator::instance()->load_disconnect_code_rerouting(e.result);
+            [&](const AmArg &result) {
+                CodesTranslator::instance()->load_disconnect_code_rerouting(result);
             }
         }},
         { "translations.dc_rewrite", {
@@ -726,8 +790,8 @@ void Yeti::initCfgTimerMappings()
                 yeti_routing_db_query(
                     "SELECT * FROM load_disconnect_code_rewrite()", key);
             },
-            [&](const PGResponse &e) {
-                CodesTranslator::instance()->load_disconnect_code_rewrite(e.result);
+            [&](const AmArg &result) {
+                CodesTranslator::instance()->load_disconnect_code_rewrite(result);
             }
         }},
         { "translations.dc_refuse", {
@@ -735,8 +799,8 @@ void Yeti::initCfgTimerMappings()
                 yeti_routing_db_query(
                     "SELECT * from load_disconnect_code_refuse()", key);
             },
-            [&](const PGResponse &e) {
-                CodesTranslator::instance()->load_disconnect_code_refuse(e.result);
+            [&](const AmArg &result) {
+                CodesTranslator::instance()->load_disconnect_code_refuse(result);
             }
         }},
         { "translations.dc_refuse_override", {
@@ -744,8 +808,8 @@ void Yeti::initCfgTimerMappings()
                 yeti_routing_db_query(
                     "SELECT * from load_disconnect_code_refuse_overrides()", key);
             },
-            [&](const PGResponse &e) {
-                CodesTranslator::instance()->load_disconnect_code_refuse_overrides(e.result);
+            [&](const AmArg &result) {
+                CodesTranslator::instance()->load_disconnect_code_refuse_overrides(result);
             }
         }},
         { "translations.dc_rerouting_override", {
@@ -753,8 +817,8 @@ void Yeti::initCfgTimerMappings()
                 yeti_routing_db_query(
                     "SELECT * from load_disconnect_code_rerouting_overrides()", key);
             },
-            [&](const PGResponse &e) {
-                CodesTranslator::instance()->load_disconnect_code_rerouting_overrides(e.result);
+            [&](const AmArg &result) {
+                CodesTranslator::instance()->load_disconnect_code_rerouting_overrides(result);
             }
         }},
         { "translations.dc_rewrite_override", {
@@ -762,8 +826,8 @@ void Yeti::initCfgTimerMappings()
                 yeti_routing_db_query(
                     "SELECT * from load_disconnect_code_rewrite_overrides()", key);
             },
-            [&](const PGResponse &e) {
-                CodesTranslator::instance()->load_disconnect_code_rewrite_overrides(e.result);
+            [&](const AmArg &result) {
+                CodesTranslator::instance()->load_disconnect_code_rewrite_overrides(result);
             }
         }},
 
@@ -773,8 +837,8 @@ void Yeti::initCfgTimerMappings()
                 yeti_routing_db_query(
                     "SELECT * from load_codecs()", key);
             },
-            [&](const PGResponse &e) {
-                CodecsGroups::instance()->load_codecs(e.result);
+            [&](const AmArg &result) {
+                CodecsGroups::instance()->load_codecs(result);
             }
         }},
 
@@ -792,29 +856,29 @@ void Yeti::initCfgTimerMappings()
                 query->addParam(config.pop_id).addParam(AmConfig.node_id);
                 AmEventDispatcher::instance()->post(POSTGRESQL_QUEUE, query);
             },
-            [&](const PGResponse &e) {
-                Registration::instance()->load_registrations(e.result);
+            [&](const AmArg &result) {
+                Registration::instance()->load_registrations(result);
             }}
         },
 
         //YetiRadius
         { "radius_authorization_profiles", {
             [&](const string &key) {
-                if(config.use_radius)
-                    yeti_routing_db_query("SELECT * from load_radius_profiles()", key);
+                yeti_routing_db_query("SELECT * from load_radius_profiles()", key);
             },
-            [&](const PGResponse &e) {
-                load_radius_auth_connections(e.result);
-            }}
+            [&](const AmArg &result) {
+                load_radius_auth_connections(result);
+            },
+            [&]() { return config.use_radius; }}
         },
         { "radius_accounting_profiles", {
             [&](const string &key) {
-                if(config.use_radius)
-                    yeti_routing_db_query("SELECT * from load_radius_accounting_profiles()", key);
+                yeti_routing_db_query("SELECT * from load_radius_accounting_profiles()", key);
             },
-            [&](const PGResponse &e) {
-                load_radius_acc_connections(e.result);
-            }}
+            [&](const AmArg &result) {
+                load_radius_acc_connections(result);
+            },
+            [&]() { return config.use_radius; }}
         },
 
         //Auth
@@ -822,8 +886,8 @@ void Yeti::initCfgTimerMappings()
             [&](const string &key) {
                 yeti_routing_db_query("SELECT * from load_incoming_auth()", key);
             },
-            [&](const PGResponse &e) {
-                router.reload_credentials(e.result);
+            [&](const AmArg &result) {
+                router.reload_credentials(result);
             }}
         },
 
@@ -841,16 +905,41 @@ void Yeti::initCfgTimerMappings()
                 query->addParam(config.pop_id).addParam(AmConfig.node_id);
                 AmEventDispatcher::instance()->post(POSTGRESQL_QUEUE, query);
             },
-            [&](const PGResponse &e) {
-                options_prober_manager.load_probers(e.result);
+            [&](const AmArg &result) {
+                options_prober_manager.load_probers(result);
             }}
         },
     };
 
+    //incremental reloads
+    auto &credentials = db_config_timer_mappings.at("auth_credentials");
+    credentials.on_delta_reload = [&](const string &token, long long since_version) {
+        auto query = new PGParamExecute(
+            PGQueryData(
+                yeti_routing_pg_worker,
+                "SELECT * FROM load_incoming_auth_changes($1)",
+                true, /* single */
+                YETI_QUEUE_NAME,
+                token),
+            PGTransactionData(), false);
+        //bigint param. versions can exceed int range
+        query->addParam(AmArg(since_version));
+        AmEventDispatcher::instance()->post(POSTGRESQL_QUEUE, query);
+    };
+    credentials.on_db_delta_response = [&](const AmArg &result) {
+        router.apply_credentials_changes(result);
+    };
+
     for(auto &mapping: db_config_timer_mappings)
         mapping.second.init_exceptions_counter(mapping.first);
 }
 
+//check_states() versions are integer, but notifications and snapshots can have bigint ones
+static long long db_state_version(const AmArg &a)
+{
+    return isArgLongLong(a) ? a.asLongLong() : a.asInt();
+}
+
 void Yeti::onDbCfgReloadTimer() noexcept
 {
     yeti_routing_db_query("SELECT * FROM check_states()", "check_states");
@@ -863,21 +952,241 @@ void Yeti::onDbCfgReloadTimerResponse(const PGResponse &e) noexcept
         const AmArg &r = e.result[0];
         for(auto &a : r) {
             //DBG("%s: %d",a.first.data(),a.second.asInt());
-            if(!db_cfg_states.hasMember(a.first) ||
-               a.second.asInt() > db_cfg_states[a.first].asInt())
+            /* apply newer versions only. the reply can be sent before
+             * the newer version came from the notification */
+            auto version = db_state_version(a.second);
+            if(db_cfg_states.hasMember(a.first) &&
+               version <= db_state_version(db_cfg_states[a.first]))
             {
-                DBG("new or newer db_state %d for: %s",
-                    a.second.asInt(), a.first.data());
-                auto it = db_config_timer_mappings.find(a.first);
-                if(it != db_config_timer_mappings.end()) {
-                    it->second.on_reload(it->first);
-                } else {
-                    ERROR("unknown db_state: %s", a.first.data());
-                }
+                continue;
+            }
+
+            DBG("new or changed db_state %lld for: %s", version, a.first.data());
+            db_cfg_states[a.first] = version;
+
+            auto it = db_config_timer_mappings.find(a.first);
+            if(it != db_config_timer_mappings.end()) {
+                if(!it->second.isEnabled())
+                    continue;
+                db_cfg_requested_states[a.first] = version;
+                requestDbCfgReload(it->first, it->second);
+            } else {
+                ERROR("unknown db_state: %s", a.first.data());
             }
         }
-        db_cfg_states = r;
     } catch(...) {
         DBG("exception on CfgReloadTimer response processing");
     }
 }
+
+bool Yeti::isDbCfgAlias(const string &key)
+{
+    //'translations' -> 'translations.*' subkeys
+    auto it = db_config_timer_mappings.upper_bound(key);
+    return it != db_config_timer_mappings.end() &&
+           it->first.size() > key.size() &&
+           it->first.compare(0, key.size(), key) == 0 &&
+           it->first[key.size()] == '.';
+}
+
+void Yeti::requestDbCfgReload(const string &key, cfg_timer_mapping_entry &entry)
+{
+    db_cfg_reload_stats.onRequest(key);
+
+    if(config.db_delta_reloads && entry.on_delta_reload) {
+        auto applied_it = db_cfg_applied_states.find(key);
+        if(applied_it != db_cfg_applied_states.end() &&
+           applied_it->second < db_cfg_requested_states[key])
+        {
+            DBG("request '%s' changes since version %lld",
+                key.data(), applied_it->second);
+            entry.on_delta_reload(key + DB_CFG_DELTA_TOKEN_SUFFIX, applied_it->second);
+            return;
+        }
+    }
+
+    entry.on_reload(key);
+}
+
+void Yeti::onDbCfgResponse(const PGResponse &e)
+{
+    bool delta = false;
+    string key = e.token;
+    static const string delta_suffix(DB_CFG_DELTA_TOKEN_SUFFIX);
+    if(key.size() > delta_suffix.size() &&
+       0==key.compare(key.size() - delta_suffix.size(), delta_suffix.size(), delta_suffix))
+    {
+        key.resize(key.size() - delta_suffix.size());
+        delta = true;
+    }
+
+    auto it = db_config_timer_mappings.find(key);
+    if(it == db_config_timer_mappings.end()) {
+        ERROR("unknown db response token: %s", e.token.data());
+        return;
+    }
+
+    if(!applyDbCfgDataset(key, e.result, delta)) {
+        if(delta) {
+            //container state is unknown after the partially applied changes
+            onDbCfgResponseFailed(e.token);
+        }
+        return;
+    }
+
+    auto state_it = db_cfg_requested_states.find(key.substr(0, key.find('.')));
+    if(state_it != db_cfg_requested_states.end()) {
+        db_cfg_applied_states[key] = state_it->second;
+        /* snapshot is kept on the last full reload version.
+         * it will be updated by the delta reload after restart */
+        if(!delta)
+            db_snapshot.save(key, state_it->second, e.result);
+    }
+
+    onDbCfgDatasetLoaded(key);
+}
+
+void Yeti::onDbCfgNotify(const string &payload)
+{
+    auto n = DbConfigNotifyListener::Notification::parse(payload);
+
+    /* reload the dataset immediately if the payload contains known state key and version.
+     * request check_states() otherwise */
+    auto it = n.key.find('.') == string::npos ?
+        db_config_timer_mappings.find(n.key) : db_config_timer_mappings.end();
+    if(it == db_config_timer_mappings.end() || n.version < 0) {
+        DBG("db notify '%s'. request check_states()", payload.data());
+        onDbCfgReloadTimer();
+        return;
+    }
+
+    if(!it->second.isEnabled())
+        return;
+
+    //late notifications can come after the newer version is seen
+    if(db_cfg_states.hasMember(n.key) &&
+       db_state_version(db_cfg_states[n.key]) >= n.version)
+    {
+        DBG("db notify '%s'. version is already applied", payload.data());
+        return;
+    }
+
+    DBG("db notify '%s'. reload", payload.data());
+    db_cfg_states[n.key] = n.version;
+    db_cfg_requested_states[n.key] = n.version;
+    requestDbCfgReload(it->first, it->second);
+}
+
+void Yeti::onDbCfgResponseFailed(const string &token)
+{
+    static const string delta_suffix(DB_CFG_DELTA_TOKEN_SUFFIX);
+    if(token.size() <= delta_suffix.size() ||
+       0!=token.compare(token.size() - delta_suffix.size(), delta_suffix.size(), delta_suffix))
+    {
+        return;
+    }
+
+    //changes are not available (e.g. versions gap). fallback to the full reload
+    auto key = token.substr(0, token.size() - delta_suffix.size());
+    auto it = db_config_timer_mappings.find(key);
+    if(it == db_config_timer_mappings.end())
+        return;
+
+    WARN("failed to load changes for '%s'. fallback to the full reload", key.data());
+    db_cfg_applied_states.erase(key);
+    db_cfg_reload_stats.onDeltaFallback(key);
+    it->second.on_reload(key);
+}
+
+bool Yeti::applyDbCfgDataset(const string &key, const AmArg &data, bool delta) noexcept
+{
+    auto &entry = db_config_timer_mappings.at(key);
+    try {
+        DBG("call %s() for '%s'",
+            delta ? "on_db_delta_response" : "on_db_response", key.data());
+        auto start = std::chrono::steady_clock::now();
+        if(delta) entry.on_db_delta_response(data);
+        else entry.on_db_response(data);
+        db_cfg_reload_stats.onApplied(
+            key, delta, data, std::chrono::steady_clock::now() - start);
+        return true;
+    } catch(AmArg::OutOfBoundsException &) {
+        ERROR("AmArg::OutOfBoundsException in cfg timer handler: %s",
+            key.data());
+    } catch(AmArg::TypeMismatchException &) {
+        ERROR("AmArg::TypeMismatchException in cfg timer handler: %s",
+            key.data());
+    } catch(std::exception &exception) {
+        ERROR("std::exception in cfg timer handler '%s': %s",
+            key.data(), exception.what());
+    } catch(std::string &s) {
+        ERROR("cfg timer handler %s exception: %s",
+            key.data(), s.data());
+    } catch(...) {
+        ERROR("exception in cfg timer handler: %s", key.data());
+    }
+
+    entry.exceptions_counter->inc();
+    return false;
+}
+
+void Yeti::onDbCfgDatasetLoaded(const string &key)
+{
+    if(!db_cfg_pending.erase(key))
+        return;
+
+    startup.pending_datasets = db_cfg_pending.size();
+    if(db_cfg_pending.empty()) {
+        startup.ready_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startup.load_start).count();
+        INFO("all DB configuration datasets are loaded in %ld ms (%u from the local snapshot)",
+             startup.ready_ms.load(), startup.datasets_from_snapshot.load());
+    }
+}
+
+void Yeti::loadDbCfgSnapshots()
+{
+    for(auto &it : db_config_timer_mappings) {
+        if(it.second.isEnabled() && !isDbCfgAlias(it.first))
+            db_cfg_pending.emplace(it.first);
+    }
+    startup.pending_datasets = db_cfg_pending.size();
+
+    if(!db_snapshot.isEnabled())
+        return;
+
+    /* apply the local snapshots and set db_cfg_states to their versions
+     * so check_states() will reload only the changed datasets.
+     * state is set only if all the subkeys are loaded with the same version */
+    map<string, long long> versions;
+    std::set<string> failed_states;
+
+    for(const auto &key : std::set<string>(db_cfg_pending)) {
+        auto state_key = key.substr(0, key.find('.'));
+
+        long long version;
+        AmArg data;
+        if(!db_snapshot.load(key, version, data) ||
+           !applyDbCfgDataset(key, data))
+        {
+            failed_states.emplace(state_key);
+            continue;
+        }
+
+        startup.datasets_from_snapshot++;
+        db_cfg_applied_states[key] = version;
+        onDbCfgDatasetLoaded(key);
+
+        auto ret = versions.emplace(state_key, version);
+        if(!ret.second && ret.first->second != version)
+            failed_states.emplace(state_key);
+    }
+
+    for(const auto &it : versions) {
+        if(failed_states.count(it.first))
+            continue;
+        DBG("%s: use version %lld from the local snapshot",
+            it.first.data(), it.second);
+        db_cfg_states[it.first] = it.second;
+    }
+}
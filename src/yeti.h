@@ -9,6 +9,8 @@
 
 #include <AmEventFdQueue.h>
 
+#include <set>
+
 #define YETI_REDIS_REGISTER_TYPE_ID 0
 #define YETI_REDIS_RPC_AOR_LOOKUP_TYPE_ID 1
 
@@ -29,25 +31,47 @@ class Yeti
     AmTimerFd keepalive_timer;
     AmTimerFd each_second_timer;
     AmTimerFd db_cfg_reload_timer;
+    AmTimerFd radius_interim_timer;
 
     struct cfg_timer_mapping_entry {
         std::function<void (const string &key)> on_reload;
-        std::function<void (const PGResponse &e)> on_db_response;
+        std::function<void (const AmArg &result)> on_db_response;
+        std::function<bool ()> enabled;
+        //optional incremental reload. requests rows changed since the version
+        std::function<void (const string &token, long long since_version)> on_delta_reload;
+        std::function<void (const AmArg &result)> on_db_delta_response;
         AtomicCounter *exceptions_counter;
         cfg_timer_mapping_entry(
             std::function<void (const string &key)> on_reload,
-            std::function<void (const PGResponse &e)> on_db_response)
+            std::function<void (const AmArg &result)> on_db_response,
+            std::function<bool ()> enabled = nullptr)
           : on_reload(on_reload),
-            on_db_response(on_db_response)
+            on_db_response(on_db_response),
+            enabled(enabled)
         {}
 
         void init_exceptions_counter(const string &key);
+        bool isEnabled() const { return !enabled || enabled(); }
     };
     map<string, cfg_timer_mapping_entry> db_config_timer_mappings;
+    //check_states() values for the requested datasets. used as the snapshots versions
+    map<string, long long> db_cfg_requested_states;
+    //check_states() values of the currently applied datasets. base for the delta reloads
+    map<string, long long> db_cfg_applied_states;
+    //datasets not loaded yet neither from DB nor from the snapshot
+    std::set<string> db_cfg_pending;
 
     void initCfgTimerMappings();
     void onDbCfgReloadTimer() noexcept;
     void onDbCfgReloadTimerResponse(const PGResponse &e) noexcept;
+    bool isDbCfgAlias(const string &key);
+    void requestDbCfgReload(const string &key, cfg_timer_mapping_entry &entry);
+    bool applyDbCfgDataset(const string &key, const AmArg &data, bool delta = false) noexcept;
+    void onDbCfgResponse(const PGResponse &e);
+    void onDbCfgResponseFailed(const string &token);
+    void onDbCfgNotify(const string &payload);
+    void onDbCfgDatasetLoaded(const string &key);
+    void loadDbCfgSnapshots();
 
   public:
 
@@ -59,6 +83,7 @@ class Yeti
         AtomicCounter &identity_failed_x5u_not_trusted;
         AtomicCounter &identity_failed_cert_invalid;
         AtomicCounter &identity_failed_cert_not_available;
+        LatencyHistogram &identity_verify_latency;
         Counters();
     } counters;
 
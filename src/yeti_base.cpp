@@ -20,26 +20,69 @@ bool yeti_routing_db_query(const string &query, const string &token)
     return 0;
 }
 
-int YetiBase::sync_db::exec_query(const string &query, const string &token)
+void YetiBase::sync_db::prefetch(const string &query, const string &token)
 {
-    db_reply_condition.set(DB_REPLY_WAITING);
+    {
+        AmLock l(replies_mutex);
+        replies[token] = reply();
+    }
 
     yeti_routing_db_query(query, token);
+}
 
-    if(!db_reply_condition.wait_for_to(5000)) {
-        ERROR("%s(%s) timeout", token.data(), query.data());
-        return 1;
+int YetiBase::sync_db::exec_query(const string &query, const string &token)
+{
+    DbReplyResult state;
+
+    {
+        std::unique_lock<AmMutex> l(replies_mutex);
+        if(!replies.count(token)) {
+            l.unlock();
+            prefetch(query, token);
+            l.lock();
+        }
+
+        if(!replies_cond.wait_for(l, std::chrono::milliseconds(5000),
+            [&]() { return replies[token].state != DB_REPLY_WAITING; }))
+        {
+            ERROR("%s(%s) timeout", token.data(), query.data());
+            state = DB_REPLY_TIMEOUT;
+        } else {
+            auto &r = replies[token];
+            state = r.state;
+            db_reply_result = std::move(r.result);
+        }
+
+        replies.erase(token);
     }
 
-    switch(db_reply_condition.get()) {
-    case DB_REPLY_WAITING:
-        throw std::logic_error("unexpected switch value");
-    case DB_REPLY_RESULT:
-        break;
-    case DB_REPLY_ERROR:
-    case DB_REPLY_TIMEOUT:
-        return 1;
+    if(state == DB_REPLY_RESULT) {
+        snapshot.save(token, 0, db_reply_result);
+        return 0;
     }
 
-    return 0;
+    long long version;
+    if(snapshot.load(token, version, db_reply_result)) {
+        WARN("%s(%s) failed. use data from the local snapshot",
+             token.data(), query.data());
+        return 0;
+    }
+
+    return 1;
+}
+
+void YetiBase::sync_db::on_reply(const string &token, DbReplyResult state, const AmArg *result)
+{
+    AmLock l(replies_mutex);
+
+    auto it = replies.find(token);
+    if(it == replies.end()) {
+        //late reply after timeout
+        return;
+    }
+
+    it->second.state = state;
+    if(result) it->second.result = *result;
+
+    replies_cond.notify_all();
 }
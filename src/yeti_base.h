@@ -7,13 +7,23 @@
 #include "resources/ResourceControl.h"
 #include "CertCache.h"
 #include "OriginationPreAuth.h"
+#include "CpsLimiter.h"
+#include "CallSetupTrace.h"
+#include "RadiusInterimScheduler.h"
 #include "RegistrarRedisConnection.h"
 #include "cdr/CdrHeaders.h"
 #include "cfg/YetiCfg.h"
+#include "db/DbConfigSnapshot.h"
+#include "db/DbConfigReloadStats.h"
+#include "db/DbConfigNotifyListener.h"
 
 #include "AmConfigReader.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <ctime>
+#include <map>
 
 #include "log.h"
 
@@ -27,7 +37,6 @@ bool yeti_routing_db_query(const string &query, const string &token);
 
 #define YETI_CALL_DURATION_TIMER SBC_TIMER_ID_CALL_TIMERS_START
 #define YETI_RINGING_TIMEOUT_TIMER (SBC_TIMER_ID_CALL_TIMERS_START+1)
-#define YETI_RADIUS_INTERIM_TIMER (SBC_TIMER_ID_CALL_TIMERS_START+2)
 #define YETI_FAKE_RINGING_TIMER (SBC_TIMER_ID_CALL_TIMERS_START+3)
 
 #if YETI_ENABLE_PROFILING
@@ -57,11 +66,19 @@ public:
     YetiComponentInited(ComponentType type) : AmEvent(0), type(type) {}
 };
 
+class DbConfigNotifyEvent : public AmEvent
+{
+public:
+    string payload;
+    DbConfigNotifyEvent(const string &payload) : AmEvent(0), payload(payload) {}
+};
+
 struct YetiBase {
     YetiBase()
       : configuration_finished(false),
         confuse_cfg(nullptr),
-        orig_pre_auth(config)
+        orig_pre_auth(config),
+        sync_db(db_snapshot)
     { 
         memset(component_inited, 0, sizeof(bool)*YetiComponentInited::MaxType); 
     }
@@ -86,6 +103,28 @@ struct YetiBase {
     OptionsProberManager options_prober_manager;
     CertCache cert_cache;
     OriginationPreAuth orig_pre_auth;
+    CpsLimiter cps_limiter;
+    CallSetupTraceCollector call_setup_traces;
+    RadiusInterimScheduler radius_interim;
+
+    DbConfigSnapshot db_snapshot;
+    DbConfigReloadStats db_cfg_reload_stats;
+    DbConfigNotifyListener db_notify_listener;
+
+    //startup time-to-ready measurement
+    struct startup_timings {
+        std::chrono::steady_clock::time_point load_start;
+        std::atomic<long> configured_ms; //-1 until onLoad() is finished
+        std::atomic<long> ready_ms;      //-1 until all the DB datasets are loaded
+        std::atomic<unsigned int> pending_datasets;
+        std::atomic<unsigned int> datasets_from_snapshot;
+        startup_timings()
+          : configured_ms(-1),
+            ready_ms(-1),
+            pending_datasets(0),
+            datasets_from_snapshot(0)
+        {}
+    } startup;
 
     //fields to provide synchronous configuration for DB-related entities
     struct sync_db {
@@ -95,10 +134,31 @@ struct YetiBase {
             DB_REPLY_ERROR,
             DB_REPLY_TIMEOUT
         };
-        AmCondition<DbReplyResult> db_reply_condition;
-        string db_reply_token;
+        struct reply {
+            DbReplyResult state;
+            AmArg result;
+            reply()
+              : state(DB_REPLY_WAITING)
+            {}
+        };
+
+        AmMutex replies_mutex;
+        std::condition_variable_any replies_cond;
+        std::map<string, reply> replies;
+
+        DbConfigSnapshot &snapshot;
         AmArg db_reply_result;
 
+        sync_db(DbConfigSnapshot &snapshot)
+          : snapshot(snapshot)
+        {}
+
+        /* post query without waiting for the reply.
+         * exec_query() with the same token will wait for the prefetched reply */
+        void prefetch(const string &query, const string &token);
+        /* falls back to the local snapshot on error/timeout
+         * and saves the successful replies to it */
         int exec_query(const string &query, const string &token);
+        void on_reply(const string &token, DbReplyResult state, const AmArg *result = nullptr);
     } sync_db;
 };
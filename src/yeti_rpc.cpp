@@ -109,6 +109,7 @@ void YetiRpc::init_rpc_tree()
 					   "<onwer_local_tag>","find resource by onwer local_tag");
 			method_arg(show_resource_state_used,"resource_id","find handlers which manage resources with ceration id",showResourcesById,"",
 					   "<resource_id>","find handlers which manage resources with ceration id");
+			method(show_resource_state,"leases","show node-local resources leases",showResourceLeases,"");
 
 
 			method(show_resource,"types","show resources types",showResourceTypes,"");
@@ -120,16 +121,21 @@ void YetiRpc::init_rpc_tree()
 		leaf(show,show_media,"media","media processor instance");
 			method(show_media,"streams","active media streams info",showMediaStreams,"");
 
-		leaf_method_arg(show,show_calls,"calls","active calls",GetCalls,"show current active calls",
+		leaf_method_arg(show,show_calls,"calls","active calls",GetCalls,"show current active calls. capped by calls_show_limit",
 						"<LOCAL-TAG>","retreive call by local_tag");
 			method(show_calls,"count","active calls count",GetCallsCount,"");
 			method(show_calls,"fields","show available call fields",showCallsFields,"");
 			method_arg(show_calls,"filtered","active calls. specify desired fields",GetCallsFields,"",
-					   "<field1> <field2> ...","active calls. send only certain fields");
+					   "<field1> <field2> ...","active calls. send only certain fields. capped by calls_show_limit");
+			method_arg(show_calls,"page","active calls ordered by local_tag. paginated",GetCallsPage,"",
+					   "<cursor>|- [<limit>] [<field1> <field2> ...]",
+					   "active calls after the cursor. limit is capped by calls_show_limit");
 
 		method(show,"configuration","actual settings",GetConfig,"");
 
-		method(show,"stats","runtime statistics",GetStats,"");
+		leaf_method(show,show_stats,"stats","runtime statistics",GetStats,"");
+			method(show_stats,"histograms","hot paths latency histograms",showStatsHistograms,"");
+			method(show_stats,"call_setup","sampled per-stage call setup traces",showStatsCallSetupTraces,"");
 
 		method(show,"interfaces","show network interfaces configuration",showInterfaces,"");
 
@@ -166,12 +172,14 @@ void YetiRpc::init_rpc_tree()
 						   "<id>","show configuration for certain accounting profile");
 				method_arg(show_radius_acc,"statistics","radius connections statistic",showRadiusAccStat,"",
 						   "<id>","show stats for certain accounting profile");
+				method(show_radius_acc,"interim","interim accounting scheduler queue and send rate",showRadiusInterimScheduler,"");
 
 		leaf(show,show_recorder,"recorder","audio recorder instance");
 			method(show_recorder,"stats","show audio recorder processor stats",showRecorderStats,"");
 
 		method(show,"aors","show registered AoRs",showAors,"");
 		method(show,"keepalive_contexts","show keepalive contexts",showKeepaliveContexts,"");
+		method(show,"aor_cache","show AoR lookup cache stats",showAorCache,"");
 		method(show,"http_sequencer_data","show http sequencer runtime data",showHttpSequencerData,"");
 
 		leaf(show,show_cert_cache,"cert_cache","");
@@ -180,10 +188,17 @@ void YetiRpc::init_rpc_tree()
 			method(show_cert_cache, "trusted_repositories", "show trusted repositories", showCertCacheTrustedRepositories, "");
 			method(show_cert_cache, "signing_keys", "show signing keys", showCertCacheSigningKeys, "");
 		method(show, "trusted_balancers", "show trusted balancers list", showTrustedBalancers, "");
+
+		leaf(show,show_router,"router","active router instance");
+			method(show_router,"admission_control","show admission control state",showRouterAdmissionControl,"");
 		method(show, "ip_auth", "show ip auth list", showIPAuth, "");
+		method(show, "cps_limit", "show per-source CPS limiter state", showCpsLimit, "");
 
 		leaf(show,show_reload,"reload","db setting reload");
 			method(show_reload,"status","show db reloading status",showReloadStatus,"");
+			method(show_reload,"startup","show startup timings and local snapshots usage",showReloadStartup,"");
+			method(show_reload,"stats","show per dataset reload statistics",showReloadStats,"");
+			method(show_reload,"notify","show db notifications listener state",showReloadNotify,"");
 
 	/* request */
 	leaf(root,request,"request","modify commands");
@@ -396,8 +411,9 @@ void YetiRpc::GetCalls(const AmArg& args, AmArg& ret) {
 		string local_tag = args[0].asCStr();
 		if(!cdr_list.getCall(local_tag,ret,&router))
 			throw CallNotFoundException(local_tag);
-	} else {
-		cdr_list.getCalls(ret,&router);
+	} else if(!cdr_list.getCalls(ret,&router,static_cast<size_t>(calls_show_limit))) {
+		WARN("active calls list is truncated to calls_show_limit %d. use 'show calls page'",
+			 calls_show_limit);
 	}
 }
 
@@ -409,7 +425,38 @@ void YetiRpc::GetCallsFields(const AmArg &args, AmArg &ret){
 	}
 
 	try {
-		cdr_list.getCallsFields(ret,&router,args);
+		if(!cdr_list.getCallsFields(ret,&router,args,static_cast<size_t>(calls_show_limit))) {
+			WARN("active calls list is truncated to calls_show_limit %d. use 'show calls page'",
+				 calls_show_limit);
+		}
+	} catch(std::string &s){
+		throw AmSession::Exception(500,s);
+	}
+}
+
+void YetiRpc::GetCallsPage(const AmArg &args, AmArg &ret){
+	string cursor;
+	int limit = calls_show_limit;
+	handler_log();
+
+	if(args.size()) {
+		cursor = args[0].asCStr();
+		if(cursor=="-") cursor.clear();
+	}
+
+	if(args.size() > 1) {
+		if(!str2int(args[1].asCStr(),limit) || limit <= 0)
+			throw AmSession::Exception(500,"invalid limit");
+		if(limit > calls_show_limit) limit = calls_show_limit;
+	}
+
+	AmArg params;
+	params.assertArray();
+	for(size_t i = 2; i < args.size(); i++)
+		params.push(args[i]);
+
+	try {
+		cdr_list.getCallsPage(ret,&router,cursor,static_cast<size_t>(limit),params);
 	} catch(std::string &s){
 		throw AmSession::Exception(500,s);
 	}
@@ -502,6 +549,14 @@ void YetiRpc::GetStats(const AmArg& args, AmArg& ret){
 	CodesTranslator::instance()->getStats(ret["translator"]);
 }
 
+void YetiRpc::showStatsHistograms(const AmArg&, AmArg& ret){
+	StatsRegistry::instance()->getHistograms(ret);
+}
+
+void YetiRpc::showStatsCallSetupTraces(const AmArg&, AmArg& ret){
+	call_setup_traces.getSamples(ret);
+}
+
 void YetiRpc::GetConfig(const AmArg& args, AmArg& ret) {
 	handler_log();
 
@@ -776,6 +831,10 @@ void YetiRpc::showRadiusAccStat(const AmArg& args, AmArg& ret){
 	radius_invoke("showAccStat", args, ret);
 }
 
+void YetiRpc::showRadiusInterimScheduler(const AmArg&, AmArg& ret){
+	radius_interim.getStats(ret);
+}
+
 void YetiRpc::requestRadiusAuthProfilesReload(const AmArg&, AmArg& ret){
 	ret = RPC_CMD_DEPRECATED;
 }
@@ -841,6 +900,11 @@ void YetiRpc::showResourcesById(const AmArg& args, AmArg& ret){
 	rctl.showResourcesById(id,ret);
 }
 
+void YetiRpc::showResourceLeases(const AmArg&, AmArg& ret){
+	handler_log();
+	rctl.showResourceLeases(ret);
+}
+
 void YetiRpc::showResourceTypes(const AmArg& args, AmArg& ret){
 	handler_log();
 	rctl.GetConfig(ret,true);
@@ -973,6 +1037,11 @@ void YetiRpc::showKeepaliveContexts(const AmArg&, AmArg& ret)
 	registrar_redis.dumpKeepAliveContexts(ret);
 }
 
+void YetiRpc::showAorCache(const AmArg&, AmArg& ret)
+{
+	registrar_redis.getAorCache().getStats(ret);
+}
+
 void YetiRpc::showHttpSequencerData(const AmArg&, AmArg& ret)
 {
 	http_sequencer.serialize(ret);
@@ -1013,6 +1082,11 @@ void YetiRpc::showCertCacheSigningKeys(const AmArg&, AmArg& ret)
     cert_cache.ShowSigningKeys(ret);
 }
 
+void YetiRpc::showRouterAdmissionControl(const AmArg&, AmArg& ret)
+{
+    router.getAdmissionControl().getState(ret);
+}
+
 void YetiRpc::showTrustedBalancers(const AmArg&, AmArg& ret)
 {
     orig_pre_auth.ShowTrustedBalancers(ret);
@@ -1023,6 +1097,11 @@ void YetiRpc::showIPAuth(const AmArg& arg, AmArg& ret)
     orig_pre_auth.ShowIPAuth(arg, ret);
 }
 
+void YetiRpc::showCpsLimit(const AmArg&, AmArg& ret)
+{
+    cps_limiter.getState(ret);
+}
+
 void YetiRpc::requestCertCacheTrustedCertsReload(const AmArg&, AmArg& ret)
 {
     ret = RPC_CMD_DEPRECATED;
@@ -1048,3 +1127,22 @@ void YetiRpc::showReloadStatus(const AmArg&, AmArg& ret)
     //TODO: rewrite to use async postgres and show db values
     ret = db_cfg_states;
 }
+
+void YetiRpc::showReloadStartup(const AmArg&, AmArg& ret)
+{
+    ret["configured_ms"] = static_cast<long long>(startup.configured_ms.load());
+    ret["ready_ms"] = static_cast<long long>(startup.ready_ms.load());
+    ret["pending_datasets"] = startup.pending_datasets.load();
+    ret["datasets_from_snapshot"] = startup.datasets_from_snapshot.load();
+    db_snapshot.getStats(ret["snapshot"]);
+}
+
+void YetiRpc::showReloadStats(const AmArg&, AmArg& ret)
+{
+    db_cfg_reload_stats.getStats(ret);
+}
+
+void YetiRpc::showReloadNotify(const AmArg&, AmArg& ret)
+{
+    db_notify_listener.getStats(ret);
+}
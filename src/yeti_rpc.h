@@ -28,10 +28,13 @@ class YetiRpc
     rpc_handler RemoveCall;
     rpc_handler ClearStats;
     rpc_handler GetStats;
+    rpc_handler showStatsHistograms;
+    rpc_handler showStatsCallSetupTraces;
     rpc_handler GetConfig;
     rpc_handler GetCall;
     rpc_handler GetCalls;
     rpc_handler GetCallsFields;
+    rpc_handler GetCallsPage;
     rpc_handler GetCallsCount;
     rpc_handler GetRegistration;
     rpc_handler GetRegistrations;
@@ -75,6 +78,7 @@ class YetiRpc
     rpc_handler showResourceByHandler;
     rpc_handler showResourceByLocalTag;
     rpc_handler showResourcesById;
+    rpc_handler showResourceLeases;
     rpc_handler requestResourcesInvalidate;
     rpc_handler requestResourcesHandlerInvalidate;
 
@@ -93,6 +97,7 @@ class YetiRpc
 
     rpc_handler showRadiusAccProfiles;
     rpc_handler showRadiusAccStat;
+    rpc_handler showRadiusInterimScheduler;
     rpc_handler requestRadiusAccProfilesReload;
 
     rpc_handler showRecorderStats;
@@ -104,6 +109,7 @@ class YetiRpc
 
     rpc_handler showAors;
     rpc_handler showKeepaliveContexts;
+    rpc_handler showAorCache;
 
     rpc_handler showHttpSequencerData;
 
@@ -118,10 +124,16 @@ class YetiRpc
     rpc_handler requestCertCacheTrustedRepositoriesReload;
     rpc_handler showCertCacheSigningKeys;
 
+    rpc_handler showRouterAdmissionControl;
+
     rpc_handler showTrustedBalancers;
     rpc_handler requestTrustedBalancersReload;
     rpc_handler showIPAuth;
+    rpc_handler showCpsLimit;
     rpc_handler requestIPAuthReload;
 
     rpc_handler showReloadStatus;
+    rpc_handler showReloadStartup;
+    rpc_handler showReloadStats;
+    rpc_handler showReloadNotify;
 };
@@ -0,0 +1,112 @@
+#include "YetiTest.h"
+#include "../src/AdmissionControl.h"
+#include "../src/cfg/yeti_opts.h"
+
+#include <queue>
+
+/* routing DB stub: latency grows with the in-flight requests count */
+struct SlowDbStub {
+    long base_latency_ms;
+    long per_request_latency_ms;
+
+    long latency(unsigned int active) const {
+        return base_latency_ms + per_request_latency_ms * active;
+    }
+};
+
+struct AdmissionLoadResult {
+    unsigned long admitted;
+    unsigned long shed;
+    unsigned int max_active;
+    long max_latency_tail;
+};
+
+/* simulates 'duration_ms' of load with 'cps' INVITEs per second
+ * against the DB stub with 1ms resolution */
+static AdmissionLoadResult run_load(
+    AdmissionControl &ac, const SlowDbStub &db,
+    unsigned int cps, long duration_ms)
+{
+    AdmissionLoadResult r{};
+    using request = std::pair<long, long>; //finish time, start time
+    std::priority_queue<request, vector<request>, std::greater<request>> in_flight;
+
+    for(long now = 0; now < duration_ms; now++) {
+        while(!in_flight.empty() && in_flight.top().first <= now) {
+            auto latency = now - in_flight.top().second;
+            in_flight.pop();
+            ac.onRequestFinished(latency);
+            //latency at the last quarter of the run
+            if(now > duration_ms * 3 / 4)
+                r.max_latency_tail = std::max(r.max_latency_tail, latency);
+        }
+
+        for(unsigned int i = 0; i < cps / 1000; i++) {
+            if(!ac.admit()) {
+                r.shed++;
+                continue;
+            }
+            r.admitted++;
+            ac.onRequestStarted();
+            in_flight.emplace(now + db.latency(in_flight.size()), now);
+            r.max_active = std::max<unsigned int>(r.max_active, in_flight.size());
+        }
+    }
+
+    while(!in_flight.empty()) {
+        ac.onRequestFinished(-1);
+        in_flight.pop();
+    }
+
+    return r;
+}
+
+static void configure_admission_control(AdmissionControl &ac, const char *cfg_buf)
+{
+    cfg_t *cfg = cfg_init(sig_yeti_routing_opts, CFGF_NONE);
+    ASSERT_EQ(cfg_parse_buf(cfg, cfg_buf), CFG_SUCCESS);
+    ASSERT_EQ(ac.configure(cfg), 0);
+    cfg_free(cfg);
+}
+
+TEST_F(YetiTest, AdmissionControlSlowDb)
+{
+    AdmissionControl ac;
+    configure_admission_control(ac,
+        "admission_control {\n"
+        "  enabled = true\n"
+        "  target_latency = 100\n"
+        "  min_active_requests = 5\n"
+        "  max_active_requests = 500\n"
+        "  retry_after = 10\n"
+        "}\n");
+
+    ASSERT_EQ(ac.getReplyCode(), 503u);
+    ASSERT_EQ(ac.getReplyHeaders(), "Retry-After: 10" CRLF);
+
+    //slow DB: 10ms + 2ms per in-flight request at 2000 cps
+    auto r = run_load(ac, SlowDbStub{10, 2}, 2000, 10000);
+    ASSERT_GT(r.shed, 0ul);
+    ASSERT_LE(r.max_active, 500u);
+    //latency settles near the target instead of unbounded growth
+    ASSERT_LT(r.max_latency_tail, 300);
+
+    AmArg state;
+    ac.getState(state);
+    ASSERT_LT(state["limit"].asInt(), 500);
+
+    //fast DB: limit recovers and all INVITEs are admitted again
+    run_load(ac, SlowDbStub{5, 0}, 2000, 10000);
+    r = run_load(ac, SlowDbStub{5, 0}, 2000, 1000);
+    ASSERT_EQ(r.shed, 0ul);
+}
+
+TEST_F(YetiTest, AdmissionControlDisabled)
+{
+    AdmissionControl ac;
+    configure_admission_control(ac, "admission_control { enabled = false }\n");
+
+    auto r = run_load(ac, SlowDbStub{10, 2}, 2000, 2000);
+    ASSERT_EQ(r.shed, 0ul);
+    ASSERT_EQ(r.admitted, 4000ul);
+}
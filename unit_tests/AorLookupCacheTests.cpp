@@ -0,0 +1,193 @@
+#include "YetiTest.h"
+#include "../src/AorLookupCache.h"
+#include "../src/RedisInstance.h"
+#include <hiredis/hiredis.h>
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+TEST_F(YetiTest, AorLookupCache)
+{
+    AorLookupCache cache;
+    std::set<int> ids{ 42, 43 };
+    AorLookupCache::AorsMap aors;
+
+    //disabled
+    ASSERT_FALSE(cache.lookup(ids, aors));
+    ASSERT_EQ(cache.createLookupRequest(ids), nullptr);
+
+    cache.configure(true, std::chrono::seconds(60));
+    std::unique_ptr<AorLookupCache::LookupRequest> request(cache.createLookupRequest(ids));
+    ASSERT_TRUE(request);
+
+    //no subscription yet
+    AorLookupCache::AorsMap reply;
+    reply[42].emplace_back("sip:user@10.0.0.1:5060", "<sip:10.0.0.10;lr>");
+    cache.update(*request, reply);
+    ASSERT_FALSE(cache.lookup(ids, aors));
+
+    cache.setReady(true);
+    request.reset(cache.createLookupRequest(ids));
+    cache.update(*request, reply);
+
+    auto now = std::chrono::steady_clock::now();
+    ASSERT_TRUE(cache.lookup(ids, aors, now));
+    //43 is cached as not registered
+    ASSERT_EQ(aors.size(), 1u);
+    ASSERT_EQ(aors[42].size(), 1u);
+    ASSERT_EQ(aors[42].front().contact, "sip:user@10.0.0.1:5060");
+    ASSERT_EQ(aors[42].front().path, "<sip:10.0.0.10;lr>");
+
+    //ttl
+    aors.clear();
+    ASSERT_FALSE(cache.lookup(ids, aors, now + std::chrono::seconds(61)));
+
+    //keyspace events
+    aors.clear();
+    ASSERT_TRUE(cache.lookup(ids, aors, now));
+    cache.invalidateKey("c:43:sip:user2@10.0.0.2:5060");
+    aors.clear();
+    ASSERT_FALSE(cache.lookup(ids, aors, now));
+    ASSERT_TRUE(cache.lookup({ 42 }, aors, now));
+
+    cache.invalidateKey("a:42");
+    aors.clear();
+    ASSERT_FALSE(cache.lookup({ 42 }, aors, now));
+
+    //invalidation during the request
+    request.reset(cache.createLookupRequest(ids));
+    cache.invalidateKey("c:100:sip:user3@10.0.0.3:5060");
+    cache.update(*request, reply);
+    ASSERT_FALSE(cache.lookup(ids, aors));
+
+    //unrelated keys
+    request.reset(cache.createLookupRequest(ids));
+    cache.invalidateKey("r:471");
+    cache.invalidateKey("c:abc");
+    cache.update(*request, reply);
+    ASSERT_TRUE(cache.lookup(ids, aors));
+
+    //subscription loss
+    cache.setReady(false);
+    ASSERT_FALSE(cache.lookup(ids, aors));
+
+    AmArg stats;
+    cache.getStats(stats);
+    ASSERT_EQ(stats["entries"].asInt(), 0);
+}
+
+static void parse_aor_lookup_reply(redisReply *r, AorLookupCache::AorsMap &aors)
+{
+    for(size_t i = 0; i + 1 < r->elements; i += 2) {
+        auto id = static_cast<int>(r->element[i]->integer);
+        auto data = r->element[i+1];
+        for(size_t j = 0; j + 1 < data->elements; j += 2)
+            aors[id].emplace_back(data->element[j]->str, data->element[j+1]->str);
+    }
+}
+
+/* call setup AoR resolving rate with EVALSHA aor_lookup.lua for each call
+ * compared to the local cache. requires external redis with scripting
+ * run: ./run_unit_test.sh YetiTest.DISABLED_AorLookupCacheBenchmark */
+TEST_F(YetiTest, AorLookupCacheNotifyConfig)
+{
+    ASSERT_TRUE(AorLookupCache::checkNotifyKeyspaceEvents("AE"));
+    ASSERT_TRUE(AorLookupCache::checkNotifyKeyspaceEvents("Eghx"));
+    ASSERT_TRUE(AorLookupCache::checkNotifyKeyspaceEvents("KEA"));
+
+    ASSERT_FALSE(AorLookupCache::checkNotifyKeyspaceEvents(""));
+    ASSERT_FALSE(AorLookupCache::checkNotifyKeyspaceEvents("KA"));
+    //no hset events
+    ASSERT_FALSE(AorLookupCache::checkNotifyKeyspaceEvents("Egx"));
+    ASSERT_FALSE(AorLookupCache::checkNotifyKeyspaceEvents("Ehx"));
+}
+
+TEST_F(YetiTest, DISABLED_AorLookupCacheBenchmark)
+{
+    static const int registered = 1000;
+    static const int calls = 20000;
+
+    if(!yeti_test::instance()->redis.external)
+        GTEST_SKIP() << "external redis is required";
+
+    std::ifstream script_file("./etc/aor_lookup.lua");
+    ASSERT_TRUE(script_file.is_open());
+    std::stringstream script;
+    script << script_file.rdbuf();
+
+    timeval timeout = { DEFAULT_REDIS_TIMEOUT_MSEC, 0 };
+    redisContext* ctx = redis::redisConnectWithTimeout(
+        yeti_test::instance()->redis.host.c_str(), yeti_test::instance()->redis.port, timeout);
+    ASSERT_TRUE(ctx);
+
+    auto command = [ctx](const char *fmt, auto... args) {
+        redisReply *r = nullptr;
+        if(redis::redisAppendCommand(ctx, fmt, args...) ||
+           redis::redisGetReply(ctx, reinterpret_cast<void **>(&r)))
+        {
+            return static_cast<redisReply *>(nullptr);
+        }
+        return r;
+    };
+
+    auto r = command("SCRIPT LOAD %s", script.str().data());
+    ASSERT_TRUE(r && r->type == REDIS_REPLY_STRING);
+    string hash(r->str);
+    redis::freeReplyObject(ctx, r);
+
+    for(int id = 1; id <= registered; id++) {
+        string contact = "sip:user" + std::to_string(id) + "@10.0.0.1:5060";
+        string contact_key = "c:" + std::to_string(id) + ":" + contact;
+        redis::freeReplyObject(ctx, command("SADD a:%d %s", id, contact.data()));
+        redis::freeReplyObject(ctx, command("HSET %s path %s", contact_key.data(), ""));
+        redis::freeReplyObject(ctx, command("EXPIRE %s 600", contact_key.data()));
+    }
+
+    auto resolve = [&](int id, AorLookupCache::AorsMap &aors) {
+        auto r = command("EVALSHA %s 1 %d", hash.data(), id);
+        ASSERT_TRUE(r && r->type == REDIS_REPLY_ARRAY);
+        parse_aor_lookup_reply(r, aors);
+        redis::freeReplyObject(ctx, r);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < calls; i++) {
+        AorLookupCache::AorsMap aors;
+        resolve(1 + i % registered, aors);
+        ASSERT_EQ(aors.size(), 1u);
+    }
+    auto redis_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    AorLookupCache cache;
+    cache.configure(true, std::chrono::seconds(60));
+    cache.setReady(true);
+
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < calls; i++) {
+        std::set<int> ids{ 1 + i % registered };
+        AorLookupCache::AorsMap aors;
+        if(!cache.lookup(ids, aors)) {
+            std::unique_ptr<AorLookupCache::LookupRequest> request(cache.createLookupRequest(ids));
+            resolve(*ids.begin(), aors);
+            cache.update(*request, aors);
+        }
+        ASSERT_EQ(aors.size(), 1u);
+    }
+    auto cached_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    for(int id = 1; id <= registered; id++) {
+        string contact_key = "c:" + std::to_string(id) + ":sip:user" + std::to_string(id) + "@10.0.0.1:5060";
+        redis::freeReplyObject(ctx, command("DEL a:%d %s", id, contact_key.data()));
+    }
+    redis::redisFree(ctx);
+
+    AmArg stats;
+    cache.getStats(stats);
+    RecordProperty("registered", registered);
+    RecordProperty("redis_calls_per_sec", std::to_string(calls * 1e9 / redis_ns));
+    RecordProperty("cache_calls_per_sec", std::to_string(calls * 1e9 / cached_ns));
+    RecordProperty("hit_ratio", std::to_string(stats["hit_ratio"].asDouble()));
+}
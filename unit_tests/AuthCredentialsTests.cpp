@@ -0,0 +1,70 @@
+#include "YetiTest.h"
+#include "../src/Auth.h"
+
+static AmArg credentials_row(int id, const char *username, const char *password, bool deleted = false)
+{
+    AmArg a;
+    a["id"] = id;
+    a["username"] = username;
+    a["password"] = password;
+    a["deleted"] = deleted;
+    return a;
+}
+
+TEST_F(YetiTest, AuthCredentialsChanges)
+{
+    Auth auth;
+    AmArg data, ret;
+
+    data.push(credentials_row(1, "user1", "pwd1"));
+    data.push(credentials_row(2, "user2", "pwd2"));
+    data.push(credentials_row(3, "shared", "pwd3"));
+    data.push(credentials_row(4, "shared", "pwd4"));
+    auth.reload_credentials(data);
+
+    auth.auth_info(ret);
+    ASSERT_EQ(ret.size(), 4u);
+
+    data = AmArg();
+    //changed username
+    data.push(credentials_row(1, "user1_renamed", "pwd1"));
+    //removed
+    data.push(credentials_row(3, "", "", true));
+    //new
+    data.push(credentials_row(5, "user5", "pwd5"));
+    auth.apply_credentials_changes(data);
+
+    ret = AmArg();
+    auth.auth_info_by_user("user1", ret);
+    ASSERT_EQ(ret.size(), 0u);
+
+    ret = AmArg();
+    auth.auth_info_by_user("user1_renamed", ret);
+    ASSERT_EQ(ret.size(), 1u);
+    ASSERT_EQ(ret[0]["id"].asInt(), 1);
+
+    ret = AmArg();
+    auth.auth_info_by_user("shared", ret);
+    ASSERT_EQ(ret.size(), 1u);
+    ASSERT_EQ(ret[0]["id"].asInt(), 4);
+
+    ret = AmArg();
+    auth.auth_info_by_id(5, ret);
+    ASSERT_EQ(ret.size(), 1u);
+
+    ret = AmArg();
+    auth.auth_info(ret);
+    ASSERT_EQ(ret.size(), 4u);
+
+    //full reload after the changes
+    data = AmArg();
+    data.push(credentials_row(2, "user2", "pwd2"));
+    auth.reload_credentials(data);
+    data = AmArg();
+    data.push(credentials_row(2, "", "", true));
+    auth.apply_credentials_changes(data);
+
+    ret = AmArg();
+    auth.auth_info(ret);
+    ASSERT_EQ(ret.size(), 0u);
+}
@@ -0,0 +1,80 @@
+#include "YetiTest.h"
+#include "../src/cdr/AuthLogBatch.h"
+#include "sip/defs.h"
+
+static AuthCdr make_auth_log(const string &remote_ip, const string &username, int code)
+{
+    static vector<UsedHeaderField> no_hdrs;
+
+    AmSipRequest req;
+    req.method = SIP_METH_REGISTER;
+    req.remote_ip = remote_ip;
+    req.remote_port = 5060;
+    req.r_uri = "sip:domain.invalid";
+    req.hdrs = "Authorization: Digest username=\"" + username +
+        "\", realm=\"domain.invalid\", nonce=\"n\", response=\"r\"" CRLF;
+
+    return AuthCdr(req, no_hdrs, code == 200, code, "reason", "internal reason", 0);
+}
+
+TEST_F(YetiTest, AuthLogBatch)
+{
+    AuthLogBatch batch;
+    batch.configure(10, std::chrono::seconds(0));
+    ASSERT_FALSE(batch.isAggregationEnabled());
+
+    vector<AuthCdr> records;
+    auto now = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < 9; i++)
+        ASSERT_FALSE(batch.add(make_auth_log("10.0.0.1", "user", 401)));
+    ASSERT_TRUE(batch.add(make_auth_log("10.0.0.1", "user", 401)));
+
+    ASSERT_TRUE(batch.take(records, false, now));
+    ASSERT_EQ(records.size(), 10u);
+
+    //without aggregation periodic flush takes everything
+    records.clear();
+    ASSERT_FALSE(batch.take(records, false, now));
+    batch.add(make_auth_log("10.0.0.1", "user", 401));
+    ASSERT_TRUE(batch.take(records, false, now));
+    ASSERT_EQ(records.size(), 1u);
+}
+
+TEST_F(YetiTest, AuthLogBatchAggregation)
+{
+    AuthLogBatch batch;
+    batch.configure(100, std::chrono::seconds(10));
+    ASSERT_TRUE(batch.isAggregationEnabled());
+
+    auto now = std::chrono::steady_clock::now();
+    vector<AuthCdr> records;
+    ASSERT_FALSE(batch.take(records, false, now));
+
+    //brute-force attempts from one source
+    for(int i = 0; i < 1000; i++)
+        ASSERT_FALSE(batch.add(make_auth_log("10.0.0.1", "user", 401)));
+    //different username, source and result are not merged
+    batch.add(make_auth_log("10.0.0.1", "user2", 401));
+    batch.add(make_auth_log("10.0.0.2", "user", 401));
+    batch.add(make_auth_log("10.0.0.1", "user", 200));
+
+    ASSERT_FALSE(batch.take(records, false, now + std::chrono::seconds(5)));
+    ASSERT_TRUE(batch.take(records, false, now + std::chrono::seconds(10)));
+    ASSERT_EQ(records.size(), 4u);
+    ASSERT_EQ(records[0].get_count(), 1000u);
+    ASSERT_EQ(records[1].get_count(), 1u);
+    ASSERT_EQ(records[2].get_count(), 1u);
+    ASSERT_EQ(records[3].get_count(), 1u);
+
+    //new window
+    batch.add(make_auth_log("10.0.0.1", "user", 401));
+    records.clear();
+    ASSERT_TRUE(batch.take(records, true));
+    ASSERT_EQ(records.size(), 1u);
+    ASSERT_EQ(records[0].get_count(), 1u);
+
+    AmArg stats;
+    batch.getStats(stats);
+    ASSERT_GT(stats["aggregation_ratio"].asDouble(), 100.0);
+}
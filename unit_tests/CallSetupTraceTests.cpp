@@ -0,0 +1,123 @@
+#include "YetiTest.h"
+#include "../src/CallSetupTrace.h"
+
+#include <chrono>
+#include <thread>
+
+TEST_F(YetiTest, CallSetupTraceStages)
+{
+    CallSetupTrace t;
+
+    //not started traces ignore marks
+    t.begin(CallSetupTrace::PreAuth);
+    t.end(CallSetupTrace::PreAuth);
+    t.finish();
+    ASSERT_FALSE(t.isStarted());
+    ASSERT_FALSE(t.isFinished());
+    ASSERT_EQ(t.getStageDuration(CallSetupTrace::PreAuth), -1);
+
+    t.start();
+    t.begin(CallSetupTrace::PreAuth);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    t.end(CallSetupTrace::PreAuth);
+
+    //end without begin
+    t.end(CallSetupTrace::DigestAuth);
+    //begin without end
+    t.begin(CallSetupTrace::RadiusAuth);
+
+    t.begin(CallSetupTrace::ResourcesCheck);
+    auto first_begin = t.getStageBegin(CallSetupTrace::ResourcesCheck);
+    t.end(CallSetupTrace::ResourcesCheck);
+    //repeated stage keeps the first begin
+    t.begin(CallSetupTrace::ResourcesCheck);
+    t.end(CallSetupTrace::ResourcesCheck);
+    ASSERT_EQ(t.getStageBegin(CallSetupTrace::ResourcesCheck), first_begin);
+
+    ASSERT_EQ(t.getTotal(), -1);
+    t.finish();
+    ASSERT_TRUE(t.isFinished());
+
+    //marks after finish are ignored
+    t.begin(CallSetupTrace::SdpProcessing);
+    t.end(CallSetupTrace::SdpProcessing);
+    ASSERT_EQ(t.getStageDuration(CallSetupTrace::SdpProcessing), -1);
+
+    ASSERT_GE(t.getStageDuration(CallSetupTrace::PreAuth), 2000);
+    ASSERT_EQ(t.getStageDuration(CallSetupTrace::DigestAuth), -1);
+    ASSERT_EQ(t.getStageDuration(CallSetupTrace::RadiusAuth), -1);
+    ASSERT_GE(t.getStageDuration(CallSetupTrace::ResourcesCheck), 0);
+    ASSERT_GE(t.getTotal(), t.getStageDuration(CallSetupTrace::PreAuth));
+
+    AmArg a;
+    t.getInfo(a);
+    ASSERT_TRUE(a["stages"].hasMember("pre_auth"));
+    ASSERT_TRUE(a["stages"].hasMember("resources_check"));
+    ASSERT_FALSE(a["stages"].hasMember("radius_auth"));
+    ASSERT_FALSE(a["stages"].hasMember("sdp_processing"));
+    ASSERT_EQ(a["total_us"].asLongLong(), t.getTotal());
+}
+
+TEST_F(YetiTest, CallSetupTraceSamples)
+{
+    CallSetupTraceCollector c;
+    c.configure(true, 2, 3);
+
+    for(int i = 0; i < 10; i++) {
+        CallSetupTrace t;
+        t.start();
+        t.begin(CallSetupTrace::GetProfile);
+        t.end(CallSetupTrace::GetProfile);
+        t.finish();
+        c.record(t, "tag" + std::to_string(i));
+    }
+
+    //every 2nd of 10 traces, the last 3 of them
+    AmArg ret;
+    c.getSamples(ret);
+    ASSERT_EQ(ret.size(), 3);
+    ASSERT_EQ(ret[0]["local_tag"].asCStr(), string("tag4"));
+    ASSERT_EQ(ret[1]["local_tag"].asCStr(), string("tag6"));
+    ASSERT_EQ(ret[2]["local_tag"].asCStr(), string("tag8"));
+    ASSERT_TRUE(ret[0]["stages"].hasMember("getprofile"));
+
+    //not finished traces are not recorded
+    c.configure(true, 1, 3);
+    CallSetupTrace t;
+    t.start();
+    c.record(t, "not_finished");
+    ret.clear();
+    c.getSamples(ret);
+    ASSERT_EQ(ret.size(), 0);
+}
+
+/* tracing cost for the call with all stages passed
+ * compared to the 1 second budget of the single thread at 1000 CPS.
+ * './run_unit_test.sh YetiTest.DISABLED_CallSetupTraceOverhead' */
+TEST_F(YetiTest, DISABLED_CallSetupTraceOverhead)
+{
+    static const int calls = 1000000;
+    static const double cps = 1000;
+
+    CallSetupTraceCollector c;
+    c.configure(true, 100, 128);
+
+    string local_tag("benchmark-local-tag");
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < calls; i++) {
+        CallSetupTrace t;
+        t.start();
+        for(int s = 0; s < CallSetupTrace::MaxStage; s++) {
+            t.begin(static_cast<CallSetupTrace::Stage>(s));
+            t.end(static_cast<CallSetupTrace::Stage>(s));
+        }
+        t.finish();
+        c.record(t, local_tag);
+    }
+    auto per_call_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / calls;
+
+    RecordProperty("ns_per_call", std::to_string(per_call_ns));
+    RecordProperty("cpu_percent", std::to_string(per_call_ns * cps / 1e9 * 100));
+    RecordProperty("cps", std::to_string(cps));
+}
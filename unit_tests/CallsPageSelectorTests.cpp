@@ -0,0 +1,29 @@
+#include "YetiTest.h"
+#include "../src/hash/CallsPageSelector.h"
+
+TEST_F(YetiTest, CallsPageSelector)
+{
+    vector<string> tags{ "e", "a", "d", "b", "f", "c" };
+
+    CallsPageSelector first("", 4);
+    for(const auto &t : tags) first.offer(t);
+    ASSERT_TRUE(first.hasMore());
+    ASSERT_EQ(first.getMatched(), 6u);
+    ASSERT_EQ(first.finish(), (vector<string>{ "a", "b", "c", "d" }));
+
+    CallsPageSelector second("d", 4);
+    for(const auto &t : tags) second.offer(t);
+    ASSERT_FALSE(second.hasMore());
+    ASSERT_EQ(second.getMatched(), 2u);
+    ASSERT_EQ(second.finish(), (vector<string>{ "e", "f" }));
+
+    CallsPageSelector exact("b", 4);
+    for(const auto &t : tags) exact.offer(t);
+    ASSERT_FALSE(exact.hasMore());
+    ASSERT_EQ(exact.finish(), (vector<string>{ "c", "d", "e", "f" }));
+
+    CallsPageSelector last("f", 4);
+    for(const auto &t : tags) last.offer(t);
+    ASSERT_FALSE(last.hasMore());
+    ASSERT_TRUE(last.finish().empty());
+}
@@ -2,6 +2,8 @@
 #include "../src/CertCache.h"
 #include <botan/data_src.h>
 
+#include <chrono>
+
 string cert_with_TNAuthList =
 "-----BEGIN CERTIFICATE-----\
 MIIDBDCCAqqgAwIBAgIUYTCTlxQtIe18LLsPvlgefvARxdswCgYIKoZIzj0EAwIw\
@@ -32,3 +34,113 @@ TEST_F(YetiTest, parseTNAuthList) {
     CertCache::serialize_cert_to_amarg(cert, a);
     ASSERT_EQ(a["tn_auth_list"][0]["spc"], "063E");
 }
+
+TEST_F(YetiTest, TrustedRepositoryMatcher) {
+    vector<string> patterns = {
+        "https://cert.example.com/.*",
+        "https://cr\\.example\\.org/x5u/.*",
+        "^https://exact\\.net/a\\.pem$",
+        "https://[a-z]+\\.rx\\.com/.*",
+        "http://host:8080/p.*"
+    };
+    TrustedRepositoryMatcher m;
+    for(const auto &p : patterns)
+        m.add(p);
+
+    auto s = m.getStats();
+    ASSERT_EQ(s.exact, size_t{1});
+    ASSERT_EQ(s.host_prefixes, size_t{2});
+    ASSERT_EQ(s.prefixes, size_t{1});
+    ASSERT_EQ(s.regexes, size_t{1});
+
+    for(const auto &url : {
+        "https://cert.example.com/a.pem",
+        "https://certXexample.com/a.pem",
+        "https://cr.example.org/x5u/1",
+        "https://crXexample.org/x5u/1",
+        "https://exact.net/a.pem",
+        "https://exact.net/aXpem",
+        "https://abc.rx.com/1",
+        "https://1.rx.com/1",
+        "http://host:8080/pa",
+        "http://host:8081/pa" })
+    {
+        bool expected = false;
+        for(const auto &p : patterns)
+            if(std::regex_match(url, std::regex(p))) expected = true;
+        //second call is served from memo
+        ASSERT_EQ(m.match(url), expected) << url;
+        ASSERT_EQ(m.match(url), expected) << url;
+    }
+
+    ASSERT_THROW(m.add("https://(.*"), std::regex_error);
+
+    m.clear();
+    ASSERT_FALSE(m.match("https://cert.example.com/a.pem"));
+}
+
+/* x5u lookups against 1k trusted repositories
+ * run: ./run_unit_test.sh YetiTest.DISABLED_TrustedRepositoryMatcherBenchmark */
+TEST_F(YetiTest, DISABLED_TrustedRepositoryMatcherBenchmark) {
+    static const int repositories = 1000;
+    static const int urls_count = 1000;
+    static const int rounds = 10;
+
+    vector<std::regex> regexes;
+    TrustedRepositoryMatcher m;
+    for(int i = 0; i < repositories; i++) {
+        string p;
+        switch(i % 4) {
+        case 0: p = "https://cert" + std::to_string(i) + "\\.example\\.com/.*"; break;
+        case 1: p = "https://cr" + std::to_string(i) + ".example.net/x5u/.*"; break;
+        case 2: p = "https://repo\\.example\\.org/" + std::to_string(i) + "/cert\\.pem"; break;
+        case 3: p = "https://[a-z]+" + std::to_string(i) + "\\.rx\\.com/.*"; break;
+        }
+        regexes.emplace_back(p);
+        m.add(p);
+    }
+
+    vector<string> urls;
+    for(int i = 0; i < urls_count; i++) {
+        //every second URL is untrusted
+        urls.emplace_back(
+            "https://cert" + std::to_string(i * 2) + ".example.com/shaken.pem");
+    }
+
+    size_t trusted = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(const auto &url : urls) {
+        for(const auto &r : regexes) {
+            if(std::regex_match(url, r)) {
+                trusted++;
+                break;
+            }
+        }
+    }
+    auto regex_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count() / urls_count;
+
+    start = std::chrono::steady_clock::now();
+    for(const auto &url : urls)
+        if(m.match(url)) trusted++;
+    auto cold_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count() / urls_count;
+
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < rounds; i++)
+        for(const auto &url : urls)
+            if(m.match(url)) trusted++;
+    auto memo_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count() / (urls_count * rounds);
+
+    auto s = m.getStats();
+    RecordProperty("repositories", repositories);
+    RecordProperty("exact", std::to_string(s.exact));
+    RecordProperty("host_prefixes", std::to_string(s.host_prefixes));
+    RecordProperty("prefixes", std::to_string(s.prefixes));
+    RecordProperty("regexes", std::to_string(s.regexes));
+    RecordProperty("regex_ns_per_lookup", std::to_string(regex_ns));
+    RecordProperty("compiled_ns_per_lookup", std::to_string(cold_ns));
+    RecordProperty("memo_ns_per_lookup", std::to_string(memo_ns));
+    RecordProperty("trusted", std::to_string(trusted));
+}
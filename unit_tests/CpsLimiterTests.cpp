@@ -0,0 +1,152 @@
+#include "YetiTest.h"
+#include "../src/CpsLimiter.h"
+
+#include <chrono>
+
+static CpsLimiter::Key ipv4_key(uint32_t ip)
+{
+    return CpsLimiter::Key{0, 0xffff00000000ULL | ip};
+}
+
+TEST_F(YetiTest, CpsLimiterTokenBucket)
+{
+    CpsLimiter limiter;
+    limiter.configure(10, 1000);
+
+    CpsLimiter::Key key, other_key;
+    ASSERT_TRUE(CpsLimiter::Key::fromString("192.168.0.1", key));
+    ASSERT_TRUE(CpsLimiter::Key::fromString("192.168.0.2", other_key));
+    ASSERT_EQ(key, ipv4_key(0xc0a80001));
+
+    uint64_t now = 1000000;
+
+    //burst of the default limit
+    for(int i = 0; i < 10; i++)
+        ASSERT_TRUE(limiter.check(key, 0, now));
+    ASSERT_FALSE(limiter.check(key, 0, now));
+
+    //other sources are not affected
+    ASSERT_TRUE(limiter.check(other_key, 0, now));
+
+    //refill with 10 tokens per second
+    ASSERT_FALSE(limiter.check(key, 0, now + 50));
+    ASSERT_TRUE(limiter.check(key, 0, now + 150));
+    ASSERT_FALSE(limiter.check(key, 0, now + 150));
+
+    //ip_auth limit overrides the default one
+    now += 10000;
+    for(int i = 0; i < 100; i++)
+        ASSERT_TRUE(limiter.check(key, 100, now));
+    ASSERT_FALSE(limiter.check(key, 100, now));
+
+    //IPv6
+    ASSERT_TRUE(CpsLimiter::Key::fromString("2001:db8::1", key));
+    ASSERT_FALSE(key == other_key);
+    for(int i = 0; i < 10; i++)
+        ASSERT_TRUE(limiter.check(key, 0, now));
+    ASSERT_FALSE(limiter.check(key, 0, now));
+
+    AmArg state;
+    limiter.getState(state);
+    ASSERT_EQ(state["sources"].asInt(), 3);
+}
+
+TEST_F(YetiTest, CpsLimiterNoDefaultLimit)
+{
+    CpsLimiter limiter;
+    limiter.configure(0, 1000);
+
+    auto key = ipv4_key(0x0a000001);
+    for(int i = 0; i < 1000; i++)
+        ASSERT_TRUE(limiter.check(key, 0, 1000));
+    ASSERT_EQ(limiter.getSourcesCount(), 0u);
+
+    ASSERT_TRUE(limiter.check(key, 1, 1000));
+    ASSERT_FALSE(limiter.check(key, 1, 1000));
+}
+
+TEST_F(YetiTest, CpsLimiterIdleEviction)
+{
+    CpsLimiter limiter;
+    limiter.configure(5, 10000);
+
+    uint64_t now = 1000000;
+    for(uint32_t i = 0; i < 10000; i++)
+        ASSERT_TRUE(limiter.check(ipv4_key(i), 0, now));
+    ASSERT_EQ(limiter.getSourcesCount(), 10000u);
+
+    //flooding source is kept while others are idle
+    auto flood_key = ipv4_key(1);
+    now += CPS_LIMITER_IDLE_TIMEOUT_MS;
+    for(int i = 0; i < 5; i++)
+        ASSERT_TRUE(limiter.check(flood_key, 0, now));
+    ASSERT_FALSE(limiter.check(flood_key, 0, now));
+
+    //new sources replace idle ones instead of the table growth
+    for(uint32_t i = 10000; i < 20000; i++)
+        ASSERT_TRUE(limiter.check(ipv4_key(i), 0, now));
+    ASSERT_LE(limiter.getSourcesCount(), 10001u);
+    ASSERT_FALSE(limiter.check(flood_key, 0, now));
+}
+
+TEST_F(YetiTest, CpsLimiterStaleTimestamp)
+{
+    CpsLimiter limiter;
+    limiter.configure(10, 10000);
+
+    auto key = ipv4_key(0x0a000001);
+    uint64_t now = 1000000;
+
+    for(int i = 0; i < 10; i++)
+        ASSERT_TRUE(limiter.check(key, 0, now));
+    ASSERT_FALSE(limiter.check(key, 0, now));
+
+    //clock read before the previous check must not refill the bucket
+    ASSERT_FALSE(limiter.check(key, 0, now - 500));
+    ASSERT_FALSE(limiter.check(key, 0, now - CPS_LIMITER_IDLE_TIMEOUT_MS));
+    ASSERT_FALSE(limiter.check(key, 0, now));
+    //and must not move the bucket time backwards
+    ASSERT_FALSE(limiter.check(key, 0, now + 50));
+    ASSERT_TRUE(limiter.check(key, 0, now + 150));
+
+    //active bucket is not evicted by the table rebuild with the stale time
+    for(uint32_t i = 0; i < 10000; i++)
+        limiter.check(ipv4_key(0x0b000000 + i), 0, now - CPS_LIMITER_IDLE_TIMEOUT_MS);
+    ASSERT_FALSE(limiter.check(key, 0, now + 150));
+}
+
+/* 1M distinct sources followed by the flood from the limited ones
+ * run: ./run_unit_test.sh YetiTest.DISABLED_CpsLimiterBenchmark */
+TEST_F(YetiTest, DISABLED_CpsLimiterBenchmark)
+{
+    static const uint32_t sources = 1000000;
+    static const int flood_rounds = 10;
+
+    CpsLimiter limiter;
+    limiter.configure(1, sources);
+
+    uint64_t now = 1000000;
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < sources; i++)
+        limiter.check(ipv4_key(i), 0, now);
+    auto insert_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    ASSERT_EQ(limiter.getSourcesCount(), sources);
+
+    unsigned long rejected = 0;
+    start = std::chrono::steady_clock::now();
+    for(int r = 0; r < flood_rounds; r++) {
+        for(uint32_t i = 0; i < sources; i++)
+            rejected += !limiter.check(ipv4_key(i), 0, now);
+    }
+    auto reject_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    ASSERT_EQ(rejected, static_cast<unsigned long>(sources) * flood_rounds);
+
+    RecordProperty("sources", std::to_string(sources));
+    RecordProperty("new_source_ns", std::to_string(static_cast<double>(insert_ns) / sources));
+    RecordProperty("rejection_ns", std::to_string(static_cast<double>(reject_ns) / (sources * flood_rounds)));
+}
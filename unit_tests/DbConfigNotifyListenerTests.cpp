@@ -0,0 +1,123 @@
+#include "YetiTest.h"
+#include "../src/db/DbConfigNotifyListener.h"
+
+#include <libpq-fe.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <condition_variable>
+
+TEST_F(YetiTest, DbConfigNotifyPayload)
+{
+    auto n = DbConfigNotifyListener::Notification::parse("auth_credentials:42");
+    ASSERT_EQ(n.key, "auth_credentials");
+    ASSERT_EQ(n.version, 42);
+
+    n = DbConfigNotifyListener::Notification::parse("ip_auth");
+    ASSERT_EQ(n.key, "ip_auth");
+    ASSERT_EQ(n.version, -1);
+
+    n = DbConfigNotifyListener::Notification::parse("");
+    ASSERT_TRUE(n.key.empty());
+    ASSERT_EQ(n.version, -1);
+
+    n = DbConfigNotifyListener::Notification::parse("key:with:colons");
+    ASSERT_EQ(n.key, "key:with:colons");
+    ASSERT_EQ(n.version, -1);
+
+    n = DbConfigNotifyListener::Notification::parse("sensors:-1");
+    ASSERT_EQ(n.key, "sensors:-1");
+    ASSERT_EQ(n.version, -1);
+}
+
+/* NOTIFY -> listener callback propagation latency.
+ * simulates config changes with pg_notify() from the separate connection
+ * and compares with the expected delay of check_states() polling.
+ * requires PostgreSQL:
+ *   YETI_TEST_PG_CONNINFO="host=127.0.0.1 user=yeti dbname=yeti" \
+ *     ./run_unit_test.sh YetiTest.DISABLED_DbConfigNotifyLatency */
+TEST_F(YetiTest, DISABLED_DbConfigNotifyLatency)
+{
+    static const int notifications_count = 1000;
+    static const int poll_interval_sec = 300;
+    static const char *channel = "yeti_cfg_test";
+
+    const char *conninfo = getenv("YETI_TEST_PG_CONNINFO");
+    if(!conninfo) GTEST_SKIP() << "YETI_TEST_PG_CONNINFO is not set";
+
+    std::mutex m;
+    std::condition_variable cv;
+    bool listening = false;
+    int received = 0;
+    std::vector<std::chrono::steady_clock::time_point> received_at(notifications_count);
+
+    DbConfigNotifyListener listener;
+    ASSERT_EQ(0, listener.configure(conninfo, channel,
+        [&](const string &payload) {
+            auto n = DbConfigNotifyListener::Notification::parse(payload);
+            std::lock_guard<std::mutex> l(m);
+            if(n.version >= 0 && n.version < notifications_count)
+                received_at[n.version] = std::chrono::steady_clock::now();
+            received++;
+            cv.notify_all();
+        },
+        [&]() {
+            std::lock_guard<std::mutex> l(m);
+            listening = true;
+            cv.notify_all();
+        }));
+    listener.start();
+
+    bool ready;
+    {
+        std::unique_lock<std::mutex> l(m);
+        ready = cv.wait_for(l, std::chrono::seconds(5), [&]() { return listening; });
+    }
+    if(!ready) {
+        listener.stop(true);
+        FAIL() << "failed to LISTEN on '" << channel << "'";
+    }
+
+    PGconn *conn = PQconnectdb(conninfo);
+    ASSERT_EQ(PQstatus(conn), CONNECTION_OK);
+
+    std::vector<std::chrono::steady_clock::time_point> sent_at(notifications_count);
+    for(int i = 0; i < notifications_count; i++) {
+        string payload = "auth_credentials:" + std::to_string(i);
+        const char *params[] = { channel, payload.data() };
+        sent_at[i] = std::chrono::steady_clock::now();
+        PGresult *res = PQexecParams(conn, "SELECT pg_notify($1, $2)",
+                                     2, nullptr, params, nullptr, nullptr, 0);
+        ASSERT_EQ(PQresultStatus(res), PGRES_TUPLES_OK);
+        PQclear(res);
+    }
+
+    {
+        std::unique_lock<std::mutex> l(m);
+        ASSERT_TRUE(cv.wait_for(l, std::chrono::seconds(10),
+            [&]() { return received >= notifications_count; }));
+    }
+
+    PQfinish(conn);
+    listener.stop(true);
+
+    std::vector<long> latencies;
+    for(int i = 0; i < notifications_count; i++) {
+        latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+            received_at[i] - sent_at[i]).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    long sum = 0;
+    for(auto l : latencies) sum += l;
+
+    RecordProperty("notifications", notifications_count);
+    RecordProperty("notify_avg_us", std::to_string(sum / notifications_count));
+    RecordProperty("notify_p50_us", std::to_string(latencies[notifications_count / 2]));
+    RecordProperty("notify_p99_us", std::to_string(latencies[notifications_count * 99 / 100]));
+    RecordProperty("notify_max_us", std::to_string(latencies.back()));
+    RecordProperty("poll_interval_sec", poll_interval_sec);
+    RecordProperty("poll_avg_sec", poll_interval_sec / 2);
+}
@@ -0,0 +1,46 @@
+#include "YetiTest.h"
+#include "../src/db/DbConfigReloadStats.h"
+
+TEST_F(YetiTest, DbConfigReloadStats)
+{
+    DbConfigReloadStats stats;
+
+    AmArg data;
+    for(int i = 0; i < 10; i++) {
+        AmArg row;
+        row["id"] = i;
+        row["username"] = "user";
+        row["password"] = "password";
+        data.push(row);
+    }
+    ASSERT_EQ(DbConfigReloadStats::estimateSize(data), 10u * (4 + 4 + 8));
+
+    auto now = std::chrono::steady_clock::now();
+    stats.onRequest("auth_credentials");
+    stats.onApplied("auth_credentials", false, data, std::chrono::microseconds(150), now);
+
+    AmArg delta;
+    delta.push(data[0]);
+    stats.onRequest("auth_credentials");
+    stats.onApplied("auth_credentials", true, delta, std::chrono::microseconds(10), now);
+    stats.onDeltaFallback("auth_credentials");
+
+    //subkey uses the state key request time
+    stats.onRequest("translations");
+    stats.onApplied("translations.dc_rewrite", false, data, std::chrono::microseconds(10));
+
+    AmArg ret;
+    stats.getStats(ret);
+    ASSERT_FALSE(ret.hasMember("translations"));
+    ASSERT_TRUE(ret.hasMember("translations.dc_rewrite"));
+    ASSERT_GE(ret["translations.dc_rewrite"]["last_request_ms"].asLongLong(), 0);
+
+    AmArg &credentials = ret["auth_credentials"];
+    ASSERT_EQ(credentials["full_reloads"].asLongLong(), 1);
+    ASSERT_EQ(credentials["delta_reloads"].asLongLong(), 1);
+    ASSERT_EQ(credentials["delta_fallbacks"].asLongLong(), 1);
+    ASSERT_EQ(credentials["last_rows"].asLongLong(), 1);
+    ASSERT_EQ(credentials["last_bytes"].asLongLong(), 16);
+    ASSERT_EQ(credentials["total_bytes"].asLongLong(), 176);
+    ASSERT_EQ(credentials["last_apply_us"].asLongLong(), 10);
+}
@@ -0,0 +1,72 @@
+#include "YetiTest.h"
+#include "../src/db/DbConfigSnapshot.h"
+
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TEST_F(YetiTest, DbConfigSnapshot)
+{
+    char dir[] = "/tmp/yeti_db_snapshot_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir));
+
+    AmArg data;
+    data.assertArray();
+    for(int i = 0; i < 3; i++) {
+        AmArg row;
+        row["id"] = i;
+        row["big_id"] = 4294967296LL + i;
+        row["enabled"] = (i % 2) == 0;
+        row["weight"] = 0.5 * i;
+        row["name"] = "row" + std::to_string(i);
+        row["nullable"] = AmArg();
+        row["list"].push(AmArg("a"));
+        row["list"].push(AmArg(i));
+        data.push(row);
+    }
+
+    DbConfigSnapshot snapshot;
+    ASSERT_FALSE(snapshot.save("codec_groups", 1, data));
+
+    ASSERT_EQ(chmod(dir, 0755), 0);
+    snapshot.configure(dir, "1/2");
+    ASSERT_TRUE(snapshot.save("codec_groups", 42, data));
+
+    //snapshots are readable by the owner only
+    struct stat st;
+    ASSERT_EQ(stat(dir, &st), 0);
+    ASSERT_EQ(st.st_mode & ALLPERMS, static_cast<mode_t>(0700));
+    ASSERT_EQ(stat((string(dir) + "/codec_groups.snapshot").data(), &st), 0);
+    ASSERT_EQ(st.st_mode & ALLPERMS, static_cast<mode_t>(0600));
+
+    long long version = 0;
+    AmArg loaded;
+    ASSERT_TRUE(snapshot.load("codec_groups", version, loaded));
+    ASSERT_EQ(version, 42);
+    ASSERT_EQ(AmArg::print(loaded), AmArg::print(data));
+
+    //types are preserved
+    AmArg &row = loaded[1];
+    ASSERT_TRUE(isArgInt(row["id"]));
+    ASSERT_TRUE(isArgLongLong(row["big_id"]));
+    ASSERT_EQ(row["big_id"].asLongLong(), 4294967297LL);
+    ASSERT_TRUE(isArgBool(row["enabled"]));
+    ASSERT_TRUE(isArgDouble(row["weight"]));
+    ASSERT_TRUE(isArgUndef(row["nullable"]));
+
+    //missed
+    ASSERT_FALSE(snapshot.load("sensors", version, loaded));
+
+    //another node
+    DbConfigSnapshot other_snapshot;
+    other_snapshot.configure(dir, "2/2");
+    ASSERT_FALSE(other_snapshot.load("codec_groups", version, loaded));
+
+    //truncated
+    string path = string(dir) + "/codec_groups.snapshot";
+    ASSERT_EQ(truncate(path.data(), 64), 0);
+    ASSERT_FALSE(snapshot.load("codec_groups", version, loaded));
+
+    unlink(path.data());
+    rmdir(dir);
+}
@@ -0,0 +1,324 @@
+#include "YetiBench.h"
+#include "../src/SqlCallProfile.h"
+#include "../src/cdr/Cdr.h"
+#include "../src/cdr/AuthCdr.h"
+#include "../src/hash/CdrFilter.h"
+#include "../src/HeaderFilter.h"
+#include "../src/sdp_filter.h"
+#include "../src/SDPFilter.h"
+#include "../src/ParamReplacer.h"
+#include "../src/OriginationPreAuth.h"
+#include "../src/SipHeaderIndex.h"
+#include "../src/CodesTranslator.h"
+#include "../src/resources/ResourceRedisConnection.h"
+#include "../src/resources/ResourceSequences.h"
+#include "../src/yeti.h"
+
+#include "sip/defs.h"
+
+/* hot paths of the call setup on the recorded getprofile row and INVITE.
+ * see YetiBench.h to run and to compare with the baseline */
+
+#define BENCH_PROFILE_ROW "getprofile_row.json"
+#define BENCH_INVITE "invite.sip"
+
+static bool bench_profile(const AmArg &row, SqlCallProfile &p)
+{
+    return p.readFromTuple(row, DynFieldsT());
+}
+
+TEST_F(YetiBench, SqlCallProfileReadFromTuple)
+{
+    AmArg row = fixtureJson(BENCH_PROFILE_ROW);
+    size_t failed = 0;
+
+    measure("SqlCallProfile::readFromTuple", 20000, [&]() {
+        SqlCallProfile p;
+        if(!bench_profile(row, p)) failed++;
+    });
+    ASSERT_EQ(failed, size_t{0});
+}
+
+TEST_F(YetiBench, CdrApplyParams)
+{
+    SqlCallProfile p;
+    ASSERT_TRUE(bench_profile(fixtureJson(BENCH_PROFILE_ROW), p));
+    Cdr cdr(p);
+    DynFieldsT df;
+    size_t params = 0;
+
+    measure("Cdr::apply_params", 20000, [&]() {
+        QueryInfo q("writecdr", false);
+        cdr.apply_params(q, df);
+        params += q.params.size();
+    });
+    ASSERT_GT(params, size_t{0});
+}
+
+TEST_F(YetiBench, AuthCdrApplyParams)
+{
+    AmSipRequest req;
+    fixtureRequest(BENCH_INVITE, req);
+    AuthCdr auth_log(req, vector<UsedHeaderField>(), false,
+                     401, "Unauthorized", "no auth credentials", 0);
+    size_t params = 0;
+
+    measure("AuthCdr::apply_params", 50000, [&]() {
+        QueryInfo q("writeauth", false);
+        auth_log.apply_params(q, true);
+        params += q.params.size();
+    });
+    ASSERT_GT(params, size_t{0});
+}
+
+TEST_F(YetiBench, CdrFilterApplyRules)
+{
+    SqlCallProfile p;
+    ASSERT_TRUE(bench_profile(fixtureJson(BENCH_PROFILE_ROW), p));
+    Cdr cdr(p);
+    cdr.attempt_num = 1;
+
+    AmArg params;
+    for(auto v : { "local_tag", "duration", "WHERE", "attempt_num=1", "duration>=0" })
+        params.push(v);
+
+    cmp_rules rules;
+    vector<string> fields;
+    ASSERT_NO_THROW(parse_fields(rules, params, fields));
+
+    size_t matched = 0;
+    measure("CdrFilter parse_fields", 50000, [&]() {
+        cmp_rules r;
+        vector<string> f;
+        parse_fields(r, params, f);
+        matched += r.size();
+    });
+    measure("CdrFilter apply_filter_rules", 1000000, [&]() {
+        if(apply_filter_rules(&cdr, rules)) matched++;
+    });
+    ASSERT_GT(matched, size_t{0});
+}
+
+TEST_F(YetiBench, HeaderFilter)
+{
+    SqlCallProfile p;
+    ASSERT_TRUE(bench_profile(fixtureJson(BENCH_PROFILE_ROW), p));
+    AmSipRequest req;
+    fixtureRequest(BENCH_INVITE, req);
+    ASSERT_FALSE(req.hdrs.empty());
+
+    vector<FilterEntry> blacklist(1);
+    blacklist.front().filter_type = FilterType::Blacklist;
+    for(auto h : { "user-agent", "privacy", "p-charging-vector", "min-se" })
+        blacklist.front().filter_list.emplace(h);
+
+    size_t size = 0;
+    measure("inplaceHeaderFilter", 200000, [&]() {
+        string hdrs(req.hdrs);
+        inplaceHeaderFilter(hdrs, blacklist);
+        size += hdrs.size();
+    });
+    measure("inplaceHeaderPatternFilter", 200000, [&]() {
+        string hdrs(req.hdrs);
+        inplaceHeaderPatternFilter(hdrs, *p.headerfilter_a2b);
+        size += hdrs.size();
+    });
+    ASSERT_GT(size, size_t{0});
+}
+
+/* processSdpOffer requires the call leg for the offers cache.
+ * measures its processing chain for the relayed offer without the cache */
+TEST_F(YetiBench, SdpOffer)
+{
+    SqlCallProfile p;
+    ASSERT_TRUE(bench_profile(fixtureJson(BENCH_PROFILE_ROW), p));
+    AmSipRequest req;
+    string offer = fixtureRequest(BENCH_INVITE, req);
+
+    CodecsGroupEntry codecs_group;
+    for(const auto &c : { "PCMA/8000", "PCMU/8000", "G729/8000", "telephone-event/8000" })
+        codecs_group.add_codec(c, "", NO_DYN_PAYLOAD);
+
+    size_t failed = 0, size = 0;
+    measure("processSdpOffer chain", 20000, [&]() {
+        AmSdp sdp;
+        string body;
+        if(sdp.parse(offer.data()) ||
+           filter_arrange_SDP(sdp, codecs_group, false) ||
+           filterSDPalines(sdp, *p.sdpalinesfilter) ||
+           filterNoAudioStreams(sdp, p.filter_noaudio_streams))
+        {
+            failed++;
+            return;
+        }
+        sdp.print(body);
+        size += body.size();
+    });
+    ASSERT_EQ(failed, size_t{0});
+    ASSERT_GT(size, size_t{0});
+}
+
+TEST_F(YetiBench, ReplaceParameters)
+{
+    SqlCallProfile p;
+    ASSERT_TRUE(bench_profile(fixtureJson(BENCH_PROFILE_ROW), p));
+    AmSipRequest req;
+    fixtureRequest(BENCH_INVITE, req);
+
+    const vector<string> fields = {
+        p.ruri, p.from, p.to, p.callid,
+        p.append_headers, p.append_headers_req, p.aleg_append_headers_reply
+    };
+
+    size_t size = 0;
+    measure("replaceParameters per profile", 50000, [&]() {
+        ParamReplacerCtx ctx;
+        for(const auto &f : fields)
+            size += ctx.replaceParameters(f, "bench", req).size();
+    });
+    ASSERT_GT(size, size_t{0});
+}
+
+TEST_F(YetiBench, OriginationPreAuthOnInvite)
+{
+    static const int subnets = 256;
+
+    AmSipRequest req;
+    fixtureRequest(BENCH_INVITE, req);
+
+    auto &cfg = Yeti::instance().config;
+    const string orig_ip("198.51.100.77");
+    if(!cfg.ip_auth_hdr.empty())
+        req.hdrs += cfg.ip_auth_hdr + ": " + orig_ip + CRLF;
+    req.hdrs += "X-YETI-AUTH: edge-2" CRLF;
+
+    OriginationPreAuth pre_auth(cfg);
+
+    AmArg balancers, lb;
+    lb["id"] = 1;
+    lb["name"] = "edge";
+    lb["signalling_ip"] = req.remote_ip;
+    balancers.push(lb);
+    pre_auth.reloadLoadBalancers(balancers);
+
+    AmArg ip_auths;
+    auto add_ip_auth = [&ip_auths](const string &ip, const string &x_yeti_auth) {
+        AmArg a;
+        a["ip"] = ip;
+        a["x_yeti_auth"] = x_yeti_auth;
+        a["require_incoming_auth"] = false;
+        a["require_identity_parsing"] = true;
+        a["cps_limit"] = 0;
+        ip_auths.push(a);
+    };
+    for(int i = 0; i < subnets; i++)
+        add_ip_auth("10." + std::to_string(i) + ".0.0/16", "");
+    add_ip_auth("198.51.100.0/24", "");
+    add_ip_auth("198.51.100.64/26", "edge-2");
+    add_ip_auth(req.remote_ip + "/32", "");
+    pre_auth.reloadLoadIPAuth(ip_auths);
+
+    size_t matched = 0;
+    measure("OriginationPreAuth::onInvite", 100000, [&]() {
+        OriginationPreAuth::Reply reply;
+        SipHeaderIndex hdrs_index(req.hdrs);
+        if(pre_auth.onInvite(req, hdrs_index, reply)) matched++;
+    });
+    ASSERT_GT(matched, size_t{0});
+}
+
+TEST_F(YetiBench, CodesTranslatorLookup)
+{
+    static const unsigned int codes[] = { 180, 183, 200, 403, 404, 408, 480, 486, 487, 488, 500, 503, 603 };
+
+    CodesTranslator ct;
+
+    AmArg rewrite, refuse, rerouting;
+    for(auto code : codes) {
+        AmArg r;
+        r["o_code"] = static_cast<int>(code);
+        r["o_reason"] = "reason " + std::to_string(code);
+        r["o_rewrited_code"] = code == 603 ? 480 : static_cast<int>(code);
+        r["o_rewrited_reason"] = "";
+        r["o_pass_reason_to_originator"] = false;
+        rewrite.push(r);
+
+        AmArg s;
+        s["received_code"] = static_cast<int>(code);
+        s["stop_rerouting"] = code < 500;
+        rerouting.push(s);
+    }
+    for(int i = 1; i <= 120; i++) {
+        AmArg r;
+        r["o_id"] = 8000 + i;
+        r["o_code"] = 400 + i % 200;
+        r["o_reason"] = "internal " + std::to_string(i);
+        r["o_rewrited_code"] = 403;
+        r["o_rewrited_reason"] = "Forbidden";
+        r["o_store_cdr"] = true;
+        r["o_silently_drop"] = false;
+        refuse.push(r);
+    }
+    ct.load_disconnect_code_rewrite(rewrite);
+    ct.load_disconnect_code_refuse(refuse);
+    ct.load_disconnect_code_rerouting(rerouting);
+
+    size_t hits = 0;
+    unsigned int k = 0;
+    measure("CodesTranslator reply lookups", 500000, [&]() {
+        unsigned int code = codes[k++ % (sizeof(codes) / sizeof(codes[0]))], out_code;
+        string out_reason;
+        ct.rewrite_response(code, "Reason", out_code, out_reason);
+        if(ct.stop_hunting(out_code)) hits++;
+    });
+    measure("CodesTranslator::translate_db_code", 500000, [&]() {
+        unsigned int internal_code, response_code;
+        string internal_reason, response_reason;
+        if(ct.translate_db_code(8001 + k++ % 120, internal_code, internal_reason,
+                                response_code, response_reason))
+        {
+            hits++;
+        }
+    });
+    ASSERT_GT(hits, size_t{0});
+}
+
+TEST_F(YetiBench, ResourceCheck)
+{
+    SqlCallProfile p;
+    ASSERT_TRUE(bench_profile(fixtureJson(BENCH_PROFILE_ROW), p));
+
+    ResourceRedisConnection conn("resourceBench");
+    AmConfigReader cfg;
+    cfg.setParameter("write_redis_host", yeti_test::instance()->redis.host.c_str());
+    cfg.setParameter("write_redis_port", int2str(yeti_test::instance()->redis.port));
+    cfg.setParameter("read_redis_host", yeti_test::instance()->redis.host.c_str());
+    cfg.setParameter("read_redis_port", int2str(yeti_test::instance()->redis.port));
+    cfg.setParameter("read_redis_timeout", int2str(DEFAULT_REDIS_TIMEOUT_MSEC));
+    cfg.setParameter("write_redis_timeout", int2str(DEFAULT_REDIS_TIMEOUT_MSEC));
+    conn.configure(cfg);
+    conn.init();
+    conn.start();
+
+    time_t time_ = time(0);
+    while(!conn.get_write_conn()->wait_connected() &&
+          !conn.get_read_conn()->wait_connected()) {
+        ASSERT_FALSE(time(0) - time_ > 3);
+    }
+
+    ResourceList rl;
+    rl.parse(p.resources);
+    ASSERT_FALSE(rl.empty());
+
+    size_t failed = 0;
+    measure("CheckResources round trip", 1000, [&]() {
+        CheckResources *cr = new CheckResources(&conn, rl);
+        cr->perform();
+        if(!cr->wait_finish(DEFAULT_REDIS_TIMEOUT_MSEC) || cr->is_error())
+            failed++;
+        delete cr;
+    });
+    ASSERT_EQ(failed, size_t{0});
+
+    conn.stop(true);
+}
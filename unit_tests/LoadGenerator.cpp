@@ -0,0 +1,638 @@
+#include "LoadGenerator.h"
+
+#include "log.h"
+#include "sip/defs.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#define LOAD_RCVBUF_SIZE (4 * 1024 * 1024)
+#define LOAD_MAX_DATAGRAM 65535
+#define LOAD_CHECK_INTERVAL std::chrono::milliseconds(100)
+
+static const std::pair<const char *, const char *> compact_forms[] = {
+    { "v", SIP_HDR_VIA },
+    { "f", SIP_HDR_FROM },
+    { "t", SIP_HDR_TO },
+    { "i", SIP_HDR_CALL_ID },
+    { "m", SIP_HDR_CONTACT },
+    { "l", SIP_HDR_CONTENT_LENGTH },
+    { "c", SIP_HDR_CONTENT_TYPE },
+};
+
+static string trim(const string &s)
+{
+    auto b = s.find_first_not_of(" \t");
+    if(b == string::npos) return string();
+    return s.substr(b, s.find_last_not_of(" \t") - b + 1);
+}
+
+//URI of the name-addr or addr-spec
+static string uri_of(const string &value)
+{
+    auto b = value.find('<');
+    if(b != string::npos)
+        return value.substr(b + 1, value.find('>', b) - b - 1);
+    return trim(value.substr(0, value.find(';')));
+}
+
+static bool has_tag(const string &value)
+{
+    return value.find(";tag=") != string::npos;
+}
+
+static size_t heap_used()
+{
+    return mallinfo2().uordblks;
+}
+
+static size_t rss_used()
+{
+    size_t size, resident = 0;
+    std::ifstream f("/proc/self/statm");
+    f >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+static string sdp(const string &host, unsigned short port, uint64_t version)
+{
+    return
+        "v=0" CRLF
+        "o=- " + std::to_string(version) + " 1 IN IP4 " + host + CRLF
+        "s=-" CRLF
+        "c=IN IP4 " + host + CRLF
+        "t=0 0" CRLF
+        "m=audio " + std::to_string(port) + " RTP/AVP 8 0 101" CRLF
+        "a=rtpmap:8 PCMA/8000" CRLF
+        "a=rtpmap:0 PCMU/8000" CRLF
+        "a=rtpmap:101 telephone-event/8000" CRLF
+        "a=fmtp:101 0-15" CRLF
+        "a=sendrecv" CRLF;
+}
+
+LoadGenerator::config::config()
+  : target_host("127.0.0.1"),
+    target_port(50600),
+    local_host("127.0.0.1"),
+    uac_port(0),
+    uas_port(50700),
+    duration_sec(10),
+    hold_msec(2000),
+    timeout_msec(5000)
+{}
+
+LoadGenerator::report::report()
+  : offered_cps(0),
+    attempts(0),
+    answered(0),
+    failed(0),
+    timeouts(0),
+    completed(0),
+    remote_hangups(0),
+    bye_timeouts(0),
+    elapsed_sec(0),
+    peak_calls(0),
+    heap_per_call(0),
+    rss_per_call(0)
+{}
+
+double LoadGenerator::report::answeredRate() const
+{
+    return attempts ? static_cast<double>(answered) / attempts : 0;
+}
+
+double LoadGenerator::report::achievedCps() const
+{
+    return elapsed_sec > 0 ? answered / elapsed_sec : 0;
+}
+
+static void latency_info(const LatencyHistogram::Snapshot &s, AmArg &ret)
+{
+    ret["count"] = static_cast<long long>(s.count);
+    ret["p50_us"] = static_cast<long long>(s.percentile(0.5));
+    ret["p90_us"] = static_cast<long long>(s.percentile(0.9));
+    ret["p99_us"] = static_cast<long long>(s.percentile(0.99));
+    ret["max_us"] = static_cast<long long>(s.max);
+}
+
+void LoadGenerator::report::getInfo(AmArg &ret) const
+{
+    ret["offered_cps"] = static_cast<int>(offered_cps);
+    ret["achieved_cps"] = achievedCps();
+    ret["attempts"] = static_cast<long long>(attempts);
+    ret["answered"] = static_cast<long long>(answered);
+    ret["failed"] = static_cast<long long>(failed);
+    ret["timeouts"] = static_cast<long long>(timeouts);
+    ret["completed"] = static_cast<long long>(completed);
+    ret["remote_hangups"] = static_cast<long long>(remote_hangups);
+    ret["bye_timeouts"] = static_cast<long long>(bye_timeouts);
+    auto &codes = ret["failure_codes"];
+    codes.assertStruct();
+    for(const auto &it : failure_codes)
+        codes[std::to_string(it.first)] = static_cast<long long>(it.second);
+    ret["elapsed_sec"] = elapsed_sec;
+    latency_info(first_reply, ret["first_reply_latency"]);
+    latency_info(answer, ret["answer_latency"]);
+    ret["peak_calls"] = static_cast<long long>(peak_calls);
+    ret["heap_per_call"] = heap_per_call;
+    ret["rss_per_call"] = rss_per_call;
+}
+
+bool LoadGenerator::sip_msg::parse(const char *buf, size_t len)
+{
+    string msg(buf, len);
+    auto hdrs_end = msg.find(CRLF CRLF);
+    if(hdrs_end == string::npos) return false;
+    body = msg.substr(hdrs_end + 4);
+
+    size_t pos = msg.find(CRLF);
+    string first_line = msg.substr(0, pos);
+    if(first_line.compare(0, 8, "SIP/2.0 ") == 0) {
+        is_request = false;
+        code = atoi(first_line.data() + 8);
+    } else {
+        is_request = true;
+        code = 0;
+        auto sp = first_line.find(' ');
+        if(sp == string::npos) return false;
+        method = first_line.substr(0, sp);
+        ruri = first_line.substr(sp + 1, first_line.find(' ', sp + 1) - sp - 1);
+    }
+
+    hdrs.clear();
+    while(pos < hdrs_end) {
+        pos += 2;
+        auto eol = msg.find(CRLF, pos);
+        string line = msg.substr(pos, eol - pos);
+        pos = eol;
+
+        if(line.empty()) continue;
+        if((line[0] == ' ' || line[0] == '\t') && !hdrs.empty()) {
+            hdrs.back().second += " " + trim(line);
+            continue;
+        }
+
+        auto colon = line.find(':');
+        if(colon == string::npos) continue;
+        string name = trim(line.substr(0, colon));
+        for(const auto &c : compact_forms) {
+            if(!strcasecmp(name.data(), c.first)) {
+                name = c.second;
+                break;
+            }
+        }
+        hdrs.emplace_back(name, trim(line.substr(colon + 1)));
+    }
+
+    auto cseq = hdr(SIP_HDR_CSEQ);
+    if(!cseq || !hdr(SIP_HDR_CALL_ID)) return false;
+    if(!is_request) {
+        auto sp = cseq->find(' ');
+        if(sp == string::npos) return false;
+        method = trim(cseq->substr(sp + 1));
+    }
+
+    return true;
+}
+
+const string *LoadGenerator::sip_msg::hdr(const char *name) const
+{
+    for(const auto &h : hdrs)
+        if(!strcasecmp(h.first.data(), name)) return &h.second;
+    return nullptr;
+}
+
+LoadGenerator::LoadGenerator(const config &cfg)
+  : cfg(cfg),
+    uac_fd(-1),
+    uas_fd(-1),
+    run_id(std::chrono::duration_cast<std::chrono::milliseconds>(
+        clock::now().time_since_epoch()).count()),
+    next_idx(0),
+    uas_tags(0),
+    established(0),
+    first_reply_latency(new LatencyHistogram()),
+    answer_latency(new LatencyHistogram()),
+    heap_base(0),
+    rss_base(0)
+{
+    memset(&target_addr, 0, sizeof(target_addr));
+}
+
+LoadGenerator::~LoadGenerator()
+{
+    if(uac_fd != -1) close(uac_fd);
+    if(uas_fd != -1) close(uas_fd);
+}
+
+int LoadGenerator::bind_socket(unsigned short &port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd == -1) {
+        ERROR("socket(): %s", strerror(errno));
+        return -1;
+    }
+
+    int rcvbuf = LOAD_RCVBUF_SIZE;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, cfg.local_host.data(), &addr.sin_addr);
+
+    if(bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) ||
+       getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &addr_len))
+    {
+        ERROR("failed to bind %s:%d: %s", cfg.local_host.data(), port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+bool LoadGenerator::init()
+{
+    target_addr.sin_family = AF_INET;
+    target_addr.sin_port = htons(cfg.target_port);
+    if(inet_pton(AF_INET, cfg.target_host.data(), &target_addr.sin_addr) != 1) {
+        ERROR("invalid target host %s", cfg.target_host.data());
+        return false;
+    }
+
+    if((uac_fd = bind_socket(cfg.uac_port)) == -1 ||
+       (uas_fd = bind_socket(cfg.uas_port)) == -1)
+    {
+        return false;
+    }
+
+    uac_hostport = cfg.local_host + ":" + std::to_string(cfg.uac_port);
+    uas_hostport = cfg.local_host + ":" + std::to_string(cfg.uas_port);
+    return true;
+}
+
+unsigned short LoadGenerator::getUasPort() const
+{
+    return cfg.uas_port;
+}
+
+void LoadGenerator::send(int fd, const sockaddr_in &addr, const string &data)
+{
+    if(sendto(fd, data.data(), data.size(), 0,
+              reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        DBG("sendto(): %s", strerror(errno));
+    }
+}
+
+void LoadGenerator::send_invite(clock::time_point now, report &r)
+{
+    uint64_t idx = next_idx++;
+    string id = std::to_string(run_id) + "-" + std::to_string(idx);
+    string call_id = "load-" + id + "@" + cfg.local_host;
+    string src = std::to_string(380500000000ull + idx % 100000000);
+    string dst = std::to_string(380440000000ull + idx % 100000000);
+
+    auto &call = calls[call_id];
+    call.state = uac_call::Calling;
+    call.idx = idx;
+    call.from = "<sip:" + src + "@" + cfg.local_host + ">;tag=" + id;
+    call.to = "<sip:" + dst + "@" + cfg.target_host + ">";
+    call.got_reply = false;
+    call.invite_time = now;
+
+    string body = sdp(cfg.local_host, 20000 + (idx % 10000) * 2, idx);
+    send(uac_fd, target_addr,
+        "INVITE sip:" + dst + "@" + cfg.target_host + ":" + std::to_string(cfg.target_port) + " SIP/2.0" CRLF
+        "Via: SIP/2.0/UDP " + uac_hostport + ";branch=z9hG4bK-" + id + "-i;rport" CRLF
+        "Max-Forwards: 70" CRLF
+        "From: " + call.from + CRLF
+        "To: " + call.to + CRLF
+        "Call-ID: " + call_id + CRLF
+        "CSeq: 1 INVITE" CRLF
+        "Contact: <sip:" + src + "@" + uac_hostport + ">" CRLF
+        "Content-Type: application/sdp" CRLF
+        "Content-Length: " + std::to_string(body.size()) + CRLF
+        CRLF + body);
+
+    r.attempts++;
+}
+
+void LoadGenerator::send_bye(const string &call_id, uac_call &call, clock::time_point now)
+{
+    call.state = uac_call::Terminating;
+    call.bye_time = now;
+
+    send(uac_fd, target_addr,
+        "BYE " + call.remote_target + " SIP/2.0" CRLF
+        "Via: SIP/2.0/UDP " + uac_hostport + ";branch=z9hG4bK-" +
+            std::to_string(run_id) + "-" + std::to_string(call.idx) + "-b;rport" CRLF
+        "Max-Forwards: 70" CRLF
+        "From: " + call.from + CRLF
+        "To: " + call.to + CRLF
+        "Call-ID: " + call_id + CRLF
+        "CSeq: 2 BYE" CRLF
+        "Content-Length: 0" CRLF
+        CRLF);
+}
+
+/* ACK of 2xx is the new transaction to the remote target.
+ * ACK of non-2xx reuses the INVITE branch from the reply */
+void LoadGenerator::send_ack(const sip_msg &reply, const uac_call *call)
+{
+    const string &call_id = *reply.hdr(SIP_HDR_CALL_ID);
+    const string *from = reply.hdr(SIP_HDR_FROM), *to = reply.hdr(SIP_HDR_TO),
+                 *via = reply.hdr(SIP_HDR_VIA), *contact = reply.hdr(SIP_HDR_CONTACT);
+    if(!from || !to || !via) return;
+
+    string ruri, branch_via;
+    if(reply.code < 300) {
+        if(!contact) return;
+        ruri = uri_of(*contact);
+        branch_via = "SIP/2.0/UDP " + uac_hostport + ";branch=z9hG4bK-" +
+            std::to_string(run_id) + "-" + (call ? std::to_string(call->idx) : call_id) + "-a;rport";
+    } else {
+        ruri = uri_of(*to);
+        branch_via = *via;
+    }
+
+    send(uac_fd, target_addr,
+        "ACK " + ruri + " SIP/2.0" CRLF
+        "Via: " + branch_via + CRLF
+        "Max-Forwards: 70" CRLF
+        "From: " + *from + CRLF
+        "To: " + *to + CRLF
+        "Call-ID: " + call_id + CRLF
+        "CSeq: 1 ACK" CRLF
+        "Content-Length: 0" CRLF
+        CRLF);
+}
+
+string LoadGenerator::reply(const sip_msg &req, int code, const char *reason,
+                            const string &contact_hostport,
+                            const string &to_tag, const string &body)
+{
+    string ret = "SIP/2.0 " + std::to_string(code) + " " + reason + CRLF;
+    for(const auto &h : req.hdrs) {
+        if(!strcasecmp(h.first.data(), SIP_HDR_VIA) ||
+           !strcasecmp(h.first.data(), SIP_HDR_FROM) ||
+           !strcasecmp(h.first.data(), SIP_HDR_CALL_ID) ||
+           !strcasecmp(h.first.data(), SIP_HDR_CSEQ))
+        {
+            ret += h.first + ": " + h.second + CRLF;
+        } else if(!strcasecmp(h.first.data(), SIP_HDR_TO)) {
+            ret += h.first + ": " + h.second;
+            if(!to_tag.empty() && !has_tag(h.second))
+                ret += ";tag=" + to_tag;
+            ret += CRLF;
+        }
+    }
+
+    if(req.method == SIP_METH_INVITE && code < 300)
+        ret += "Contact: <sip:load@" + contact_hostport + ">" CRLF;
+    if(!body.empty())
+        ret += "Content-Type: application/sdp" CRLF;
+    ret += "Content-Length: " + std::to_string(body.size()) + CRLF CRLF + body;
+    return ret;
+}
+
+void LoadGenerator::on_uac_message(const sip_msg &msg, const sockaddr_in &from,
+                                   clock::time_point now, report &r)
+{
+    const string &call_id = *msg.hdr(SIP_HDR_CALL_ID);
+    auto it = calls.find(call_id);
+
+    if(msg.is_request) {
+        if(msg.method == SIP_METH_ACK) return;
+        if(msg.method == SIP_METH_BYE && it != calls.end()) {
+            if(it->second.state == uac_call::Established) {
+                r.remote_hangups++;
+                established--;
+            }
+            calls.erase(it);
+        }
+        string body;
+        if(msg.method == SIP_METH_INVITE)
+            body = sdp(cfg.local_host, 20000, now.time_since_epoch().count());
+        send(uac_fd, from, reply(msg, 200, "OK", uac_hostport, string(), body));
+        return;
+    }
+
+    if(msg.method == SIP_METH_BYE) {
+        if(msg.code >= 200 && it != calls.end() &&
+           it->second.state == uac_call::Terminating)
+        {
+            r.completed++;
+            calls.erase(it);
+        }
+        return;
+    }
+
+    if(msg.method != SIP_METH_INVITE) return;
+
+    if(it == calls.end()) {
+        if(msg.code < 200) return;
+        send_ack(msg, nullptr);
+        if(msg.code < 300 && msg.hdr(SIP_HDR_CONTACT)) {
+            //answered after the timeout
+            uac_call late;
+            late.idx = next_idx++;
+            late.from = *msg.hdr(SIP_HDR_FROM);
+            late.to = *msg.hdr(SIP_HDR_TO);
+            late.remote_target = uri_of(*msg.hdr(SIP_HDR_CONTACT));
+            send_bye(call_id, late, now);
+        }
+        return;
+    }
+
+    auto &call = it->second;
+    if(!call.got_reply) {
+        call.got_reply = true;
+        first_reply_latency->record(now - call.invite_time);
+    }
+
+    if(msg.code < 200) return;
+
+    send_ack(msg, &call);
+    if(call.state != uac_call::Calling) return;
+
+    if(msg.code >= 300) {
+        r.failed++;
+        r.failure_codes[msg.code]++;
+        calls.erase(it);
+        return;
+    }
+
+    auto contact = msg.hdr(SIP_HDR_CONTACT);
+    call.state = uac_call::Established;
+    call.to = *msg.hdr(SIP_HDR_TO);
+    call.remote_target = contact ? uri_of(*contact) : msg.ruri;
+    answer_latency->record(now - call.invite_time);
+    r.answered++;
+    established++;
+    last_answer = now;
+    byes.emplace_back(now + std::chrono::milliseconds(cfg.hold_msec), call_id);
+}
+
+void LoadGenerator::on_uas_message(const sip_msg &msg, const sockaddr_in &from)
+{
+    if(!msg.is_request || msg.method == SIP_METH_ACK) return;
+
+    const string &call_id = *msg.hdr(SIP_HDR_CALL_ID);
+    auto to = msg.hdr(SIP_HDR_TO);
+
+    if(msg.method == SIP_METH_INVITE && to && !has_tag(*to)) {
+        auto it = uas_answers.find(call_id);
+        if(it == uas_answers.end()) {
+            uint64_t tag = uas_tags++;
+            it = uas_answers.emplace(call_id, reply(
+                msg, 200, "OK", uas_hostport, "uas-" + std::to_string(run_id) + "-" + std::to_string(tag),
+                sdp(cfg.local_host, 40000 + (tag % 10000) * 2, tag))).first;
+        }
+        send(uas_fd, from, it->second);
+        return;
+    }
+
+    string body;
+    if(msg.method == SIP_METH_INVITE)
+        body = sdp(cfg.local_host, 40000, uas_tags++);
+    else if(msg.method == SIP_METH_BYE)
+        uas_answers.erase(call_id);
+
+    send(uas_fd, from, reply(msg, 200, "OK", uas_hostport, "uas", body));
+}
+
+void LoadGenerator::read_socket(int fd, clock::time_point now, report &r)
+{
+    static thread_local char buf[LOAD_MAX_DATAGRAM];
+    sip_msg msg;
+    sockaddr_in from;
+
+    while(true) {
+        socklen_t from_len = sizeof(from);
+        ssize_t len = recvfrom(fd, buf, sizeof(buf), 0,
+                               reinterpret_cast<sockaddr *>(&from), &from_len);
+        if(len <= 0) return;
+
+        if(!msg.parse(buf, len)) {
+            DBG("failed to parse the received message");
+            continue;
+        }
+
+        if(fd == uac_fd)
+            on_uac_message(msg, from, now, r);
+        else
+            on_uas_message(msg, from);
+    }
+}
+
+void LoadGenerator::check_timeouts(clock::time_point now, report &r)
+{
+    auto timeout = std::chrono::milliseconds(cfg.timeout_msec);
+    for(auto it = calls.begin(); it != calls.end();) {
+        const auto &call = it->second;
+        if(call.state == uac_call::Calling && now - call.invite_time > timeout) {
+            r.timeouts++;
+            it = calls.erase(it);
+        } else if(call.state == uac_call::Terminating && now - call.bye_time > timeout) {
+            r.bye_timeouts++;
+            it = calls.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void LoadGenerator::sample_memory(report &r)
+{
+    if(!established || established < r.peak_calls) return;
+
+    size_t heap = heap_used(), rss = rss_used();
+    r.peak_calls = established;
+    r.heap_per_call = heap > heap_base ?
+        static_cast<double>(heap - heap_base) / established : 0;
+    r.rss_per_call = rss > rss_base ?
+        static_cast<double>(rss - rss_base) / established : 0;
+}
+
+bool LoadGenerator::run(unsigned int cps, report &r)
+{
+    if(uac_fd == -1 || uas_fd == -1 || !cps) return false;
+
+    r = report();
+    r.offered_cps = cps;
+    first_reply_latency->reset();
+    answer_latency->reset();
+    established = 0;
+
+    heap_base = heap_used();
+    rss_base = rss_used();
+
+    uint64_t total = static_cast<uint64_t>(cps) * cfg.duration_sec;
+    auto start = clock::now(), next_check = start + LOAD_CHECK_INTERVAL;
+    last_answer = start;
+
+    pollfd fds[2] = {
+        { uac_fd, POLLIN, 0 },
+        { uas_fd, POLLIN, 0 }
+    };
+
+    while(true) {
+        auto now = clock::now();
+
+        if(r.attempts < total) {
+            uint64_t due = std::min(total, 1 + static_cast<uint64_t>(
+                std::chrono::duration<double>(now - start).count() * cps));
+            while(r.attempts < due)
+                send_invite(now, r);
+        } else if(calls.empty()) {
+            break;
+        }
+
+        while(!byes.empty() && byes.front().first <= now) {
+            auto it = calls.find(byes.front().second);
+            if(it != calls.end() && it->second.state == uac_call::Established) {
+                established--;
+                send_bye(it->first, it->second, now);
+            }
+            byes.pop_front();
+        }
+
+        if(now >= next_check) {
+            sample_memory(r);
+            check_timeouts(now, r);
+            next_check = now + LOAD_CHECK_INTERVAL;
+        }
+
+        if(poll(fds, 2, 1) > 0) {
+            now = clock::now();
+            if(fds[0].revents & POLLIN) read_socket(uac_fd, now, r);
+            if(fds[1].revents & POLLIN) read_socket(uas_fd, now, r);
+        }
+    }
+
+    byes.clear();
+    uas_answers.clear();
+
+    r.elapsed_sec = std::max<double>(
+        cfg.duration_sec, std::chrono::duration<double>(last_answer - start).count());
+    r.first_reply = first_reply_latency->snapshot();
+    r.answer = answer_latency->snapshot();
+
+    return true;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "../src/stats/LatencyHistogram.h"
+
+#include "AmArg.h"
+
+#include <netinet/in.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using std::string;
+
+/* synthetic SIP calls over UDP on the loopback.
+ *
+ * UAC part sends INVITEs to the node with the offered rate,
+ * acknowledges final replies and sends BYE after the hold time.
+ * UAS part answers INVITEs of the B-legs with 200 OK and the static SDP
+ * and replies 200 OK to the other requests.
+ * requests are not retransmitted, lost transactions end as timeouts.
+ *
+ * memory per call is the heap and RSS growth at the peak of the
+ * established calls divided by their number. it includes the generator
+ * own per-call state (~1.5KB for the UAC and UAS parts) */
+class LoadGenerator
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    struct config {
+        //signalling interface of the node (unit_tests/etc/sems.conf)
+        string target_host;
+        unsigned short target_port;
+        string local_host;
+        //0 to bind to the ephemeral port
+        unsigned short uac_port;
+        unsigned short uas_port;
+        unsigned int duration_sec;
+        unsigned int hold_msec;
+        unsigned int timeout_msec;
+        config();
+    };
+
+    struct report {
+        unsigned int offered_cps;
+        uint64_t attempts;
+        uint64_t answered;
+        uint64_t failed;
+        uint64_t timeouts;
+        uint64_t completed;
+        //BYE from the node before the hold time
+        uint64_t remote_hangups;
+        //no reply to the BYE
+        uint64_t bye_timeouts;
+        std::map<int, uint64_t> failure_codes;
+        //from the first INVITE to the last answer
+        double elapsed_sec;
+        LatencyHistogram::Snapshot first_reply;
+        LatencyHistogram::Snapshot answer;
+        size_t peak_calls;
+        double heap_per_call;
+        double rss_per_call;
+
+        report();
+        double answeredRate() const;
+        double achievedCps() const;
+        void getInfo(AmArg &ret) const;
+    };
+
+  private:
+    struct sip_msg {
+        bool is_request;
+        int code;
+        string method;
+        string ruri;
+        std::vector<std::pair<string, string>> hdrs;
+        string body;
+
+        bool parse(const char *buf, size_t len);
+        //compact forms are expanded by parse()
+        const string *hdr(const char *name) const;
+    };
+
+    struct uac_call {
+        enum State { Calling, Established, Terminating } state;
+        uint64_t idx;
+        string from;
+        string to;
+        string remote_target;
+        bool got_reply;
+        clock::time_point invite_time;
+        clock::time_point bye_time;
+    };
+
+    config cfg;
+    int uac_fd;
+    int uas_fd;
+    sockaddr_in target_addr;
+    string uac_hostport;
+    string uas_hostport;
+    uint64_t run_id;
+    uint64_t next_idx;
+    uint64_t uas_tags;
+    clock::time_point last_answer;
+
+    std::unordered_map<string, uac_call> calls;
+    //Call-ID, BYE time. the hold time is constant so answers order is kept
+    std::deque<std::pair<clock::time_point, string>> byes;
+    //200 OK of the B-legs INVITEs by Call-ID for the retransmissions
+    std::unordered_map<string, string> uas_answers;
+    size_t established;
+
+    std::unique_ptr<LatencyHistogram> first_reply_latency;
+    std::unique_ptr<LatencyHistogram> answer_latency;
+    size_t heap_base;
+    size_t rss_base;
+
+    //updates the port with the bound one
+    int bind_socket(unsigned short &port);
+    void send(int fd, const sockaddr_in &addr, const string &data);
+
+    void send_invite(clock::time_point now, report &r);
+    void send_bye(const string &call_id, uac_call &call, clock::time_point now);
+    void send_ack(const sip_msg &reply, const uac_call *call);
+    string reply(const sip_msg &req, int code, const char *reason, const string &contact_hostport,
+                 const string &to_tag = string(), const string &body = string());
+
+    void on_uac_message(const sip_msg &msg, const sockaddr_in &from, clock::time_point now, report &r);
+    void on_uas_message(const sip_msg &msg, const sockaddr_in &from);
+    void read_socket(int fd, clock::time_point now, report &r);
+
+    void check_timeouts(clock::time_point now, report &r);
+    void sample_memory(report &r);
+
+  public:
+    LoadGenerator(const config &cfg);
+    ~LoadGenerator();
+
+    //binds the sockets
+    bool init();
+    unsigned short getUasPort() const;
+
+    /* generates calls with the rate for config::duration_sec
+     * and waits until they are finished or timed out */
+    bool run(unsigned int cps, report &r);
+};
@@ -0,0 +1,60 @@
+#include "LoadTestPostgres.h"
+#include "../src/SqlRouter.h"
+#include "../src/yeti_base.h"
+
+#include "ampi/PostgreSqlAPI.h"
+#include "AmEventDispatcher.h"
+#include "AmSessionContainer.h"
+#include "log.h"
+
+LoadTestPostgres::LoadTestPostgres(const AmArg &profiles)
+  : pg_queue(AmEventDispatcher::instance()->delEventQueue(POSTGRESQL_QUEUE)),
+    profiles(profiles),
+    getprofile_requests(0),
+    dropped_writes(0)
+{
+    AmEventDispatcher::instance()->addEventQueue(POSTGRESQL_QUEUE, this);
+}
+
+LoadTestPostgres::~LoadTestPostgres()
+{
+    AmEventDispatcher::instance()->delEventQueue(POSTGRESQL_QUEUE);
+    if(pg_queue)
+        AmEventDispatcher::instance()->addEventQueue(POSTGRESQL_QUEUE, pg_queue);
+}
+
+void LoadTestPostgres::postEvent(AmEvent *ev)
+{
+    if(auto e = dynamic_cast<PGParamExecute *>(ev)) {
+        const auto &q = e->qdata;
+
+        if(q.worker_name == yeti_routing_pg_worker &&
+           !q.info.empty() && q.info.front().query == getprofile_sql_statement_name)
+        {
+            getprofile_requests++;
+            if(!AmSessionContainer::instance()->postEvent(
+                q.sender_id, new PGResponse(profiles, q.token)))
+            {
+                DBG("no session %s for the getprofile response", q.sender_id.data());
+            }
+            delete ev;
+            return;
+        }
+
+        if(q.worker_name == yeti_cdr_pg_worker ||
+           q.worker_name == yeti_auth_log_pg_worker)
+        {
+            dropped_writes++;
+            delete ev;
+            return;
+        }
+    }
+
+    if(pg_queue) {
+        pg_queue->postEvent(ev);
+        return;
+    }
+
+    ERROR("no postgresql queue for the event %d", ev->event_id);
+    delete ev;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "AmArg.h"
+#include "AmEventQueue.h"
+
+#include <atomic>
+#include <cstdint>
+
+/* POSTGRESQL_QUEUE handler for the load tests. replaces the registered one while alive.
+ *
+ * getprofile queries are answered immediately with the canned rows,
+ * CDR and auth log writes are dropped.
+ * other events are passed to the replaced handler */
+class LoadTestPostgres
+  : public AmEventQueueInterface
+{
+    AmEventQueueInterface *pg_queue;
+    AmArg profiles;
+
+    std::atomic<uint64_t> getprofile_requests;
+    std::atomic<uint64_t> dropped_writes;
+
+  public:
+    LoadTestPostgres(const AmArg &profiles);
+    ~LoadTestPostgres();
+
+    void postEvent(AmEvent *ev) override;
+
+    uint64_t getProfileRequests() const { return getprofile_requests; }
+    uint64_t getDroppedWrites() const { return dropped_writes; }
+};
@@ -0,0 +1,155 @@
+#include "YetiBench.h"
+#include "../src/ParamReplacer.h"
+#include "../src/SqlCallProfile.h"
+#include "sip/defs.h"
+
+#include <chrono>
+
+static AmSipRequest replacer_request()
+{
+    AmSipRequest req;
+    req.method = SIP_METH_INVITE;
+    req.r_uri = "sip:bob@b.domain.invalid;transport=udp";
+    req.from = "\"Alice\" <sip:alice@a.domain.invalid:5062;user=phone>;tag=ft1";
+    req.from_tag = "ft1";
+    req.to = "<sip:bob@b.domain.invalid>";
+    req.callid = "call-id@domain.invalid";
+    req.remote_ip = "10.0.0.1";
+    req.remote_port = 5060;
+    req.hdrs =
+        "P-Asserted-Identity: <sip:pai@p.domain.invalid;npdi>" CRLF
+        "X-Hdr: <sip:xh@h.domain.invalid>" CRLF
+        "X-Bad: garbage" CRLF;
+    return req;
+}
+
+static const string replacer_app_param("a=1;bb=22");
+
+static const char *replacer_patterns[] = {
+    "static-value",
+    "X-Static: 1\\r\\nX-Static2: 2\\r\\n",
+    "sip:$rU@$rd;$rP(transport)",
+    "$f|$fu|$fU|$fd|$fh|$fp|$fP|$fn|$ft",
+    "$t|$tU|$tt",
+    "$ci|$si:$sp|$m",
+    "$P(bb)$P(a)",
+    "$H(X-Hdr)|$H.(X-Hdr)|$Hu(X-Hdr)",
+    "$Hu(X-Bad)rest$ci",
+    "$_u($fU)$_l(ABC)$_s($tU)$#(a b&c)",
+    "X-A: 1\\r\\nX-PAI: $ai\\r\\nX-PAI-Host: $ad\\r\\n",
+    "$aU@$ad $pU",
+    "$fP(user)|$fP()|",
+    "unclosed $P(bb",
+    "trailing \\",
+};
+
+TEST_F(YetiTest, ParamReplacerTemplate)
+{
+    auto req = replacer_request();
+
+    for(auto pattern : replacer_patterns) {
+        AmUriParser ruri_parser, from_parser, to_parser;
+        string expected = replaceParameters(
+            pattern, "test", req, nullptr, replacer_app_param, string(),
+            ruri_parser, from_parser, to_parser, false, false, false);
+
+        ParamReplacerCtx ctx;
+        ctx.app_param = replacer_app_param;
+        ASSERT_EQ(ctx.replaceParameters(pattern, "test", req), expected) << pattern;
+        //memoized values from the first evaluation
+        ASSERT_EQ(ctx.replaceParameters(pattern, "test", req), expected) << pattern;
+
+        ParamReplacerTemplate t(pattern);
+        ParamReplacerCtx tctx;
+        tctx.app_param = replacer_app_param;
+        ASSERT_EQ(tctx.replaceParameters(t, "test", req), expected) << pattern;
+        ASSERT_EQ(t.source(), pattern);
+    }
+
+    ParamReplacerCtx ctx;
+    ctx.app_param = replacer_app_param;
+    ASSERT_EQ(ctx.replaceParameters("sip:$rU@$rd;$rP(transport)", "ruri", req),
+              "sip:bob@b.domain.invalid;udp");
+    ASSERT_EQ(ctx.replaceParameters("$ci|$si:$sp|$P(bb)", "test", req),
+              "call-id@domain.invalid|10.0.0.1:5060|22");
+    ASSERT_EQ(ctx.replaceParameters("X-A: $fU\\r\\n", "test", req), "X-A: alice\r\n");
+
+    ASSERT_FALSE(ParamReplacerTemplate("X-A: 1\\r\\n").hasParams());
+    ASSERT_TRUE(ParamReplacerTemplate("X-A: $ci\\r\\n").hasParams());
+}
+
+/* evaluation of the recorded getprofile row (unit_tests/bench/) for the recorded INVITE.
+ * profile is read by SqlCallProfile::readFromTuple() and evaluated by evaluate()
+ * as for each call. the row fields are also replaced by the interpreter and by
+ * the compiled templates to compare them on the same data.
+ * './run_unit_test.sh YetiBench.DISABLED_ParamReplacerEvaluateBenchmark' */
+TEST_F(YetiBench, DISABLED_ParamReplacerEvaluateBenchmark)
+{
+    static const int calls = 20000;
+
+    AmArg row = fixtureJson("getprofile_row.json");
+    AmSipRequest req;
+    fixtureRequest("invite.sip", req);
+
+    size_t failed = 0;
+    auto measure_profile = [&](bool evaluate) {
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < calls; i++) {
+            SqlCallProfile p;
+            if(!p.readFromTuple(row, DynFieldsT())) {
+                failed++;
+                continue;
+            }
+            if(!evaluate) continue;
+            ParamReplacerCtx ctx(&p);
+            ctx.app_param = replacer_app_param;
+            if(!p.evaluate(ctx, req)) failed++;
+        }
+        return std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / calls;
+    };
+
+    auto read_ns = measure_profile(false);
+    auto read_evaluate_ns = measure_profile(true);
+    ASSERT_EQ(failed, size_t{0});
+
+    SqlCallProfile p;
+    ASSERT_TRUE(p.readFromTuple(row, DynFieldsT()));
+    const std::vector<string> fields = {
+        p.ruri, p.from, p.to, p.callid,
+        p.dlg_contact_params, p.bleg_dlg_contact_params,
+        p.append_headers, p.append_headers_req, p.aleg_append_headers_reply
+    };
+
+    auto measure_fields = [&](bool interpreted) {
+        size_t total_size = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < calls; i++) {
+            ParamReplacerCtx ctx;
+            ctx.app_param = replacer_app_param;
+            for(const auto &f : fields) {
+                total_size += interpreted ?
+                    replaceParameters(
+                        f, "test", req, nullptr,
+                        ctx.app_param, ctx.outbound_interface_host,
+                        ctx.ruri_parser, ctx.from_parser, ctx.to_parser,
+                        false, false, false).size() :
+                    ctx.replaceParameters(f, "test", req).size();
+            }
+        }
+        auto ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / calls;
+        return std::make_pair(ns, total_size);
+    };
+
+    auto interpreted = measure_fields(true);
+    auto compiled = measure_fields(false);
+    ASSERT_EQ(interpreted.second, compiled.second);
+
+    RecordProperty("read_ns_per_call", std::to_string(read_ns));
+    RecordProperty("read_evaluate_ns_per_call", std::to_string(read_evaluate_ns));
+    RecordProperty("evaluate_ns_per_call", std::to_string(read_evaluate_ns - read_ns));
+    RecordProperty("row_fields", std::to_string(fields.size()));
+    RecordProperty("interpreter_ns_per_call", std::to_string(interpreted.first));
+    RecordProperty("compiled_ns_per_call", std::to_string(compiled.first));
+}
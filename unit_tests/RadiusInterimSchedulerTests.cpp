@@ -0,0 +1,227 @@
+#include "YetiTest.h"
+#include "../src/RadiusInterimScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <thread>
+
+struct InterimSchedulerRecorder {
+    std::map<string, std::vector<uint64_t>> sent_ticks;
+    std::vector<size_t> batch_sizes;
+    std::vector<int> last_batch_profiles;
+    uint64_t tick;
+
+    InterimSchedulerRecorder()
+      : tick(0)
+    {}
+
+    RadiusInterimScheduler::send_func_t func()
+    {
+        return [this](RadiusInterimScheduler::batch_t &batch) {
+            batch_sizes.push_back(batch.size());
+            last_batch_profiles.clear();
+            for(auto &r : batch) {
+                sent_ticks[r.local_tag].push_back(tick);
+                last_batch_profiles.push_back(r.profile_id);
+            }
+        };
+    }
+};
+
+static timeval interim_connect_time(int seconds_ago)
+{
+    timeval now, d = { seconds_ago, 0 }, ret;
+    gettimeofday(&now, nullptr);
+    timersub(&now, &d, &ret);
+    return ret;
+}
+
+TEST_F(YetiTest, RadiusInterimSchedulerSpread)
+{
+    static const int calls = 1000;
+    static const unsigned int interval = 10;
+    static const uint64_t interval_ticks = interval * 1000 / RADIUS_INTERIM_TICK_MSEC;
+    static const uint64_t jitter_ticks = interval_ticks / RADIUS_INTERIM_JITTER_DIVISOR;
+
+    InterimSchedulerRecorder rec;
+    RadiusInterimScheduler s(rec.func());
+    auto base = std::chrono::steady_clock::now();
+
+    //all calls connected at once
+    PlaceholdersHash placeholders;
+    auto connect_time = interim_connect_time(0);
+    std::vector<RadiusInterimScheduler::entry_id_t> ids;
+    for(int i = 0; i < calls; i++)
+        ids.push_back(s.add(1 + i % 3, "tag" + std::to_string(i), placeholders, connect_time, interval));
+    ASSERT_EQ(s.size(), size_t{calls});
+
+    for(rec.tick = 1; rec.tick <= 2 * interval_ticks; rec.tick++)
+        s.onTimer(base + std::chrono::milliseconds(rec.tick * RADIUS_INTERIM_TICK_MSEC));
+
+    /* every call twice, the first one within [interval - jitter, interval]
+     * and the second one an interval later */
+    ASSERT_EQ(rec.sent_ticks.size(), size_t{calls});
+    std::set<uint64_t> first_ticks;
+    for(const auto &it : rec.sent_ticks) {
+        ASSERT_EQ(it.second.size(), size_t{2}) << it.first;
+        ASSERT_GE(it.second[0], interval_ticks - jitter_ticks);
+        ASSERT_LE(it.second[0], interval_ticks);
+        ASSERT_EQ(it.second[1] - it.second[0], interval_ticks);
+        first_ticks.insert(it.second[0]);
+    }
+
+    //no synchronized burst, all the ticks of the jitter window are used
+    ASSERT_EQ(first_ticks.size(), jitter_ticks + 1);
+    size_t max_batch = 0;
+    for(auto size : rec.batch_sizes) max_batch = std::max(max_batch, size);
+    ASSERT_LT(max_batch, 2 * calls / jitter_ticks);
+
+    //batch is ordered by the accounting profile
+    ASSERT_TRUE(std::is_sorted(rec.last_batch_profiles.begin(), rec.last_batch_profiles.end()));
+
+    AmArg stats;
+    s.getStats(stats);
+    ASSERT_EQ(stats["queue_depth"].asLongLong(), calls);
+    ASSERT_EQ(stats["sent"].asLongLong(), 2 * calls);
+    ASSERT_EQ(stats["profiles"]["1"]["queue_depth"].asLongLong(), (calls + 2) / 3);
+    ASSERT_GT(stats["send_rate"].asDouble(), 0);
+
+    //removed entries are not sent anymore
+    for(auto id : ids) s.remove(id);
+    s.remove(ids.front());
+    ASSERT_EQ(s.size(), size_t{0});
+
+    rec.sent_ticks.clear();
+    for(; rec.tick <= 6 * interval_ticks; rec.tick++)
+        s.onTimer(base + std::chrono::milliseconds(rec.tick * RADIUS_INTERIM_TICK_MSEC));
+    ASSERT_TRUE(rec.sent_ticks.empty());
+
+    stats.clear();
+    s.getStats(stats);
+    ASSERT_EQ(stats["profiles"]["1"]["queue_depth"].asLongLong(), 0);
+}
+
+TEST_F(YetiTest, RadiusInterimSchedulerRounds)
+{
+    //interval longer than the wheel
+    static const unsigned int interval = 300;
+    static const uint64_t interval_ticks = interval * 1000 / RADIUS_INTERIM_TICK_MSEC;
+    static const uint64_t jitter_ticks = interval_ticks / RADIUS_INTERIM_JITTER_DIVISOR;
+    static_assert(interval_ticks - jitter_ticks > RADIUS_INTERIM_WHEEL_SLOTS, "interval must exceed the wheel");
+
+    std::map<string, string> last_values;
+    uint64_t tick = 0;
+    std::vector<uint64_t> sent_ticks;
+    RadiusInterimScheduler s([&](RadiusInterimScheduler::batch_t &batch) {
+        for(auto &r : batch) {
+            sent_ticks.push_back(tick);
+            last_values = r.placeholders.get();
+        }
+    });
+    auto base = std::chrono::steady_clock::now();
+
+    PlaceholdersHash placeholders;
+    placeholders.set(PlaceholdersHash::key("call_local_tag"), string("long-call"));
+    s.add(5, "long-call", placeholders, interim_connect_time(7), interval);
+
+    //timer overruns are caught up
+    for(tick = 10; tick <= 3 * interval_ticks + 10; tick += 10)
+        s.onTimer(base + std::chrono::milliseconds(tick * RADIUS_INTERIM_TICK_MSEC));
+
+    ASSERT_EQ(sent_ticks.size(), size_t{3});
+    ASSERT_GE(sent_ticks[0], interval_ticks - jitter_ticks);
+    ASSERT_LE(sent_ticks[0], interval_ticks + 10);
+    ASSERT_EQ(sent_ticks[1] - sent_ticks[0], interval_ticks);
+    ASSERT_EQ(sent_ticks[2] - sent_ticks[1], interval_ticks);
+
+    //duration is set at send time
+    ASSERT_EQ(last_values["call_local_tag"], "long-call");
+    ASSERT_EQ(last_values["call_duration_int"], "7");
+
+    placeholders.set(PlaceholdersHash::key("call_duration_int"), 1LL);
+    RadiusInterimScheduler::setDuration(placeholders, timeval{}, timeval{});
+    ASSERT_EQ(placeholders.get()["call_duration_float"], "0.0");
+    ASSERT_EQ(placeholders.get()["call_duration_int"], "0");
+}
+
+TEST_F(YetiTest, RadiusInterimSchedulerNoSendAfterRemove)
+{
+    std::atomic<bool> sending(false), removed(false), sent_after_remove(false);
+    RadiusInterimScheduler s([&](RadiusInterimScheduler::batch_t &) {
+        sending = true;
+        //slow post to the radius module
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if(removed) sent_after_remove = true;
+    });
+    auto base = std::chrono::steady_clock::now();
+
+    PlaceholdersHash placeholders;
+    auto id = s.add(1, "removed-call", placeholders, interim_connect_time(0), 1);
+
+    //the first interim is due within the interval
+    std::thread timer([&] {
+        s.onTimer(base + std::chrono::seconds(2));
+    });
+    while(!sending) std::this_thread::yield();
+
+    //Stop is posted by the leg after remove() returns
+    s.remove(id);
+    removed = true;
+    timer.join();
+
+    ASSERT_FALSE(sent_after_remove);
+    ASSERT_EQ(s.size(), size_t{0});
+}
+
+/* ticks of the two intervals with 50k calls connected within the single second.
+ * per-call timers would fire in 10 ticks, the scheduler spreads them over the ticks
+ * of the jitter window at the end of each interval.
+ * './run_unit_test.sh YetiTest.DISABLED_RadiusInterimSchedulerBenchmark' */
+TEST_F(YetiTest, DISABLED_RadiusInterimSchedulerBenchmark)
+{
+    static const int calls = 50000;
+    static const unsigned int interval = 60;
+    static const uint64_t interval_ticks = interval * 1000 / RADIUS_INTERIM_TICK_MSEC;
+
+    size_t sent = 0, max_batch = 0;
+    RadiusInterimScheduler s([&](RadiusInterimScheduler::batch_t &batch) {
+        for(auto &r : batch) sent += r.placeholders.get().size();
+        max_batch = std::max(max_batch, batch.size());
+    });
+    auto base = std::chrono::steady_clock::now();
+
+    PlaceholdersHash placeholders;
+    placeholders.set(PlaceholdersHash::key("call_local_tag"), string("benchmark-local-tag"));
+    placeholders.set(PlaceholdersHash::key("time_connect_int"), 1700000000LL);
+    auto connect_time = interim_connect_time(0);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<RadiusInterimScheduler::entry_id_t> ids;
+    for(int i = 0; i < calls; i++)
+        ids.push_back(s.add(i % 4, "benchmark-tag-" + std::to_string(i), placeholders, connect_time, interval));
+    auto add_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / calls;
+
+    start = std::chrono::steady_clock::now();
+    for(uint64_t tick = 1; tick <= 2 * interval_ticks; tick++)
+        s.onTimer(base + std::chrono::milliseconds(tick * RADIUS_INTERIM_TICK_MSEC));
+    auto interval_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count() / 2;
+
+    start = std::chrono::steady_clock::now();
+    for(auto id : ids) s.remove(id);
+    auto remove_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / calls;
+
+    ASSERT_GT(sent, size_t{0});
+    RecordProperty("calls", calls);
+    RecordProperty("interval_ticks", std::to_string(interval_ticks));
+    RecordProperty("add_ns", std::to_string(add_ns));
+    RecordProperty("remove_ns", std::to_string(remove_ns));
+    RecordProperty("interval_processing_ms", std::to_string(interval_ms));
+    RecordProperty("max_batch", std::to_string(max_batch));
+    RecordProperty("per_call_timers_max_batch", calls * RADIUS_INTERIM_TICK_MSEC / 1000);
+}
@@ -4,6 +4,10 @@
 #include "../src/RedisConnection.h"
 #include "../src/resources/ResourceRedisConnection.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 TEST_F(YetiTest, RedisFormatTest)
 {
     char *cmd, *cmd1;
@@ -45,7 +49,7 @@ class TestRedisConnection
 
     void process_reply_event(RedisReplyEvent & event) override {
         gotreply.set(true);
-        result = event.data;
+        result = event.data();
         rstatus = event.result;
     }
 
@@ -110,6 +114,174 @@ TEST_F(YetiTest, RedisConnectionTest)
     conn.stop(true);
 }
 
+/* replies are recorded per connection in the order of arrival.
+ * user_type_id of the request is connection_idx * requests_per_connection + seq */
+class IoThreadsTestPool
+  : public RedisConnectionPool
+{
+    AmMutex replies_mutex;
+    std::vector<std::vector<int>> replies;
+    std::atomic<int> replies_count;
+    int requests_per_connection;
+
+  public:
+    std::vector<RedisConnection *> conns;
+
+    IoThreadsTestPool(unsigned int io_threads, int requests_per_connection)
+      : RedisConnectionPool("io_test", "ioThreadsTest"),
+        replies_count(0),
+        requests_per_connection(requests_per_connection)
+    {
+        set_io_threads(io_threads);
+    }
+
+    int init(const string& host, int port, int connections) {
+        if(RedisConnectionPool::init()) return -1;
+        for(int i = 0; i < connections; i++) {
+            auto c = addConnection(host, port);
+            if(!c) return -1;
+            conns.push_back(c);
+        }
+        replies.resize(conns.size());
+        return 0;
+    }
+
+    bool wait_connected() {
+        for(auto c : conns)
+            if(!c->wait_connected()) return false;
+        return true;
+    }
+
+    void process_reply_event(RedisReplyEvent &event) override {
+        if(event.result == RedisReplyEvent::SuccessReply) {
+            AmLock l(replies_mutex);
+            replies[event.user_type_id / requests_per_connection].push_back(
+                event.user_type_id % requests_per_connection);
+        }
+        replies_count++;
+    }
+
+    bool post_ping(size_t conn_idx, int seq) {
+        return postRedisRequestFmt(
+            conns[conn_idx], get_queue_name(), get_queue_name(), false,
+            nullptr, static_cast<int>(conn_idx) * requests_per_connection + seq,
+            "PING");
+    }
+
+    bool wait_replies(int count, int timeout_sec) {
+        time_t time_ = time(0);
+        while(replies_count < count) {
+            if(time(0) - time_ > timeout_sec) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    std::vector<int> get_replies(size_t conn_idx) {
+        AmLock l(replies_mutex);
+        return replies[conn_idx];
+    }
+};
+
+TEST_F(YetiTest, RedisIoThreadsTest)
+{
+    static const int connections = 4;
+    static const int requests = 1000;
+
+    IoThreadsTestPool pool(2, requests);
+    ASSERT_FALSE(pool.init(yeti_test::instance()->redis.host.c_str(),
+                           yeti_test::instance()->redis.port, connections));
+    pool.start();
+    ASSERT_TRUE(pool.wait_connected());
+
+    //connections are spread over the threads
+    ASSERT_TRUE(pool.conns[0]->get_io_thread());
+    ASSERT_NE(pool.conns[0]->get_io_thread(), pool.conns[1]->get_io_thread());
+    ASSERT_EQ(pool.conns[0]->get_io_thread(), pool.conns[2]->get_io_thread());
+
+    for(int i = 0; i < requests; i++) {
+        for(size_t c = 0; c < connections; c++)
+            ASSERT_TRUE(pool.post_ping(c, i));
+    }
+    ASSERT_TRUE(pool.wait_replies(connections * requests, 5));
+
+    //order is kept per connection
+    for(size_t c = 0; c < connections; c++) {
+        auto replies = pool.get_replies(c);
+        ASSERT_EQ(replies.size(), static_cast<size_t>(requests));
+        for(int i = 0; i < requests; i++)
+            ASSERT_EQ(replies[i], i);
+    }
+
+    pool.stop(true);
+}
+
+TEST_F(YetiTest, RedisNotPostedRequestKeepsUserData)
+{
+    struct TrackedCtx
+      : public AmObject
+    {
+        bool &deleted;
+        TrackedCtx(bool &deleted)
+          : deleted(deleted)
+        {}
+        ~TrackedCtx() { deleted = true; }
+    };
+
+    bool deleted = false;
+    std::unique_ptr<TrackedCtx> ctx(new TrackedCtx(deleted));
+
+    //no queue with such name
+    ASSERT_FALSE(postRedisRequestFmt(nullptr, "noSuchQueue", "noSuchQueue", false,
+                                     ctx.get(), 0, "PING"));
+    ASSERT_FALSE(deleted);
+
+    //stopped I/O thread
+    IoThreadsTestPool pool(1, 1);
+    ASSERT_FALSE(pool.init(yeti_test::instance()->redis.host.c_str(),
+                           yeti_test::instance()->redis.port, 1));
+    pool.start();
+    ASSERT_TRUE(pool.wait_connected());
+    pool.stop(true);
+    ASSERT_FALSE(postRedisRequestFmt(pool.conns[0], pool.get_queue_name(), pool.get_queue_name(), false,
+                                     ctx.get(), 0, "PING"));
+    ASSERT_FALSE(deleted);
+
+    ctx.reset();
+    ASSERT_TRUE(deleted);
+}
+
+/* PING throughput of 8 connections served by the pool thread (0)
+ * and by 1 to 8 I/O threads.
+ * './run_unit_test.sh YetiTest.DISABLED_RedisIoThreadsScaling' */
+TEST_F(YetiTest, DISABLED_RedisIoThreadsScaling)
+{
+    static const int connections = 8;
+    static const int requests = 50000;
+
+    for(unsigned int io_threads : { 0, 1, 2, 4, 8 }) {
+        IoThreadsTestPool pool(io_threads, requests);
+        ASSERT_FALSE(pool.init(yeti_test::instance()->redis.host.c_str(),
+                               yeti_test::instance()->redis.port, connections));
+        pool.start();
+        ASSERT_TRUE(pool.wait_connected());
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < requests; i++) {
+            for(size_t c = 0; c < connections; c++)
+                pool.post_ping(c, i);
+        }
+        ASSERT_TRUE(pool.wait_replies(connections * requests, 60));
+        auto elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+        RecordProperty("io_threads_" + std::to_string(io_threads) + "_requests_per_sec",
+                       std::to_string(connections * requests / elapsed));
+
+        pool.stop(true);
+    }
+}
+
 TEST_F(YetiTest, RedisMultiTest)
 {
     timeval timeout = { DEFAULT_REDIS_TIMEOUT_MSEC, 0 };
@@ -130,3 +302,113 @@ TEST_F(YetiTest, RedisMultiTest)
     AmArg ret = runMultiCommand(ctx, commands, "HSET-HGET");
     redis::redisFree(ctx);
 }
+
+TEST_F(YetiTest, RedisReplyViewTest)
+{
+    AmArg a;
+    a.assertArray();
+    a.push(AmArg(42));
+    a.push(AmArg("-17"));
+    a.push(AmArg("not a number"));
+    a.push(AmArg());
+    AmArg nested;
+    nested.push(AmArg("key"));
+    nested.push(AmArg(1));
+    a.push(nested);
+
+    redisReply *r;
+    Amarg2redisReply(a, &r);
+
+    //reply tree is moved to the detached copy, shell stays for hiredis
+    redisReply *d = redis::detachReply(r);
+    ASSERT_EQ(r->type, REDIS_REPLY_NIL);
+    ASSERT_FALSE(r->element);
+    ASSERT_EQ(r->elements, 0u);
+
+    RedisReplyView v(d);
+    ASSERT_TRUE(v.isArray());
+    ASSERT_EQ(v.size(), 5u);
+
+    long long i;
+    ASSERT_TRUE(v[0].isInteger());
+    ASSERT_TRUE(v[0].toInt(i));
+    ASSERT_EQ(i, 42);
+    ASSERT_TRUE(v[1].isString());
+    ASSERT_EQ(v[1].str(), "-17");
+    ASSERT_TRUE(v[1].toInt(i));
+    ASSERT_EQ(i, -17);
+    ASSERT_FALSE(v[2].toInt(i));
+    ASSERT_TRUE(v[3].isNil());
+    ASSERT_EQ(v[4][0].str(), "key");
+    //out of range elements and absent replies are NIL
+    ASSERT_TRUE(v[5].isNil());
+    ASSERT_TRUE(RedisReplyView().isNil());
+    ASSERT_EQ(v[0].size(), 0u);
+
+    AmArg converted;
+    v.toAmArg(converted);
+    ASSERT_TRUE(isArgArray(converted));
+    ASSERT_EQ(converted.size(), 5u);
+    ASSERT_EQ(converted[0].asLongLong(), 42);
+    ASSERT_EQ(converted[1].asCStr(), string("-17"));
+    ASSERT_TRUE(isArgUndef(converted[3]));
+    ASSERT_EQ(converted[4][0].asCStr(), string("key"));
+
+    redis::freeDetachedReply(d);
+    redis::freeDetachedReply(r);
+}
+
+/* HGETALL-like reply with 10k elements parsed via the AmArg conversion
+ * and via the view over the detached reply.
+ * './run_unit_test.sh YetiTest.DISABLED_RedisReplyViewThroughput' */
+TEST_F(YetiTest, DISABLED_RedisReplyViewThroughput)
+{
+    static const int elements = 10000;
+    static const int replies = 1000;
+
+    AmArg a;
+    a.assertArray();
+    for(int i = 0; i < elements; i++)
+        a.push(AmArg(int2str(i)));
+
+    redisReply *r;
+    Amarg2redisReply(a, &r);
+
+    long long amarg_sum = 0, view_sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int n = 0; n < replies; n++) {
+        AmArg data;
+        redisReply2Amarg(data, r);
+        for(size_t i = 0; i < data.size(); i++) {
+            long int v;
+            if(str2long((char *)data[i].asCStr(), v))
+                amarg_sum += v;
+        }
+    }
+    auto amarg_elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for(int n = 0; n < replies; n++) {
+        redisReply *d = redis::detachReply(r);
+        RedisReplyView data(d);
+        for(size_t i = 0; i < data.size(); i++) {
+            long long v;
+            if(data[i].toInt(v))
+                view_sum += v;
+        }
+        //give the tree back for the next iteration
+        memcpy(r, d, sizeof(redisReply));
+        free(d);
+    }
+    auto view_elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    redis::freeDetachedReply(r);
+    ASSERT_EQ(amarg_sum, view_sum);
+
+    RecordProperty("elements", elements);
+    RecordProperty("amarg_replies_per_sec", std::to_string(replies / amarg_elapsed));
+    RecordProperty("view_replies_per_sec", std::to_string(replies / view_elapsed));
+}
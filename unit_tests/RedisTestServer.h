@@ -10,6 +10,13 @@
 class RedisTestServer : protected TestServer
 {
     map<string, int> statuses;
+    //formatted command prefix -> status. e.g. for the commands with variable arguments
+    map<string, int> prefix_statuses;
+    struct permanent_response {
+        AmArg response;
+        bool returned;
+    };
+    map<string, permanent_response> permanent_responses;
 public:
     RedisTestServer(){}
     ~RedisTestServer(){}
@@ -34,6 +41,27 @@ public:
             addResponse(cmd, response);
     }
 
+    //response for each execution of the command instead of the single one
+    void addPermanentCommandResponse(const string& cmd, int status, AmArg response, ...)
+    {
+        va_list args;
+        va_start(args, response);
+        char* command;
+        redis::redisvFormatCommand(&command, cmd.c_str(), args);
+        statuses.emplace(command, status);
+        permanent_responses[command] = { response, false };
+        redis::redisFreeCommand(command);
+        va_end(args);
+    }
+
+    //status for all commands with the same name and arguments count
+    void addCommandStatus(const string& name, int args_count, int status)
+    {
+        string prefix = "*" + std::to_string(args_count + 1) + "\r\n" +
+                        "$" + std::to_string(name.size()) + "\r\n" + name + "\r\n";
+        prefix_statuses[prefix] = status;
+    }
+
     void addTail(const string& cmd, int sec, ...)
     {
         va_list args;
@@ -50,17 +78,37 @@ public:
         if(statuses.find(cmd) != statuses.end()) {
             return statuses[cmd];
         }
+        for(const auto &it : prefix_statuses) {
+            if(cmd.compare(0, it.first.size(), it.first) == 0)
+                return it.second;
+        }
         return REDIS_REPLY_NIL;
     }
 
     bool getResponse(const string& cmd, AmArg& res)
     {
         while(checkTail(cmd)){}
-        return TestServer::getResponse(cmd, res);
+        if(TestServer::getResponse(cmd, res))
+            return true;
+
+        auto it = permanent_responses.find(cmd);
+        if(it == permanent_responses.end())
+            return false;
+
+        //responses are read until false. return the permanent one once per execution
+        if(it->second.returned) {
+            it->second.returned = false;
+            return false;
+        }
+        it->second.returned = true;
+        res = it->second.response;
+        return true;
     }
 
     void clear() {
         statuses.clear();
+        prefix_statuses.clear();
+        permanent_responses.clear();
         TestServer::clear();
     }
 };
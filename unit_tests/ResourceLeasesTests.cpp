@@ -0,0 +1,306 @@
+#include "YetiTest.h"
+#include "../src/resources/ResourceLeases.h"
+#include "../src/resources/ResourceSequences.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <random>
+
+/* stub of the resources hashes in redis shared by the simulated nodes.
+ * operations are applied as OperationResources would write them,
+ * renewals as resource_lease.lua would do */
+class ResourcesRedisStub {
+    std::map<int, long long> fields; //node_id -> value of the single resource hash
+
+  public:
+    void apply(int node_id, const ResourceOperationList &ops)
+    {
+        OperationResources op(nullptr, ops);
+        for(const auto &d : op.get_deltas())
+            fields[node_id] += d.value;
+    }
+
+    bool renew(int node_id, const ResourceLeases::renew_request &req, long long &total_before)
+    {
+        total_before = total();
+        if(total_before + req.lease_size > req.limit)
+            return false;
+        fields[node_id] += req.lease_size;
+        return true;
+    }
+
+    long long total() const
+    {
+        long long ret = 0;
+        for(const auto &it : fields) ret += it.second;
+        return ret;
+    }
+
+    long long get(int node_id) { return fields[node_id]; }
+    void invalidate(int node_id) { fields[node_id] = 0; }
+};
+
+struct LeaseTestNode {
+    int node_id;
+    ResourceLeases leases;
+    std::list<ResourceList> calls;
+    long long strict_taken;
+
+    LeaseTestNode(int node_id, int type, int lease_size)
+      : node_id(node_id),
+        strict_taken(0)
+    {
+        //retry denied renewals immediately
+        leases.configure({ { type, lease_size } }, 0);
+    }
+
+    //renewals are answered immediately as the redis thread would do
+    bool start_call(ResourcesRedisStub &redis, const string &resources)
+    {
+        ResourceList rl;
+        rl.parse(resources);
+
+        std::vector<ResourceLeases::renew_request> renew;
+        bool leased = leases.take(rl, renew);
+        for(const auto &req : renew) {
+            long long total;
+            bool granted = redis.renew(node_id, req, total);
+            ResourceOperationList ops;
+            leases.on_renew(req, granted, total, ops);
+            redis.apply(node_id, ops);
+        }
+
+        if(!leased) {
+            //strict path
+            Resource &r = rl.front();
+            if(redis.total() >= r.limit) return false;
+            r.active = true;
+            r.taken = true;
+            ResourceOperationList ops;
+            ops.emplace_back(ResourceOperation::RES_GET, r);
+            redis.apply(node_id, ops);
+            strict_taken += r.takes;
+        }
+
+        calls.push_back(rl);
+        return true;
+    }
+
+    void end_call(ResourcesRedisStub &redis, std::list<ResourceList>::iterator it)
+    {
+        ResourceOperationList ops;
+        for(auto &r : *it) {
+            if(!r.taken) continue;
+            if(r.leased) {
+                leases.put(r, ops);
+            } else {
+                ops.emplace_back(ResourceOperation::RES_PUT, r);
+                strict_taken -= r.takes;
+            }
+        }
+        redis.apply(node_id, ops);
+        calls.erase(it);
+    }
+
+    AmArg lease_info(const string &key)
+    {
+        AmArg a;
+        leases.info(a);
+        return a["leases"][key];
+    }
+};
+
+TEST_F(YetiTest, ResourceLeasesTakePut)
+{
+    ResourcesRedisStub redis;
+    LeaseTestNode node(1, 5, 10);
+
+    //no lease yet. strict path and renewal
+    ASSERT_TRUE(node.start_call(redis, "5:100:1000:1"));
+    ASSERT_EQ(node.strict_taken, 1);
+    ASSERT_EQ(redis.get(1), 11);
+
+    //served locally without redis writes
+    for(int i = 0; i < 4; i++)
+        ASSERT_TRUE(node.start_call(redis, "5:100:1000:1"));
+    ASSERT_EQ(redis.get(1), 11);
+    ASSERT_EQ(node.lease_info("r:5:100")["used"].asLongLong(), 4);
+
+    //renewal below the half of the block
+    for(int i = 0; i < 2; i++)
+        ASSERT_TRUE(node.start_call(redis, "5:100:1000:1"));
+    ASSERT_EQ(redis.get(1), 21);
+    ASSERT_EQ(node.lease_info("r:5:100")["leased"].asLongLong(), 20);
+
+    //types without lease_size are not served locally
+    std::vector<ResourceLeases::renew_request> renew;
+    ResourceList rl;
+    rl.parse("6:100:1000:1");
+    ASSERT_FALSE(node.leases.take(rl, renew));
+    ASSERT_TRUE(renew.empty());
+    ASSERT_FALSE(rl.front().taken);
+
+    while(!node.calls.empty())
+        node.end_call(redis, node.calls.begin());
+    ASSERT_EQ(node.strict_taken, 0);
+    ASSERT_EQ(node.lease_info("r:5:100")["used"].asLongLong(), 0);
+    ASSERT_EQ(redis.get(1), node.lease_info("r:5:100")["leased"].asLongLong());
+
+    //reset drops the queued lease operations and ignores puts for the old generation
+    ASSERT_TRUE(node.start_call(redis, "5:100:1000:1"));
+    ResourceOperationList queue;
+    queue.emplace_back(ResourceOperation::RES_PUT, node.calls.front().front());
+    ResourceOperation strict_op;
+    strict_op.op = ResourceOperation::RES_PUT;
+    queue.push_back(strict_op);
+    node.leases.reset(queue);
+    ASSERT_EQ(queue.size(), size_t{1});
+    ASSERT_EQ(queue.front().leased, 0u);
+
+    ResourceOperationList ops;
+    node.leases.put(node.calls.front().front(), ops);
+    ASSERT_TRUE(ops.empty());
+    ASSERT_EQ(node.lease_info("r:5:100")["leased"].asLongLong(), 0);
+}
+
+TEST_F(YetiTest, ResourceLeasesConcurrentRenewal)
+{
+    static const int limit = 100;
+    static const int lease_size = 30;
+    const string resources = "5:100:" + int2str(limit) + ":1";
+
+    ResourcesRedisStub redis;
+    LeaseTestNode node1(1, 5, lease_size), node2(2, 5, lease_size);
+
+    //usage of the strict path on the other node
+    ResourceList strict;
+    strict.parse("5:100:" + int2str(limit) + ":50");
+    strict.front().active = true;
+    ResourceOperationList strict_ops;
+    strict_ops.emplace_back(ResourceOperation::RES_GET, strict.front());
+    redis.apply(3, strict_ops);
+
+    /* both nodes request the block while there is room for the single one.
+     * the second renewal is executed before the reply for the first one is processed.
+     * with the separate read of the usage both would see 50 and exceed the limit */
+    std::vector<ResourceLeases::renew_request> renew1, renew2;
+    ResourceList rl1, rl2;
+    rl1.parse(resources);
+    rl2.parse(resources);
+    ASSERT_FALSE(node1.leases.take(rl1, renew1));
+    ASSERT_FALSE(node2.leases.take(rl2, renew2));
+    ASSERT_EQ(renew1.size(), size_t{1});
+    ASSERT_EQ(renew2.size(), size_t{1});
+
+    long long total1, total2;
+    bool granted1 = redis.renew(node1.node_id, renew1.front(), total1);
+    bool granted2 = redis.renew(node2.node_id, renew2.front(), total2);
+    ASSERT_TRUE(granted1);
+    ASSERT_FALSE(granted2);
+    ASSERT_EQ(total1, 50);
+    ASSERT_EQ(total2, 80);
+    ASSERT_LE(redis.total(), limit);
+
+    //replies are processed in the reverse order
+    ResourceOperationList ops;
+    node2.leases.on_renew(renew2.front(), granted2, total2, ops);
+    ASSERT_TRUE(ops.empty());
+    ASSERT_TRUE(node2.lease_info("r:5:100")["draining"].asBool());
+    node1.leases.on_renew(renew1.front(), granted1, total1, ops);
+    ASSERT_TRUE(ops.empty());
+
+    ASSERT_EQ(node1.lease_info("r:5:100")["leased"].asLongLong(), lease_size);
+    ASSERT_EQ(node2.lease_info("r:5:100")["leased"].asLongLong(), 0);
+    ASSERT_EQ(redis.get(node1.node_id), lease_size);
+    ASSERT_EQ(redis.get(node2.node_id), 0);
+    ASSERT_EQ(redis.total(), 50 + lease_size);
+
+    //block granted after the invalidation of the node field is returned
+    ResourceLeases::renew_request req = { 5, 100, limit, lease_size, node1.leases.get_generation() };
+    ResourceOperationList queue;
+    node1.leases.reset(queue);
+    redis.invalidate(node1.node_id);
+
+    long long total;
+    ASSERT_TRUE(redis.renew(node1.node_id, req, total));
+    node1.leases.on_renew(req, true, total, ops);
+    ASSERT_EQ(ops.size(), size_t{1});
+    redis.apply(node1.node_id, ops);
+    ASSERT_EQ(redis.get(node1.node_id), 0);
+    ASSERT_EQ(node1.lease_info("r:5:100")["leased"].asLongLong(), 0);
+}
+
+TEST_F(YetiTest, ResourceLeasesMultiNode)
+{
+    static const int nodes_count = 3;
+    static const int limit = 1000;
+    static const int lease_size = 50;
+    static const int steps = 200000;
+
+    const string resources = "5:100:" + int2str(limit) + ":1";
+
+    ResourcesRedisStub redis;
+    std::vector<std::unique_ptr<LeaseTestNode>> nodes;
+    for(int i = 0; i < nodes_count; i++)
+        nodes.emplace_back(new LeaseTestNode(i + 1, 5, lease_size));
+
+    auto active_calls = [&]() {
+        size_t ret = 0;
+        for(auto &n : nodes) ret += n->calls.size();
+        return static_cast<long long>(ret);
+    };
+
+    std::mt19937 rnd(42);
+    long long rejected = 0;
+    for(int step = 0; step < steps; step++) {
+        auto &node = *nodes[rnd() % nodes_count];
+
+        //load oscillates around the limit to pass through the draining
+        bool overload_phase = (step / 20000) % 2;
+        bool start = rnd() % 100 < (overload_phase ? 60 : 45);
+
+        if(start) {
+            if(!node.start_call(redis, resources))
+                rejected++;
+        } else if(!node.calls.empty()) {
+            auto it = node.calls.begin();
+            std::advance(it, rnd() % node.calls.size());
+            node.end_call(redis, it);
+        }
+
+        //all the nodes together never exceed the limit
+        ASSERT_LE(redis.total(), limit);
+        ASSERT_LE(active_calls(), redis.total());
+
+        //node field consists of the lease and the strict path calls
+        if(step % 1000 == 0) {
+            for(auto &n : nodes) {
+                auto info = n->lease_info("r:5:100");
+                ASSERT_EQ(redis.get(n->node_id),
+                          info["leased"].asLongLong() + n->strict_taken);
+                ASSERT_LE(info["used"].asLongLong(), info["leased"].asLongLong());
+            }
+        }
+    }
+    ASSERT_GT(rejected, 0);
+
+    //leases are drained close to the limit
+    while(true) {
+        bool started = false;
+        for(auto &n : nodes)
+            started |= n->start_call(redis, resources);
+        if(!started) break;
+    }
+    ASSERT_GE(active_calls(), limit - nodes_count * lease_size);
+
+    for(auto &n : nodes) {
+        while(!n->calls.empty())
+            n->end_call(redis, n->calls.begin());
+        auto info = n->lease_info("r:5:100");
+        ASSERT_EQ(n->strict_taken, 0);
+        ASSERT_EQ(info["used"].asLongLong(), 0);
+        ASSERT_EQ(redis.get(n->node_id), info["leased"].asLongLong());
+        ASSERT_LE(info["leased"].asLongLong(), 2 * lease_size);
+    }
+}
@@ -3,6 +3,9 @@
 #include "../src/resources/ResourceControl.h"
 #include "../src/resources/ResourceRedisConnection.h"
 
+#include <chrono>
+#include <thread>
+
 static AmCondition<bool> inited(false);
 static void InitCallback() {
     inited.set(true);
@@ -323,3 +326,141 @@ TEST_F(YetiTest, ResourceTimeout)
 
     conn.stop(true);
 }
+
+TEST_F(YetiTest, ResourceOperationsMerge)
+{
+    ResourceOperationList rol;
+    auto add = [&rol](ResourceOperation::Operation op, int type, int takes, bool flag) {
+        ResourceOperation r;
+        r.op = op;
+        r.type = type;
+        r.id = 472;
+        r.takes = takes;
+        r.active = r.taken = flag;
+        rol.push_back(r);
+    };
+
+    //+2/-2 pair of the short call
+    add(ResourceOperation::RES_GET, 0, 2, true);
+    add(ResourceOperation::RES_PUT, 0, 2, true);
+    add(ResourceOperation::RES_GET, 1, 1, true);
+    add(ResourceOperation::RES_GET, 1, 1, true);
+    add(ResourceOperation::RES_PUT, 2, 3, true);
+    //filtered out
+    add(ResourceOperation::RES_GET, 3, 1, false);
+    add(ResourceOperation::RES_PUT, 4, 1, false);
+    add(ResourceOperation::RES_NONE, 5, 1, true);
+
+    OperationResources op(nullptr, rol);
+    ASSERT_EQ(op.get_operations_count(), 5u);
+
+    auto &deltas = op.get_deltas();
+    ASSERT_EQ(deltas.size(), 2u);
+    ASSERT_EQ(deltas[0].type, 1);
+    ASSERT_EQ(deltas[0].id, 472);
+    ASSERT_EQ(deltas[0].value, 2);
+    ASSERT_EQ(deltas[1].type, 2);
+    ASSERT_EQ(deltas[1].value, -3);
+
+    //nothing to write for the zero-sum operations
+    rol.clear();
+    add(ResourceOperation::RES_GET, 0, 2, true);
+    add(ResourceOperation::RES_PUT, 0, 2, true);
+    OperationResources zero_op(nullptr, rol);
+    ASSERT_TRUE(zero_op.get_deltas().empty());
+    ASSERT_FALSE(zero_op.perform());
+}
+
+class ResourceOperationsConnection
+  : public ResourceRedisConnection
+{
+  public:
+    ResourceOperationsConnection()
+      : ResourceRedisConnection("resourceTest")
+    {}
+    using ResourceRedisConnection::process_operations_list;
+};
+
+/* short calls get/put throughput with operations merging and pipelined batches.
+ * commands/op is 1 without merging.
+ * './run_unit_test.sh YetiTest.DISABLED_ResourceOperationsThroughput' */
+TEST_F(YetiTest, DISABLED_ResourceOperationsThroughput)
+{
+    static const int calls = 100000;
+    static const int concurrent_calls = 100;
+
+    server->addCommandResponse("MULTI", REDIS_REPLY_STATUS, AmArg());
+    server->addCommandStatus("HINCRBY", 3, REDIS_REPLY_STATUS);
+    server->addPermanentCommandResponse("EXEC", REDIS_REPLY_ARRAY, AmArg());
+
+    for(int max_inflight : { 1, 4, 16 }) {
+        ResourceOperationsConnection conn;
+        AmConfigReader cfg;
+        cfg.setParameter("write_redis_host", yeti_test::instance()->redis.host.c_str());
+        cfg.setParameter("write_redis_port", int2str(yeti_test::instance()->redis.port));
+        cfg.setParameter("read_redis_host", yeti_test::instance()->redis.host.c_str());
+        cfg.setParameter("read_redis_port", int2str(yeti_test::instance()->redis.port));
+        cfg.setParameter("read_redis_timeout", int2str(DEFAULT_REDIS_TIMEOUT_MSEC));
+        cfg.setParameter("write_redis_timeout", int2str(DEFAULT_REDIS_TIMEOUT_MSEC));
+        cfg.setParameter("max_inflight_batches", int2str(max_inflight));
+        conn.configure(cfg);
+        conn.registerResourcesInitializedCallback(InitCallback);
+        conn.init();
+        conn.start();
+
+        inited.set(false);
+        time_t time_ = time(0);
+        while(!inited.wait_for_to(500)) {
+            ASSERT_FALSE(time(0) - time_ > 3);
+        }
+
+        AmArg before;
+        conn.get_operations_stats(before);
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < calls + concurrent_calls; i++) {
+            ResourceOperationList rol;
+            rol.parse("0:472:1000:1;1:472:1000:1");
+            for(auto &res: rol) {
+                res.active = res.taken = true;
+                //get for the new call, put for the call started concurrent_calls ago
+                if(i < calls) {
+                    res.op = ResourceOperation::RES_GET;
+                    ResourceOperationList get_rol;
+                    get_rol.push_back(res);
+                    conn.process_operations_list(get_rol);
+                }
+                if(i >= concurrent_calls) {
+                    res.op = ResourceOperation::RES_PUT;
+                    ResourceOperationList put_rol;
+                    put_rol.push_back(res);
+                    conn.process_operations_list(put_rol);
+                }
+            }
+        }
+
+        AmArg stats;
+        time_ = time(0);
+        while(true) {
+            stats.clear();
+            conn.get_operations_stats(stats);
+            if(!stats["queued"].asLongLong() && !stats["inflight"].asInt())
+                break;
+            ASSERT_FALSE(time(0) - time_ > 30);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        auto operations = stats["operations"].asLongLong() - before["operations"].asLongLong();
+        auto batches = stats["batches"].asLongLong() - before["batches"].asLongLong();
+        auto commands = stats["commands"].asLongLong() - before["commands"].asLongLong();
+        auto prefix = "max_inflight_batches_" + std::to_string(max_inflight) + "_";
+        RecordProperty(prefix + "operations", std::to_string(operations));
+        RecordProperty(prefix + "ops_per_sec", std::to_string(operations / elapsed));
+        RecordProperty(prefix + "batches", std::to_string(batches));
+        RecordProperty(prefix + "commands_per_op",
+                       std::to_string(operations ? static_cast<double>(commands) / operations : 0.0));
+
+        conn.stop(true);
+    }
+}
@@ -0,0 +1,103 @@
+#include "YetiTest.h"
+#include "../src/sdp_filter.h"
+#include "../src/SdpOfferCache.h"
+#include "../src/SDPFilter.h"
+
+#include <chrono>
+
+static const char *sdp_offer =
+    "v=0\r\n"
+    "o=- 3711 3711 IN IP4 192.168.0.10\r\n"
+    "s=-\r\n"
+    "c=IN IP4 192.168.0.10\r\n"
+    "t=0 0\r\n"
+    "m=audio 10000 RTP/AVP 8 0 18 9 101\r\n"
+    "a=rtpmap:8 PCMA/8000\r\n"
+    "a=rtpmap:0 PCMU/8000\r\n"
+    "a=rtpmap:18 G729/8000\r\n"
+    "a=fmtp:18 annexb=no\r\n"
+    "a=rtpmap:9 G722/8000\r\n"
+    "a=rtpmap:101 telephone-event/8000\r\n"
+    "a=fmtp:101 0-15\r\n"
+    "a=ptime:20\r\n"
+    "a=sendrecv\r\n";
+
+TEST_F(YetiTest, SdpFilterArrangeCodecIds)
+{
+    CodecsGroupEntry codecs_group;
+    for(const auto &c : { "pcmu/8000", "G729/8000", "PCMA/8000", "telephone-event/8000" })
+        ASSERT_TRUE(codecs_group.add_codec(c, "", NO_DYN_PAYLOAD));
+
+    ASSERT_EQ(codecs_group.get_codecs_ids_count(), 4u);
+    ASSERT_EQ(codecs_group.get_codec_id("pcma"), codecs_group.get_payloads_ids()[2]);
+    ASSERT_EQ(codecs_group.get_codec_id("PCMA"), CODEC_ID_UNKNOWN);
+    ASSERT_EQ(codecs_group.get_codec_id("g722"), CODEC_ID_UNKNOWN);
+
+    //payloads are arranged in the group order, names are matched case-insensitively
+    AmSdp sdp;
+    ASSERT_EQ(sdp.parse(sdp_offer), 0);
+    ASSERT_EQ(filter_arrange_SDP(sdp, codecs_group, false), 0);
+    ASSERT_EQ(sdp.media.size(), 1u);
+
+    vector<int> types;
+    for(const auto &p : sdp.media.front().payloads)
+        types.push_back(p.payload_type);
+    ASSERT_EQ(types, vector<int>({ 0, 18, 8, 101 }));
+}
+
+/* relayed offer processing rate: full filtering chain
+ * compared to the repeated offer served from SdpOfferCache
+ * run: ./run_unit_test.sh YetiTest.DISABLED_SdpOfferBenchmark */
+TEST_F(YetiTest, DISABLED_SdpOfferBenchmark)
+{
+    static const int offers = 20000;
+
+    CodecsGroupEntry codecs_group;
+    for(const auto &c : { "PCMU/8000", "PCMA/8000", "telephone-event/8000" })
+        codecs_group.add_codec(c, "", NO_DYN_PAYLOAD);
+
+    vector<FilterEntry> alines_filter;
+    FilterEntry alines_entry;
+    alines_entry.filter_type = FilterType::Blacklist;
+    alines_entry.filter_list.emplace("ptime");
+    alines_filter.push_back(alines_entry);
+
+    std::string_view offer(sdp_offer);
+    string body;
+    vector<SdpMedia> negotiated_media;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < offers; i++) {
+        AmSdp sdp;
+        ASSERT_EQ(sdp.parse(offer.data()), 0);
+        filter_arrange_SDP(sdp, codecs_group, false);
+        filterSDPalines(sdp, alines_filter);
+        negotiated_media = sdp.media;
+        body.clear();
+        sdp.print(body);
+    }
+    auto full_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    SdpOfferCache cache;
+    CodecsGroupEntryPtr codecs_group_ptr(&codecs_group, [](const CodecsGroupEntry *) {});
+    cache.valid = true;
+    cache.offer_hash = SdpOfferCache::hash(offer);
+    cache.offer.assign(offer);
+    cache.codecs_group = codecs_group_ptr;
+    cache.single_codec = false;
+    cache.body = body;
+    cache.negotiated_media = negotiated_media;
+
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < offers; i++) {
+        ASSERT_TRUE(cache.match(SdpOfferCache::hash(offer), offer, codecs_group_ptr, false));
+        negotiated_media = cache.negotiated_media;
+        body = cache.body;
+    }
+    auto cached_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    RecordProperty("full_chain_offers_per_sec", std::to_string(offers * 1e9 / full_ns));
+    RecordProperty("cached_offers_per_sec", std::to_string(offers * 1e9 / cached_ns));
+}
@@ -0,0 +1,157 @@
+#include "YetiTest.h"
+#include "../src/SipHeaderIndex.h"
+#include "../src/HeaderFilter.h"
+#include "../src/UsedHeaderField.h"
+#include "sip/defs.h"
+
+#include <chrono>
+#include <algorithm>
+
+static string invite_hdrs =
+    "Max-Forwards: 70" CRLF
+    "X-AUTH-IP: 192.168.0.10" CRLF
+    "X-YETI-AUTH: secret" CRLF
+    "User-Agent: yeti-test" CRLF
+    "Allow: INVITE, ACK, CANCEL, BYE, OPTIONS, INFO, UPDATE, REFER" CRLF
+    "Supported: timer, 100rel" CRLF
+    "Session-Expires: 1800" CRLF
+    "Min-SE: 90" CRLF
+    "P-Asserted-Identity: <sip:123@domain.invalid>" CRLF
+    "Diversion: <sip:user1@domain1;uparam1=uval11>" CRLF
+    "Diversion: <sip:user2@domain2>, <sip:user3@domain3>" CRLF
+    "Identity: eyJhbGciOiJFUzI1NiJ9.eyJhdHRlc3QiOiJBIn0.c2ln;info=<https://cert.invalid/x5u.pem>" CRLF
+    "X-Custom-1: value1" CRLF
+    "X-Custom-2: value2" CRLF
+    "Content-Type: application/sdp" CRLF;
+
+TEST_F(YetiTest, SipHeaderIndex)
+{
+    SipHeaderIndex index(invite_hdrs);
+
+    ASSERT_FALSE(index.failed());
+    ASSERT_EQ(index.headers().size(), size_t{15});
+
+    ASSERT_EQ(index.getFirst("x-yeti-auth"), "secret");
+    ASSERT_EQ(index.getFirst("X-AUTH-IP"), "192.168.0.10");
+    ASSERT_EQ(index.getAll("DIVERSION"),
+              "<sip:user1@domain1;uparam1=uval11>, <sip:user2@domain2>, <sip:user3@domain3>");
+    ASSERT_EQ(index.getAll("diversion"), getHeader(invite_hdrs, "Diversion"));
+    ASSERT_FALSE(index.exists("X-Custom"));
+    ASSERT_TRUE(index.getFirst("X-Unknown").empty());
+
+    //rebind to the copy with the same content
+    string hdrs_copy = invite_hdrs;
+    index.bind(hdrs_copy);
+    ASSERT_EQ(index.getFirst("Min-SE"), "90");
+
+    //rebind to the different headers invalidates index
+    string other_hdrs("Min-SE: 120" CRLF);
+    index.bind(other_hdrs);
+    ASSERT_EQ(index.headers().size(), size_t{1});
+    ASSERT_EQ(index.getFirst("min-se"), "120");
+
+    //different headers of the same size
+    string same_size_hdrs("X-A: 123456" CRLF);
+    ASSERT_EQ(same_size_hdrs.size(), other_hdrs.size());
+    index.bind(same_size_hdrs);
+    ASSERT_EQ(index.getFirst("x-a"), "123456");
+    ASSERT_FALSE(index.exists("min-se"));
+
+    string malformed_hdrs("Min-SE: 120" CRLF "Malformed header" CRLF);
+    SipHeaderIndex malformed_index(malformed_hdrs);
+    ASSERT_TRUE(malformed_index.failed());
+    ASSERT_EQ(malformed_index.getFirst("min-se"), "120");
+}
+
+/* INVITE preprocessing cost: pre-auth, identity, routing headers and filter
+ * run: ./run_unit_test.sh YetiTest.DISABLED_SipHeaderIndexBenchmark */
+TEST_F(YetiTest, DISABLED_SipHeaderIndexBenchmark)
+{
+    static const int iterations = 100000;
+
+    AmSipRequest req;
+    req.hdrs = invite_hdrs;
+
+    vector<UsedHeaderField> used_header_fields;
+    for(const auto &name : { "P-Asserted-Identity", "Diversion", "X-Custom-1", "X-Custom-2" }) {
+        used_header_fields.emplace_back(AmArg{
+            { "varname", name },
+            { "varformat", "" },
+            { "varparam", "" }
+        });
+    }
+
+    vector<FilterEntry> filters;
+    FilterEntry entry;
+    entry.filter_type = FilterType::Blacklist;
+    entry.filter_list.emplace("x-custom-1");
+    entry.filter_list.emplace("x-yeti-auth");
+    filters.push_back(entry);
+
+    auto legacy_scan = [](const string &hdrs, const char *name, string &value) {
+        size_t start_pos = 0;
+        while(start_pos < hdrs.length()) {
+            size_t name_end, val_begin, val_end, hdr_end;
+            if(skip_header(hdrs, start_pos, name_end, val_begin, val_end, hdr_end))
+                break;
+            string hdr_name = hdrs.substr(start_pos, name_end-start_pos);
+            std::transform(hdr_name.begin(), hdr_name.end(), hdr_name.begin(), ::tolower);
+            if(hdr_name == name && value.empty())
+                value = hdrs.substr(val_begin, val_end-val_begin);
+            start_pos = hdr_end;
+        }
+    };
+
+    size_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++) {
+        string orig_ip, x_yeti_auth, identity, value;
+        legacy_scan(req.hdrs, "x-auth-ip", orig_ip);
+        legacy_scan(req.hdrs, "x-yeti-auth", x_yeti_auth);
+        legacy_scan(req.hdrs, "identity", identity);
+        for(const auto &f : used_header_fields) {
+            value = getHeader(req.hdrs, f.getName());
+            checksum += value.size();
+        }
+        string hdrs = req.hdrs;
+        size_t start_pos = 0;
+        while(start_pos < hdrs.length()) {
+            size_t name_end, val_begin, val_end, hdr_end;
+            if(skip_header(hdrs, start_pos, name_end, val_begin, val_end, hdr_end))
+                break;
+            string hdr_name = hdrs.substr(start_pos, name_end-start_pos);
+            std::transform(hdr_name.begin(), hdr_name.end(), hdr_name.begin(), ::tolower);
+            if(entry.filter_list.contains(hdr_name))
+                hdrs.erase(start_pos, hdr_end-start_pos);
+            else
+                start_pos = hdr_end;
+        }
+        checksum += orig_ip.size() + x_yeti_auth.size() + identity.size() + hdrs.size();
+    }
+    auto legacy_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++) {
+        SipHeaderIndex index(req.hdrs);
+        string orig_ip = index.getFirst("X-AUTH-IP");
+        string x_yeti_auth = index.getFirst("X-YETI-AUTH");
+        string identity = index.getFirst("Identity");
+        string value;
+        for(const auto &f : used_header_fields) {
+            value.clear();
+            f.getValue(req, index, value);
+            checksum += value.size();
+        }
+        string hdrs = req.hdrs;
+        inplaceHeaderFilter(hdrs, filters);
+        checksum += orig_ip.size() + x_yeti_auth.size() + identity.size() + hdrs.size();
+    }
+    auto indexed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    RecordProperty("legacy_ns_per_op", std::to_string(legacy_ns / iterations));
+    RecordProperty("indexed_ns_per_op", std::to_string(indexed_ns / iterations));
+    RecordProperty("checksum", std::to_string(checksum));
+}
@@ -0,0 +1,262 @@
+#include "YetiBench.h"
+#include "../src/SqlCallProfile.h"
+#include "../src/CallCtx.h"
+#include "../src/yeti.h"
+
+#include "jsonArg.h"
+
+#include <malloc.h>
+#include <chrono>
+
+static AmArg profile_row()
+{
+    AmArg t;
+    t["ruri"] = "sip:123@domain.invalid";
+    t["from"] = "<sip:456@domain.invalid>";
+    t["to"] = "<sip:123@domain.invalid>";
+    t["transit_headers_a2b"] = "X-Origin,P-Asserted-Identity,Diversion,X-Custom-*";
+    t["transit_headers_b2a"] = "X-Term,P-Charge-Info";
+    t["sdp_filter_type_id"] = FILTER_TYPE_WHITELIST;
+    t["sdp_filter_list"] = "PCMA,PCMU,G729,telephone-event";
+    t["sdp_alines_filter_type_id"] = FILTER_TYPE_BLACKLIST;
+    t["sdp_alines_filter_list"] = "crypto,ice-ufrag,ice-pwd,candidate";
+    t["reply_translations"] = "603=>488 Not acceptable here|486=>480 Unavailable";
+    t["aleg_rtp_acl"].push("10.0.0.0/8");
+    t["aleg_rtp_acl"].push("192.168.0.0/16");
+    t["bleg_rtp_acl"].push("172.16.0.0/12");
+    return t;
+}
+
+TEST_F(YetiTest, SqlCallProfileCow)
+{
+    SqlCallProfile p;
+    ASSERT_TRUE(p.readFromTuple(profile_row(), DynFieldsT()));
+    ASSERT_FALSE(p.headerfilter_a2b->empty());
+    ASSERT_EQ(p.aleg_rtp_acl->size(), size_t{2});
+    ASSERT_EQ(p.reply_translations->size(), size_t{2});
+
+    SqlCallProfile copy(p);
+    ASSERT_TRUE(copy.headerfilter_a2b.shared());
+    ASSERT_EQ(&*copy.headerfilter_a2b, &*p.headerfilter_a2b);
+    ASSERT_EQ(&*copy.aleg_rtp_acl, &*p.aleg_rtp_acl);
+    ASSERT_TRUE(copy.headerfilter_a2b == p.headerfilter_a2b);
+
+    //modification detaches the block from the source profile
+    copy.reply_translations.write().erase(603);
+    ASSERT_NE(&*copy.reply_translations, &*p.reply_translations);
+    ASSERT_EQ(copy.reply_translations->size(), size_t{1});
+    ASSERT_EQ(p.reply_translations->size(), size_t{2});
+    ASSERT_FALSE(p.reply_translations.shared());
+}
+
+/* memory and time per profile copy with shared blocks
+ * and with detached blocks (equivalent of the deep copy)
+ * run: ./run_unit_test.sh YetiTest.DISABLED_SqlCallProfileCopyBenchmark */
+TEST_F(YetiTest, DISABLED_SqlCallProfileCopyBenchmark)
+{
+    static const int copies = 10000;
+
+    SqlCallProfile p;
+    ASSERT_TRUE(p.readFromTuple(profile_row(), DynFieldsT()));
+
+    auto measure = [&p](bool deep, size_t &bytes_per_copy, long &ns_per_copy) {
+        list<SqlCallProfile> profiles;
+        auto heap_before = mallinfo2().uordblks;
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < copies; i++) {
+            auto &c = profiles.emplace_back(p);
+            if(deep) {
+                c.headerfilter_a2b.write();
+                c.headerfilter_b2a.write();
+                c.sdpfilter.write();
+                c.sdpalinesfilter.write();
+                c.bleg_sdpalinesfilter.write();
+                c.mediafilter.write();
+                c.reply_translations.write();
+                c.aleg_rtp_acl.write();
+                c.bleg_rtp_acl.write();
+            }
+        }
+        ns_per_copy = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count() / copies;
+        bytes_per_copy = (mallinfo2().uordblks - heap_before) / copies;
+    };
+
+    size_t shared_bytes, deep_bytes;
+    long shared_ns, deep_ns;
+    measure(true, deep_bytes, deep_ns);
+    measure(false, shared_bytes, shared_ns);
+
+    RecordProperty("deep_copy_bytes", std::to_string(deep_bytes));
+    RecordProperty("deep_copy_ns", std::to_string(deep_ns));
+    RecordProperty("shared_copy_bytes", std::to_string(shared_bytes));
+    RecordProperty("shared_copy_ns", std::to_string(shared_ns));
+}
+
+/* routing state setup/teardown rate with the per-call arena
+ * compared to the same profiles in the heap-allocated list.
+ * each simulated call reads its profiles from the getprofile row
+ * run: ./run_unit_test.sh YetiTest.DISABLED_CallCtxArenaBenchmark */
+TEST_F(YetiTest, DISABLED_CallCtxArenaBenchmark)
+{
+    static const int calls = 20000;
+    static const int profiles_per_call = 3;
+
+    AmArg row = profile_row();
+    size_t failed = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < calls; i++) {
+        list<SqlCallProfile> profiles;
+        for(int j = 0; j < profiles_per_call; j++) {
+            auto &p = profiles.emplace_back();
+            if(!p.readFromTuple(row, DynFieldsT())) failed++;
+            p.rl.parse("1:1:10:1");
+        }
+    }
+    auto heap_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < calls; i++) {
+        auto ctx = new CallCtx(Yeti::instance().router);
+        for(int j = 0; j < profiles_per_call; j++) {
+            auto &p = ctx->profiles.emplace_back();
+            if(!p.readFromTuple(row, DynFieldsT())) failed++;
+            p.rl.parse("1:1:10:1");
+        }
+        ctx->current_profile = ctx->profiles.begin();
+        delete ctx;
+    }
+    auto arena_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    ASSERT_EQ(failed, size_t{0});
+    RecordProperty("heap_calls_per_sec", std::to_string(calls * 1e9 / heap_ns));
+    RecordProperty("arena_calls_per_sec", std::to_string(calls * 1e9 / arena_ns));
+}
+
+TEST_F(YetiTest, PlaceholdersHash)
+{
+    auto use_radius = Yeti::instance().config.use_radius;
+    Yeti::instance().config.use_radius = true;
+    SqlCallProfile p;
+    ASSERT_TRUE(p.readFromTuple(profile_row(), DynFieldsT()));
+    Yeti::instance().config.use_radius = use_radius;
+
+    auto local_tag = PlaceholdersHash::key("call_local_tag");
+    auto port = PlaceholdersHash::key("aleg_remote_port");
+    auto time_start = PlaceholdersHash::key("time_start_float");
+    ASSERT_EQ(PlaceholdersHash::key("call_local_tag"), local_tag);
+    ASSERT_NE(port, local_tag);
+
+    //leg copy of the profile placeholders
+    PlaceholdersHash v(p.placeholders_hash);
+    timeval tv = { 1500000000, 250000 };
+    v.set(local_tag, string("tag"));
+    v.set(port, 5060LL);
+    v.set(time_start, tv, PlaceholdersHash::TimeFloat);
+
+    auto values = v.get();
+    ASSERT_EQ(values["ruri"], arg2json(profile_row()["ruri"]));
+    ASSERT_EQ(values["call_local_tag"], "tag");
+    ASSERT_EQ(values["aleg_remote_port"], "5060");
+    ASSERT_EQ(values["time_start_float"], timeval2str_usec(tv));
+
+    //profile is not affected by the leg values
+    ASSERT_FALSE(p.placeholders_hash.get().count("call_local_tag"));
+
+    //profile update keeps the call values
+    AmArg row = profile_row();
+    row["ruri"] = "sip:789@domain.invalid";
+    PlaceholdersHash h;
+    h.setRow(row);
+    h.set(port, 5070LL);
+    v.update(h);
+    values = v.get();
+    ASSERT_EQ(values["ruri"], arg2json(row["ruri"]));
+    ASSERT_EQ(values["call_local_tag"], "tag");
+    ASSERT_EQ(values["aleg_remote_port"], "5070");
+}
+
+/* placeholders handling for the call with RADIUS auth and accounting:
+ * profile read, legs copies, hooks values and requests to the RADIUS module.
+ * legacy is the map of the formatted values copied as a whole.
+ * run: ./run_unit_test.sh YetiTest.DISABLED_PlaceholdersHashBenchmark */
+TEST_F(YetiTest, DISABLED_PlaceholdersHashBenchmark)
+{
+    static const int calls = 20000;
+    //call_profile and placeholders of both legs
+    static const int profile_copies = 4;
+    static const int interims = 3;
+
+    //routing rows have about 150 columns
+    AmArg row = profile_row();
+    for(int i = 0; i < 140; i++)
+        row["column_" + int2str(i)] = i % 2 ? AmArg(i) : AmArg("value_" + int2str(i));
+
+    timeval now;
+    gettimeofday(&now, nullptr);
+
+    static const char *hook_keys[] = {
+        "call_local_tag", "call_orig_call_id", "call_time_start",
+        "time_start", "time_start_float", "time_start_int",
+        "aleg_remote_ip", "aleg_remote_port", "aleg_local_ip", "aleg_local_port",
+        "time_connect", "time_connect_float", "time_connect_int",
+        "call_duration_float", "call_duration_int",
+        "leg_disconnect_code", "leg_disconnect_reason",
+        "time_end", "time_end_float", "time_end_int"
+    };
+    static const size_t hook_keys_count = sizeof(hook_keys)/sizeof(hook_keys[0]);
+    //auth, start, interims and stop requests
+    static const size_t events = 2 + interims;
+    static const size_t keys_per_event = hook_keys_count / events;
+
+    std::vector<PlaceholdersHash::key_id_t> ids;
+    for(auto k : hook_keys)
+        ids.push_back(PlaceholdersHash::key(k));
+
+    size_t events_size = 0;
+    auto measure = [&](bool legacy, double &allocations_per_call, double &ns_per_call) {
+        bench_allocations_start();
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < calls; i++) {
+            if(legacy) {
+                std::map<string, string> profile;
+                for(const auto &f: row)
+                    profile[f.first] = arg2json(f.second);
+                std::list<std::map<string, string>> copies(profile_copies, profile);
+                auto &v = copies.back();
+                for(size_t e = 0; e < events; e++) {
+                    for(size_t k = e * keys_per_event; k < (e + 1) * keys_per_event; k++)
+                        v[hook_keys[k]] = timeval2str_usec(now);
+                    std::map<string, string> event(v);
+                    events_size += event.size();
+                }
+            } else {
+                PlaceholdersHash profile;
+                profile.setRow(row);
+                std::list<PlaceholdersHash> copies(profile_copies, profile);
+                auto &v = copies.back();
+                for(size_t e = 0; e < events; e++) {
+                    for(size_t k = e * keys_per_event; k < (e + 1) * keys_per_event; k++)
+                        v.set(ids[k], now, PlaceholdersHash::TimeFloat);
+                    events_size += v.get().size();
+                }
+            }
+        }
+        ns_per_call = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / calls;
+        allocations_per_call = static_cast<double>(bench_allocations_stop()) / calls;
+    };
+
+    double legacy_allocations, legacy_ns, allocations_per_call, ns_per_call;
+    measure(true, legacy_allocations, legacy_ns);
+    measure(false, allocations_per_call, ns_per_call);
+
+    RecordProperty("events_values", std::to_string(events_size));
+    RecordProperty("legacy_allocations_per_call", std::to_string(legacy_allocations));
+    RecordProperty("legacy_ns_per_call", std::to_string(legacy_ns));
+    RecordProperty("interned_allocations_per_call", std::to_string(allocations_per_call));
+    RecordProperty("interned_ns_per_call", std::to_string(ns_per_call));
+}
@@ -0,0 +1,158 @@
+#include "YetiTest.h"
+#include "../src/stats/StatsRegistry.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+TEST_F(YetiTest, LatencyHistogramBuckets)
+{
+    for(uint64_t v : { 0ull, 1ull, 31ull, 32ull, 33ull, 63ull, 64ull, 100ull,
+                       1000ull, 12345ull, 999999ull, 1ull << 36, (1ull << 37) - 1 })
+    {
+        auto idx = LatencyHistogram::bucketIndex(v);
+        ASSERT_LT(idx, LatencyHistogram::buckets_count);
+        ASSERT_LE(LatencyHistogram::bucketLowerBound(idx), v);
+        ASSERT_GE(LatencyHistogram::bucketUpperBound(idx), v);
+        //relative error
+        ASSERT_LE(LatencyHistogram::bucketUpperBound(idx) - LatencyHistogram::bucketLowerBound(idx),
+                  v / LatencyHistogram::sub_buckets);
+    }
+
+    for(unsigned int i = 1; i < LatencyHistogram::buckets_count; i++) {
+        ASSERT_EQ(LatencyHistogram::bucketLowerBound(i),
+                  LatencyHistogram::bucketUpperBound(i-1) + 1);
+    }
+
+    ASSERT_EQ(LatencyHistogram::bucketIndex(~0ull), LatencyHistogram::buckets_count - 1);
+}
+
+TEST_F(YetiTest, LatencyHistogramPercentiles)
+{
+    LatencyHistogram h;
+
+    auto s = h.snapshot();
+    ASSERT_EQ(s.count, 0u);
+    ASSERT_EQ(s.percentile(0.99), 0u);
+
+    for(uint64_t v = 1; v <= 10000; v++)
+        h.record(v);
+    h.record(std::chrono::milliseconds(20));
+
+    s = h.snapshot();
+    ASSERT_EQ(s.count, 10001u);
+    ASSERT_EQ(s.min, 1u);
+    ASSERT_EQ(s.max, 20000u);
+    ASSERT_EQ(s.sum, 10000u * 10001 / 2 + 20000);
+
+    auto near = [](uint64_t value, uint64_t expected) {
+        return value >= expected && value <= expected + expected / LatencyHistogram::sub_buckets;
+    };
+    ASSERT_TRUE(near(s.percentile(0.5), 5001));
+    ASSERT_TRUE(near(s.percentile(0.9), 9001));
+    ASSERT_TRUE(near(s.percentile(0.99), 9901));
+    ASSERT_EQ(s.percentile(1), 20000u);
+
+    ASSERT_EQ(s.countBelow(0), 0u);
+    ASSERT_EQ(s.countBelow(31), 31u);
+    ASSERT_EQ(s.countBelow(100000), 10001u);
+
+    h.reset();
+    s = h.snapshot();
+    ASSERT_EQ(s.count, 0u);
+    ASSERT_EQ(s.min, 0u);
+}
+
+TEST_F(YetiTest, LatencyHistogramCountBelowBoundary)
+{
+    LatencyHistogram h;
+
+    //1000 is inside the [992, 1023] bucket
+    auto idx = LatencyHistogram::bucketIndex(1000);
+    ASSERT_LT(LatencyHistogram::bucketLowerBound(idx), 1000u);
+    ASSERT_GT(LatencyHistogram::bucketUpperBound(idx), 1000u);
+
+    h.record(LatencyHistogram::bucketUpperBound(idx - 1));
+    h.record(1001);
+
+    auto s = h.snapshot();
+    //sample just above the boundary is not counted as le=1000
+    ASSERT_EQ(s.countBelow(1000), 1u);
+    ASSERT_EQ(s.countBelow(LatencyHistogram::bucketUpperBound(idx)), 2u);
+
+    h.reset();
+    s = h.snapshot();
+    ASSERT_EQ(s.count, 0u);
+    ASSERT_EQ(s.min, 0u);
+}
+
+TEST_F(YetiTest, StatsRegistryConcurrentUpdates)
+{
+    static const int threads_count = 8;
+    static const int iterations = 10000;
+
+    auto &c = StatsRegistry::instance()->counter("test_sharded_counter");
+    auto &h = StatsRegistry::instance()->histogram("test_latency");
+    ASSERT_EQ(&c, &StatsRegistry::instance()->counter("test_sharded_counter"));
+    ASSERT_EQ(&h, &StatsRegistry::instance()->histogram("test_latency"));
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < threads_count; i++) {
+        threads.emplace_back([&]() {
+            for(int k = 0; k < iterations; k++) {
+                c.inc();
+                h.record(k);
+            }
+        });
+    }
+    for(auto &t : threads) t.join();
+
+    ASSERT_EQ(c.get(), static_cast<uint64_t>(threads_count * iterations));
+    ASSERT_EQ(h.snapshot().count, static_cast<uint64_t>(threads_count * iterations));
+
+    StatsRegistry::instance()->flush();
+
+    AmArg ret;
+    StatsRegistry::instance()->getHistograms(ret);
+    ASSERT_TRUE(ret.hasMember("test_latency"));
+    ASSERT_EQ(ret["test_latency"]["count"].asLongLong(), threads_count * iterations);
+}
+
+/* single shared atomic counter vs ShardedCounter and histogram record()
+ * with concurrent updates from the multiple threads.
+ * './run_unit_test.sh YetiTest.DISABLED_StatsRegistryBenchmark' */
+TEST_F(YetiTest, DISABLED_StatsRegistryBenchmark)
+{
+    static const int iterations = 5000000;
+
+    auto run = [](int threads_count, std::function<void (int)> f) {
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < threads_count; i++) {
+            threads.emplace_back([&f]() {
+                for(int k = 0; k < iterations; k++) f(k);
+            });
+        }
+        for(auto &t : threads) t.join();
+        return std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / (iterations * threads_count);
+    };
+
+    for(int threads_count : { 1, 4, 8, 16 }) {
+        std::atomic<uint64_t> shared(0);
+        ShardedCounter sharded;
+        LatencyHistogram histogram;
+
+        auto shared_ns = run(threads_count, [&](int) { shared.fetch_add(1, std::memory_order_relaxed); });
+        auto sharded_ns = run(threads_count, [&](int) { sharded.inc(); });
+        auto histogram_ns = run(threads_count, [&](int k) { histogram.record(k & 0xffff); });
+
+        //aggregated throughput of all the threads
+        auto prefix = "threads_" + std::to_string(threads_count) + "_";
+        RecordProperty(prefix + "shared_atomic_ns_per_op", std::to_string(shared_ns));
+        RecordProperty(prefix + "sharded_counter_ns_per_op", std::to_string(sharded_ns));
+        RecordProperty(prefix + "histogram_record_ns_per_op", std::to_string(histogram_ns));
+    }
+}
@@ -0,0 +1,232 @@
+#include "YetiBench.h"
+
+#include "jsonArg.h"
+#include "sip/defs.h"
+
+#include <strings.h>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+/* operator new calls while enabled.
+ * default operator delete releases the memory with free() */
+static std::atomic<bool> count_allocations(false);
+static std::atomic<size_t> allocations(0);
+
+void *operator new(size_t size)
+{
+    if(count_allocations.load(std::memory_order_relaxed))
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void bench_allocations_start()
+{
+    allocations.store(0);
+    count_allocations.store(true);
+}
+
+size_t bench_allocations_stop()
+{
+    count_allocations.store(false);
+    return allocations.load();
+}
+
+std::map<string, YetiBench::result> YetiBench::results;
+
+static bool env_flag(const char *name)
+{
+    const char *v = getenv(name);
+    return v && *v && strcmp(v, "0");
+}
+
+static double arg2double(const AmArg &a)
+{
+    if(isArgDouble(a)) return a.asDouble();
+    if(isArgInt(a)) return a.asInt();
+    if(isArgLongLong(a)) return a.asLongLong();
+    return 0;
+}
+
+static bool read_file(const string &path, string &data)
+{
+    std::ifstream f(path);
+    if(!f) return false;
+    std::stringstream s;
+    s << f.rdbuf();
+    data = s.str();
+    return true;
+}
+
+static bool write_file(const string &path, const string &data)
+{
+    std::ofstream f(path, std::ios::trunc);
+    if(!f) return false;
+    f << data << std::endl;
+    return f.good();
+}
+
+void YetiBench::record(const string &name, unsigned long ops, double ns, size_t allocations)
+{
+    auto &r = results[name];
+    r.ns_per_op = ns / ops;
+    r.allocs_per_op = static_cast<double>(allocations) / ops;
+    RecordProperty(name + "_ns_per_op", std::to_string(r.ns_per_op));
+    RecordProperty(name + "_allocs_per_op", std::to_string(r.allocs_per_op));
+}
+
+string YetiBench::fixture(const string &name)
+{
+    string data;
+    if(!read_file(YETI_BENCH_FIXTURES_DIR + name, data))
+        ADD_FAILURE() << "failed to read fixture " << YETI_BENCH_FIXTURES_DIR << name;
+    return data;
+}
+
+AmArg YetiBench::fixtureJson(const string &name)
+{
+    AmArg ret;
+    if(!json2arg(fixture(name), ret))
+        ADD_FAILURE() << "failed to parse json fixture " << name;
+    return ret;
+}
+
+static string tag_param(const string &value)
+{
+    auto pos = value.find(";tag=");
+    if(pos == string::npos) return string();
+    pos += 5;
+    return value.substr(pos, value.find(';', pos) - pos);
+}
+
+string YetiBench::fixtureRequest(const string &name, AmSipRequest &req)
+{
+    //fixtures are stored with LF line endings
+    string msg;
+    for(auto c : fixture(name)) {
+        if(c == '\r') continue;
+        if(c == '\n') msg += CRLF;
+        else msg += c;
+    }
+
+    auto body_pos = msg.find(CRLF CRLF);
+    if(body_pos == string::npos) {
+        ADD_FAILURE() << "no headers end in fixture " << name;
+        return string();
+    }
+
+    std::istringstream s(msg.substr(0, body_pos + 2));
+    string line, version;
+    std::getline(s, line);
+    std::istringstream(line) >> req.method >> req.r_uri >> version;
+
+    while(std::getline(s, line)) {
+        if(!line.empty() && line.back() == '\r') line.pop_back();
+        auto colon = line.find(':');
+        if(colon == string::npos) continue;
+
+        string hdr = line.substr(0, colon);
+        string value = line.substr(line.find_first_not_of(' ', colon + 1));
+
+        if(!strcasecmp(hdr.data(), SIP_HDR_FROM)) {
+            req.from = value;
+            req.from_tag = tag_param(value);
+        } else if(!strcasecmp(hdr.data(), SIP_HDR_TO)) {
+            req.to = value;
+            req.to_tag = tag_param(value);
+        } else if(!strcasecmp(hdr.data(), SIP_HDR_CALL_ID)) {
+            req.callid = value;
+        } else if(!strcasecmp(hdr.data(), SIP_HDR_CSEQ)) {
+            req.cseq = strtoul(value.data(), nullptr, 10);
+        } else if(!strcasecmp(hdr.data(), SIP_HDR_CONTACT)) {
+            req.contact = value;
+        } else if(!strcasecmp(hdr.data(), SIP_HDR_VIA)) {
+            //sent-by of the topmost via as the source of the request
+            auto host = value.substr(value.find(' ') + 1);
+            host = host.substr(0, host.find(';'));
+            auto port = host.find(':');
+            req.remote_ip = host.substr(0, port);
+            req.remote_port = port == string::npos ? 5060 : atoi(host.data() + port + 1);
+        } else if(strcasecmp(hdr.data(), SIP_HDR_MAX_FORWARDS) &&
+                  strcasecmp(hdr.data(), SIP_HDR_CONTENT_TYPE) &&
+                  strcasecmp(hdr.data(), SIP_HDR_CONTENT_LENGTH))
+        {
+            req.hdrs += line + CRLF;
+        }
+    }
+
+    return msg.substr(body_pos + 4);
+}
+
+void YetiBench::TearDownTestSuite()
+{
+    if(results.empty()) return;
+
+    AmArg current;
+    for(const auto &it : results) {
+        AmArg &r = current[it.first];
+        r["ns_per_op"] = it.second.ns_per_op;
+        r["allocs_per_op"] = it.second.allocs_per_op;
+    }
+    auto measured = std::move(results);
+    results.clear();
+
+    if(!write_file(YETI_BENCH_RESULTS, arg2json(current)))
+        ADD_FAILURE() << "failed to write " << YETI_BENCH_RESULTS;
+
+    if(env_flag("YETI_BENCH_SAVE_BASELINE")) {
+        if(!write_file(YETI_BENCH_BASELINE, arg2json(current)))
+            ADD_FAILURE() << "failed to write " << YETI_BENCH_BASELINE;
+        else
+            RecordProperty("baseline_saved", YETI_BENCH_BASELINE);
+        return;
+    }
+
+    string data;
+    AmArg baseline;
+    if(!read_file(YETI_BENCH_BASELINE, data) ||
+       !json2arg(data, baseline) || !isArgStruct(baseline))
+    {
+        //record it with 'make bench-baseline'
+        RecordProperty("baseline_missing", YETI_BENCH_BASELINE);
+        return;
+    }
+
+    double threshold = YETI_BENCH_DEFAULT_THRESHOLD;
+    if(const char *v = getenv("YETI_BENCH_THRESHOLD"))
+        threshold = atof(v);
+    bool strict = env_flag("YETI_BENCH_STRICT");
+
+    RecordProperty("baseline", YETI_BENCH_BASELINE);
+    RecordProperty("threshold_pct", std::to_string(threshold));
+    for(const auto &it : measured) {
+        const string &name = it.first;
+        if(!baseline.hasMember(name)) {
+            RecordProperty(name + "_baseline", "missing");
+            continue;
+        }
+
+        double ns = it.second.ns_per_op,
+               allocs = it.second.allocs_per_op,
+               base_ns = arg2double(baseline[name]["ns_per_op"]),
+               base_allocs = arg2double(baseline[name]["allocs_per_op"]);
+
+        double ns_diff = base_ns > 0 ? (ns - base_ns) * 100 / base_ns : 0;
+        //fractional allocations come from the background threads
+        bool regression = ns_diff > threshold ||
+            allocs > base_allocs * (1 + threshold / 100) + 0.5;
+
+        RecordProperty(name + "_ns_diff_pct", std::to_string(ns_diff));
+        RecordProperty(name + "_baseline_allocs_per_op", std::to_string(base_allocs));
+        RecordProperty(name + "_regression", regression ? "true" : "false");
+
+        if(regression && strict)
+            ADD_FAILURE() << name << " regressed: " << ns << " ns/op, "
+                          << allocs << " allocs/op against the baseline "
+                          << base_ns << " ns/op, " << base_allocs << " allocs/op";
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "YetiTest.h"
+
+#include "AmArg.h"
+#include "AmSipMsg.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+#define YETI_BENCH_FIXTURES_DIR "unit_tests/bench/"
+#define YETI_BENCH_BASELINE YETI_BENCH_FIXTURES_DIR "baseline.json"
+#define YETI_BENCH_RESULTS "build/unit_tests/bench_results.json"
+#define YETI_BENCH_DEFAULT_THRESHOLD 10
+
+/* operator new calls of all the threads between start and stop */
+void bench_allocations_start();
+size_t bench_allocations_stop();
+
+/* microbenchmarks of the hot paths on the recorded fixtures from unit_tests/bench/
+ * run: ./run_unit_test.sh 'YetiBench.*' or make bench
+ *
+ * measure() reports ns/op and allocations/op. results of the suite are saved to
+ * YETI_BENCH_RESULTS and compared with YETI_BENCH_BASELINE if it exists.
+ * environment:
+ *   YETI_BENCH_SAVE_BASELINE=1  save results as the new baseline (make bench-baseline)
+ *   YETI_BENCH_THRESHOLD=<pct>  allowed ns/op and allocs/op growth. YETI_BENCH_DEFAULT_THRESHOLD by default
+ *   YETI_BENCH_STRICT=1         fail the suite on regressions instead of the warnings */
+class YetiBench : public YetiTest
+{
+    struct result {
+        double ns_per_op;
+        double allocs_per_op;
+    };
+    static std::map<string, result> results;
+
+    static void record(const string &name, unsigned long ops, double ns, size_t allocations);
+
+  protected:
+    //warms up with the tenth of ops before the measured loop
+    template<typename F>
+    void measure(const string &name, unsigned long ops, F f)
+    {
+        for(unsigned long i = 0; i < std::max(1ul, ops / 10); i++) f();
+
+        bench_allocations_start();
+        auto start = std::chrono::steady_clock::now();
+        for(unsigned long i = 0; i < ops; i++) f();
+        auto ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count();
+        record(name, ops, ns, bench_allocations_stop());
+    }
+
+    static string fixture(const string &name);
+    static AmArg fixtureJson(const string &name);
+    /* fills the request fields and hdrs as the SIP parser does
+     * for the recorded message. returns the body */
+    static string fixtureRequest(const string &name, AmSipRequest &req);
+
+  public:
+    static void TearDownTestSuite();
+};
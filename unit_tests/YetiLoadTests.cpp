@@ -0,0 +1,370 @@
+#include "YetiBench.h"
+#include "LoadGenerator.h"
+#include "LoadTestPostgres.h"
+#include "../src/yeti.h"
+#include "../src/CodecsGroup.h"
+#include "../src/CallSetupTrace.h"
+#include "../src/stats/StatsRegistry.h"
+
+#include "jsonArg.h"
+
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+/* end-to-end calls per second capacity of the node without external services.
+ *
+ * synthetic INVITEs come to the signalling interface over the loopback,
+ * getprofile is answered by LoadTestPostgres with the recorded row,
+ * redis is served by RedisTestServer and B-legs are answered by the
+ * UAS part of LoadGenerator.
+ *
+ * run: ./run_unit_test.sh 'YetiLoad.*' or make load
+ * environment:
+ *   YETI_LOAD_CPS=50,100,200         offered rate steps
+ *   YETI_LOAD_STEP_SEC=10            calls generation time of the step
+ *   YETI_LOAD_HOLD_MSEC=2000         answered calls duration
+ *   YETI_LOAD_MAX_LATENCY_MSEC=500   allowed INVITE to 200 OK p99 of the sustained step
+ *   YETI_LOAD_MIN_CPS=<cps>          fail if the achievable rate is lower
+ *   YETI_LOAD_RESOURCES=<resources>  resources of the profile. none by default
+ *
+ * the step is sustained when at least 99% of the calls are answered within the latency.
+ * report is recorded to the test properties and saved to YETI_LOAD_REPORT */
+
+#define YETI_LOAD_REPORT "build/unit_tests/load_report.json"
+#define YETI_LOAD_MIN_ANSWERED 0.99
+
+class YetiLoad : public YetiBench
+{
+    //codecs groups of the node replaced by load_codecs()
+    map<unsigned int,std::shared_ptr<CodecsGroupEntry>> saved_codec_groups;
+    bool codecs_loaded = false;
+    //ip auth of the node replaced by allow_local_calls()
+    AmArg saved_ip_auth;
+    bool ip_auth_replaced = false;
+
+  protected:
+    void TearDown() override
+    {
+        if(codecs_loaded) {
+            CodecsGroups::instance()->swap(saved_codec_groups);
+            codecs_loaded = false;
+        }
+        if(ip_auth_replaced) {
+            Yeti::instance().orig_pre_auth.reloadLoadIPAuth(saved_ip_auth["entries"]);
+            ip_auth_replaced = false;
+        }
+        YetiBench::TearDown();
+    }
+
+    static unsigned int env_uint(const char *name, unsigned int default_value)
+    {
+        const char *v = getenv(name);
+        return v && *v ? static_cast<unsigned int>(atoi(v)) : default_value;
+    }
+
+    static std::vector<unsigned int> env_steps()
+    {
+        std::vector<unsigned int> ret;
+        const char *v = getenv("YETI_LOAD_CPS");
+        std::istringstream s(v && *v ? v : "50,100,200");
+        string step;
+        while(std::getline(s, step, ','))
+            if(auto cps = atoi(step.data()); cps > 0) ret.push_back(cps);
+        return ret;
+    }
+
+    static std::vector<LatencyHistogram *> setup_histograms(std::vector<string> &names)
+    {
+        auto &registry = *StatsRegistry::instance();
+        std::vector<LatencyHistogram *> ret;
+
+        names.emplace_back("router_getprofile_latency");
+        for(int i = 0; i < CallSetupTrace::MaxStage; i++)
+            names.emplace_back(string("call_setup_") +
+                CallSetupTrace::getStageName(static_cast<CallSetupTrace::Stage>(i)));
+        names.emplace_back("call_setup_total");
+
+        for(const auto &name : names)
+            ret.push_back(&registry.histogram(name));
+        return ret;
+    }
+
+    static AmArg profile_rows(unsigned short uas_port)
+    {
+        string uas = "127.0.0.1:" + std::to_string(uas_port);
+        AmArg row = fixtureJson("getprofile_row.json");
+
+        row["ruri"] = "sip:$rU@" + uas;
+        row["from"] = "<sip:$fU@127.0.0.1>";
+        row["to"] = "<sip:$rU@" + uas + ">";
+        row["next_hop"] = uas;
+        const char *resources = getenv("YETI_LOAD_RESOURCES");
+        row["resources"] = resources ? resources : "";
+        AmArg no_acl;
+        no_acl.assertArray();
+        row["aleg_rtp_acl"] = no_acl;
+        row["bleg_rtp_acl"] = no_acl;
+
+        AmArg rows;
+        rows.push(row);
+        return rows;
+    }
+
+    void load_codecs(AmArg &row)
+    {
+        AmArg codecs;
+        for(auto group : { row["aleg_codecs_group_id"].asInt(), row["bleg_codecs_group_id"].asInt() }) {
+            for(auto name : { "PCMA/8000", "PCMU/8000", "telephone-event/8000" }) {
+                AmArg c;
+                c["o_codec_group_id"] = group;
+                c["o_codec_name"] = name;
+                c["o_dynamic_payload_id"] = NO_DYN_PAYLOAD;
+                c["o_format_params"] = "";
+                codecs.push(c);
+            }
+        }
+        if(!codecs_loaded) {
+            CodecsGroups::instance()->swap(saved_codec_groups);
+            codecs_loaded = true;
+        }
+        CodecsGroups::instance()->load_codecs(codecs);
+    }
+
+    //accept the generated calls without the digest auth
+    void allow_local_calls()
+    {
+        auto &yeti = Yeti::instance();
+        AmArg filter, local_auth, a;
+
+        if(!ip_auth_replaced) {
+            filter.assertArray();
+            yeti.orig_pre_auth.ShowIPAuth(filter, saved_ip_auth);
+            ip_auth_replaced = true;
+        }
+
+        a["ip"] = "127.0.0.1/32";
+        a["x_yeti_auth"] = "";
+        a["require_incoming_auth"] = false;
+        a["require_identity_parsing"] = false;
+        a["cps_limit"] = 0;
+        local_auth.push(a);
+        yeti.orig_pre_auth.reloadLoadIPAuth(local_auth);
+    }
+};
+
+TEST_F(YetiLoad, CallsPerSecond)
+{
+    LoadGenerator::config cfg;
+    cfg.duration_sec = env_uint("YETI_LOAD_STEP_SEC", cfg.duration_sec);
+    cfg.hold_msec = env_uint("YETI_LOAD_HOLD_MSEC", cfg.hold_msec);
+    uint64_t max_latency_us = env_uint("YETI_LOAD_MAX_LATENCY_MSEC", 500) * 1000;
+
+    auto steps = env_steps();
+    ASSERT_FALSE(steps.empty());
+
+    auto gen = std::make_unique<LoadGenerator>(cfg);
+    ASSERT_TRUE(gen->init());
+
+    AmArg rows = profile_rows(gen->getUasPort());
+    load_codecs(rows[0]);
+    allow_local_calls();
+
+    std::vector<string> stage_names;
+    auto stages = setup_histograms(stage_names);
+
+    AmArg report;
+    double achievable_cps = 0;
+    {
+        LoadTestPostgres pg(rows);
+
+        for(auto cps : steps) {
+            for(auto h : stages) h->reset();
+            auto getprofile_requests = pg.getProfileRequests();
+            auto dropped_writes = pg.getDroppedWrites();
+
+            LoadGenerator::report r;
+            if(!gen->run(cps, r)) {
+                ADD_FAILURE() << "failed to run the " << cps << " cps step";
+                break;
+            }
+
+            bool sustained = r.answeredRate() >= YETI_LOAD_MIN_ANSWERED &&
+                             r.answer.percentile(0.99) <= max_latency_us;
+
+            report["steps"].push(AmArg());
+            AmArg &step = report["steps"].back();
+            r.getInfo(step);
+            step["sustained"] = sustained;
+            step["getprofile_requests"] =
+                static_cast<long long>(pg.getProfileRequests() - getprofile_requests);
+            step["dropped_writes"] =
+                static_cast<long long>(pg.getDroppedWrites() - dropped_writes);
+
+            auto prefix = "cps_" + std::to_string(cps) + "_";
+            RecordProperty(prefix + "achieved", std::to_string(r.achievedCps()));
+            RecordProperty(prefix + "attempts", std::to_string(r.attempts));
+            RecordProperty(prefix + "answered", std::to_string(r.answered));
+            RecordProperty(prefix + "failed", std::to_string(r.failed));
+            RecordProperty(prefix + "timeouts", std::to_string(r.timeouts));
+            RecordProperty(prefix + "sustained", sustained ? "true" : "false");
+            RecordProperty(prefix + "first_reply_p50_us", std::to_string(r.first_reply.percentile(0.5)));
+            RecordProperty(prefix + "first_reply_p99_us", std::to_string(r.first_reply.percentile(0.99)));
+            RecordProperty(prefix + "answer_p50_us", std::to_string(r.answer.percentile(0.5)));
+            RecordProperty(prefix + "answer_p99_us", std::to_string(r.answer.percentile(0.99)));
+            RecordProperty(prefix + "peak_calls", std::to_string(r.peak_calls));
+            RecordProperty(prefix + "heap_per_call", std::to_string(r.heap_per_call));
+            RecordProperty(prefix + "rss_per_call", std::to_string(r.rss_per_call));
+
+            AmArg &stages_info = step["stages"];
+            for(size_t i = 0; i < stages.size(); i++) {
+                auto s = stages[i]->snapshot();
+                if(!s.count) continue;
+                stages[i]->getStats(stages_info[stage_names[i]]);
+                RecordProperty(prefix + stage_names[i] + "_p50_us", std::to_string(s.percentile(0.5)));
+                RecordProperty(prefix + stage_names[i] + "_p99_us", std::to_string(s.percentile(0.99)));
+            }
+
+            if(!sustained) break;
+            achievable_cps = std::max(achievable_cps, r.achievedCps());
+
+            //let the finished sessions go away before the next step
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+
+    report["achievable_cps"] = achievable_cps;
+    RecordProperty("achievable_cps", std::to_string(achievable_cps));
+
+    std::ofstream f(YETI_LOAD_REPORT, std::ios::trunc);
+    f << arg2json(report) << std::endl;
+    if(!f.good()) ADD_FAILURE() << "failed to write " << YETI_LOAD_REPORT;
+
+    ASSERT_GT(achievable_cps, 0) << "the first step " << steps.front() << " cps is not sustained";
+    if(auto min_cps = env_uint("YETI_LOAD_MIN_CPS", 0))
+        ASSERT_GE(achievable_cps, min_cps);
+}
+
+static long peak_rss_kb()
+{
+    std::ifstream f("/proc/self/status");
+    string line;
+    while(std::getline(f, line)) {
+        if(line.compare(0, 6, "VmHWM:") == 0)
+            return std::stol(line.substr(6));
+    }
+    return -1;
+}
+
+static void reset_peak_rss()
+{
+    std::ofstream f("/proc/self/clear_refs");
+    f << "5";
+}
+
+/* peak RSS and time-to-first-byte of the full active calls reply
+ * compared to the pages of 'show calls page' (CdrList::getCallsPage)
+ * on the calls established by the generator and held during the measurement.
+ *
+ * run: ./run_unit_test.sh 'YetiLoad.DISABLED_CallsPageBenchmark'
+ * environment:
+ *   YETI_LOAD_PAGE_CALLS=2000   established calls
+ *   YETI_LOAD_PAGE_CPS=200      calls generation rate */
+TEST_F(YetiLoad, DISABLED_CallsPageBenchmark)
+{
+    static const size_t page_limit = 100;
+    auto &yeti = Yeti::instance();
+
+    auto calls_count = env_uint("YETI_LOAD_PAGE_CALLS", 2000);
+    auto cps = env_uint("YETI_LOAD_PAGE_CPS", 200);
+    ASSERT_GT(cps, 0u);
+
+    LoadGenerator::config cfg;
+    cfg.duration_sec = std::max(1u, calls_count / cps);
+    //hold the calls until the measurements are done
+    cfg.hold_msec = (cfg.duration_sec + 30) * 1000;
+
+    auto gen = std::make_unique<LoadGenerator>(cfg);
+    ASSERT_TRUE(gen->init());
+
+    AmArg rows = profile_rows(gen->getUasPort());
+    load_codecs(rows[0]);
+    allow_local_calls();
+
+    LoadTestPostgres pg(rows);
+
+    LoadGenerator::report r;
+    bool generated = false;
+    std::thread generator([&]() { generated = gen->run(cps, r); });
+
+    //wait for the calls to be established
+    long int established = 0;
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::seconds(cfg.duration_sec + 10);
+    while(std::chrono::steady_clock::now() < deadline) {
+        established = yeti.cdr_list.getCallsCount();
+        if(established >= calls_count * YETI_LOAD_MIN_ANSWERED) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    AmArg no_params;
+    no_params.assertArray();
+
+    //paginated: select page, serialize and encode page calls only
+    reset_peak_rss();
+    auto rss_before = peak_rss_kb();
+    auto start = std::chrono::steady_clock::now();
+    string cursor;
+    size_t pages = 0, page_calls = 0, total_bytes = 0;
+    std::chrono::steady_clock::duration page_ttfb{};
+    while(true) {
+        AmArg ret;
+        yeti.cdr_list.getCallsPage(ret, &yeti.router, cursor, page_limit, no_params);
+        page_calls += ret["calls"].size();
+        total_bytes += arg2json(ret).size();
+
+        if(!pages++) page_ttfb = std::chrono::steady_clock::now() - start;
+        if(!ret.hasMember("next_cursor")) break;
+        cursor = ret["next_cursor"].asCStr();
+    }
+    auto page_all = std::chrono::steady_clock::now() - start;
+    auto page_rss = peak_rss_kb() - rss_before;
+
+    //full: serialize all calls, then encode the whole reply
+    reset_peak_rss();
+    rss_before = peak_rss_kb();
+    start = std::chrono::steady_clock::now();
+    size_t full_calls, full_bytes;
+    {
+        AmArg ret;
+        yeti.cdr_list.getCallsPage(ret, &yeti.router, string(),
+                                   std::numeric_limits<size_t>::max(), no_params);
+        full_calls = ret["calls"].size();
+        full_bytes = arg2json(ret).size();
+    }
+    auto full_ttfb = std::chrono::steady_clock::now() - start;
+    auto full_rss = peak_rss_kb() - rss_before;
+
+    generator.join();
+
+    auto ms = [](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+
+    RecordProperty("established_calls", std::to_string(established));
+    RecordProperty("full_calls", std::to_string(full_calls));
+    RecordProperty("full_bytes", std::to_string(full_bytes));
+    RecordProperty("full_ttfb_ms", std::to_string(ms(full_ttfb)));
+    RecordProperty("full_peak_rss_kb", std::to_string(full_rss));
+    RecordProperty("page_limit", std::to_string(page_limit));
+    RecordProperty("pages", std::to_string(pages));
+    RecordProperty("page_calls", std::to_string(page_calls));
+    RecordProperty("page_bytes", std::to_string(total_bytes));
+    RecordProperty("first_page_ttfb_ms", std::to_string(ms(page_ttfb)));
+    RecordProperty("all_pages_ms", std::to_string(ms(page_all)));
+    RecordProperty("page_peak_rss_kb", std::to_string(page_rss));
+
+    ASSERT_TRUE(generated);
+    ASSERT_GT(full_calls, 0u) << "no calls were established";
+}